@@ -0,0 +1,411 @@
+/*
+ * aggregateipflowsmp.{cc,hh} -- set aggregate annotation based on TCP/UDP
+ * flow, with per-thread flow tables
+ *
+ * Based on AggregateIPFlows by Eddie Kohler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "aggregateipflowsmp.hh"
+#include <click/error.hh>
+#include <click/straccum.hh>
+#include <click/args.hh>
+#include <clicknet/ip.h>
+#include <clicknet/tcp.h>
+#include <clicknet/udp.h>
+#include <clicknet/icmp.h>
+#include <click/packet_anno.hh>
+CLICK_DECLS
+
+#define SEC_OLDER(s1, s2)	((int)(s1 - s2) < 0)
+
+static inline bool
+ports_reverse_order(uint32_t ports)
+{
+    return (int32_t) ((ports << 16) - ports) < 0;
+}
+
+static inline uint32_t
+flip_ports(uint32_t ports)
+{
+    return ((ports >> 16) & 0xFFFF) | (ports << 16);
+}
+
+AggregateIPFlowsMP::AggregateIPFlowsMP()
+{
+}
+
+AggregateIPFlowsMP::~AggregateIPFlowsMP()
+{
+}
+
+void *
+AggregateIPFlowsMP::cast(const char *n)
+{
+    if (strcmp(n, "AggregateNotifier") == 0)
+	return (AggregateNotifier *)this;
+    else if (strcmp(n, "AggregateIPFlowsMP") == 0)
+	return (Element *)this;
+    else
+	return Element::cast(n);
+}
+
+int
+AggregateIPFlowsMP::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    _tcp_timeout = 24 * 60 * 60;
+    _tcp_done_timeout = 30;
+    _udp_timeout = 60;
+    _wheel_size = 4096;
+
+    if (Args(conf, this, errh)
+	.read("TCP_TIMEOUT", SecondsArg(), _tcp_timeout)
+	.read("TCP_DONE_TIMEOUT", SecondsArg(), _tcp_done_timeout)
+	.read("UDP_TIMEOUT", SecondsArg(), _udp_timeout)
+	.read("WHEEL_SIZE", _wheel_size)
+	.read_or_set("ICMP", _handle_icmp_errors, false)
+	.read_or_set("SYMETRIC", _symetric, true)
+	.complete() < 0)
+	return -1;
+
+    if (_wheel_size < 2)
+	return errh->error("WHEEL_SIZE must be at least 2");
+
+    _smallest_timeout = (_tcp_timeout < _tcp_done_timeout ? _tcp_timeout : _tcp_done_timeout);
+    _smallest_timeout = (_smallest_timeout < _udp_timeout ? _smallest_timeout : _udp_timeout);
+    return 0;
+}
+
+int
+AggregateIPFlowsMP::initialize(ErrorHandler *)
+{
+    _timestamp_warning = false;
+
+    // Give each thread its own range of aggregate numbers, so flows stay
+    // globally unique without any synchronization. Every thread gets one,
+    // not only those get_passing_threads() expects: packets may come from
+    // threads the thread analysis did not see.
+    unsigned n = _state.weight();
+    uint32_t range = 0xFFFFFFFFU / n;
+    for (unsigned i = 0; i < n; i++) {
+	State &s = _state.get_value(i);
+	s.first = i * range + 1;
+	s.last = (i + 1) * range;
+	s.next = s.first;
+	s.wheel.initialize(_wheel_size);
+    }
+    return 0;
+}
+
+void
+AggregateIPFlowsMP::clear_state(State &s)
+{
+    for (Map::iterator it = s.map.begin(); it.live(); it++) {
+	notify(it.value()->aggregate(), AggregateListener::DELETE_AGG, 0);
+	s.expired++;
+	delete it.value();
+    }
+    s.map.clear();
+    // Flows are gone, just drop the stale wheel references
+    s.wheel.clear();
+    s.wheel_sec = 0;
+}
+
+void
+AggregateIPFlowsMP::cleanup(CleanupStage)
+{
+    for (unsigned i = 0; i < _state.weight(); i++)
+	clear_state(_state.get_value(i));
+}
+
+inline uint32_t
+AggregateIPFlowsMP::relevant_timeout(const FlowInfo *f) const
+{
+    if (f->_key.proto == IP_PROTO_UDP)
+	return _udp_timeout;
+    else if (f->_flow_over == 3)
+	return _tcp_done_timeout;
+    else
+	return _tcp_timeout;
+}
+
+inline uint32_t
+AggregateIPFlowsMP::next_aggregate(State &s)
+{
+    uint32_t agg = s.next;
+    s.next = (agg == s.last ? s.first : agg + 1);
+    s.created++;
+    return agg;
+}
+
+inline void
+AggregateIPFlowsMP::schedule(State &s, FlowInfo *f, uint32_t delay)
+{
+    // Longer delays cascade through the wheel
+    if (delay >= _wheel_size)
+	delay = _wheel_size - 1;
+    else if (delay == 0)
+	delay = 1;
+    s.wheel.schedule_after(f, delay, [](FlowInfo *prev, FlowInfo *next) {
+	    prev->_wheel_next = next;
+	});
+}
+
+AggregateIPFlowsMP::FlowInfo *
+AggregateIPFlowsMP::expire(State &s, FlowInfo *f)
+{
+    FlowInfo *next = f->_wheel_next;
+    uint32_t age = s.active_sec - f->_last_sec;
+    uint32_t timeout = relevant_timeout(f);
+    if (SEC_OLDER(f->_last_sec, s.active_sec) && age >= timeout) {
+	notify(f->aggregate(), AggregateListener::DELETE_AGG, 0);
+	s.map.erase(f->_key);
+	s.expired++;
+	delete f;
+    } else
+	schedule(s, f, SEC_OLDER(f->_last_sec, s.active_sec) ? timeout - age : timeout);
+    return next;
+}
+
+void
+AggregateIPFlowsMP::advance_wheel(State &s, uint32_t now)
+{
+    if (unlikely(s.wheel_sec == 0)) {
+	s.wheel_sec = now;
+	return;
+    }
+    if (!SEC_OLDER(s.wheel_sec, now))
+	return;
+    uint32_t ticks = now - s.wheel_sec;
+    if (ticks > _wheel_size)
+	ticks = _wheel_size;
+    s.wheel_sec = now;
+    while (ticks--)
+	s.wheel.run_timers([this,&s](FlowInfo *f) -> FlowInfo * {
+		return expire(s, f);
+	    });
+}
+
+const click_ip *
+AggregateIPFlowsMP::icmp_encapsulated_header(const Packet *p)
+{
+    const click_icmp *icmph = p->icmp_header();
+    if (p->has_transport_header()
+	&& (icmph->icmp_type == ICMP_UNREACH
+	    || icmph->icmp_type == ICMP_TIMXCEED
+	    || icmph->icmp_type == ICMP_PARAMPROB
+	    || icmph->icmp_type == ICMP_SOURCEQUENCH
+	    || icmph->icmp_type == ICMP_REDIRECT)) {
+	const click_ip *embedded_iph = reinterpret_cast<const click_ip *>(icmph + 1);
+	unsigned embedded_hlen = embedded_iph->ip_hl << 2;
+	if ((unsigned)p->transport_length() >= sizeof(click_icmp) + embedded_hlen
+	    && embedded_hlen >= sizeof(click_ip))
+	    return embedded_iph;
+    }
+    return 0;
+}
+
+inline AggregateIPFlowsMP::FlowInfo *
+AggregateIPFlowsMP::find_flow_info(State &s, const FlowKey &key, bool flipped, const Packet *p)
+{
+    Map::iterator it = s.map.find_insert(key);
+    FlowInfo *finfo = it.value();
+    if (finfo) {
+	// if this flow is actually dead (but the wheel did not reach it yet),
+	// then renumber it for consistent semantics; same if a closed TCP
+	// flow is reopened with a SYN
+	uint32_t age = s.active_sec - finfo->_last_sec;
+	if ((SEC_OLDER(finfo->_last_sec, s.active_sec)
+	     && age > _smallest_timeout && age > relevant_timeout(finfo))
+	    || (finfo->_flow_over == 3
+		&& p->ip_header()->ip_p == IP_PROTO_TCP
+		&& (p->tcp_header()->th_flags & TH_SYN))) {
+	    notify(finfo->aggregate(), AggregateListener::DELETE_AGG, 0);
+	    s.expired++;
+	    finfo->_aggregate = next_aggregate(s);
+	    finfo->_reverse = flipped;
+	    finfo->_flow_over = 0;
+	    notify(finfo->aggregate(), AggregateListener::NEW_AGG, p);
+	}
+	return finfo;
+    }
+
+    finfo = new FlowInfo(key, next_aggregate(s), flipped);
+    finfo->_last_sec = s.active_sec;
+    it.value() = finfo;
+    schedule(s, finfo, relevant_timeout(finfo));
+    notify(finfo->aggregate(), AggregateListener::NEW_AGG, p);
+    return finfo;
+}
+
+inline void
+AggregateIPFlowsMP::packet_emit_hook(const Packet *p, const click_ip *iph, FlowInfo *finfo)
+{
+    finfo->_last_sec = p->timestamp_anno().sec();
+
+    // check whether this indicates the flow is over
+    if (iph->ip_p == IP_PROTO_TCP
+	&& p->transport_length() >= 14
+	&& PAINT_ANNO(p) < 2) {	// ignore ICMP errors
+	if (p->tcp_header()->th_flags & TH_RST)
+	    finfo->_flow_over = 3;
+	else if (p->tcp_header()->th_flags & TH_FIN)
+	    finfo->_flow_over |= (1 << PAINT_ANNO(p));
+	else if (p->tcp_header()->th_flags & TH_SYN)
+	    finfo->_flow_over = 0;
+    }
+}
+
+inline int
+AggregateIPFlowsMP::handle_packet(State &s, Packet *p)
+{
+    const click_ip *iph = p->ip_header();
+    int paint = 0;
+
+    // assign timestamp if no timestamp given
+    if (!p->timestamp_anno()) {
+	if (!_timestamp_warning) {
+	    click_chatter("%p{element}: warning: packet received without timestamp", this);
+	    _timestamp_warning = true;
+	}
+	p->timestamp_anno().assign_now();
+    }
+
+    // extract encapsulated ICMP header if appropriate
+    if (p->has_network_header() && iph->ip_p == IP_PROTO_ICMP
+	&& IP_FIRSTFRAG(iph) && _handle_icmp_errors) {
+	iph = icmp_encapsulated_header(p);
+	paint = 2;
+    }
+
+    // return if not a proper, first-fragment TCP/UDP packet
+    if (!p->has_network_header() || !iph
+	|| (iph->ip_p != IP_PROTO_TCP && iph->ip_p != IP_PROTO_UDP)
+	|| (iph->ip_src.s_addr == 0 && iph->ip_dst.s_addr == 0)
+	|| !IP_FIRSTFRAG(iph))
+	return ACT_DROP;
+
+    const uint8_t *udp_ptr = reinterpret_cast<const uint8_t *>(iph) + (iph->ip_hl << 2);
+    if (udp_ptr + 4 > p->end_data())
+	return ACT_DROP;
+
+    uint32_t src = iph->ip_src.s_addr;
+    uint32_t dst = iph->ip_dst.s_addr;
+    uint32_t ports = *reinterpret_cast<const uint32_t *>(udp_ptr);
+    if (_symetric
+	&& (src > dst || (src == dst && ports_reverse_order(ports)))) {
+	uint32_t tmp = src;
+	src = dst;
+	dst = tmp;
+	ports = flip_ports(ports);
+	paint ^= 1;
+    }
+
+    uint32_t now = p->timestamp_anno().sec();
+    if (SEC_OLDER(s.active_sec, now) || s.active_sec == 0) {
+	s.active_sec = now;
+	advance_wheel(s, now);
+    }
+
+    FlowInfo *finfo = find_flow_info(s, FlowKey(src, dst, ports, iph->ip_p), paint & 1, p);
+    if (finfo->reverse())
+	paint ^= 1;
+
+    SET_AGGREGATE_ANNO(p, finfo->aggregate());
+    SET_PAINT_ANNO(p, paint);
+    packet_emit_hook(p, iph, finfo);
+    return ACT_EMIT;
+}
+
+void
+AggregateIPFlowsMP::push(int, Packet *p)
+{
+    if (handle_packet(*_state, p) == ACT_EMIT)
+	output(0).push(p);
+    else
+	checked_output_push(1, p);
+}
+
+#if HAVE_BATCH
+void
+AggregateIPFlowsMP::push_batch(int, PacketBatch *batch)
+{
+    State &s = *_state;
+    auto fnt = [this,&s](Packet *p) -> int { return handle_packet(s, p); };
+    CLASSIFY_EACH_PACKET(2, fnt, batch, [this](int port, PacketBatch *batch) {
+	    checked_output_push_batch(port, batch);
+	});
+}
+#endif
+
+enum { H_COUNT, H_CREATED, H_EXPIRED, H_THREAD_COUNT, H_CLEAR };
+
+String
+AggregateIPFlowsMP::read_handler(Element *e, void *thunk)
+{
+    AggregateIPFlowsMP *af = static_cast<AggregateIPFlowsMP *>(e);
+    switch ((intptr_t)thunk) {
+      case H_COUNT: {
+	  uint64_t count = 0;
+	  for (unsigned i = 0; i < af->_state.weight(); i++)
+	      count += af->_state.get_value(i).map.size();
+	  return String(count);
+      }
+      case H_CREATED: {
+	  PER_THREAD_MEMBER_SUM(uint64_t, created, af->_state, created);
+	  return String(created);
+      }
+      case H_EXPIRED: {
+	  PER_THREAD_MEMBER_SUM(uint64_t, expired, af->_state, expired);
+	  return String(expired);
+      }
+      case H_THREAD_COUNT: {
+	  StringAccum sa;
+	  for (unsigned i = 0; i < af->_state.weight(); i++)
+	      if (af->_state.get_value(i).last)
+		  sa << i << ' ' << af->_state.get_value(i).map.size() << '\n';
+	  return sa.take_string();
+      }
+      default:
+	return "<error>";
+    }
+}
+
+int
+AggregateIPFlowsMP::write_handler(const String &, Element *e, void *thunk, ErrorHandler *)
+{
+    AggregateIPFlowsMP *af = static_cast<AggregateIPFlowsMP *>(e);
+    switch ((intptr_t)thunk) {
+      case H_CLEAR:
+	for (unsigned i = 0; i < af->_state.weight(); i++)
+	    af->clear_state(af->_state.get_value(i));
+	return 0;
+      default:
+	return -1;
+    }
+}
+
+void
+AggregateIPFlowsMP::add_handlers()
+{
+    add_read_handler("count", read_handler, H_COUNT);
+    add_read_handler("created", read_handler, H_CREATED);
+    add_read_handler("expired", read_handler, H_EXPIRED);
+    add_read_handler("thread_count", read_handler, H_THREAD_COUNT);
+    add_write_handler("clear", write_handler, H_CLEAR);
+}
+
+ELEMENT_REQUIRES(userlevel AggregateNotifier)
+EXPORT_ELEMENT(AggregateIPFlowsMP)
+ELEMENT_MT_SAFE(AggregateIPFlowsMP)
+CLICK_ENDDECLS
@@ -0,0 +1,223 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_AGGREGATEIPFLOWSMP_HH
+#define CLICK_AGGREGATEIPFLOWSMP_HH
+#include <click/batchelement.hh>
+#include <click/hashtable.hh>
+#include <click/multithread.hh>
+#include <click/timerwheel.hh>
+#include "aggregatenotifier.hh"
+CLICK_DECLS
+
+/*
+=c
+
+AggregateIPFlowsMP([I<KEYWORDS>])
+
+=s ipmeasure
+
+sets aggregate annotation based on flow, thread-safe version
+
+=d
+
+AggregateIPFlowsMP is a multi-core, batch-native variant of AggregateIPFlows.
+It monitors TCP and UDP flows, setting the aggregate annotation on every
+passing packet to a flow number, and the paint annotation to a direction
+indication. Non-TCP/UDP packets, short packets and non-first fragments are
+emitted on output 1, or dropped if there is no output 1.
+
+Every thread traversing the element owns a private flow table, so no lock is
+taken on the data path. This is meant to be used behind a NIC doing RSS (or
+any other flow-consistent dispatching), so that both directions of a flow
+are handled by the same thread. If a flow is seen by several threads, each
+of them will give it a different aggregate number.
+
+Flow numbers stay globally unique: the 32-bit aggregate space is split in one
+range per Click thread, whether or not it is expected to traverse the element
+(the first thread starts at 1, as AggregateIPFlows does).
+Numbers are assigned sequentially inside each range, and wrap around within
+the range.
+
+Flows are expired by a per-thread timing wheel driven by packet time, instead
+of the periodic full-table reap of AggregateIPFlows. A flow is only touched by
+the wheel when its deadline comes, and is rescheduled if it saw packets in
+the meantime. Long timeouts are handled by cascading through the wheel.
+
+Unlike AggregateIPFlows, AggregateIPFlowsMP does not hold fragments back to
+find their port numbers; non-first fragments are always emitted on port 1.
+
+Keywords are:
+
+=over 8
+
+=item TCP_TIMEOUT
+
+The timeout for active TCP flows, in seconds. Default is 24 hours.
+
+=item TCP_DONE_TIMEOUT
+
+The timeout for completed TCP flows, in seconds. A completed TCP flow has seen
+FIN flags on both subflows. Default is 30 seconds.
+
+=item UDP_TIMEOUT
+
+The timeout for UDP connections, in seconds. Default is 1 minute.
+
+=item WHEEL_SIZE
+
+Integer. Number of one-second slots of the per-thread timing wheel. Timeouts
+longer than this cascade through the wheel. Default is 4096.
+
+=item ICMP
+
+Boolean. If true, then mark ICMP errors relating to a connection with an
+aggregate annotation corresponding to that connection. ICMP error packets get
+paint annotations equal to 2 plus the paint color of the encapsulated packet.
+Default is false.
+
+=item SYMETRIC
+
+Boolean. If true, reverse connections are considered the same connection.
+Default is true.
+
+=back
+
+AggregateIPFlowsMP is an AggregateNotifier. Listeners are called from the
+thread that created or expired the aggregate, so they must themselves be
+thread-safe if the element is traversed by more than one thread.
+
+=h count read-only
+
+Returns the number of active flows, summed over all threads.
+
+=h created read-only
+
+Returns the number of aggregates created since the start, summed over all
+threads.
+
+=h expired read-only
+
+Returns the number of aggregates expired since the start, summed over all
+threads.
+
+=h thread_count read-only
+
+Returns the number of active flows of each thread, one line per thread.
+
+=h clear write-only
+
+Expires all flows. Future packets will get new aggregate annotation values.
+Must not be called while packets are flowing.
+
+=e
+
+   FromDPDKDevice(0, MAXTHREADS 4)
+       -> Strip(14) -> CheckIPHeader
+       -> af :: AggregateIPFlowsMP
+       -> Discard;
+
+=a
+
+AggregateIPFlows, AggregateCounter */
+
+class AggregateIPFlowsMP : public BatchElement, public AggregateNotifier { public:
+
+    AggregateIPFlowsMP() CLICK_COLD;
+    ~AggregateIPFlowsMP() CLICK_COLD;
+
+    const char *class_name() const override	{ return "AggregateIPFlowsMP"; }
+    void *cast(const char *) override;
+    const char *port_count() const override	{ return PORTS_1_1X2; }
+    const char *processing() const override	{ return PUSH; }
+
+    int configure(Vector<String> &, ErrorHandler *) override CLICK_COLD;
+    int initialize(ErrorHandler *) override CLICK_COLD;
+    void add_handlers() override CLICK_COLD;
+    void cleanup(CleanupStage) override CLICK_COLD;
+
+    void push(int, Packet *) override;
+#if HAVE_BATCH
+    void push_batch(int, PacketBatch *) override;
+#endif
+
+    struct FlowKey {
+	uint32_t a;
+	uint32_t b;
+	uint32_t ports;
+	uint32_t proto;
+	FlowKey() : a(0), b(0), ports(0), proto(0) { }
+	FlowKey(uint32_t aa, uint32_t bb, uint32_t pp, uint8_t p)
+	    : a(aa), b(bb), ports(pp), proto(p) { }
+	inline hashcode_t hashcode() const {
+	    return (a << 12) + b + ((a >> 20) & 0x1F) + (ports * 0x9E3779B1U) + proto;
+	}
+	inline bool operator==(const FlowKey &o) const {
+	    return a == o.a && b == o.b && ports == o.ports && proto == o.proto;
+	}
+    };
+
+  private:
+
+    struct FlowInfo {
+	FlowKey _key;
+	uint32_t _aggregate;
+	uint32_t _last_sec;
+	unsigned _flow_over : 2;
+	bool _reverse : 1;
+	FlowInfo *_wheel_next;
+	FlowInfo(const FlowKey &key, uint32_t agg, bool reverse)
+	    : _key(key), _aggregate(agg), _flow_over(0), _reverse(reverse),
+	      _wheel_next(0) { }
+	uint32_t aggregate() const { return _aggregate; }
+	bool reverse() const	{ return _reverse; }
+    };
+
+    typedef HashTable<FlowKey, FlowInfo *> Map;
+
+    struct State {
+	Map map;
+	TimerWheel<FlowInfo> wheel;
+	uint32_t next;
+	uint32_t first;
+	uint32_t last;
+	uint32_t active_sec;
+	uint32_t wheel_sec;
+	uint64_t created;
+	uint64_t expired;
+	State() : next(0), first(0), last(0), active_sec(0), wheel_sec(0),
+		  created(0), expired(0) { }
+    };
+
+    per_thread<State> _state;
+
+    uint32_t _tcp_timeout;
+    uint32_t _tcp_done_timeout;
+    uint32_t _udp_timeout;
+    uint32_t _smallest_timeout;
+    uint32_t _wheel_size;
+
+    bool _handle_icmp_errors;
+    bool _symetric;
+    bool _timestamp_warning;
+
+    static const click_ip *icmp_encapsulated_header(const Packet *);
+
+    inline uint32_t relevant_timeout(const FlowInfo *) const;
+    inline uint32_t next_aggregate(State &);
+    inline void schedule(State &, FlowInfo *, uint32_t delay);
+    void advance_wheel(State &, uint32_t now);
+    FlowInfo *expire(State &, FlowInfo *);
+    void clear_state(State &);
+
+    inline FlowInfo *find_flow_info(State &, const FlowKey &, bool flipped, const Packet *);
+    inline void packet_emit_hook(const Packet *, const click_ip *, FlowInfo *);
+
+    enum { ACT_EMIT, ACT_DROP };
+    inline int handle_packet(State &, Packet *);
+
+    static String read_handler(Element *, void *) CLICK_COLD;
+    static int write_handler(const String &, Element *, void *, ErrorHandler *) CLICK_COLD;
+
+};
+
+CLICK_ENDDECLS
+#endif
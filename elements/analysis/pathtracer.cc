@@ -0,0 +1,188 @@
+// -*- c-basic-offset: 4 -*-
+/*
+ * pathtracer.{cc,hh} -- sampled per-packet path tracing
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "pathtracer.hh"
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#include <click/packet_anno.hh>
+CLICK_DECLS
+
+PathTracer::PathTracer()
+    : _sample(1000), _capacity(65536), _anno(-1),
+      _active(true), _initialized(false)
+{
+}
+
+PathTracer::~PathTracer()
+{
+}
+
+int
+PathTracer::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    if (Args(conf, this, errh)
+	.read_m("ANNO", AnnoArg(4), _anno)
+	.read("SAMPLE", _sample)
+	.read("CAPACITY", _capacity)
+	.read("ACTIVE", _active)
+	.complete() < 0)
+	return -1;
+    if (_sample == 0)
+	return errh->error("SAMPLE must be positive");
+    if (_capacity == 0)
+	return errh->error("CAPACITY must be positive");
+    return 0;
+}
+
+int
+PathTracer::initialize(ErrorHandler *errh)
+{
+    if (PathTrace::initialize(_capacity, _anno, errh) < 0)
+	return -1;
+    _initialized = true;
+    PathTrace::active = _active;
+    return 0;
+}
+
+void
+PathTracer::cleanup(CleanupStage)
+{
+    if (_initialized)
+	PathTrace::cleanup();
+    _initialized = false;
+}
+
+inline void
+PathTracer::mark(State &s, Packet *p)
+{
+    if (++s.count < _sample) {
+	p->set_anno_u32(_anno, 0);
+	return;
+    }
+    s.count = 0;
+    s.sampled++;
+    // The thread number in the high byte keeps IDs unique and non-zero
+    uint32_t id = (((uint32_t) click_current_cpu_id() & 0x7F) + 1) << 24
+	| (++s.seq & 0xFFFFFF);
+    p->set_anno_u32(_anno, id);
+    if (PathTrace::active)
+	PathTrace::record(this, 0, PathTrace::PUSH, id);
+}
+
+Packet *
+PathTracer::simple_action(Packet *p)
+{
+    mark(*_state, p);
+    return p;
+}
+
+#if HAVE_BATCH
+PacketBatch *
+PathTracer::simple_action_batch(PacketBatch *batch)
+{
+    State &s = *_state;
+    FOR_EACH_PACKET(batch, p)
+	mark(s, p);
+    return batch;
+}
+#endif
+
+String
+PathTracer::read_handler(Element *e, void *thunk)
+{
+    PathTracer *pt = static_cast<PathTracer *>(e);
+    StringAccum sa;
+    switch ((intptr_t) thunk) {
+    case h_records: {
+	Vector<PathTrace::Record> records;
+	PathTrace::collect(records);
+	for (int i = 0; i < records.size(); i++) {
+	    const PathTrace::Record &r = records[i];
+	    sa << r.id << ' ' << (int) r.thread << ' ' << r.cycles << ' '
+	       << r.element->name() << ' ' << r.port << ' '
+	       << (r.kind == PathTrace::PUSH ? "push" : "pull") << '\n';
+	}
+	return sa.take_string();
+    }
+    case h_paths: {
+	Vector<PathTrace::Record> records;
+	PathTrace::collect(records);
+	for (int i = 0; i < records.size(); ) {
+	    int j = i + 1;
+	    while (j < records.size() && records[j].id == records[i].id)
+		j++;
+	    sa << records[i].id << ' ' << (records[j - 1].cycles - records[i].cycles);
+	    for (int k = i; k < j; k++) {
+		sa << ' ' << records[k].element->name();
+		if (k > i) {
+		    sa << " +" << (records[k].cycles - records[k - 1].cycles);
+		    if (records[k].thread != records[k - 1].thread)
+			sa << " [" << (int) records[k].thread << ']';
+		}
+	    }
+	    sa << '\n';
+	    i = j;
+	}
+	return sa.take_string();
+    }
+    case h_sampled: {
+	PER_THREAD_MEMBER_SUM(uint64_t, sampled, pt->_state, sampled);
+	return String(sampled);
+    }
+    case h_written:
+	return String(PathTrace::written());
+    case h_active:
+	return String(PathTrace::active);
+    default:
+	return String();
+    }
+}
+
+int
+PathTracer::write_handler(const String &str, Element *, void *thunk, ErrorHandler *errh)
+{
+    switch ((intptr_t) thunk) {
+    case h_active: {
+	bool active;
+	if (!BoolArg().parse(str, active))
+	    return errh->error("syntax error");
+	PathTrace::active = active;
+	return 0;
+    }
+    case h_clear:
+	PathTrace::clear();
+	return 0;
+    default:
+	return -1;
+    }
+}
+
+void
+PathTracer::add_handlers()
+{
+    add_read_handler("records", read_handler, h_records);
+    add_read_handler("paths", read_handler, h_paths);
+    add_read_handler("sampled", read_handler, h_sampled);
+    add_read_handler("written", read_handler, h_written);
+    add_read_handler("active", read_handler, h_active);
+    add_write_handler("active", write_handler, h_active);
+    add_write_handler("clear", write_handler, h_clear, Handler::BUTTON);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(userlevel)
+EXPORT_ELEMENT(PathTracer)
@@ -0,0 +1,153 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_PATHTRACER_HH
+#define CLICK_PATHTRACER_HH
+#include <click/batchelement.hh>
+#include <click/multithread.hh>
+#include <click/pathtrace.hh>
+CLICK_DECLS
+
+/*
+=c
+
+PathTracer(I<KEYWORDS> ANNO, [SAMPLE, CAPACITY, ACTIVE])
+
+=s counters
+
+traces the path of sampled packets through the configuration
+
+=d
+
+PathTracer marks 1 in SAMPLE packets with a trace ID annotation, and clears
+that annotation on the others. While tracing is active, every port transfer of
+a marked packet, anywhere in the configuration, appends a record to a buffer
+of the running thread: the trace ID, the element and the port the packet goes
+through, and the CPU cycle counter. See PathTrace for the details.
+
+Put PathTracer close to the packet sources, e.g. right after FromDPDKDevice.
+Marked packets are followed across Pipeliner and queue handoffs, so the read
+handlers can break down the latency of a slow packet per element and per
+queue. A configuration may contain only one PathTracer.
+
+Chains fused at initialization (click --fuse) still record every element of
+the chain.
+
+Keywords are:
+
+=over 8
+
+=item ANNO
+
+Annotation offset of the 4-byte trace ID. Required. Every packet whose
+annotation is not zero there is recorded as traced, wherever it comes from,
+so pick bytes that no element of the configuration writes. In particular,
+bytes 40-47 hold the cycle counters of SetCycleCount (PERFCTR_ANNO) and the
+IPsec SA references, and 28-31 the extra length of truncated packets and of
+HeaderTee replicas.
+
+=item SAMPLE
+
+Integer. Mark one packet in SAMPLE, counted per thread. Default is 1000.
+
+=item CAPACITY
+
+Integer. Number of records kept per thread, rounded up to a power of two.
+Older records are overwritten. Default is 65536.
+
+=item ACTIVE
+
+Boolean. Whether tracing starts active. Default is true.
+
+=back
+
+=h records read-only
+
+Returns the records still in the buffers, one per line, sorted by trace ID then
+cycle counter: "ID THREAD CYCLES ELEMENT PORT DIRECTION". DIRECTION is "push"
+for a packet pushed to input PORT of ELEMENT, and "pull" for a packet pulled
+from output PORT of ELEMENT.
+
+=h paths read-only
+
+Returns one line per traced packet: the trace ID, the total number of cycles
+between its first and last records, and the elements it went through, each
+followed by the cycles elapsed since the previous record and, if the thread
+changed, the new thread number in brackets.
+
+=h sampled read-only
+
+Returns the number of packets marked.
+
+=h written read-only
+
+Returns the number of records written since the last clear, including the
+overwritten ones.
+
+=h active read/write
+
+Returns or sets whether tracing is active. Stop tracing before reading records
+of a busy router, as running threads overwrite the buffers.
+
+=h clear write-only
+
+Forgets all records.
+
+=e
+
+   FromDPDKDevice(0)
+       -> pt :: PathTracer(ANNO 32, SAMPLE 10000)
+       -> Strip(14) -> CheckIPHeader
+       -> Pipeliner -> ...
+
+   click -p 8080 conf.click
+   # later
+   write pt.active false
+   read pt.paths
+
+=a
+
+RecordTimestamp, TimestampDiff, RoundTripCycleCount */
+
+class PathTracer : public BatchElement { public:
+
+    PathTracer() CLICK_COLD;
+    ~PathTracer() CLICK_COLD;
+
+    const char *class_name() const override	{ return "PathTracer"; }
+    const char *port_count() const override	{ return PORTS_1_1; }
+
+    int configure(Vector<String> &, ErrorHandler *) override CLICK_COLD;
+    int initialize(ErrorHandler *) override CLICK_COLD;
+    void cleanup(CleanupStage) override CLICK_COLD;
+    void add_handlers() override CLICK_COLD;
+
+    Packet *simple_action(Packet *) override;
+#if HAVE_BATCH
+    PacketBatch *simple_action_batch(PacketBatch *) override;
+#endif
+
+  private:
+
+    struct State {
+	uint32_t count;
+	uint32_t seq;
+	uint64_t sampled;
+	State() : count(0), seq(0), sampled(0) { }
+    };
+    per_thread<State> _state;
+
+    uint32_t _sample;
+    uint32_t _capacity;
+    int _anno;
+    bool _active;
+    bool _initialized;
+
+    inline void mark(State &, Packet *);
+
+    enum { h_records, h_paths, h_sampled, h_written, h_active, h_clear };
+    static String read_handler(Element *, void *) CLICK_COLD;
+    static int write_handler(const String &, Element *, void *, ErrorHandler *) CLICK_COLD;
+
+};
+
+CLICK_ENDDECLS
+#endif
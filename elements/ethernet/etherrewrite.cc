@@ -27,6 +27,7 @@
 CLICK_DECLS
 
 EtherRewrite::EtherRewrite()
+    : _simd(true)
 {
 }
 
@@ -40,8 +41,12 @@ EtherRewrite::configure(Vector<String> &conf, ErrorHandler *errh)
     if (Args(conf, this, errh)
         .read_mp("SRC", EtherAddressArg(), _ethh.ether_shost)
         .read_mp("DST", EtherAddressArg(), _ethh.ether_dhost)
+        .read("SIMD", _simd)
         .complete() < 0)
        return -1;
+#if CLICK_SIMD
+    _addrs = click_simd_ether_addresses(&_ethh);
+#endif
     return 0;
 }
 
@@ -55,6 +60,19 @@ EtherRewrite::smaction(Packet *p)
     return q;
 }
 
+#if CLICK_SIMD
+inline Packet *
+EtherRewrite::simd_smaction(Packet *p)
+{
+    if (!p->shared() && p->has_mac_header()
+        && p->end_buffer() - p->mac_header() >= 16) {
+        click_simd_ether_rewrite(p->uniqueify()->mac_header(), _addrs);
+        return p;
+    }
+    return smaction(p);
+}
+#endif
+
 inline void
 EtherRewrite::push(int, Packet *p)
 {
@@ -72,17 +90,15 @@ EtherRewrite::pull(int)
 }
 
 #if HAVE_BATCH
-void
-EtherRewrite::push_batch(int, PacketBatch *batch)
-{
-    EXECUTE_FOR_EACH_PACKET(smaction, batch);
-    output(0).push_batch(batch);
-}
-
 PacketBatch *
-EtherRewrite::pull_batch(int, unsigned max)
+EtherRewrite::simple_action_batch(PacketBatch *batch)
 {
-    PacketBatch *batch = input_pull_batch(0, max);
+# if CLICK_SIMD
+    if (_simd) {
+        EXECUTE_FOR_EACH_PACKET(simd_smaction, batch);
+        return batch;
+    }
+# endif
     EXECUTE_FOR_EACH_PACKET(smaction, batch);
     return batch;
 }
@@ -2,12 +2,13 @@
 #define CLICK_ETHERREWRITE_HH
 #include <click/batchelement.hh>
 #include <clicknet/ether.h>
+#include <click/simd.hh>
 CLICK_DECLS
 
 /*
 =c
 
-EtherRewrite(SRC, DST)
+EtherRewrite(SRC, DST [, I<keywords> SIMD])
 
 =s ethernet
 
@@ -18,6 +19,20 @@ rewrite source and destination Ethernet address
 Rewrite the source and the destination address in the Ethernet header.
 The ETHERTYPE is left untouched.
 
+Keyword arguments are:
+
+=over 8
+
+=item SIMD
+
+Boolean. If true, the addresses of the packets of a batch are written with
+one 16-byte vector store per packet, which rewrites the Ethernet type and the
+next two bytes with their own value. Shared packets and packets with less than
+16 bytes of buffer from the MAC header are handled one by one. Default is
+true.
+
+=back
+
 =e
 
 Ensure that source address of all packets passing by is 1:1:1:1:1:1, and
@@ -51,6 +66,7 @@ class EtherRewrite : public BatchElement { public:
 
     const char *class_name() const override	{ return "EtherRewrite"; }
     const char *port_count() const override	{ return PORTS_1_1; }
+    const char *flags() const override		{ return "F"; }
 
     int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
     bool can_live_reconfigure() const	{ return true; }
@@ -61,13 +77,18 @@ class EtherRewrite : public BatchElement { public:
     void push(int, Packet *) override;
 
 #if HAVE_BATCH
-    void push_batch(int, PacketBatch *) override;
-    PacketBatch *pull_batch(int, unsigned) override;
+    PacketBatch *simple_action_batch(PacketBatch *) override;
 #endif
 
   private:
 
     click_ether _ethh;
+    bool _simd;
+#if CLICK_SIMD
+    __m128i _addrs;
+
+    inline Packet *simd_smaction(Packet *);
+#endif
 
 };
 
@@ -27,7 +27,7 @@
 
 CLICK_DECLS
 
-FlowIPManager::FlowIPManager() : _verbose(1), _flags(0), _timer(this), _task(this), _cache(true)
+FlowIPManager::FlowIPManager() : hash(0), fcbs(0), _verbose(1), _flags(0), _timer(this), _task(this), _cache(true)
 {
 }
 
@@ -40,10 +40,12 @@ FlowIPManager::configure(Vector<String> &conf, ErrorHandler *errh)
 {
     bool lf = false;
 
+    if (_expiry.configure(conf, this, errh, 60) < 0)
+        return -1;
+
     if (Args(conf, this, errh)
         .read_or_set_p("CAPACITY", _table_size, 65536)
         .read_or_set("RESERVE",_reserve, 0)
-        .read_or_set("TIMEOUT", _timeout, 60)
 #if RTE_VERSION > RTE_VERSION_NUM(18,8,0,0)
         .read_or_set("LF", lf, false)
 #endif
@@ -69,7 +71,7 @@ FlowIPManager::configure(Vector<String> &conf, ErrorHandler *errh)
     }
 #endif
 
-    _reserve += sizeof(uint32_t);
+    _reserve += sizeof(FlowExpiry::State);
 
     return 0;
 }
@@ -94,14 +96,14 @@ int FlowIPManager::solve_initialize(ErrorHandler *errh)
     if (!hash)
         return errh->error("Could not init flow table !");
 
-    fcbs =  (FlowControlBlock*)CLICK_ALIGNED_ALLOC(_flow_state_size_full * _table_size);
-    bzero(fcbs,_flow_state_size_full * _table_size);
-    CLICK_ASSERT_ALIGNED(fcbs);
+    fcbs =  (FlowControlBlock*)SlabAllocator::allocate_large(_flow_state_size_full * _table_size);
     if (!fcbs)
         return errh->error("Could not init data table !");
+    CLICK_ASSERT_ALIGNED(fcbs);
+    bzero(fcbs,_flow_state_size_full * _table_size);
 
-    if (_timeout > 0) {
-        _timer_wheel.initialize(_timeout);
+    if (_expiry.enabled()) {
+        _timer_wheel.initialize(_expiry.max_timeout());
 
         _timer.initialize(this);
         _timer.schedule_after(Timestamp::make_sec(1));
@@ -112,28 +114,23 @@ int FlowIPManager::solve_initialize(ErrorHandler *errh)
     return 0;
 }
 
-const auto setter = [](FlowControlBlock* prev, FlowControlBlock* next)
-{
-    *((FlowControlBlock**)&prev->data_32[2]) = next;
-};
-
 bool FlowIPManager::run_task(Task* t)
 {
     Timestamp recent = Timestamp::recent_steady();
-    _timer_wheel.run_timers([this,recent](FlowControlBlock* prev) -> FlowControlBlock*{
-        FlowControlBlock* next = *((FlowControlBlock**)&prev->data_32[2]);
-        int old = (recent - prev->lastseen).sec();
-        if (old > _timeout) {
-            if (unlikely(_verbose > 1))
-                click_chatter("Release %p as it is expired since %d", prev, old);
-        //expire
-            rte_hash_free_key_with_position(hash, prev->data_32[0]);
-        } else {
-            //click_chatter("Cascade %p", prev);
-            //No need for lock as we'll be the only one to enqueue there
-            _timer_wheel.schedule_after(prev, _timeout - (recent - prev->lastseen).sec(),setter);
-        }
-        return next;
+    _expiry.run(_timer_wheel, recent, _flags, [this](FlowControlBlock* fcb) {
+        int32_t pos = FlowExpiry::state(fcb)->index;
+        void* key;
+        if (unlikely(_verbose > 1))
+            click_chatter("Release %p as it is expired", fcb);
+        if (rte_hash_get_key_with_position(hash, pos, &key) < 0)
+            return;
+        IPFlow5ID fid = *(IPFlow5ID*)key;
+        rte_hash_del_key(hash, &fid);
+#if RTE_VERSION > RTE_VERSION_NUM(18,8,0,0)
+        //Lock-free tables do not reuse the slot of deleted keys by themselves
+        if (_flags & RTE_HASH_EXTRA_FLAGS_RW_CONCURRENCY_LF)
+            rte_hash_free_key_with_position(hash, pos);
+#endif
     });
     return true;
 }
@@ -148,6 +145,8 @@ void FlowIPManager::cleanup(CleanupStage stage)
 {
     if (hash)
         rte_hash_free(hash);
+    if (fcbs)
+        SlabAllocator::deallocate_large(fcbs, _flow_state_size_full * _table_size);
 }
 
 void FlowIPManager::process(Packet* p, BatchBuilder& b, const Timestamp& recent)
@@ -155,6 +154,8 @@ void FlowIPManager::process(Packet* p, BatchBuilder& b, const Timestamp& recent)
     IPFlow5ID fid = IPFlow5ID(p);
 
     if (_cache && fid == b.last_id) {
+        if (_expiry.enabled())
+            _expiry.track(_timer_wheel, fcb_stack, p, _flags);
         b.append(p);
         return;
     }
@@ -176,18 +177,15 @@ void FlowIPManager::process(Packet* p, BatchBuilder& b, const Timestamp& recent)
             click_chatter("New flow %d", ret);
         fcb = (FlowControlBlock*)((unsigned char*)fcbs + (_flow_state_size_full * ret));
         //Remember ID for deletion
-        fcb->data_32[0] = ret;
-        if (_timeout) {
-            if (_flags) {
-                _timer_wheel.schedule_after_mp(fcb, _timeout, setter);
-            } else {
-                _timer_wheel.schedule_after(fcb, _timeout, setter);
-            }
-        }
+        FlowExpiry::state(fcb)->index = ret;
+        if (_expiry.enabled())
+            _expiry.start(_timer_wheel, fcb, p, _flags);
     } else { //existing flow
         if (unlikely(_verbose > 1))
             click_chatter("Existing flow %d", ret);
         fcb = (FlowControlBlock*)((unsigned char*)fcbs + (_flow_state_size_full * ret));
+        if (_expiry.enabled())
+            _expiry.track(_timer_wheel, fcb, p, _flags);
     }
 
     if (b.last == ret) {
@@ -241,6 +239,8 @@ String FlowIPManager::read_handler(Element* e, void* thunk)
 void FlowIPManager::add_handlers()
 {
     add_read_handler("count", read_handler, h_count);
+    if (_expiry.enabled())
+        _expiry.add_handlers(this);
 }
 
 CLICK_ENDDECLS
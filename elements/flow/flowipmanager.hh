@@ -9,14 +9,14 @@
 #include <click/flow/flowelement.hh>
 #include <click/flow/common.hh>
 #include <click/batchbuilder.hh>
-#include <click/timerwheel.hh>
+#include <click/flow/flowexpiry.hh>
 CLICK_DECLS
 class DPDKDevice;
 struct rte_hash;
 
 
 /**
- * FlowIPManager(CAPACITY [, RESERVE])
+ * FlowIPManager(CAPACITY [, RESERVE, TIMEOUT, SYN_TIMEOUT, CLOSE_TIMEOUT, UDP_TIMEOUT, OTHER_TIMEOUT])
  *
  * =s flow
  *  FCB packet classifier - cuckoo shared-by-all-threads
@@ -30,6 +30,18 @@ struct rte_hash;
  * neither set the offsets for placement in the FCB automatically. Look at
  * the middleclick branch for alternatives.
  *
+ * Flows idle for longer than the timeout of their class are removed. TCP
+ * flows are tracked from their flags: flows that only sent SYNs expire after
+ * SYN_TIMEOUT seconds (default 10), established flows after TIMEOUT seconds
+ * (default 60), and flows that sent a FIN or a RST after CLOSE_TIMEOUT
+ * seconds (default 10), so that closed connections leave the table quickly.
+ * UDP flows expire after UDP_TIMEOUT seconds, and flows of other protocols
+ * after OTHER_TIMEOUT seconds, both TIMEOUT by default. A TIMEOUT of 0
+ * disables expiry.
+ *
+ * The flows handler returns the number of flows in each class, and the
+ * expired handler the number of flows of each class that expired.
+ *
  * =a FlowIPManger
  *
  */
@@ -67,7 +79,7 @@ class FlowIPManager: public VirtualFlowManager, public Router::InitFuture {
         int _verbose;
         int _flags;
 
-        int _timeout;
+        FlowExpiry _expiry;
         Timer _timer; //Timer to launch the wheel
         Task _task;
 
@@ -75,7 +87,7 @@ class FlowIPManager: public VirtualFlowManager, public Router::InitFuture {
 
         static String read_handler(Element* e, void* thunk);
         inline void process(Packet* p, BatchBuilder& b, const Timestamp& recent);
-        TimerWheel<FlowControlBlock> _timer_wheel;
+        FlowExpiry::wheel_type _timer_wheel;
 };
 
 CLICK_ENDDECLS
@@ -26,27 +26,23 @@ FlowIPManagerIMP::~FlowIPManagerIMP()
 int
 FlowIPManagerIMP::configure(Vector<String> &conf, ErrorHandler *errh)
 {
+    if (_expiry.configure(conf, this, errh, 0) < 0)
+        return -1;
+
     if (Args(conf, this, errh)
         .read_or_set_p("CAPACITY", _table_size, 65536)
         .read_or_set("RESERVE", _reserve, 0)
-        .read_or_set("TIMEOUT", _timeout, -1)
         .read_or_set("CACHE", _cache, true)
         .complete() < 0)
         return -1;
 
-    if (_timeout > 0) {
-        return errh->error("Timeout unsupported!");
-    }
-
-    errh->warning("This element does not support timeout");
-
     find_children(_verbose);
 
     router()->get_root_init_future()->postOnce(&_fcb_builded_init_future);
 
     _fcb_builded_init_future.post(this);
 
-    _reserve += sizeof(uint32_t);
+    _reserve += sizeof(FlowExpiry::State);
 
     return 0;
 }
@@ -86,59 +82,56 @@ int FlowIPManagerIMP::solve_initialize(ErrorHandler *errh)
         if (!_tables[i].hash)
             return errh->error("Could not init flow table %d : error %d (%s)!", i, rte_errno, rte_strerror(rte_errno));
 
-        _tables[i].fcbs =  (FlowControlBlock*)CLICK_ALIGNED_ALLOC(_flow_state_size_full * _table_size);
-        click_chatter("Created fcbs %d\n", _tables[i].fcbs);
-        CLICK_ASSERT_ALIGNED(_tables[i].fcbs);
-        bzero(_tables[i].fcbs,_flow_state_size_full * _table_size);
+        // Each table lives on the NUMA node of the thread using it
+        _tables[i].fcbs =  (FlowControlBlock*)SlabAllocator::allocate_large(_flow_state_size_full * _table_size, SlabAllocator::thread_node(i));
         if (!_tables[i].fcbs)
             return errh->error("Could not init data table %d!", i);
-    }
+        CLICK_ASSERT_ALIGNED(_tables[i].fcbs);
+        bzero(_tables[i].fcbs,_flow_state_size_full * _table_size);
 
-    if (_timeout > 0) {
-        _timer_wheel.initialize(_timeout);
+        if (_expiry.enabled())
+            _tables[i].wheel.initialize(_expiry.max_timeout());
     }
 
-    /*
-    _timer.initialize(this);
-    _timer.schedule_after(Timestamp::make_sec(1));*/
     _task.initialize(this, false);
 
     return 0;
 }
 
 
-const auto setter = [](FlowControlBlock* prev, FlowControlBlock* next)
-{
-        *((FlowControlBlock**)&prev->data_32[2]) = next;
-};
-
 bool FlowIPManagerIMP::run_task(Task* t)
 {
-    /*
-     Not working : the timerwheel must be per-thread too
-     Timestamp recent = Timestamp::recent_steady();
-    _timer_wheel.run_timers([this,recent](FlowControlBlock* prev) -> FlowControlBlock*{
-        FlowControlBlock* next = *((FlowControlBlock**)&prev->data_32[2]);
-        int old = (recent - prev->lastseen).sec();
-        if (old > _timeout) {
-            //click_chatter("Release %p as it is expired since %d", prev, old);
-            //expire
-            rte_hash_free_key_with_position(vhash[click_current_cpu_id()], prev->data_32[0]);//depreciated
-        } else {
-            //click_chatter("Cascade %p", prev);
-            //No need for lock as we'll be the only one to enqueue there
-            _timer_wheel.schedule_after(prev, _timeout - (recent - prev->lastseen).sec(),setter);
-        }
-        return next;
-    });
-    return true;*/
     return false;
 }
 
 void FlowIPManagerIMP::run_timer(Timer* t)
 {
-    //_task.reschedule();
-   // t->reschedule_after(Timestamp::make_sec(1));
+}
+
+/**
+ * Advance the wheel of a table to the current second. Must be called by
+ * the thread of the table.
+ */
+void FlowIPManagerIMP::expire(gtable& tab, const Timestamp& recent)
+{
+    Timestamp::seconds_type now = recent.sec();
+    if (likely(now == tab.wheel_time))
+        return;
+    //After a full turn, all flows came up once and are scheduled from now
+    int ticks = tab.wheel_time ? now - tab.wheel_time : 0;
+    if (ticks > _expiry.max_timeout() + 1)
+        ticks = _expiry.max_timeout() + 1;
+    tab.wheel_time = now;
+    while (ticks-- > 0) {
+        _expiry.run(tab.wheel, recent, false, [&tab](FlowControlBlock* fcb) {
+            int32_t pos = FlowExpiry::state(fcb)->index;
+            void* key;
+            if (rte_hash_get_key_with_position(tab.hash, pos, &key) < 0)
+                return;
+            IPFlow5ID fid = *(IPFlow5ID*)key;
+            rte_hash_del_key(tab.hash, &fid);
+        });
+    }
 }
 
 void FlowIPManagerIMP::cleanup(CleanupStage stage)
@@ -149,7 +142,7 @@ void FlowIPManagerIMP::cleanup(CleanupStage stage)
            rte_hash_free(_tables[i].hash);
 
        if (_tables[i].fcbs)
-            delete _tables[i].fcbs;
+            SlabAllocator::deallocate_large(_tables[i].fcbs, _flow_state_size_full * _table_size);
     }
 
     delete _tables;
@@ -159,11 +152,14 @@ void FlowIPManagerIMP::process(Packet* p, BatchBuilder& b, const Timestamp& rece
 {
     IPFlow5ID fid = IPFlow5ID(p);
 
+    auto& tab = _tables[click_current_cpu_id()];
+
     if (_cache && fid == b.last_id) {
+        if (_expiry.enabled())
+            _expiry.track(tab.wheel, fcb_stack, p, false);
         b.append(p);
         return;
     }
-    auto& tab = _tables[click_current_cpu_id()];
     rte_hash* table = tab.hash;
 
     FlowControlBlock* fcb;
@@ -179,17 +175,14 @@ void FlowIPManagerIMP::process(Packet* p, BatchBuilder& b, const Timestamp& rece
             return;
         }
         fcb = (FlowControlBlock*)((unsigned char*)tab.fcbs + (_flow_state_size_full * ret));
-        //We remember the index in the first 4 reserved bytes
-        fcb->data_32[0] = ret;
-        if (_timeout > 0) {
-            if (_flags) {
-                _timer_wheel.schedule_after_mp(fcb, _timeout, setter);
-            } else {
-                _timer_wheel.schedule_after(fcb, _timeout, setter);
-            }
-        }
+        //We remember the index in the first reserved bytes
+        FlowExpiry::state(fcb)->index = ret;
+        if (_expiry.enabled())
+            _expiry.start(tab.wheel, fcb, p, false);
     } else { //existing flow
         fcb = (FlowControlBlock*)((unsigned char*)tab.fcbs + (_flow_state_size_full * ret));
+        if (_expiry.enabled())
+            _expiry.track(tab.wheel, fcb, p, false);
     }
 
     if (b.last == ret) {
@@ -214,6 +207,8 @@ void FlowIPManagerIMP::push_batch(int, PacketBatch* batch)
 {
     BatchBuilder b;
     Timestamp recent = Timestamp::recent_steady();
+    if (_expiry.enabled())
+        expire(_tables[click_current_cpu_id()], recent);
     FOR_EACH_PACKET_SAFE(batch, p) {
         process(p, b, recent);
     }
@@ -251,6 +246,8 @@ String FlowIPManagerIMP::read_handler(Element* e, void* thunk)
 void FlowIPManagerIMP::add_handlers()
 {
     add_read_handler("count", read_handler, h_count);
+    if (_expiry.enabled())
+        _expiry.add_handlers(this);
 }
 
 CLICK_ENDDECLS
@@ -9,7 +9,7 @@
 #include <click/flow/common.hh>
 #include <click/flow/flowelement.hh>
 #include <click/batchbuilder.hh>
-#include <click/timerwheel.hh>
+#include <click/flow/flowexpiry.hh>
 
 CLICK_DECLS
 
@@ -17,7 +17,7 @@ class DPDKDevice;
 struct rte_hash;
 
 /**
- * FlowIPManagerIMP(CAPACITY [, RESERVE])
+ * FlowIPManagerIMP(CAPACITY [, RESERVE, TIMEOUT, SYN_TIMEOUT, CLOSE_TIMEOUT, UDP_TIMEOUT, OTHER_TIMEOUT])
  *
  * =s flow
  *  FCB packet classifier - cuckoo per-thread
@@ -31,6 +31,10 @@ struct rte_hash;
  * neither set the offsets for placement in the FCB automatically. Look at
  * the middleclick branch for alternatives.
  *
+ * Flows expire as with FlowIPManager, but TIMEOUT is 0 by default. Each
+ * thread has its own timer wheel, advanced by the packets of the thread, so
+ * the flows of a thread expire only while it receives packets.
+ *
  * =a FlowIPManger
  *
  */
@@ -61,10 +65,12 @@ class FlowIPManagerIMP: public VirtualFlowManager, public Router::InitFuture {
 
 
         struct gtable {
-            gtable() : hash(0), fcbs(0) {
+            gtable() : hash(0), fcbs(0), wheel_time(0) {
             }
             rte_hash* hash;
             FlowControlBlock *fcbs;
+            FlowExpiry::wheel_type wheel;
+            Timestamp::seconds_type wheel_time; //Last second the wheel ran for
         } CLICK_ALIGNED(CLICK_CACHE_LINE_SIZE);
 
         gtable* _tables;
@@ -75,14 +81,14 @@ class FlowIPManagerIMP: public VirtualFlowManager, public Router::InitFuture {
         int _verbose;
         int _flags;
 
-        int _timeout;
+        FlowExpiry _expiry;
         Timer _timer; //Timer to launch the wheel
         Task _task;
         bool _cache;
 
         static String read_handler(Element* e, void* thunk);
         inline void process(Packet* p, BatchBuilder& b, const Timestamp& recent);
-        TimerWheel<FlowControlBlock> _timer_wheel;
+        inline void expire(gtable& tab, const Timestamp& recent);
 };
 
 CLICK_ENDDECLS
@@ -80,7 +80,7 @@ CheckIPHeader::InterfacesArg::parse(const String &str, Vector<IPAddress> &result
     return false;
 }
 
-CheckIPHeader::CheckIPHeader() : _checksum(true), _reason_drops(0)
+CheckIPHeader::CheckIPHeader() : _checksum(true), _simd(true), _reason_drops(0)
 {
     _count = 0;
     _drops = 0;
@@ -108,6 +108,7 @@ CheckIPHeader::configure(Vector<String> &conf, ErrorHandler *errh)
         .read("VERBOSE", verbose)
         .read("DETAILS", details)
         .read("CHECKSUM", _checksum)
+        .read("SIMD", _simd)
         .consume() < 0)
         return -1;
 
@@ -164,7 +165,7 @@ CheckIPHeader::drop(Reason reason, Packet *p, bool batch)
     return 0;
 }
 
-inline CheckIPHeader::Reason CheckIPHeader::valid(Packet* p) {
+inline CheckIPHeader::Reason CheckIPHeader::valid(Packet* p, bool checksum_ok) {
     unsigned plen = p->length() - _offset;
 
     // cast to int so very large plen is interpreted as negative
@@ -184,7 +185,7 @@ inline CheckIPHeader::Reason CheckIPHeader::valid(Packet* p) {
         //return BAD_IP_LEN;
 	plen = len;
 
-    if (_checksum) {
+    if (_checksum && !checksum_ok) {
         int val;
     #if HAVE_FAST_CHECKSUM && FAST_CHECKSUM_ALIGNED
         if (_aligned)
@@ -242,6 +243,116 @@ CheckIPHeader::simple_action(Packet *p)
     }
 }
 
+#if HAVE_BATCH
+PacketBatch *
+CheckIPHeader::simple_action_batch(PacketBatch *batch)
+{
+# if CLICK_SIMD
+    if (_simd && _checksum)
+        return simd_action_batch(batch);
+# endif
+    EXECUTE_FOR_EACH_PACKET_DROPPABLE(CheckIPHeader::simple_action, batch, [](Packet *){});
+    return batch;
+}
+
+void
+CheckIPHeader::simple_action_array(PacketArray &a)
+{
+# if CLICK_SIMD
+    if (_simd && _checksum) {
+        simd_action_array(a);
+        return;
+    }
+# endif
+    EXECUTE_FOR_EACH_PACKET_ARRAY_DROPPABLE(CheckIPHeader::simple_action, a, [](Packet *){});
+}
+
+# if CLICK_SIMD
+/*
+ * Verify the version, header length and checksum of up to CLICK_SIMD_LANES
+ * packets with the vector kernel. Returns the mask of the lanes that passed.
+ * The remaining checks and the annotations are done by valid(), which also
+ * does the full check of the packets rejected by the kernel, to find the
+ * drop reason or accept headers with options.
+ */
+inline unsigned
+CheckIPHeader::simd_check(Packet **lane, int n)
+{
+    const unsigned char *hdr[CLICK_SIMD_LANES];
+    int nv = 0;
+    unsigned vector = 0;
+    for (int i = 0; i < n; i++)
+        if ((int) (lane[i]->length() - _offset) >= (int) sizeof(click_ip)) {
+            hdr[nv++] = lane[i]->data() + _offset;
+            vector |= 1U << i;
+        }
+
+    unsigned ok = 0;
+    if (nv) {
+        unsigned good = click_simd_ip_check(hdr, nv);
+        for (int i = 0, v = 0; i < n; i++)
+            if (vector & (1U << i)) {
+                if (good & (1U << v))
+                    ok |= 1U << i;
+                v++;
+            }
+    }
+    return ok;
+}
+
+PacketBatch *
+CheckIPHeader::simd_action_batch(PacketBatch *batch)
+{
+    BATCH_CREATE_INIT(out);
+    Packet *next = batch;
+    while (next) {
+        Packet *lane[CLICK_SIMD_LANES];
+        int n = 0;
+        for (; next && n < CLICK_SIMD_LANES; n++, next = next->next())
+            lane[n] = next;
+
+        unsigned ok = simd_check(lane, n);
+        for (int i = 0; i < n; i++) {
+            Packet *p = lane[i];
+            Reason r = valid(p, ok & (1U << i));
+            if (r != NREASONS) {
+                drop(r, p, true);
+                continue;
+            }
+            BATCH_CREATE_APPEND(out, p);
+        }
+    }
+    BATCH_CREATE_FINISH(out);
+    return out;
+}
+
+/*
+ * Same as simd_action_batch(), but the lanes are read in place from the
+ * array and the accepted packets are compacted at its front.
+ */
+void
+CheckIPHeader::simd_action_array(PacketArray &a)
+{
+    Packet **in = a.data(), **end = in + a.count(), **out = in;
+    while (in != end) {
+        int n = end - in < CLICK_SIMD_LANES ? end - in : CLICK_SIMD_LANES;
+        unsigned ok = simd_check(in, n);
+        for (int i = 0; i < n; i++) {
+            Packet *p = in[i];
+            Reason r = valid(p, ok & (1U << i));
+            if (r != NREASONS) {
+                drop(r, p, true);
+                continue;
+            }
+            *out++ = p;
+        }
+        in += n;
+    }
+    a.set_count(out - a.data());
+}
+# endif
+#endif
+
 String
 CheckIPHeader::read_handler(Element *e, void *thunk)
 {
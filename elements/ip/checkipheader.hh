@@ -2,6 +2,7 @@
 #define CLICK_CHECKIPHEADER_HH
 #include <click/batchelement.hh>
 #include <click/atomic.hh>
+#include <click/simd.hh>
 CLICK_DECLS
 class Args;
 
@@ -79,6 +80,14 @@ Boolean. If it is true, then CheckIPHeader will maintain detailed counts of
 how many packets were dropped for each possible reason, accessible through the
 C<drop_details> handler. False by default.
 
+=item SIMD
+
+Boolean. If true, the version, header length and checksum of the packets of a
+batch or PacketArray are checked eight at a time with vector instructions
+(SSE2, or AVX2 when the CPU supports it). Packets failing the vector check,
+including valid packets with IP options, are checked again one by one. Only
+used when CHECKSUM is true. True by default.
+
 =back
 
 =n
@@ -117,12 +126,16 @@ class CheckIPHeader : public SimpleElement<CheckIPHeader> {
         const char *class_name() const override { return "CheckIPHeader"; }
         const char *port_count() const override { return PORTS_1_1X2; }
         const char *processing() const override { return PROCESSING_A_AH; }
-        const char *flags() const      { return Element::AGNOSTIC; }
+        const char *flags() const override { return "F"; }
 
         int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
         void add_handlers() CLICK_COLD;
 
         Packet *simple_action(Packet *p);
+    #if HAVE_BATCH
+        PacketBatch *simple_action_batch(PacketBatch *batch) override;
+        void simple_action_array(PacketArray &a);
+    #endif
 
         struct OldBadSrcArg {
             static bool parse(const String &str, Vector<IPAddress> &result, Args &args);
@@ -144,6 +157,7 @@ class CheckIPHeader : public SimpleElement<CheckIPHeader> {
         bool _aligned;
     #endif
         bool _verbose;
+        bool _simd;
 
         Vector<IPAddress> _good_dst;  // array of IP dst addrs for which _bad_src does not apply
 
@@ -164,7 +178,12 @@ class CheckIPHeader : public SimpleElement<CheckIPHeader> {
 
         enum { h_count, h_drops, h_drop_details };
 
-        inline Reason valid(Packet *p);
+        inline Reason valid(Packet *p, bool checksum_ok = false);
+    #if HAVE_BATCH && CLICK_SIMD
+        inline unsigned simd_check(Packet **lane, int n);
+        PacketBatch *simd_action_batch(PacketBatch *batch);
+        void simd_action_array(PacketArray &a);
+    #endif
         Packet *drop(Reason reason, Packet *p, bool batch);
         static String read_handler(Element *e, void *thunk) CLICK_COLD;
 
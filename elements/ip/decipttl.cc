@@ -28,7 +28,7 @@
 CLICK_DECLS
 
 DecIPTTL::DecIPTTL()
-    : _active(true), _multicast(true)
+    : _active(true), _multicast(true), _simd(true)
 {
     _drops = 0;
 }
@@ -42,7 +42,8 @@ DecIPTTL::configure(Vector<String> &conf, ErrorHandler *errh)
 {
     return Args(conf, this, errh)
 	.read("ACTIVE", _active)
-	.read("MULTICAST", _multicast).complete();
+	.read("MULTICAST", _multicast)
+	.read("SIMD", _simd).complete();
 }
 
 Packet *
@@ -84,9 +85,61 @@ DecIPTTL::simple_action(Packet *p)
 PacketBatch *
 DecIPTTL::simple_action_batch(PacketBatch *batch)
 {
+# if CLICK_SIMD
+    if (_simd && _active && _multicast)
+	return simd_action_batch(batch);
+# endif
     EXECUTE_FOR_EACH_PACKET_DROPPABLE(DecIPTTL::simple_action, batch, [](Packet *){});
     return batch;
 }
+
+# if CLICK_SIMD
+/*
+ * Take packets CLICK_SIMD_LANES at a time. Unique packets with a full IP
+ * header go through the vector kernel, which leaves alone those whose TTL
+ * expired. Packets that were not handled by the kernel go through
+ * simple_action(), which also sends the expired ones to output 1.
+ */
+PacketBatch *
+DecIPTTL::simd_action_batch(PacketBatch *batch)
+{
+    BATCH_CREATE_INIT(out);
+    Packet *next = batch;
+    while (next) {
+	Packet *lane[CLICK_SIMD_LANES];
+	unsigned char *hdr[CLICK_SIMD_LANES];
+	int n = 0, nv = 0;
+	unsigned vector = 0;
+	for (; next && n < CLICK_SIMD_LANES; n++, next = next->next()) {
+	    lane[n] = next;
+	    if (!next->shared() && next->network_length() >= (int) sizeof(click_ip)) {
+		hdr[nv++] = next->uniqueify()->network_header();
+		vector |= 1U << n;
+	    }
+	}
+
+	unsigned done = 0;
+	if (nv) {
+	    unsigned live = click_simd_ip_dec_ttl(hdr, nv);
+	    for (int i = 0, v = 0; i < n; i++)
+		if (vector & (1U << i)) {
+		    if (live & (1U << v))
+			done |= 1U << i;
+		    v++;
+		}
+	}
+
+	for (int i = 0; i < n; i++) {
+	    Packet *q = lane[i];
+	    if (!(done & (1U << i)) && !(q = simple_action(q)))
+		continue;
+	    BATCH_CREATE_APPEND(out, q);
+	}
+    }
+    BATCH_CREATE_FINISH(out);
+    return out;
+}
+# endif
 #endif
 
 void
@@ -3,6 +3,7 @@
 #include <click/batchelement.hh>
 #include <click/glue.hh>
 #include <click/atomic.hh>
+#include <click/simd.hh>
 CLICK_DECLS
 
 /*
@@ -31,6 +32,14 @@ CLICK_DECLS
  * Boolean.  If false, do not decrement the TTLs for multicast packets.
  * Defaults to true.
  *
+ * =item SIMD
+ *
+ * Boolean.  If true, batches are processed eight packets at a time with
+ * vector instructions (SSE2, or AVX2 when the CPU supports it). Packets which
+ * cannot take the vector path, such as shared packets or packets whose TTL
+ * expired, are handled one by one as usual. Only used when MULTICAST is true.
+ * Defaults to true.
+ *
  * =back
  *
  * =e
@@ -49,6 +58,7 @@ class DecIPTTL : public BatchElement { public:
 
     const char *class_name() const override		{ return "DecIPTTL"; }
     const char *port_count() const override		{ return PORTS_1_1X2; }
+    const char *flags() const override		{ return "F"; }
     const char *processing() const override		{ return PROCESSING_A_AH; }
 
     int configure(Vector<String> &conf, ErrorHandler *errh) CLICK_COLD;
@@ -64,6 +74,11 @@ class DecIPTTL : public BatchElement { public:
     atomic_uint32_t _drops;
     bool _active;
     bool _multicast;
+    bool _simd;
+
+#if HAVE_BATCH && CLICK_SIMD
+    PacketBatch *simd_action_batch(PacketBatch *);
+#endif
 };
 
 CLICK_ENDDECLS
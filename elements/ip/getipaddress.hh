@@ -48,6 +48,7 @@ class GetIPAddress : public BatchElement {
 
   const char *class_name() const override		{ return "GetIPAddress"; }
   const char *port_count() const override		{ return PORTS_1_1; }
+  const char *flags() const override		{ return "F"; }
 
   int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
 
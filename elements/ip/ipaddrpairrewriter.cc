@@ -71,19 +71,10 @@ IPAddrPairRewriter::IPAddrPairFlow::unparse(StringAccum &sa, bool direction,
 
 IPAddrPairRewriter::IPAddrPairRewriter()
 {
-#if HAVE_USER_MULTITHREAD
-    _maps_no = ( click_max_cpu_ids() == 0 )? 1 : click_max_cpu_ids();
-    _allocator = new SizedHashAllocator<sizeof(IPAddrPairFlow)>[_maps_no];
-    //click_chatter("[%s]: Allocated %d flow maps", class_name(), _maps_no);
-#endif
 }
 
 IPAddrPairRewriter::~IPAddrPairRewriter()
 {
-#if HAVE_USER_MULTITHREAD
-    if ( _allocator )
-        delete [] _allocator;
-#endif
 }
 
 void *
@@ -137,7 +128,7 @@ IPAddrPairRewriter::add_flow(int, const IPFlowID &flowid,
     void *data;
     if (rewritten_flowid.sport()
 	|| rewritten_flowid.dport()
-	|| !(data = _allocator[click_current_cpu_id()].allocate()))
+	|| !(data = SlabAllocator::allocate(sizeof(IPAddrPairFlow))))
 	return 0;
 
     IPAddrPairFlow *flow = new(data) IPAddrPairFlow
@@ -153,12 +153,6 @@ class IPAddrPairRewriter : public IPRewriterBase { public:
     void add_handlers() CLICK_COLD;
 
   private:
-#if HAVE_USER_MULTITHREAD
-    unsigned _maps_no;
-    SizedHashAllocator<sizeof(IPAddrPairFlow)> *_allocator;
-#else
-    SizedHashAllocator<sizeof(IPAddrPairFlow)> _allocator[CLICK_CPU_MAX];
-#endif
 
     unsigned _annos;
 
@@ -174,7 +168,7 @@ IPAddrPairRewriter::destroy_flow(IPRewriterFlow *flow)
 {
     unmap_flow(flow, _map[click_current_cpu_id()]);
     static_cast<IPAddrPairFlow *>(flow)->~IPAddrPairFlow();
-    _allocator[click_current_cpu_id()].deallocate(flow);
+    SlabAllocator::deallocate(flow, sizeof(IPAddrPairFlow));
 }
 
 CLICK_ENDDECLS
@@ -72,19 +72,10 @@ IPAddrRewriter::IPAddrFlow::unparse(StringAccum &sa, bool direction,
 
 IPAddrRewriter::IPAddrRewriter()
 {
-#if HAVE_USER_MULTITHREAD
-    _maps_no = ( click_max_cpu_ids() == 0 )? 1 : click_max_cpu_ids();
-    _allocator = new SizedHashAllocator<sizeof(IPAddrFlow)>[_maps_no];
-    //click_chatter("[%s]: Allocated %d flow maps", class_name(), _maps_no);
-#endif
 }
 
 IPAddrRewriter::~IPAddrRewriter()
 {
-#if HAVE_USER_MULTITHREAD
-    if ( _allocator )
-        delete [] _allocator;
-#endif
 }
 
 void *
@@ -142,7 +133,7 @@ IPAddrRewriter::add_flow(int, const IPFlowID &flowid,
     if (rewritten_flowid.sport()
 	|| rewritten_flowid.dport()
 	|| rewritten_flowid.daddr()
-	|| !(data = _allocator[click_current_cpu_id()].allocate()))
+	|| !(data = SlabAllocator::allocate(sizeof(IPAddrFlow))))
 	return 0;
 
     IPAddrFlow *flow = new(data) IPAddrFlow
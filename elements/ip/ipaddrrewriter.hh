@@ -153,13 +153,6 @@ class IPAddrRewriter : public IPRewriterBase { public:
 
   protected:
 
-#if HAVE_USER_MULTITHREAD
-    unsigned _maps_no;
-    SizedHashAllocator<sizeof(IPAddrFlow)> *_allocator;
-#else
-    SizedHashAllocator<sizeof(IPAddrFlow)> _allocator[CLICK_CPU_MAX];
-#endif
-
     unsigned _annos;
 
     int process(int port, Packet *p_in);
@@ -174,7 +167,7 @@ IPAddrRewriter::destroy_flow(IPRewriterFlow *flow)
 {
     unmap_flow(flow, _map[click_current_cpu_id()]);
     static_cast<IPAddrFlow *>(flow)->~IPAddrFlow();
-    _allocator[click_current_cpu_id()].deallocate(flow);
+    SlabAllocator::deallocate(flow, sizeof(IPAddrFlow));
 }
 
 CLICK_ENDDECLS
@@ -23,6 +23,7 @@
 #include <click/error.hh>
 #include <click/args.hh>
 #include <click/straccum.hh>
+#include <clicknet/ether.h>
 #include <clicknet/ip.h>
 #include <clicknet/tcp.h>
 #include <clicknet/icmp.h>
@@ -1336,6 +1337,16 @@ IPFilter::configure(Vector<String> &conf, ErrorHandler *errh)
     parse_program(zprog, conf, noutputs(), this, errh);
 
     if (!errh->nerrors()) {
+        // Assume an Ethernet header and an IP header without options
+        int length = zprog.safe_length();
+        if (length > offset_transp)
+            length = sizeof(click_ether) + sizeof(click_ip) + length - offset_transp;
+        else if (length > offset_net)
+            length = sizeof(click_ether) + length - offset_net;
+        else
+            length = length > 2 ? length - 2 : 0;
+        if (_split.configure(length, errh) < 0)
+            return -1;
         _zprog = zprog;
         return 0;
     }
@@ -1390,6 +1401,9 @@ IPFilter::read_handler(Element *e, void *thunk)
             }
             return String(((float) ipf->_cache.cache_misses_nb / (float) tot)*100);
         }
+        case H_SPLIT_ACCESS: {
+            return ipf->_split.unparse();
+        }
         default: {
             return "-1";
         }
@@ -1405,6 +1419,9 @@ IPFilter::add_handlers()
     add_read_handler("cache_total_count", read_handler, H_CACHE_TOTAL);
     add_read_handler("cache_hits_ratio", read_handler, H_CACHE_HITS_RATIO);
     add_read_handler("cache_misses_ratio", read_handler, H_CACHE_MISSES_RATIO);
+#if HAVE_DPDK
+    add_read_handler("split_access", read_handler, H_SPLIT_ACCESS);
+#endif
 }
 
 //
@@ -1492,7 +1509,7 @@ IPFilter::push_batch(int, PacketBatch *batch)
 void
 IPFilter::push(int, Packet *p)
 {
-    checked_output_push(match(_zprog, p), p);
+    checked_output_push(match(p), p);
 }
 
 CLICK_ENDDECLS
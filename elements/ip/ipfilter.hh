@@ -150,6 +150,12 @@ in the cache.
 This ratio ranges in [0, 100].
 If CACHING is disabled, this handler returns -1.
 
+=h split_access read-only
+Only with DPDK. Returns the number of header-data split packets that were
+shorter than the program needs but had more data in their payload segment
+("beyond"), and the number of them whose missing bytes were pulled up to the
+header segment ("pulled"). See DPDKInfo's SPLIT_ACCESS.
+
 =a
 
 IPClassifier, Classifier, CheckIPHeader, MarkIPHeader, CheckIPHeader2,
@@ -321,13 +327,17 @@ class IPFilter : public BatchElement { public:
     IPFilterProgram _zprog;
     bool _caching;
     IPFilterCache _cache;
+    Classification::SplitAccess _split;
+
+    inline unsigned split_length(const Packet *p) const;
 
     static String read_handler(Element *e, void *thunk);
 
     enum {
         H_PROGRAM,
         H_CACHE_HITS, H_CACHE_MISSES, H_CACHE_TOTAL,
-        H_CACHE_HITS_RATIO, H_CACHE_MISSES_RATIO
+        H_CACHE_HITS_RATIO, H_CACHE_MISSES_RATIO,
+        H_SPLIT_ACCESS
     };
 
   private:
@@ -480,9 +490,37 @@ IPFilter::match(const IPFilterProgram &zprog, const Packet *p)
     }
 }
 
+// Number of bytes after p->data() the program reads. Without the header
+// annotation the program starts from, assume the packet is long enough.
+inline unsigned
+IPFilter::split_length(const Packet *p) const
+{
+    int length = _zprog.safe_length();
+    const unsigned char *start;
+    if (length > offset_transp) {
+        if (!p->has_transport_header())
+            return p->length();
+        start = p->transport_header();
+        length -= offset_transp;
+    } else if (length > offset_net) {
+        if (!p->has_network_header())
+            return p->length();
+        start = p->network_header();
+        length -= offset_net;
+    } else {
+        if (!p->has_mac_header())
+            return p->length();
+        start = p->mac_header() - 2;
+    }
+    int end = start + length - p->data();
+    return end > 0 ? end : 0;
+}
+
 inline int
 IPFilter::match(Packet *p)
 {
+    if (unlikely(_split.enabled()))
+        _split.check(p, split_length(p));
     return match(_zprog, p);
 }
 
@@ -0,0 +1,263 @@
+// -*- c-basic-offset: 4 -*-
+/*
+ * ippolicer.{cc,hh} -- polices IP traffic per address and per prefix
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "ippolicer.hh"
+#include <click/args.hh>
+#include <click/error.hh>
+#include <clicknet/ip.h>
+CLICK_DECLS
+
+IPPolicer::IPPolicer()
+    : _bytes(false), _dst(false), _capacity(1 << 20)
+{
+}
+
+IPPolicer::~IPPolicer()
+{
+}
+
+int
+IPPolicer::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    uint32_t rate[2], burst[2];
+    bool have_burst[2];
+    int prefix = 24;
+    // BYTES decides how the rates are parsed
+    if (Args(this, errh).bind(conf).read("BYTES", _bytes).consume() < 0)
+	return -1;
+    Args args(conf, this, errh);
+    if (_bytes)
+	args.read_mp("HOST_RATE", BandwidthArg(), rate[0])
+	    .read_mp("PREFIX_RATE", BandwidthArg(), rate[1]);
+    else
+	args.read_mp("HOST_RATE", rate[0])
+	    .read_mp("PREFIX_RATE", rate[1]);
+    if (args.read("HOST_BURST", burst[0]).read_status(have_burst[0])
+	.read("PREFIX_BURST", burst[1]).read_status(have_burst[1])
+	.read("PREFIX", prefix)
+	.read("DST", _dst)
+	.read("CAPACITY", _capacity)
+	.complete() < 0)
+	return -1;
+
+    if (prefix < 0 || prefix > 32)
+	return errh->error("PREFIX must be between 0 and 32");
+    if (_capacity < WAYS)
+	return errh->error("CAPACITY must be at least %d", (int) WAYS);
+
+    for (int i = 0; i < 2; i++) {
+	Level &l = _levels[i];
+	l.enabled = rate[i] != 0;
+	if (!have_burst[i]) {
+	    burst[i] = rate[i] / 50;
+	    if (burst[i] < (_bytes ? 1500U : 1U))
+		burst[i] = _bytes ? 1500 : 1;
+	}
+	l.rate.assign(rate[i], burst[i] ? burst[i] : 1);
+    }
+    _levels[0].mask = 0xFFFFFFFFU;
+    _levels[1].mask = prefix ? 0xFFFFFFFFU << (32 - prefix) : 0;
+    return 0;
+}
+
+int
+IPPolicer::initialize(ErrorHandler *)
+{
+    uint32_t nsets = 1;
+    while (nsets * WAYS < _capacity)
+	nsets <<= 1;
+    for (int i = 0; i < 2; i++)
+	if (_levels[i].enabled) {
+	    _levels[i].sets = CLICK_ALIGNED_NEW(Set, nsets);
+	    memset(_levels[i].sets, 0, sizeof(Set) * nsets);
+	    _levels[i].nsets = nsets;
+	}
+    return 0;
+}
+
+void
+IPPolicer::cleanup(CleanupStage)
+{
+    for (int i = 0; i < 2; i++)
+	if (_levels[i].sets) {
+	    CLICK_ALIGNED_DELETE(_levels[i].sets, Set, _levels[i].nsets);
+	    _levels[i].sets = 0;
+	}
+}
+
+/* Returns the slot of ADDR in level L, installing it in place of the least
+   recently used slot of its set if needed. A slot is installed in two steps:
+   its meta is claimed as INSTALLING, then its counter is reset, and only then
+   is the key published, so no thread sees the key with the counter of the
+   evicted one. */
+inline IPPolicer::Slot *
+IPPolicer::find(Level &l, uint32_t addr, time_point_type now, Stats &st)
+{
+    uint32_t key = addr & l.mask;
+    uint32_t h = key * 0x9E3779B1U;
+    Set &set = l.sets[(h ^ (h >> 16)) & (l.nsets - 1)];
+    // Last use, in jiffies, never 0
+    uint32_t use = now | 1;
+
+    while (1) {
+	Slot *victim = 0;
+	uint64_t victim_meta = 0;
+	uint32_t victim_age = 0;
+	bool installing = false;
+	for (int w = 0; w < WAYS; w++) {
+	    Slot *s = &set.slot[w];
+	    uint64_t meta = s->meta;
+	    if ((uint32_t) meta == INSTALLING) {
+		// Wait for the key if another thread is installing it
+		if ((uint32_t) (meta >> 32) == key)
+		    installing = true;
+		continue;
+	    }
+	    if (meta && (uint32_t) (meta >> 32) == key) {
+		// If another thread refreshed or evicted the slot first,
+		// keep its value
+		if ((uint32_t) meta != use)
+		    atomic_uint64_t::compare_and_swap(s->meta, meta,
+						      ((uint64_t) key << 32) | use);
+		return s;
+	    }
+	    uint32_t age = meta ? use - (uint32_t) meta : 0xFFFFFFFFU;
+	    if (!victim || age > victim_age) {
+		victim = s;
+		victim_meta = meta;
+		victim_age = age;
+	    }
+	}
+
+	if (installing || !victim)
+	    continue;
+
+	// Another thread may install the same key, or take the victim,
+	// first: then look again
+	if (atomic_uint64_t::compare_and_swap(victim->meta, victim_meta,
+					      ((uint64_t) key << 32) | INSTALLING)) {
+	    // Threads that found the evicted key may still take tokens
+	    counter_type c(true);
+	    c.set_time_point(now);
+	    uint64_t old = victim->counter;
+	    while (!atomic_uint64_t::compare_and_swap(victim->counter, old, counter_word(c)))
+		old = victim->counter;
+	    click_write_fence();
+	    victim->meta = ((uint64_t) key << 32) | use;
+	    if (victim_meta)
+		st.evictions++;
+	    return victim;
+	}
+    }
+}
+
+/* Takes TOKENS tokens from slot S of level L, if it has them. */
+inline bool
+IPPolicer::take(Level &l, Slot *s, unsigned tokens, time_point_type now)
+{
+    uint64_t old = s->counter;
+    while (1) {
+	counter_type c = word_counter(old);
+	c.refill(l.rate, now);
+	if (!c.remove_if(l.rate, tokens))
+	    return false;
+	if (atomic_uint64_t::compare_and_swap(s->counter, old, counter_word(c)))
+	    return true;
+	old = s->counter;
+    }
+}
+
+inline int
+IPPolicer::classify(Packet *p, time_point_type now, Stats &st)
+{
+    const click_ip *ip = p->ip_header();
+    uint32_t addr = ntohl(_dst ? ip->ip_dst.s_addr : ip->ip_src.s_addr);
+    unsigned tokens = _bytes ? p->length() : 1;
+
+    Slot *prefix = 0;
+    if (_levels[1].enabled) {
+	// Check the prefix first, so that hosts do not lose tokens for
+	// packets over the prefix limit
+	prefix = find(_levels[1], addr, now, st);
+	counter_type c = word_counter(prefix->counter);
+	c.refill(_levels[1].rate, now);
+	if (!c.contains(_levels[1].rate, tokens))
+	    goto exceed;
+    }
+    if (_levels[0].enabled
+	&& !take(_levels[0], find(_levels[0], addr, now, st), tokens, now))
+	goto exceed;
+    if (prefix && !take(_levels[1], prefix, tokens, now))
+	goto exceed;
+    st.conform++;
+    return 0;
+
+  exceed:
+    st.exceed++;
+    return 1;
+}
+
+void
+IPPolicer::push(int, Packet *p)
+{
+    checked_output_push(classify(p, IPPolicerParameters::now(), *_stats), p);
+}
+
+#if HAVE_BATCH
+void
+IPPolicer::push_batch(int, PacketBatch *batch)
+{
+    time_point_type now = IPPolicerParameters::now();
+    Stats &st = *_stats;
+    auto fnt = [this, now, &st](Packet *p) { return classify(p, now, st); };
+    CLASSIFY_EACH_PACKET(2, fnt, batch, checked_output_push_batch);
+}
+#endif
+
+String
+IPPolicer::read_handler(Element *e, void *thunk)
+{
+    IPPolicer *pol = static_cast<IPPolicer *>(e);
+    uint64_t n = 0;
+    int what = (uintptr_t) thunk;
+    if (what == h_hosts || what == h_prefixes) {
+	Level &l = pol->_levels[what == h_prefixes];
+	for (uint32_t i = 0; i < l.nsets; i++)
+	    for (int w = 0; w < WAYS; w++)
+		n += l.sets[i].slot[w].meta != 0;
+	return String(n);
+    }
+    for (unsigned i = 0; i < pol->_stats.weight(); i++) {
+	const Stats &st = pol->_stats.get_value(i);
+	n += (what == h_conform ? st.conform
+	      : what == h_exceed ? st.exceed : st.evictions);
+    }
+    return String(n);
+}
+
+void
+IPPolicer::add_handlers()
+{
+    add_read_handler("conform", read_handler, h_conform);
+    add_read_handler("exceed", read_handler, h_exceed);
+    add_read_handler("evictions", read_handler, h_evictions);
+    add_read_handler("hosts", read_handler, h_hosts);
+    add_read_handler("prefixes", read_handler, h_prefixes);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(IPPolicer)
+ELEMENT_MT_SAFE(IPPolicer)
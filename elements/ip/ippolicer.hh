@@ -0,0 +1,216 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_IPPOLICER_HH
+#define CLICK_IPPOLICER_HH
+#include <click/batchelement.hh>
+#include <click/tokenbucket.hh>
+#include <click/atomic.hh>
+#include <click/multithread.hh>
+CLICK_DECLS
+
+/*
+=c
+
+IPPolicer(HOST_RATE, PREFIX_RATE [, I<keywords> HOST_BURST, PREFIX_BURST, PREFIX, BYTES, DST, CAPACITY])
+
+=s ipmeasure
+
+polices IP traffic per source address and per source prefix
+
+=d
+
+IPPolicer limits the rate of every source address to HOST_RATE, and the rate
+of every prefix of PREFIX bits to PREFIX_RATE, with one token bucket per
+address and per prefix. Packets within both limits are emitted on output 0;
+the others are emitted on output 1, if it exists, or dropped. Packets that
+exceed a limit take no tokens. A rate of 0 disables that level.
+
+Buckets take 8 bytes, and are refilled when packets use them, so millions of
+them can be kept. Each level has a table of CAPACITY buckets, organized in
+sets of 4 buckets that fill a cache line: an address or prefix may only use
+the 4 buckets of its set. When they are all taken, the bucket used the
+longest time ago in the set is reused. A bucket idle for long enough to
+refill is full, so reusing it loses nothing; size CAPACITY so that active
+sources fit.
+
+The tables take no lock: threads install buckets and take tokens with atomic
+compare-and-swap operations, so any number of threads can push packets
+through one IPPolicer. Packets must have their IP header annotation set.
+
+Keyword arguments are:
+
+=over 8
+
+=item HOST_BURST, PREFIX_BURST
+
+Integer. Capacity of the buckets of addresses and of prefixes, in packets,
+or in bytes if BYTES is true. Default is 20ms worth of the rate, and at least
+one packet, or 1500 bytes.
+
+=item PREFIX
+
+Integer between 0 and 32. Length of the prefixes. Default is 24.
+
+=item BYTES
+
+Boolean. If true, the rates are bandwidths, and buckets count bytes. Default
+is false: rates are in packets per second.
+
+=item DST
+
+Boolean. If true, police destination addresses instead of source addresses.
+Default is false.
+
+=item CAPACITY
+
+Integer. Number of buckets of each level. Default is 1048576, for 8 MB of
+tokens and 8 MB of keys per level.
+
+=back
+
+=h conform read-only
+
+Returns the number of packets emitted on output 0.
+
+=h exceed read-only
+
+Returns the number of packets over a limit.
+
+=h evictions read-only
+
+Returns the number of buckets reused for another address or prefix.
+
+=h hosts, prefixes read-only
+
+Returns the number of buckets in use, for addresses or prefixes.
+
+=e
+
+   // 1000 packets per second per host, 20000 per /24
+   pol :: IPPolicer(1000, 20000, HOST_BURST 100, PREFIX_BURST 2000);
+   CheckIPHeader -> pol -> ...;
+   pol[1] -> Discard;
+
+=a
+
+RatedSplitter, BandwidthRatedSplitter, Meter, IPRateMonitor */
+
+/* TokenBucket parameters with 32-bit time points, so that a counter fits in
+   a 64-bit word. */
+class IPPolicerParameters : public TokenBucketJiffyParameters<unsigned> { public:
+
+    typedef uint32_t time_point_type;
+    typedef int32_t duration_type;
+
+    static time_point_type now() {
+	return click_jiffies();
+    }
+
+    static time_point_type time_point(time_point_type t) {
+	return t;
+    }
+
+    /* Time points of other threads may be a little ahead. */
+    static duration_type time_monotonic_difference(time_point_type a, time_point_type b) {
+	duration_type d = b - a;
+	return d > 0 ? d : 0;
+    }
+
+    static bool time_less(time_point_type a, time_point_type b) {
+	return (duration_type) (a - b) < 0;
+    }
+
+};
+
+class IPPolicer : public BatchElement { public:
+
+    IPPolicer() CLICK_COLD;
+    ~IPPolicer() CLICK_COLD;
+
+    const char *class_name() const override	{ return "IPPolicer"; }
+    const char *port_count() const override	{ return PORTS_1_1X2; }
+    const char *processing() const override	{ return PUSH; }
+
+    int configure(Vector<String> &, ErrorHandler *) override CLICK_COLD;
+    int initialize(ErrorHandler *) override CLICK_COLD;
+    void cleanup(CleanupStage) override CLICK_COLD;
+    void add_handlers() override CLICK_COLD;
+
+    void push(int port, Packet *p) override;
+#if HAVE_BATCH
+    void push_batch(int port, PacketBatch *batch) override;
+#endif
+
+  private:
+
+    typedef TokenRateX<IPPolicerParameters> rate_type;
+    typedef TokenCounterX<rate_type> counter_type;
+    typedef rate_type::time_point_type time_point_type;
+
+    // Last use of a slot being installed. Real last uses are odd.
+    enum { WAYS = 4, INSTALLING = 2 };
+
+    struct Slot {
+	volatile uint64_t meta;		// key << 32 | last use, 0 if free,
+					// key << 32 | INSTALLING while reset
+	volatile uint64_t counter;	// a counter_type
+    };
+
+    struct Set {
+	Slot slot[WAYS];
+    } CLICK_CACHE_ALIGN;
+
+    struct Level {
+	Set *sets;
+	uint32_t nsets;
+	uint32_t mask;			// of the addresses
+	rate_type rate;
+	bool enabled;
+	Level() : sets(0), nsets(0), mask(0), enabled(false) {
+	}
+    };
+
+    struct Stats {
+	uint64_t conform;
+	uint64_t exceed;
+	uint64_t evictions;
+	Stats() : conform(0), exceed(0), evictions(0) {
+	}
+    };
+
+    Level _levels[2];			// [0] addresses, [1] prefixes
+    bool _bytes;
+    bool _dst;
+    uint32_t _capacity;
+    per_thread<Stats> _stats;
+
+    static inline uint64_t counter_word(const counter_type &c);
+    static inline counter_type word_counter(uint64_t w);
+
+    inline Slot *find(Level &l, uint32_t addr, time_point_type now, Stats &st);
+    inline bool take(Level &l, Slot *s, unsigned tokens, time_point_type now);
+    inline int classify(Packet *p, time_point_type now, Stats &st);
+
+    enum { h_conform, h_exceed, h_evictions, h_hosts, h_prefixes };
+    static String read_handler(Element *, void *) CLICK_COLD;
+
+};
+
+inline uint64_t
+IPPolicer::counter_word(const counter_type &c)
+{
+    static_assert(sizeof(counter_type) == sizeof(uint64_t), "counter must fit a word");
+    uint64_t w;
+    memcpy(&w, &c, sizeof(w));
+    return w;
+}
+
+inline IPPolicer::counter_type
+IPPolicer::word_counter(uint64_t w)
+{
+    counter_type c;
+    memcpy(&c, &w, sizeof(w));
+    return c;
+}
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,465 @@
+// -*- c-basic-offset: 4 -*-
+/*
+ * ipratemonmp.{cc,hh} -- measures packet rates clustered by src/dst addr,
+ * with per-thread counters
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "ipratemonmp.hh"
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#include <click/packet_anno.hh>
+#include <clicknet/ip.h>
+CLICK_DECLS
+
+IPRateMonitorMP::IPRateMonitorMP()
+    : _count_packets(true), _anno_packets(true),
+      _fwd_anno(FWD_RATE_ANNO_OFFSET), _rev_anno(REV_RATE_ANNO_OFFSET),
+      _thresh(1), _memmax(0), _ratio(1), _period(Timestamp::make_msec(100)),
+      _timer(this), _mem(0), _generation(1), _resets(0), _resettime(0)
+{
+}
+
+IPRateMonitorMP::~IPRateMonitorMP()
+{
+}
+
+int
+IPRateMonitorMP::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    String count_what;
+    if (Args(conf, this, errh)
+	.read_mp("TYPE", WordArg(), count_what)
+	.read_mp("RATIO", FixedPointArg(16), _ratio)
+	.read_mp("THRESH", _thresh)
+	.read_p("MEMORY", _memmax)
+	.read_p("ANNO", _anno_packets)
+	.read("FWD_ANNO", AnnoArg(4), _fwd_anno)
+	.read("REV_ANNO", AnnoArg(4), _rev_anno)
+	.read("PERIOD", _period)
+	.complete() < 0)
+	return -1;
+    if (count_what.upper() == "PACKETS")
+	_count_packets = true;
+    else if (count_what.upper() == "BYTES")
+	_count_packets = false;
+    else
+	return errh->error("monitor type should be \"PACKETS\" or \"BYTES\"");
+
+#if HAVE_BATCH
+    if (_anno_packets
+	&& ((_fwd_anno < BATCH_COUNT_ANNO_OFFSET + BATCH_COUNT_ANNO_SIZE && _fwd_anno + 4 > BATCH_COUNT_ANNO_OFFSET)
+	    || (_rev_anno < BATCH_COUNT_ANNO_OFFSET + BATCH_COUNT_ANNO_SIZE && _rev_anno + 4 > BATCH_COUNT_ANNO_OFFSET)))
+	return errh->error("FWD_ANNO and REV_ANNO conflict with batching, move them or disable ANNO");
+#endif
+
+    if (_memmax && _memmax < MEMMAX_MIN)
+	_memmax = MEMMAX_MIN;
+    _memmax *= 1024;
+
+    if (_ratio > 0x10000)
+	return errh->error("ratio must be between 0 and 1");
+    if (!_period)
+	return errh->error("PERIOD must be positive");
+
+    // Set zoom-threshold as if ratio were 1.
+    _thresh = (_thresh * _ratio) >> 16;
+    return 0;
+}
+
+int
+IPRateMonitorMP::initialize(ErrorHandler *)
+{
+    _resettime = EWMAParameters::epoch();
+    _timer.initialize(this);
+    _timer.schedule_after(_period);
+    return 0;
+}
+
+void
+IPRateMonitorMP::free_stats(Stats *s, size_t &mem)
+{
+    for (int i = 0; i < Stats::MAX_COUNTERS; i++)
+	if (Counter *c = s->counter[i]) {
+	    if (c->next_level)
+		free_stats(c->next_level, mem);
+	    delete c;
+	    mem -= sizeof(Counter);
+	}
+    delete s;
+    mem -= sizeof(Stats);
+}
+
+void
+IPRateMonitorMP::cleanup(CleanupStage)
+{
+    for (unsigned i = 0; i < _threads.weight(); i++) {
+	Thread &t = _threads.get_value(i);
+	if (t.base)
+	    free_stats(t.base, t.mem);
+	t.base = 0;
+	t.snapshot.clear();
+    }
+}
+
+/* Applies the decisions of the last pass to the tree of this thread, and
+   publishes its counters for the next pass. Runs on the thread, once per
+   pass. */
+void
+IPRateMonitorMP::apply(Thread &t)
+{
+    _lock.acquire();
+    unsigned generation = _generation;
+    if (t.resets != _resets && t.base) {
+	free_stats(t.base, t.mem);
+	t.base = 0;
+    }
+    t.resets = _resets;
+    if (!t.base) {
+	t.base = new Stats;
+	t.mem += sizeof(Stats);
+    } else
+	apply(t, t.base, 0, 0);
+    _lock.release();
+
+    Vector<Entry> snapshot;
+    publish(t.base, 0, 0, snapshot);
+    t.lock.acquire();
+    t.snapshot.swap(snapshot);
+    t.snapshot_mem = t.mem;
+    t.lock.release();
+    t.generation = generation;
+}
+
+void
+IPRateMonitorMP::apply(Thread &t, Stats *s, int level, uint32_t prefix)
+{
+    int shift = 24 - 8 * level;
+    for (int i = 0; i < Stats::MAX_COUNTERS; i++) {
+	Counter *c = s->counter[i];
+	if (!c)
+	    continue;
+	uint32_t addr = prefix | (i << shift);
+	Merged *m = _merged.findp(make_key(level, addr));
+
+	// Forget the counters that nobody uses anymore
+	if (!m && !c->next_level) {
+	    c->rate.update(0);
+	    if (!c->rate.scaled_average(0) && !c->rate.scaled_average(1)) {
+		delete c;
+		t.mem -= sizeof(Counter);
+		s->counter[i] = 0;
+		continue;
+	    }
+	}
+
+	for (int r = 0; r < 2; r++) {
+	    int64_t others = m ? m->rate[r] - c->published[r] : 0;
+	    c->others[r] = others > 0 ? others : 0;
+	}
+
+	if (m && m->split && level < 3) {
+	    if (!c->next_level) {
+		c->next_level = new Stats;
+		t.mem += sizeof(Stats);
+	    }
+	} else if (c->next_level) {
+	    free_stats(c->next_level, t.mem);
+	    c->next_level = 0;
+	}
+	if (c->next_level)
+	    apply(t, c->next_level, level + 1, addr);
+    }
+}
+
+void
+IPRateMonitorMP::publish(Stats *s, int level, uint32_t prefix, Vector<Entry> &snapshot)
+{
+    int shift = 24 - 8 * level;
+    for (int i = 0; i < Stats::MAX_COUNTERS; i++) {
+	Counter *c = s->counter[i];
+	if (!c)
+	    continue;
+	uint32_t addr = prefix | (i << shift);
+	c->rate.update(0);
+	c->published[0] = c->rate.scaled_average(0);
+	c->published[1] = c->rate.scaled_average(1);
+	Entry e;
+	e.key = make_key(level, addr);
+	e.rate = c->rate;
+	snapshot.push_back(e);
+	if (c->next_level)
+	    publish(c->next_level, level + 1, addr, snapshot);
+    }
+}
+
+inline void
+IPRateMonitorMP::update(Thread &t, Packet *p, bool forward, bool update_ewma)
+{
+    if (unlikely(t.generation != _generation))
+	apply(t);
+
+    const click_ip *ip = p->ip_header();
+    int val = _count_packets ? 1 : ntohs(ip->ip_len);
+    uint32_t addr = ntohl(forward ? ip->ip_src.s_addr : ip->ip_dst.s_addr);
+    int ratenum = forward ? 0 : 1;
+
+    // Zoom in to the deepest level, updating every level on the way
+    Stats *s = t.base;
+    Counter *c;
+    for (int shift = 24; ; shift -= 8) {
+	unsigned char byte = (addr >> shift) & 255;
+	if (!(c = s->counter[byte])) {
+	    c = s->counter[byte] = new Counter;
+	    t.mem += sizeof(Counter);
+	}
+	if (update_ewma)
+	    c->rate.update(val, ratenum);
+	if (!c->next_level)
+	    break;
+	s = c->next_level;
+    }
+
+    if (_anno_packets) {
+	int freq = EWMAParameters::epoch_frequency();
+	int fwd_rate = c->rate.scaled_average(0) + c->others[0];
+	int rev_rate = c->rate.scaled_average(1) + c->others[1];
+	p->set_anno_s32(_fwd_anno, (fwd_rate * freq) >> scale);
+	p->set_anno_s32(_rev_anno, (rev_rate * freq) >> scale);
+    }
+}
+
+inline void
+IPRateMonitorMP::process(int port, Packet *p)
+{
+    // Only inspect 1 in RATIO packets
+    bool ewma = ((unsigned) ((click_random() >> 5) & 0xffff) <= _ratio);
+    update(*_threads, p, port == 0, ewma);
+}
+
+void
+IPRateMonitorMP::push(int port, Packet *p)
+{
+    process(port, p);
+    output(port).push(p);
+}
+
+#if HAVE_BATCH
+void
+IPRateMonitorMP::push_batch(int port, PacketBatch *batch)
+{
+    FOR_EACH_PACKET(batch, p)
+	process(port, p);
+    output(port).push_batch(batch);
+}
+#endif
+
+/* Merges the counters published by the threads, and decides which subnets
+   to split. */
+void
+IPRateMonitorMP::merge()
+{
+    MergedMap merged;
+    size_t mem = 0;
+    for (unsigned i = 0; i < _threads.weight(); i++) {
+	Thread &t = _threads.get_value(i);
+	t.lock.acquire();
+	for (int j = 0; j < t.snapshot.size(); j++) {
+	    MyEWMA rate = t.snapshot[j].rate;
+	    rate.update(0);
+	    Merged &m = merged.find_force(t.snapshot[j].key);
+	    m.rate[0] += rate.scaled_average(0);
+	    m.rate[1] += rate.scaled_average(1);
+	}
+	mem += t.snapshot_mem;
+	t.lock.release();
+    }
+
+    _lock.acquire();
+    unsigned now = EWMAParameters::epoch();
+    Vector<uint64_t> expired;
+    for (HashMap<uint64_t, unsigned>::iterator it = _frozen.begin(); it.live(); it++)
+	if ((int) (it.value() - now) <= 0)
+	    expired.push_back(it.key());
+    for (int i = 0; i < expired.size(); i++)
+	_frozen.erase(expired[i]);
+
+    // Over the memory limit, only keep the splits of the busiest subnets
+    bool over = _memmax && mem > _memmax;
+    Vector<int64_t> rates;
+    int freq = EWMAParameters::epoch_frequency();
+    for (MergedMap::iterator it = merged.begin(); it.live(); it++) {
+	Merged &m = it.value();
+	int level = it.key() >> 32;
+	int64_t rate = (m.rate[0] > m.rate[1] ? m.rate[0] : m.rate[1]);
+	if (level < 3 && ((rate * freq) >> scale) >= _thresh
+	    && !_frozen.findp(it.key())) {
+	    Merged *old = _merged.findp(it.key());
+	    m.split = !over || (old && old->split);
+	    if (m.split && over)
+		rates.push_back(rate);
+	}
+    }
+    if (over && rates.size()) {
+	click_qsort(rates.begin(), rates.size());
+	int64_t min_rate = rates[rates.size() / 10];
+	for (MergedMap::iterator it = merged.begin(); it.live(); it++)
+	    if (it.value().split
+		&& it.value().rate[0] < min_rate && it.value().rate[1] < min_rate)
+		it.value().split = false;
+    }
+
+    _merged.swap(merged);
+    _mem = mem;
+    _generation++;
+    _lock.release();
+}
+
+void
+IPRateMonitorMP::run_timer(Timer *)
+{
+    merge();
+    _timer.reschedule_after(_period);
+}
+
+String
+IPRateMonitorMP::look()
+{
+    StringAccum sa;
+    sa << (EWMAParameters::epoch() - _resettime) << "\n";
+
+    Vector<Pair<uint64_t, Merged> > entries;
+    _lock.acquire();
+    for (MergedMap::iterator it = _merged.begin(); it.live(); it++)
+	entries.push_back(make_pair(it.key(), it.value()));
+    _lock.release();
+
+    // Sort by prefix, then by level: each subnet is followed by its subnets
+    Vector<uint64_t> order;
+    for (int i = 0; i < entries.size(); i++)
+	order.push_back(((entries[i].first & 0xFFFFFFFFU) << 2) | (entries[i].first >> 32));
+    Vector<int> perm;
+    for (int i = 0; i < order.size(); i++)
+	perm.push_back(i);
+    click_qsort(perm.begin(), perm.size(), sizeof(int),
+		[](const void *a, const void *b, void *o) -> int {
+		    const Vector<uint64_t> &order = *static_cast<const Vector<uint64_t> *>(o);
+		    uint64_t x = order[*static_cast<const int *>(a)];
+		    uint64_t y = order[*static_cast<const int *>(b)];
+		    return x < y ? -1 : (x > y ? 1 : 0);
+		}, &order);
+
+    int freq = EWMAParameters::epoch_frequency();
+    for (int i = 0; i < perm.size(); i++) {
+	const Merged &m = entries[perm[i]].second;
+	if (m.rate[0] <= 0 && m.rate[1] <= 0)
+	    continue;
+	int level = entries[perm[i]].first >> 32;
+	uint32_t addr = entries[perm[i]].first;
+	for (int l = 0; l < level; l++)
+	    sa << '\t';
+	for (int l = 0; l <= level; l++)
+	    sa << (l ? "." : "") << ((addr >> (24 - 8 * l)) & 255);
+	sa << '\t' << cp_unparse_real2(m.rate[0] * freq, scale)
+	   << '\t' << cp_unparse_real2(m.rate[1] * freq, scale) << '\n';
+    }
+    return sa.take_string();
+}
+
+String
+IPRateMonitorMP::read_handler(Element *e, void *thunk)
+{
+    IPRateMonitorMP *rm = static_cast<IPRateMonitorMP *>(e);
+    switch ((uintptr_t) thunk) {
+    case h_look:
+	return rm->look();
+    case h_memmax:
+	return String(rm->_memmax / 1024);
+    default:
+	return String();
+    }
+}
+
+int
+IPRateMonitorMP::write_handler(const String &str, Element *e, void *thunk, ErrorHandler *errh)
+{
+    IPRateMonitorMP *rm = static_cast<IPRateMonitorMP *>(e);
+    switch ((uintptr_t) thunk) {
+    case h_reset:
+	for (unsigned i = 0; i < rm->_threads.weight(); i++) {
+	    Thread &t = rm->_threads.get_value(i);
+	    t.lock.acquire();
+	    t.snapshot.clear();
+	    t.lock.release();
+	}
+	rm->_lock.acquire();
+	rm->_merged.clear();
+	rm->_resets++;
+	rm->_generation++;
+	rm->_resettime = EWMAParameters::epoch();
+	rm->_lock.release();
+	return 0;
+    case h_memmax: {
+	uint32_t memmax;
+	if (!IntArg().parse(str, memmax))
+	    return errh->error("expecting 1 integer");
+	if (memmax && memmax < MEMMAX_MIN)
+	    memmax = MEMMAX_MIN;
+	rm->_memmax = memmax * 1024;
+	return 0;
+    }
+    case h_anno_level: {
+	IPAddress a;
+	int level, when;
+	if (Args(rm, errh).push_back_words(str)
+	    .read_mp("ADDR", a)
+	    .read_mp("LEVEL", level)
+	    .read_mp("WHEN", when)
+	    .complete() < 0)
+	    return -1;
+	if (level < 0 || level > 3)
+	    return errh->error("2nd argument specifies a level, between 0 and 3, to annotate");
+	if (when < 1)
+	    return errh->error("3rd argument specifies when this rule expires, must be > 0");
+	unsigned until = EWMAParameters::epoch() + when * EWMAParameters::epoch_frequency();
+	rm->_lock.acquire();
+	rm->_frozen.insert(make_key(level, ntohl(a.addr())), until);
+	// Fold the subnet at the next pass
+	if (Merged *m = rm->_merged.findp(make_key(level, ntohl(a.addr()))))
+	    m->split = false;
+	rm->_generation++;
+	rm->_lock.release();
+	return 0;
+    }
+    default:
+	return -1;
+    }
+}
+
+void
+IPRateMonitorMP::add_handlers()
+{
+    add_data_handlers("thresh", Handler::OP_READ, &_thresh);
+    add_data_handlers("mem", Handler::OP_READ, &_mem);
+    add_read_handler("look", read_handler, h_look);
+    add_read_handler("memmax", read_handler, h_memmax);
+    add_write_handler("memmax", write_handler, h_memmax);
+    add_write_handler("reset", write_handler, h_reset, Handler::BUTTON);
+    add_write_handler("anno_level", write_handler, h_anno_level);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(userlevel IPRateMonitor)
+EXPORT_ELEMENT(IPRateMonitorMP)
+ELEMENT_MT_SAFE(IPRateMonitorMP)
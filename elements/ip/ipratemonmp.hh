@@ -0,0 +1,215 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_IPRATEMONMP_HH
+#define CLICK_IPRATEMONMP_HH
+#include <click/batchelement.hh>
+#include <click/hashmap.hh>
+#include <click/sync.hh>
+#include <click/timer.hh>
+#include <click/vector.hh>
+#include "ipratemon.hh"
+CLICK_DECLS
+
+/*
+=c
+
+IPRateMonitorMP(TYPE, RATIO, THRESH [, MEMORY, ANNO, I<keywords> FWD_ANNO, REV_ANNO, PERIOD])
+
+=s ipmeasure
+
+measures coming and going IP traffic rates, on several threads
+
+=d
+
+IPRateMonitorMP measures the same rates as IPRateMonitor, and takes the same
+arguments, but packets are counted without taking a lock, so that several
+threads can push packets through it at full speed.
+
+Each thread keeps its own tree of counters, that only it updates. Every
+PERIOD, a background pass merges the counters of all threads, and decides
+which subnets to split, because their total rate exceeds THRESH, and which to
+fold back. Each thread applies these decisions the next time it processes a
+packet, and then publishes its counters for the next pass. The rate
+annotations of a packet are the rate measured by its thread plus the rates of
+the other threads at the last pass. The look handler and the memory limit
+also use the merged counters, so they lag by up to two PERIODs.
+
+Packets coming on input 0 are counted by source address, and packets coming
+on input 1 by destination address.
+
+Keyword arguments are those of IPRateMonitor, and:
+
+=over 8
+
+=item FWD_ANNO
+
+Annotation offset of the 4-byte forward rate. Default is the fwd_rate
+annotation, used by CompareBlock.
+
+=item REV_ANNO
+
+Annotation offset of the 4-byte reverse rate. Default is the rev_rate
+annotation, used by CompareBlock. With batching, it overlaps the batch
+annotations, and the configuration is rejected: then, move it, or set ANNO to
+false. Pick an annotation that no other element of the configuration uses:
+for instance, 28 is the extra length annotation, that HeaderTee sets and
+ToDump or ToIPSummaryDump read.
+
+=item PERIOD
+
+Time between two merges of the counters of the threads. Default is 100ms.
+
+=back
+
+=h look read-only
+
+Returns the merged rates, like the look handler of IPRateMonitor.
+
+=h thresh read-only
+
+Returns THRESH.
+
+=h mem read-only
+
+Returns the memory used by the counters of all threads at the last pass, in
+bytes.
+
+=h memmax read/write
+
+Returns or sets MEMORY.
+
+=h reset write-only
+
+Resets all rates.
+
+=h anno_level write-only
+
+Expects "IPAddress level when", like the anno_level handler of
+IPRateMonitor.
+
+=e
+
+   fd :: FromDPDKDevice(0, MAXTHREADS 4)
+       -> CheckIPHeader(14)
+       -> rm :: IPRateMonitorMP(PACKETS, 1, 1000, REV_ANNO 28)
+       -> ...
+
+=a IPRateMonitor, CompareBlock */
+
+class IPRateMonitorMP : public BatchElement { public:
+
+    IPRateMonitorMP() CLICK_COLD;
+    ~IPRateMonitorMP() CLICK_COLD;
+
+    const char *class_name() const override	{ return "IPRateMonitorMP"; }
+    const char *port_count() const override	{ return "1-2/1-2"; }
+    const char *processing() const override	{ return PUSH; }
+
+    int configure(Vector<String> &, ErrorHandler *) override CLICK_COLD;
+    int initialize(ErrorHandler *) override CLICK_COLD;
+    void cleanup(CleanupStage) override CLICK_COLD;
+    void add_handlers() override CLICK_COLD;
+
+    void push(int port, Packet *p) override;
+#if HAVE_BATCH
+    void push_batch(int port, PacketBatch *batch) override;
+#endif
+
+    void run_timer(Timer *) override;
+
+    typedef IPRateMonitor::EWMAParameters EWMAParameters;
+    typedef IPRateMonitor::MyEWMA MyEWMA;
+
+  private:
+
+    enum { scale = IPRateMonitor::scale, MEMMAX_MIN = 100 };
+
+    struct Stats;
+
+    struct Counter {
+	MyEWMA rate;		// measured by this thread, [0] forward
+	Stats *next_level;
+	int others[2];		// scaled rates of the other threads
+	int published[2];	// scaled rates at the last publication
+	Counter() : next_level(0) {
+	    others[0] = others[1] = published[0] = published[1] = 0;
+	}
+    };
+
+    struct Stats {
+	enum { MAX_COUNTERS = 256 };
+	Counter *counter[MAX_COUNTERS];
+	Stats() {
+	    memset(counter, 0, sizeof(counter));
+	}
+    };
+
+    // A counter, identified by its level (0 to 3) and its prefix
+    struct Entry {
+	uint64_t key;
+	MyEWMA rate;
+    };
+
+    struct Merged {
+	int64_t rate[2];	// scaled rates of all threads
+	bool split;
+	Merged() : split(false) {
+	    rate[0] = rate[1] = 0;
+	}
+    };
+    typedef HashMap<uint64_t, Merged> MergedMap;
+
+    struct Thread {
+	Stats *base;
+	size_t mem;
+	unsigned generation;	// of the last decisions applied
+	unsigned resets;
+	Spinlock lock;		// protects snapshot
+	Vector<Entry> snapshot;
+	size_t snapshot_mem;
+	Thread() : base(0), mem(0), generation(0), resets(0), snapshot_mem(0) {
+	}
+    };
+
+    per_thread<Thread> _threads;
+
+    bool _count_packets;
+    bool _anno_packets;
+    int _fwd_anno;
+    int _rev_anno;
+    int _thresh;
+    size_t _memmax;
+    unsigned _ratio;
+    Timestamp _period;
+    Timer _timer;
+
+    // Decisions of the last pass, read by the threads once per pass
+    Spinlock _lock;
+    MergedMap _merged;
+    HashMap<uint64_t, unsigned> _frozen;	// prefix -> epoch, by anno_level
+    size_t _mem;
+    volatile unsigned _generation;
+    volatile unsigned _resets;
+    unsigned _resettime;
+
+    static inline uint64_t make_key(int level, uint32_t addr) {
+	uint32_t mask = 0xFFFFFFFFU << (24 - 8 * level);
+	return ((uint64_t) level << 32) | (addr & mask);
+    }
+
+    inline void update(Thread &t, Packet *p, bool forward, bool update_ewma);
+    inline void process(int port, Packet *p);
+    void apply(Thread &t);
+    void apply(Thread &t, Stats *s, int level, uint32_t prefix);
+    void publish(Stats *s, int level, uint32_t prefix, Vector<Entry> &snapshot);
+    static void free_stats(Stats *s, size_t &mem);
+    void merge();
+    String look();
+
+    enum { h_look, h_reset, h_memmax, h_anno_level };
+    static String read_handler(Element *, void *) CLICK_COLD;
+    static int write_handler(const String &, Element *, void *, ErrorHandler *) CLICK_COLD;
+
+};
+
+CLICK_ENDDECLS
+#endif
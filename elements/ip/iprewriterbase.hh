@@ -5,6 +5,7 @@
 #include "elements/ip/iprwmapping.hh"
 #include <click/batchelement.hh>
 #include <click/bitvector.hh>
+#include <click/allocator.hh>
 
 CLICK_DECLS
 class IPMapper;
@@ -2,11 +2,12 @@
 #define CLICK_SETIPCHECKSUM_HH
 #include <click/batchelement.hh>
 #include <click/glue.hh>
+#include <click/simd.hh>
 CLICK_DECLS
 
 /*
  * =c
- * SetIPChecksum()
+ * SetIPChecksum([I<keywords> SIMD])
  * =s ip
  * sets IP packets' checksums
  * =d
@@ -17,6 +18,19 @@ CLICK_DECLS
  * header, like DecIPTTL, SetIPDSCP, and IPRewriter, already update the
  * checksum incrementally.
  *
+ * Keyword arguments are:
+ *
+ * =over 8
+ *
+ * =item SIMD
+ *
+ * Boolean. If true, the checksums of the packets of a batch are computed
+ * eight at a time with vector instructions (SSE2, or AVX2 when the CPU
+ * supports it). Shared packets and headers with IP options are handled one by
+ * one. Defaults to true.
+ *
+ * =back
+ *
  * =a CheckIPHeader, DecIPTTL, SetIPDSCP, IPRewriter */
 
 class SetIPChecksum : public BatchElement { public:
@@ -26,6 +40,9 @@ class SetIPChecksum : public BatchElement { public:
 
     const char *class_name() const override		{ return "SetIPChecksum"; }
     const char *port_count() const override		{ return PORTS_1_1; }
+    const char *flags() const override		{ return "F"; }
+
+    int configure(Vector<String> &conf, ErrorHandler *errh) CLICK_COLD;
     void add_handlers() CLICK_COLD;
 
     Packet *simple_action(Packet *p);
@@ -36,6 +53,11 @@ class SetIPChecksum : public BatchElement { public:
   private:
 
     unsigned _drops;
+    bool _simd;
+
+#if HAVE_BATCH && CLICK_SIMD
+    PacketBatch *simd_action_batch(PacketBatch *);
+#endif
 
 };
 
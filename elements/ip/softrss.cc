@@ -0,0 +1,504 @@
+// -*- c-basic-offset: 4 -*-
+/*
+ * softrss.{cc,hh} -- software receive side scaling, with inner-header hashing
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "softrss.hh"
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#include <click/algorithm.hh>
+#include <clicknet/ip.h>
+#include <clicknet/ether.h>
+#if defined(__SSE4_2__)
+# include <nmmintrin.h>
+#endif
+CLICK_DECLS
+
+static const unsigned char default_key[40] = {
+    0x6d, 0x5a, 0x56, 0xda, 0x25, 0x5b, 0x0e, 0xc2,
+    0x41, 0x67, 0x25, 0x3d, 0x43, 0xa3, 0x8f, 0xb0,
+    0xd0, 0xca, 0x2b, 0xcb, 0xae, 0x7b, 0x30, 0xb4,
+    0x77, 0xcb, 0x2d, 0xa3, 0x80, 0x30, 0xf2, 0x0c,
+    0x6a, 0x42, 0xb7, 0x3b, 0xbe, 0xac, 0x01, 0xfa
+};
+
+SoftRSS::SoftRSS()
+    : _reta_mask(0), _offset(14), _anno(-1),
+      _fields(F_SRC | F_DST | F_SPORT | F_DPORT), _tunnel(0),
+      _crc(false), _symmetric(false)
+{
+}
+
+SoftRSS::~SoftRSS()
+{
+}
+
+int
+SoftRSS::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    String hash = "toeplitz", fields, tunnel;
+    String key((const char *) default_key, sizeof(default_key));
+    uint32_t reta_size = 128;
+    if (Args(conf, this, errh)
+	.read("HASH", WordArg(), hash)
+	.read("FIELDS", fields)
+	.read("SYMMETRIC", _symmetric)
+	.read("TUNNEL", tunnel)
+	.read("KEY", key)
+	.read("RETA_SIZE", reta_size)
+	.read("OFFSET", _offset)
+	.read("ANNO", AnnoArg(4), _anno)
+	.complete() < 0)
+	return -1;
+
+    if (hash == "toeplitz")
+	_crc = false;
+    else if (hash == "crc")
+	_crc = true;
+    else
+	return errh->error("HASH must be toeplitz or crc");
+
+    if (fields) {
+	Vector<String> words;
+	cp_spacevec(fields, words);
+	_fields = 0;
+	for (int i = 0; i < words.size(); i++) {
+	    if (words[i] == "src")
+		_fields |= F_SRC;
+	    else if (words[i] == "dst")
+		_fields |= F_DST;
+	    else if (words[i] == "sport")
+		_fields |= F_SPORT;
+	    else if (words[i] == "dport")
+		_fields |= F_DPORT;
+	    else if (words[i] == "proto")
+		_fields |= F_PROTO;
+	    else
+		return errh->error("unknown field %<%s%>", words[i].c_str());
+	}
+	if (!_fields)
+	    return errh->error("FIELDS is empty");
+    }
+
+    if (tunnel) {
+	Vector<String> words;
+	cp_spacevec(tunnel, words);
+	_tunnel = 0;
+	for (int i = 0; i < words.size(); i++) {
+	    if (words[i] == "gtp")
+		_tunnel |= T_GTP;
+	    else if (words[i] == "vxlan")
+		_tunnel |= T_VXLAN;
+	    else if (words[i] == "erspan")
+		_tunnel |= T_ERSPAN;
+	    else if (words[i] == "all")
+		_tunnel |= T_GTP | T_VXLAN | T_ERSPAN;
+	    else if (words[i] != "none")
+		return errh->error("unknown tunnel %<%s%>", words[i].c_str());
+	}
+    }
+
+    if (key.length() < 4)
+	return errh->error("KEY must be at least 4 bytes long");
+    _key = key;
+    if (reta_size == 0 || reta_size > 65536)
+	return errh->error("RETA_SIZE must be between 1 and 65536");
+    if (noutputs() > 65536)
+	return errh->error("too many outputs");
+    if (_offset < 0)
+	return errh->error("OFFSET must be positive");
+
+    uint32_t size = 1;
+    while (size < reta_size)
+	size <<= 1;
+    _reta.resize(size);
+    for (uint32_t i = 0; i < size; i++)
+	_reta[i] = i % noutputs();
+    _reta_mask = size - 1;
+    return 0;
+}
+
+int
+SoftRSS::initialize(ErrorHandler *)
+{
+    if (!_crc)
+	build_toeplitz();
+    for (unsigned i = 0; i < _counts.weight(); i++)
+	_counts.get_value(i).resize(_reta.size(), 0);
+    return 0;
+}
+
+/* The Toeplitz hash XORs, for every bit set in the input, the 32 bits of the
+   key starting at that bit. Precomputing the XOR of those windows for every
+   value of every input byte makes it one lookup per byte. */
+void
+SoftRSS::build_toeplitz()
+{
+    const unsigned char *key = reinterpret_cast<const unsigned char *>(_key.data());
+    int nbits = _key.length() * 8;
+    Vector<uint32_t> window(max_input * 8, 0);
+    for (int i = 0; i < window.size(); i++)
+	for (int b = 0; b < 32; b++) {
+	    int k = (i + b) % nbits;
+	    if (key[k / 8] & (0x80 >> (k % 8)))
+		window[i] |= 0x80000000U >> b;
+	}
+
+    _toeplitz.resize(max_input * 256);
+    for (int j = 0; j < max_input; j++) {
+	uint32_t *t = &_toeplitz[j * 256];
+	t[0] = 0;
+	for (int v = 1; v < 256; v++) {
+	    int low = ffs_lsb((uint32_t) v) - 1;
+	    t[v] = t[v & (v - 1)] ^ window[j * 8 + 7 - low];
+	}
+    }
+}
+
+static inline uint32_t
+crc32c(const unsigned char *data, int len)
+{
+    uint32_t crc = 0xFFFFFFFF;
+#if defined(__SSE4_2__)
+    for (; len >= 4; data += 4, len -= 4) {
+	uint32_t v;
+	memcpy(&v, data, 4);
+	crc = _mm_crc32_u32(crc, v);
+    }
+    for (; len > 0; data++, len--)
+	crc = _mm_crc32_u8(crc, *data);
+#else
+    for (; len > 0; data++, len--) {
+	crc ^= *data;
+	for (int b = 0; b < 8; b++)
+	    crc = (crc >> 1) ^ (0x82F63B78 & -(crc & 1));
+    }
+#endif
+    return ~crc;
+}
+
+bool
+SoftRSS::parse_ip(const unsigned char *ip, const unsigned char *end, IPInfo &info)
+{
+    if (end - ip < 1)
+	return false;
+    int v = ip[0] >> 4;
+    if (v == 4) {
+	int hl = (ip[0] & 0xF) << 2;
+	if (hl < (int) sizeof(click_ip) || end - ip < hl)
+	    return false;
+	info.src = ip + 12;
+	info.dst = ip + 16;
+	info.alen = 4;
+	info.proto = ip[9];
+	// Every fragment is hashed without ports, so they all go the same way
+	if ((ip[6] & 0x3F) || ip[7])
+	    info.l4 = 0;
+	else
+	    info.l4 = ip + hl;
+	return true;
+    } else if (v == 6) {
+	if (end - ip < 40)
+	    return false;
+	info.src = ip + 8;
+	info.dst = ip + 24;
+	info.alen = 16;
+	info.proto = ip[6];
+	info.l4 = ip + 40;
+	return true;
+    } else
+	return false;
+}
+
+static inline const unsigned char *
+ether_payload(const unsigned char *e, const unsigned char *end)
+{
+    if (end - e < 14)
+	return 0;
+    int off = 12;
+    uint16_t type = (e[off] << 8) | e[off + 1];
+    while (type == ETHERTYPE_8021Q || type == 0x88A8) {
+	off += 4;
+	if (end - e < off + 2)
+	    return 0;
+	type = (e[off] << 8) | e[off + 1];
+    }
+    if (type != ETHERTYPE_IP && type != ETHERTYPE_IP6)
+	return 0;
+    return e + off + 2;
+}
+
+const unsigned char *
+SoftRSS::inner_ip(const IPInfo &info, const unsigned char *end) const
+{
+    const unsigned char *l4 = info.l4;
+    if (!l4)
+	return 0;
+
+    if (info.proto == IP_PROTO_UDP && (_tunnel & (T_GTP | T_VXLAN))) {
+	if (end - l4 < 8)
+	    return 0;
+	uint16_t dport = (l4[2] << 8) | l4[3];
+	const unsigned char *h = l4 + 8;
+	if (dport == 2152 && (_tunnel & T_GTP)) {
+	    // GTPv1-U G-PDU, with the optional fields and extension headers
+	    if (end - h < 8 || (h[0] >> 5) != 1 || h[1] != 0xFF)
+		return 0;
+	    int off = 8;
+	    if (h[0] & 0x07) {
+		if (end - h < 12)
+		    return 0;
+		off = 12;
+		int next = (h[0] & 0x04) ? h[11] : 0;
+		while (next) {
+		    if (end - h < off + 1)
+			return 0;
+		    int len = h[off] * 4;
+		    if (len == 0 || end - h < off + len)
+			return 0;
+		    next = h[off + len - 1];
+		    off += len;
+		}
+	    }
+	    return h + off;
+	} else if (dport == 4789 && (_tunnel & T_VXLAN)) {
+	    if (end - h < 8 || !(h[0] & 0x08))
+		return 0;
+	    return ether_payload(h + 8, end);
+	}
+    } else if (info.proto == IP_PROTO_GRE && (_tunnel & T_ERSPAN)) {
+	if (end - l4 < 4)
+	    return 0;
+	uint16_t flags = (l4[0] << 8) | l4[1];
+	uint16_t proto = (l4[2] << 8) | l4[3];
+	int off = 4 + ((flags & 0xC000) ? 4 : 0) + ((flags & 0x2000) ? 4 : 0)
+	    + ((flags & 0x1000) ? 4 : 0);
+	const unsigned char *h = l4 + off;
+	if (proto == 0x88BE) {
+	    // Type I has no ERSPAN header, and no GRE sequence number
+	    if (flags & 0x1000) {
+		if (end - h < 8 || (h[0] >> 4) != 1)
+		    return 0;
+		h += 8;
+	    }
+	    return ether_payload(h, end);
+	} else if (proto == 0x22EB) {
+	    if (end - h < 12 || (h[0] >> 4) != 2)
+		return 0;
+	    h += (h[11] & 0x01) ? 20 : 12;
+	    return ether_payload(h, end);
+	}
+    }
+    return 0;
+}
+
+uint32_t
+SoftRSS::hash(Packet *p) const
+{
+    const unsigned char *end = p->end_data();
+    IPInfo info;
+    if (!parse_ip(p->data() + _offset, end, info))
+	return 0;
+    if (_tunnel) {
+	IPInfo inner;
+	const unsigned char *ip = inner_ip(info, end);
+	if (ip && parse_ip(ip, end, inner))
+	    info = inner;
+    }
+
+    static const unsigned char zero[2] = {0, 0};
+    const unsigned char *a = info.src, *b = info.dst, *pa = zero, *pb = zero;
+    if (info.l4 && end - info.l4 >= 4
+	&& (info.proto == IP_PROTO_TCP || info.proto == IP_PROTO_UDP
+	    || info.proto == IP_PROTO_SCTP)) {
+	pa = info.l4;
+	pb = info.l4 + 2;
+    }
+    if (_symmetric) {
+	int c = memcmp(a, b, info.alen);
+	if (c > 0 || (c == 0 && memcmp(pa, pb, 2) > 0)) {
+	    click_swap(a, b);
+	    click_swap(pa, pb);
+	}
+    }
+
+    unsigned char in[max_input];
+    int n = 0;
+    if (_fields & F_SRC) {
+	memcpy(in + n, a, info.alen);
+	n += info.alen;
+    }
+    if (_fields & F_DST) {
+	memcpy(in + n, b, info.alen);
+	n += info.alen;
+    }
+    if (_fields & F_SPORT) {
+	memcpy(in + n, pa, 2);
+	n += 2;
+    }
+    if (_fields & F_DPORT) {
+	memcpy(in + n, pb, 2);
+	n += 2;
+    }
+    if (_fields & F_PROTO)
+	in[n++] = info.proto;
+
+    if (_crc)
+	return crc32c(in, n);
+    uint32_t h = 0;
+    const uint32_t *t = _toeplitz.begin();
+    for (int j = 0; j < n; j++, t += 256)
+	h ^= t[in[j]];
+    return h;
+}
+
+void
+SoftRSS::push(int, Packet *p)
+{
+    output(process(p)).push(p);
+}
+
+#if HAVE_BATCH
+void
+SoftRSS::push_batch(int, PacketBatch *batch)
+{
+    auto fnt = [this](Packet *p) { return process(p); };
+    CLASSIFY_EACH_PACKET(noutputs() + 1, fnt, batch, checked_output_push_batch);
+}
+#endif
+
+void
+SoftRSS::loads(Vector<uint64_t> &entries, Vector<uint64_t> &outputs) const
+{
+    entries.assign(_reta.size(), 0);
+    outputs.assign(noutputs(), 0);
+    for (unsigned t = 0; t < _counts.weight(); t++) {
+	const Vector<uint64_t> &c = _counts.get_value(t);
+	for (int i = 0; i < c.size(); i++)
+	    entries[i] += c[i];
+    }
+    for (int i = 0; i < _reta.size(); i++)
+	outputs[_reta[i]] += entries[i];
+}
+
+void
+SoftRSS::rebalance()
+{
+    Vector<uint64_t> entries, outputs;
+    loads(entries, outputs);
+    // Each move strictly decreases the sum of the squared loads, so this
+    // terminates; the bound only guards against surprises
+    for (int iter = 0; iter < _reta.size(); iter++) {
+	int hi = 0, lo = 0;
+	for (int o = 1; o < outputs.size(); o++) {
+	    if (outputs[o] > outputs[hi])
+		hi = o;
+	    if (outputs[o] < outputs[lo])
+		lo = o;
+	}
+	uint64_t gap = outputs[hi] - outputs[lo];
+	int best = -1;
+	for (int i = 0; i < _reta.size(); i++)
+	    if (_reta[i] == hi && entries[i] > 0 && entries[i] < gap
+		&& (best < 0 || entries[i] > entries[best]))
+		best = i;
+	if (best < 0)
+	    break;
+	_reta[best] = lo;
+	outputs[hi] -= entries[best];
+	outputs[lo] += entries[best];
+    }
+    reset_counts();
+}
+
+void
+SoftRSS::reset_counts()
+{
+    for (unsigned t = 0; t < _counts.weight(); t++) {
+	Vector<uint64_t> &c = _counts.get_value(t);
+	for (int i = 0; i < c.size(); i++)
+	    c[i] = 0;
+    }
+}
+
+String
+SoftRSS::read_handler(Element *e, void *thunk)
+{
+    SoftRSS *rss = static_cast<SoftRSS *>(e);
+    StringAccum sa;
+    switch ((intptr_t) thunk) {
+    case h_reta:
+	for (int i = 0; i < rss->_reta.size(); i++)
+	    sa << (i ? " " : "") << rss->_reta[i];
+	return sa.take_string();
+    case h_loads: {
+	Vector<uint64_t> entries, outputs;
+	rss->loads(entries, outputs);
+	for (int o = 0; o < outputs.size(); o++)
+	    sa << (o ? " " : "") << outputs[o];
+	return sa.take_string();
+    }
+    default:
+	return String();
+    }
+}
+
+int
+SoftRSS::write_handler(const String &str, Element *e, void *thunk, ErrorHandler *errh)
+{
+    SoftRSS *rss = static_cast<SoftRSS *>(e);
+    switch ((intptr_t) thunk) {
+    case h_reta: {
+	Vector<String> words;
+	cp_spacevec(str, words);
+	if (words.size() == 0 || words.size() > rss->_reta.size())
+	    return errh->error("expected 1 to %d outputs", rss->_reta.size());
+	Vector<uint16_t> outs;
+	for (int i = 0; i < words.size(); i++) {
+	    int o;
+	    if (!IntArg().parse(words[i], o) || o < 0 || o >= rss->noutputs())
+		return errh->error("bad output %<%s%>", words[i].c_str());
+	    outs.push_back(o);
+	}
+	// Entries are updated in place: running threads see each entry
+	// either before or after the change
+	for (int i = 0; i < rss->_reta.size(); i++)
+	    rss->_reta[i] = outs[i % outs.size()];
+	return 0;
+    }
+    case h_rebalance:
+	rss->rebalance();
+	return 0;
+    case h_reset_counts:
+	rss->reset_counts();
+	return 0;
+    default:
+	return -1;
+    }
+}
+
+void
+SoftRSS::add_handlers()
+{
+    add_read_handler("reta", read_handler, h_reta);
+    add_write_handler("reta", write_handler, h_reta);
+    add_read_handler("loads", read_handler, h_loads);
+    add_write_handler("rebalance", write_handler, h_rebalance, Handler::BUTTON);
+    add_write_handler("reset_counts", write_handler, h_reset_counts, Handler::BUTTON);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(SoftRSS)
+ELEMENT_MT_SAFE(SoftRSS)
@@ -0,0 +1,196 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_SOFTRSS_HH
+#define CLICK_SOFTRSS_HH
+#include <click/batchelement.hh>
+#include <click/multithread.hh>
+#include <click/vector.hh>
+CLICK_DECLS
+
+/*
+=c
+
+SoftRSS([I<keywords> HASH, FIELDS, SYMMETRIC, TUNNEL, KEY, RETA_SIZE, OFFSET, ANNO])
+
+=s classification
+
+spreads flows over its outputs like NIC RSS, optionally by inner headers
+
+=d
+
+SoftRSS hashes the 5-tuple of each packet and emits it on the output found at
+that hash in an indirection table (RETA), like the receive side scaling of
+NICs. Connect its outputs to Pipeliner elements, or to queues served by
+different threads, to spread the load of one input over several cores.
+
+Unlike the NIC, SoftRSS can hash the headers of the packet carried by a tunnel.
+All the traffic of one GTP-U, VXLAN or ERSPAN tunnel has the same outer
+5-tuple, so hardware RSS sends it to a single core, while the inner flows it
+carries can be spread. Packets whose tunnel cannot be parsed are hashed by
+their outer headers, and non-IP packets go to the first entry of the table.
+
+Input packets start with an Ethernet header, or with an IP header at OFFSET.
+IPv4 and IPv6 are supported, for both the outer and the inner headers. Ports
+are hashed for TCP, UDP and SCTP packets that are not fragments, and taken as 0
+otherwise, so all the fragments of a packet go to the same output.
+
+Keyword arguments are:
+
+=over 8
+
+=item HASH
+
+Either C<toeplitz> or C<crc>. Toeplitz is the hash of NIC RSS: with the same
+KEY and FIELDS, SoftRSS computes the same hash as the NIC. C<crc> is the
+CRC32-C of the fields, computed with the SSE 4.2 instructions when they are
+available; it is cheaper, but does not match any NIC. Default is toeplitz.
+
+=item FIELDS
+
+Space-separated list of the fields to hash, among C<src>, C<dst>, C<sport>,
+C<dport> and C<proto>. They are hashed in that order whatever the order given.
+Default is C<src dst sport dport>, as NIC RSS.
+
+=item SYMMETRIC
+
+Boolean. If true, both directions of a connection get the same hash, by
+ordering the addresses and ports before hashing. Default is false.
+
+=item TUNNEL
+
+Space-separated list of the tunnels to look into, among C<gtp> (GTP-U, UDP
+port 2152), C<vxlan> (UDP port 4789) and C<erspan> (GRE, ERSPAN types I to
+III), or C<all> or C<none>. Default is none.
+
+=item KEY
+
+Toeplitz key, at least 4 bytes, used cyclically when the hashed fields are
+longer. Default is the 40-byte key of the Microsoft RSS specification.
+
+=item RETA_SIZE
+
+Integer. Number of entries of the indirection table, rounded up to a power of
+two. Entry I initially maps to output I modulo the number of outputs. Default
+is 128.
+
+=item OFFSET
+
+Integer. Offset of the outer IP header. Default is 14.
+
+=item ANNO
+
+Annotation offset where the 4-byte hash is stored, as the NIC stores it in
+the descriptor. Default is not to store it.
+
+=back
+
+=h reta read/write
+
+Returns the output of each entry of the indirection table, space-separated.
+When written with fewer entries than RETA_SIZE, the list is repeated.
+
+=h loads read-only
+
+Returns the number of packets sent to each output since the last rebalance, as
+counted per table entry, space-separated.
+
+=h rebalance write-only
+
+Moves table entries from the most loaded output to the least loaded one until
+no move reduces the imbalance, using the packet counts since the last
+rebalance, then resets those counts. Only the flows of the moved entries change
+output. Write it periodically (e.g. from a Script) to follow the load.
+
+=h reset_counts write-only
+
+Resets the packet counts of the table entries.
+
+=e
+
+Spreads the inner flows of GTP-U tunnels over 4 cores:
+
+   FromDPDKDevice(0)
+       -> rss :: SoftRSS(TUNNEL gtp, SYMMETRIC true);
+   rss[0] -> Pipeliner -> ...
+   rss[1] -> Pipeliner -> ...
+   rss[2] -> Pipeliner -> ...
+   rss[3] -> Pipeliner -> ...
+
+   Script(TYPE ACTIVE, wait 1s, write rss.rebalance, loop)
+
+=a
+
+HashSwitch, CPUSwitch, Pipeliner, GTPDecap, ERSPANDecap */
+
+class SoftRSS : public BatchElement { public:
+
+    SoftRSS() CLICK_COLD;
+    ~SoftRSS() CLICK_COLD;
+
+    const char *class_name() const override	{ return "SoftRSS"; }
+    const char *port_count() const override	{ return "1/1-"; }
+    const char *processing() const override	{ return PUSH; }
+
+    int configure(Vector<String> &, ErrorHandler *) override CLICK_COLD;
+    int initialize(ErrorHandler *) override CLICK_COLD;
+    void add_handlers() override CLICK_COLD;
+
+    uint32_t hash(Packet *p) const;
+    inline int process(Packet *p);
+
+    void push(int port, Packet *p) override;
+#if HAVE_BATCH
+    void push_batch(int port, PacketBatch *batch) override;
+#endif
+
+    enum { F_SRC = 1, F_DST = 2, F_SPORT = 4, F_DPORT = 8, F_PROTO = 16 };
+    enum { T_GTP = 1, T_VXLAN = 2, T_ERSPAN = 4 };
+    enum { max_input = 16 + 16 + 2 + 2 + 1 };
+
+  private:
+
+    struct IPInfo {
+	const unsigned char *src;
+	const unsigned char *dst;
+	const unsigned char *l4;
+	int alen;
+	int proto;
+    };
+
+    Vector<uint32_t> _toeplitz;
+    Vector<uint16_t> _reta;
+    per_thread<Vector<uint64_t> > _counts;
+    uint32_t _reta_mask;
+    String _key;
+    int _offset;
+    int _anno;
+    int _fields;
+    int _tunnel;
+    bool _crc;
+    bool _symmetric;
+
+    static bool parse_ip(const unsigned char *ip, const unsigned char *end, IPInfo &info);
+    const unsigned char *inner_ip(const IPInfo &info, const unsigned char *end) const;
+    void build_toeplitz();
+    void loads(Vector<uint64_t> &entries, Vector<uint64_t> &outputs) const;
+    void rebalance();
+    void reset_counts();
+
+    enum { h_reta, h_loads, h_rebalance, h_reset_counts };
+    static String read_handler(Element *, void *) CLICK_COLD;
+    static int write_handler(const String &, Element *, void *, ErrorHandler *) CLICK_COLD;
+
+};
+
+inline int
+SoftRSS::process(Packet *p)
+{
+    uint32_t h = hash(p);
+    if (_anno >= 0)
+	p->set_anno_u32(_anno, h);
+    uint32_t i = h & _reta_mask;
+    (*_counts)[i]++;
+    return _reta[i];
+}
+
+CLICK_ENDDECLS
+#endif
@@ -27,7 +27,9 @@ CLICK_DECLS
 
 AddressTranslator::AddressTranslator()
   : _dynamic_mapping_allocation_direction(0),
-    _in_map(0), _out_map(0), _rover(0), _rover2(0), _nmappings(0)
+    _static_fwd(-1), _static_rev(-1), _binding_out(-1), _binding_in(-1),
+    _mportl(0), _mporth(0), _port_block(64), _timeout(0), _tick(1),
+    _timer(this)
 {
     // input 0: IPv6 arriving outward packets
     // input 1: IPv6 arriving inward packets
@@ -40,120 +42,18 @@ AddressTranslator::~AddressTranslator()
 {
 }
 
-AddressTranslator::Mapping::Mapping()
-  :  _prev(0), _next(0), _free_next(0)
-{
-}
-
 void
 AddressTranslator::cleanup(CleanupStage)
 {
-  if (_dynamic_mapping_allocation_direction==0)
-    {
-      clean_map(_in_map, 1);
-      clean_map(_out_map, 0);
-    }
-  else
-    {
-      clean_map(_in_map, 0);
-      clean_map(_out_map, 1);
-    }
-}
-
-void
-AddressTranslator::mapping_freed(Mapping *m, bool major_map)
-{
-  if (major_map)
-  {
-    if (_rover == m) {
-      _rover = m->get_next();
-      if (_rover == m)
-	_rover = 0;
-    }
-
-    _nmappings--;
-    if (_nmappings) {
-      Mapping * m_prev = m->free_next();
-      m_prev->set_next(m->get_next());
-    }
-  }
-
- else
-   {
-     if(_rover2 == m) {
-       _rover2 = m->get_next();
-       if (_rover2 == m)
-	 _rover2 = 0;
-     }
-     _nmappings2--;
-    if (_nmappings2) {
-      Mapping * m_prev = m->free_next();
-      m_prev->set_next(m->get_next());
-    }
-   }
-}
-
-void
-AddressTranslator::clean_map(Map6 &table, bool major_map)
-{
-
-  Mapping *to_free=0;
-  for (Map6::iterator iter = table.begin(); iter.live(); iter++) {
-    Mapping *m = iter.value();
-    m->set_free_next(to_free);
-    to_free = m;
-  }
-
-  while (to_free) {
-    Mapping *next = to_free->free_next();
-    mapping_freed(to_free, major_map);
-    delete to_free;
-    to_free = next;
+  for (unsigned i = 0; i < _state.weight(); i++) {
+    State &s = _state.get_value(i);
+    for (Map6::iterator iter = s._out_map.begin(); iter.live(); iter++)
+      delete iter.value();
+    s._out_map.clear();
+    s._in_map.clear();
+    memset(s._wheel, 0, sizeof(s._wheel));
+    s._nmappings = 0;
   }
-  table.clear();
-}
-
-unsigned short
-AddressTranslator::find_mport( )
-{
-  if (_mportl == _mporth || !_rover)
-    return _mportl;
-
-  Mapping * r = _rover;
-  Mapping * r2 = _rover2;
-  unsigned short this_mport = r->sport();
-  //click_chatter("in find_mport(), this_mport is %x", this_mport);
-
-  do {
-    Mapping *next = r->get_next();
-    Mapping *next2 = r2->get_next();
-    unsigned short next_mport = next->sport();
-    if (next_mport > this_mport +1)
-      {
-      goto found;
-     }
-    else if (next_mport <= this_mport) {
-      if (this_mport < _mporth)
-	{
-	  goto found;
-	}
-      else if (next_mport > _mportl) {
-	this_mport = _mportl -1;
-	goto found;
-      }
-    }
-    r = next;
-    r2=next2;
-    this_mport = next_mport;
-  } while (r!=_rover);
-
-  return 0;
-
- found:
-  _rover = r;
-  _rover2 = r2;
-  return this_mport+1;
-
 }
 
 //add an entry to the mapping table for dynamic mapping
@@ -202,6 +102,21 @@ AddressTranslator::add_map(IP6Address &iai, unsigned short ipi, IP6Address &mai,
 int
 AddressTranslator::configure(Vector<String> &conf, ErrorHandler *errh)
 {
+  uint32_t timeout = 300;
+  if (Args(this, errh).bind(conf)
+      .read("TIMEOUT", SecondsArg(), timeout)
+      .read("PORT_BLOCK", _port_block)
+      .consume() < 0)
+    return -1;
+  if (timeout == 0)
+    return errh->error("TIMEOUT must be positive");
+  if (_port_block == 0 || _port_block > 65536)
+    return errh->error("PORT_BLOCK must be between 1 and 65536");
+  _timeout = (click_jiffies_t) timeout * CLICK_HZ;
+  _tick = _timeout / (wheel_size / 2);
+  if (_tick == 0)
+    _tick = 1;
+
   _v.clear();
   int s = 0;
   IP6Address ia, ma, ea;
@@ -294,7 +209,8 @@ AddressTranslator::configure(Vector<String> &conf, ErrorHandler *errh)
   cp_spacevec(conf[s+i], words1);
 
 
-  if (cp_ip6_address(words1[0], (unsigned char *)&ipa6) && IntArg().parse(words1[1], port_start) && IntArg().parse(words1[2], port_end))
+  if (words1.size() == 3 && cp_ip6_address(words1[0], (unsigned char *)&ipa6) && IntArg().parse(words1[1], port_start) && IntArg().parse(words1[2], port_end)
+      && port_start > 0 && port_start <= port_end && port_end <= 65535)
     {
 	  _maddr = ipa6;
 	  _mportl = port_start;
@@ -307,479 +223,469 @@ AddressTranslator::configure(Vector<String> &conf, ErrorHandler *errh)
   return errh->nerrors() ? -1 : 0;
 }
 
-bool
-AddressTranslator::lookup(IP6Address &iai, unsigned short &ipi, IP6Address &mai, unsigned short &mpi, IP6Address &ea, unsigned short &ep, bool lookup_direction)
-{
 
-  if (( _number_of_smap >0 ) || (!_dynamic_portmapping))
-    {
-      //find the mapped entry in the table
-      for (int i=0; i<_v.size(); i++)
-	{
-	  bool match = true;
-	  if (_v[i]._static) //this is a static mapping entry
-	    {
-
-	      if (_static_mapping[0]  && (lookup_direction ==_dynamic_mapping_allocation_direction))
-		match =  match && (_v[i]._iai == iai);
-	      if (_static_mapping[1]  && (lookup_direction ==_dynamic_mapping_allocation_direction))
-		match =  match && (_v[i]._ipi == ipi);
-	      if (_static_mapping[0] && (lookup_direction != _dynamic_mapping_allocation_direction))
-		match =  match && (_v[i]._mai == mai);
-	      if (_static_mapping[1] && (lookup_direction != _dynamic_mapping_allocation_direction))
-		match =  match && (_v[i]._mpi == mpi);
-
-	      if (match)
-		{
-		  if (_static_mapping[2] && (lookup_direction == _dynamic_mapping_allocation_direction))
-		    mai = _v[i]._mai;
-		  else if (_static_mapping[2] && (lookup_direction != _dynamic_mapping_allocation_direction))
-		    iai = _v[i]._iai;
-		  else if (lookup_direction == _dynamic_mapping_allocation_direction)
-		    mai = iai;
-		  else if (lookup_direction != _dynamic_mapping_allocation_direction)
-		    iai = _v[i]._iai;
-
-		  if (_static_mapping[3])
-		    mpi = _v[i]._mpi;
-		  else if (lookup_direction == _dynamic_mapping_allocation_direction)
-		    mpi = ipi;
-		  else if (lookup_direction !=_dynamic_mapping_allocation_direction)
-		    ipi = mpi;
-		  return (true);
-		}
-	    }
-
-	  else  if (_v[i]._binding) //this is a dynamic bindign entry
-	    {
-	      if (lookup_direction ==0)
-		match =  (_v[i]._iai == iai);  //outward, check if the inner address matches
-	      else
-		match = (_v[i]._mai == mai); //inward, check if the map address matches
-	      if (match)
-		{
-		  if (lookup_direction==0) //outward packet
-		    {
-		      mai = _v[i]._mai;
-		      mpi = ipi;
-		    }
-		  else //inward packet
-		    {
-		      iai = _v[i]._iai;
-		      ipi = mpi;
-		    }
-		   return (true);
-		}
-	    }
-	}
-
-      //no match found
-      if (!_dynamic_mapping)
-	return false;
-      if (_dynamic_mapping_allocation_direction != lookup_direction)
-	return false;
-
-      if (!_dynamic_portmapping) // dynamic address mapping only, try to allocate an address
-	{
-
-	  for (int i=0; i<_v.size(); i++) {
-	    if ((_v[i]._binding == false ) && ((!_v[i]._static)))
-	      {
-		if (lookup_direction == 0) //outward packet
-		  {
-		    _v[i]._iai = iai;
-		    mai = _v[i]._mai;
-		    mpi = ipi;
-		  }
-		else  //inward packet
-		  {
-		    _v[i]._mai = mai;
-		    iai = _v[i]._iai;
-		    ipi = mpi;
-		  }
-
-		_v[i]._binding = true;
-		//_v[i]._t = time(NULL);
-		//_v[i]._t = MyEWMA2::now();
-
-		return (true);
-	      }
-
-	  }
-	}
-      return false;
-    }
-
-
-  //dynamic address and port mapping look up
-  IP6FlowID fd;
-  // create flowid & lookup in the _out_map or _in_map
-  if (lookup_direction ==0)  // outward lookup
-    {
-      fd = IP6FlowID(iai, ipi, ea, ep);
-      Mapping *m = _out_map.find(fd);
-      if (m) {
-	mai = m->flow_id().saddr();
-	mpi = m->flow_id().sport();
-	return true;
-      }
-    }
-  else //inward lookup
-    {
-      fd = IP6FlowID(ea, ep, mai, mpi);
-      Mapping *m = _in_map.find(fd);
-      if (m) {
-	iai = m->flow_id().daddr();
-	ipi = m->flow_id().dport();
-	return true;
-      }
+int
+AddressTranslator::initialize(ErrorHandler *)
+{
+  // The first matching entry of _v wins, as with a linear scan
+  for (int i = 0; i < _v.size(); i++)
+    if (_v[i]._static) {
+      unsigned short ipi = _static_mapping[1] ? _v[i]._ipi : 0;
+      unsigned short mpi = _static_mapping[1] ? _v[i]._mpi : 0;
+      IP6FlowID fwd(_v[i]._iai, ipi, IP6Address(), 0);
+      IP6FlowID rev(_v[i]._mai, mpi, IP6Address(), 0);
+      if (!_static_fwd.findp(fwd))
+	_static_fwd.insert(fwd, i);
+      if (!_static_rev.findp(rev))
+	_static_rev.insert(rev, i);
     }
+  for (int i = _v.size() - 1; i >= 0; i--)
+    if (!_v[i]._static && !_v[i]._binding)
+      _free_entries.push_back(i);
+
+  if (_dynamic_mapping && _dynamic_portmapping) {
+    int nblocks = ((int) _mporth - _mportl) / _port_block + 1;
+    _block_owner.assign(nblocks, -1);
+    for (int b = nblocks - 1; b >= 0; b--)
+      _free_blocks.push_back(b);
+    click_jiffies_t now = click_jiffies();
+    for (unsigned i = 0; i < _state.weight(); i++)
+      _state.get_value(i)._wheel_tick = now / _tick;
+    _timer.initialize(this);
+    _timer.schedule_after(Timestamp::make_jiffies(_tick));
+  }
+  return 0;
+}
 
-
-  if (lookup_direction != _dynamic_mapping_allocation_direction )
+bool
+AddressTranslator::lookup_static(IP6Address &iai, unsigned short &ipi, IP6Address &mai, unsigned short &mpi, bool lookup_direction)
+{
+  int i;
+  if (lookup_direction == _dynamic_mapping_allocation_direction)
+    i = _static_fwd.find(IP6FlowID(iai, _static_mapping[1] ? ipi : 0, IP6Address(), 0));
+  else
+    i = _static_rev.find(IP6FlowID(mai, _static_mapping[1] ? mpi : 0, IP6Address(), 0));
+  if (i < 0)
     return false;
 
-  // if lookup is not successful, create a new mapping if the lookup_direction is the same as the addressAllocationDirection
-  // first find the freeport and its corresponding map address, create new flowid
-   // then add to in_map and out_map
-
-  unsigned short new_mport = 0;
-  new_mport = find_mport(); //
-  //click_chatter("***********new port is %x", new_mport);
+  EntryMap &e = _v[i];
+  if (_static_mapping[2] && (lookup_direction == _dynamic_mapping_allocation_direction))
+    mai = e._mai;
+  else if (_static_mapping[2] && (lookup_direction != _dynamic_mapping_allocation_direction))
+    iai = e._iai;
+  else if (lookup_direction == _dynamic_mapping_allocation_direction)
+    mai = iai;
+  else if (lookup_direction != _dynamic_mapping_allocation_direction)
+    iai = e._iai;
+
+  if (_static_mapping[3])
+    mpi = e._mpi;
+  else if (lookup_direction == _dynamic_mapping_allocation_direction)
+    mpi = ipi;
+  else if (lookup_direction !=_dynamic_mapping_allocation_direction)
+    ipi = mpi;
+  return true;
+}
 
-  if (!new_mport) {
-      click_chatter("AddressTranslator ran out of ports");
+bool
+AddressTranslator::lookup_binding(IP6Address &iai, unsigned short &ipi, IP6Address &mai, unsigned short &mpi, bool lookup_direction)
+{
+  int i;
+  if (lookup_direction == 0) //outward, check if the inner address matches
+    i = _binding_out.find(IP6FlowID(iai, 0, IP6Address(), 0));
+  else //inward, check if the map address matches
+    i = _binding_in.find(IP6FlowID(mai, 0, IP6Address(), 0));
+
+  if (i < 0) {
+    // try to allocate an address
+    if (!_dynamic_mapping || _dynamic_mapping_allocation_direction != lookup_direction
+	|| !_free_entries.size())
       return false;
+    i = _free_entries.back();
+    _free_entries.pop_back();
+    if (lookup_direction == 0)
+      _v[i]._iai = iai;
+    else
+      _v[i]._mai = mai;
+    _v[i]._binding = true;
+    _binding_out.insert(IP6FlowID(_v[i]._iai, 0, IP6Address(), 0), i);
+    _binding_in.insert(IP6FlowID(_v[i]._mai, 0, IP6Address(), 0), i);
   }
 
-  if (lookup_direction == 0)
+  if (lookup_direction==0) //outward packet
     {
-      mpi = new_mport;
-      mai = _maddr;
+      mai = _v[i]._mai;
+      mpi = ipi;
     }
-  else
+  else //inward packet
     {
-      ipi = new_mport;
-      iai = _maddr;
+      iai = _v[i]._iai;
+      ipi = mpi;
     }
-
-  IP6FlowID orig_out_flow = IP6FlowID(iai, ipi, ea, ep);
-  IP6FlowID orig_in_flow  = IP6FlowID(ea, ep, mai, mpi);
-  IP6FlowID new_out_flow = IP6FlowID(mai, mpi, ea, ep);
-  IP6FlowID new_in_flow  = IP6FlowID(ea, ep, iai, ipi);
-  Mapping *out_mapping = new Mapping;
-  out_mapping->initialize(new_out_flow);
-  Mapping *in_mapping = new Mapping;
-  in_mapping->initialize(new_in_flow);
-  if (lookup_direction == 0)
-    {
-      if (mpi==_mportl) //the first port mapping
-	{
-	  _rover = out_mapping;
-	  _rover->set_next(_rover);
-	  _rover2= in_mapping;
-	  _rover2->set_next(_rover2);
-	}
-      else
-	{
-	  out_mapping->set_next(_rover->get_next());
-	  _rover->set_next(out_mapping);
-	  _rover = out_mapping;
-	  in_mapping->set_next(_rover2->get_next());
-	  _rover2->set_next(in_mapping);
-	  _rover2 = in_mapping;
-	}
-    }
-  else
-    {
-      if (ipi == _mportl)
-	{
-	  _rover = in_mapping;
-	  _rover->set_next(_rover);
-	  _rover2 = out_mapping;
-	  _rover2->set_next(_rover2);
-	}
-      else
-	{
-	  in_mapping->set_next(_rover->get_next());
-	  _rover->set_next(in_mapping);
-	  _rover = in_mapping;
-	  out_mapping->set_next(_rover2->get_next());
-	  _rover2->set_next(out_mapping);
-	  _rover2 = out_mapping;
-	}
-    }
-
-  _out_map.insert(orig_out_flow, out_mapping);
-  _in_map.insert(orig_in_flow, in_mapping);
-  _nmappings++;
-  _nmappings2++;
   return true;
-
 }
 
-
-void
-AddressTranslator::push(int port, Packet *p)
+AddressTranslator::State *
+AddressTranslator::port_owner(unsigned short port)
 {
-  if (port == 0)
-    handle_outward(p);
-  else
-    handle_inward(p);
+  if (port < _mportl || port > _mporth)
+    return 0;
+  int owner = _block_owner[(port - _mportl) / _port_block];
+  if (owner < 0)
+    return 0;
+  return &_state.get_value_for_thread(owner);
 }
 
-
-
-void
-AddressTranslator::handle_outward(Packet *p)
+unsigned short
+AddressTranslator::alloc_port(State &s)
 {
-  click_ip6 *ip6 = (click_ip6 *)p->data();
-  unsigned char *start = (unsigned char *)p->data();
-  IP6Address ip6_src = IP6Address(ip6->ip6_src);
-  IP6Address ip6_msrc;
-  IP6Address ip6_dst = IP6Address(ip6->ip6_dst);
-  uint16_t sport;
-  uint16_t dport;
-  uint16_t mport;
-
-  WritablePacket *q= Packet::make(p->length());
-  if (q==0) {
-    click_chatter("can not make packet!");
-    assert(0);
+  if (!s._free_ports.size()) {
+    _blocks_lock.acquire();
+    if (!_free_blocks.size()) {
+      _blocks_lock.release();
+      return 0;
+    }
+    int b = _free_blocks.back();
+    _free_blocks.pop_back();
+    _block_owner[b] = click_current_cpu_id();
+    _blocks_lock.release();
+
+    unsigned first = _mportl + b * _port_block;
+    unsigned last = first + _port_block - 1;
+    if (last > _mporth)
+      last = _mporth;
+    for (unsigned port = last; port >= first; port--)
+      s._free_ports.push_back(port);
   }
+  unsigned short port = s._free_ports.back();
+  s._free_ports.pop_back();
+  return port;
+}
 
+bool
+AddressTranslator::lookup_port(IP6Address &iai, unsigned short &ipi, IP6Address &mai, unsigned short &mpi, IP6Address &ea, unsigned short &ep, bool lookup_direction)
+{
+  // Mappings are created by the thread seeing the flow in the allocation
+  // direction, from its own port blocks; the other direction finds them
+  // through the owner of the block of the mapped port
+  bool allocating = (lookup_direction == _dynamic_mapping_allocation_direction);
+  State *s;
+  if (allocating)
+    s = &*_state;
+  else if (!(s = port_owner(lookup_direction == 0 ? ipi : mpi)))
+    return false;
 
-  // create the new packet
-  // replace src IP6, src port, and tcp checksum fields in the packet
-  unsigned char *start_new = (unsigned char *)q->data();
-  memset(q->data(), '\0', q->length());
-  memcpy(start_new, start, p->length());
-  click_ip6 *ip6_new = (click_ip6 * )q->data();
-
-  if (ip6_new->ip6_nxt ==0x3a) //the upper layer is an icmp6 packet
-    {
+  s->_lock.acquire();
+  bool found = lookup_mapping(*s, allocating, iai, ipi, mai, mpi, ea, ep, lookup_direction);
+  s->_lock.release();
+  return found;
+}
 
-      unsigned char * icmp6_start = (unsigned char *)(ip6_new +1);
-      if (lookup(ip6_src, dport, ip6_msrc, mport, ip6_dst, sport, 0))
-	{
+bool
+AddressTranslator::lookup_mapping(State &s, bool allocating, IP6Address &iai, unsigned short &ipi, IP6Address &mai, unsigned short &mpi, IP6Address &ea, unsigned short &ep, bool lookup_direction)
+{
+  click_jiffies_t now = click_jiffies();
+  Mapping *m;
+  if (lookup_direction == 0)
+    m = s._out_map.find(IP6FlowID(iai, ipi, ea, ep));
+  else
+    m = s._in_map.find(IP6FlowID(ea, ep, mai, mpi));
 
-	  ip6_new->ip6_src = ip6_msrc;
-	  switch (icmp6_start[0])  {
-	  case 1  : ;
-	  case 3  : ;
-	  case 128: ;
-	  case 129: {
-	    click_icmp6_echo * icmp6 = (click_icmp6_echo *) (ip6_new+1);
-	    icmp6->icmp6_cksum=0;
-	    icmp6->icmp6_cksum= htons(in6_fast_cksum(&ip6_new->ip6_src, &ip6_new->ip6_dst, ip6_new->ip6_plen, 0x3a, 0, (unsigned char *)icmp6, ip6_new->ip6_plen));
-	  }
-	  break;
-	  case 2: {
-	    click_icmp6_pkttoobig * icmp6 = (click_icmp6_pkttoobig *)(ip6_new +1);
-	    icmp6->icmp6_cksum=0;
-	    icmp6->icmp6_cksum= htons(in6_fast_cksum(&ip6_new->ip6_src, &ip6_new->ip6_dst, ip6_new->ip6_plen, 0x3a, 0, (unsigned char *)icmp6, ip6_new->ip6_plen));
-	  }
-	  break;
-	  case 4: {
-	    click_icmp6_paramprob * icmp6 = (click_icmp6_paramprob *)(ip6_new +1);
-	    icmp6->icmp6_cksum=0;
-	    icmp6->icmp6_cksum= htons(in6_fast_cksum(&ip6_new->ip6_src, &ip6_new->ip6_dst, ip6_new->ip6_plen, 0x3a, 0, (unsigned char *)icmp6, ip6_new->ip6_plen));
-	  }
-	  break;
-	  default: ; break;
-	  }
-
-	  p->kill();
-	  output(0).push(q);
-	}
-      else
-	{
-	  //click_chatter(" failed for mapping the ip6 address and port for an icmpv6 packet ");
-	  p->kill();
-	}
+  if (!m) {
+    if (!allocating)
+      return false;
+    unsigned short port = alloc_port(s);
+    if (!port) {
+      click_chatter("AddressTranslator ran out of ports");
+      return false;
     }
+    if (lookup_direction == 0)
+      m = new Mapping(iai, ipi, _maddr, port, ea, ep);
+    else
+      m = new Mapping(_maddr, port, mai, mpi, ea, ep);
+    s._out_map.insert(m->out_flow(), m);
+    s._in_map.insert(m->in_flow(), m);
+    s._nmappings++;
+    schedule(s, m, now + _timeout);
+  }
 
+  m->_used = now;
+  if (lookup_direction == 0) {
+    mai = m->_mai;
+    mpi = m->_mpi;
+  } else {
+    iai = m->_iai;
+    ipi = m->_ipi;
+  }
+  return true;
+}
 
-  else if (ip6_new->ip6_nxt ==0x6) //the upper layer is a tcp packet
-    {
-       click_tcp *tcp_new  = (click_tcp *)(ip6_new+1);
-       sport = ntohs(tcp_new->th_sport);
-       dport = ntohs(tcp_new->th_dport);
+bool
+AddressTranslator::lookup(IP6Address &iai, unsigned short &ipi, IP6Address &mai, unsigned short &mpi, IP6Address &ea, unsigned short &ep, bool lookup_direction)
+{
+  if (_number_of_smap > 0 && lookup_static(iai, ipi, mai, mpi, lookup_direction))
+    return true;
+  if (!_dynamic_mapping)
+    return false;
+  if (!_dynamic_portmapping) {
+    _binding_lock.acquire();
+    bool found = lookup_binding(iai, ipi, mai, mpi, lookup_direction);
+    _binding_lock.release();
+    return found;
+  }
+  return lookup_port(iai, ipi, mai, mpi, ea, ep, lookup_direction);
+}
 
-      if (lookup(ip6_src, sport, ip6_msrc, mport, ip6_dst, dport, 0))
-	{
-	  ip6_new->ip6_src = ip6_msrc;
-	  tcp_new->th_sport = htons(mport);
-	  //recalculate the checksum for TCP, deal with fragment later
-	  tcp_new->th_sum = 0;
-	  tcp_new->th_sum = htons(in6_fast_cksum(&ip6_new->ip6_src, &ip6_new->ip6_dst, ip6_new->ip6_plen, ip6_new->ip6_nxt, tcp_new->th_sum, (unsigned char *)tcp_new, ip6_new->ip6_plen));
-	  p->kill();
-	  output(0).push(q);
-	}
-      else
-	{
-	  //click_chatter(" failed to map the ip6 address and port for a tcp packet");
-	  p->kill();
-	}
-    }
+/* The timer wheel has wheel_size slots of _tick jiffies, and TIMEOUT spans
+   half of them. A mapping sits in the slot following its expiry time; when
+   the slot is reached, mappings used in the meantime are moved to the slot of
+   their new expiry time, and the others are removed. */
+void
+AddressTranslator::schedule(State &s, Mapping *m, click_jiffies_t expiry)
+{
+  Mapping *&slot = s._wheel[(expiry / _tick + 1) % wheel_size];
+  m->_wheel_next = slot;
+  slot = m;
+}
 
-  else if (ip6_new->ip6_nxt ==0x11) //the upper layer is a udp packet
-    {
-      click_udp *udp_new  = (click_udp *)(ip6_new+1);
-      sport = ntohs(udp_new->uh_sport);
-      dport = ntohs(udp_new->uh_dport);
+void
+AddressTranslator::free_mapping(State &s, Mapping *m)
+{
+  s._out_map.erase(m->out_flow());
+  s._in_map.erase(m->in_flow());
+  s._free_ports.push_back(_dynamic_mapping_allocation_direction == 0 ? m->_mpi : m->_ipi);
+  s._nmappings--;
+  delete m;
+}
 
-      if (lookup(ip6_src, sport, ip6_msrc, mport, ip6_dst, dport, 0))
-	{
-	  ip6_new->ip6_src = ip6_msrc;
-	  udp_new->uh_sport = htons(mport);
-	  //recalculate the checksum for UDP, deal with fragment later
-	  udp_new->uh_sum = 0;
-	  udp_new->uh_sum = htons(in6_fast_cksum(&ip6_new->ip6_src, &ip6_new->ip6_dst, ip6_new->ip6_plen, ip6_new->ip6_nxt, udp_new->uh_sum, (unsigned char *)udp_new, ip6_new->ip6_plen));
-	  p->kill();
-	  output(0).push(q);
-	}
-      else
-	{
-	  //click_chatter(" failed to map the ip6 address and port for a udp packet");
-	  p->kill();
-	}
+void
+AddressTranslator::expire(State &s, click_jiffies_t now)
+{
+  click_jiffies_t now_tick = now / _tick;
+  for (int n = 0; (click_jiffies_difference_t) (now_tick - s._wheel_tick) >= 0; n++) {
+    if (n == wheel_size) {
+      // Every slot was visited, the remaining mappings are not due yet
+      s._wheel_tick = now_tick + 1;
+      break;
     }
-
-  else //discard other packets
-    {
-      click_chatter(" discard the packet, protocol unrecognized");
-      p->kill();
+    Mapping *m = s._wheel[s._wheel_tick % wheel_size];
+    s._wheel[s._wheel_tick % wheel_size] = 0;
+    s._wheel_tick++;
+    while (m) {
+      Mapping *next = m->_wheel_next;
+      click_jiffies_t expiry = m->_used + _timeout;
+      if ((click_jiffies_difference_t) (expiry - now) > 0)
+	schedule(s, m, expiry);
+      else {
+	free_mapping(s, m);
+	s._expired++;
+      }
+      m = next;
     }
-
+  }
 }
 
 void
-AddressTranslator::handle_inward(Packet *p)
+AddressTranslator::run_timer(Timer *)
 {
-click_ip6 *ip6 = (click_ip6 *)p->data();
-  unsigned char *start = (unsigned char *)p->data();
-  IP6Address ip6_src = IP6Address(ip6->ip6_src);
-  IP6Address ip6_mdst = IP6Address(ip6->ip6_dst);
-  IP6Address ip6_dst ;
-  uint16_t sport;
-  uint16_t mport;
-  uint16_t dport;
+  click_jiffies_t now = click_jiffies();
+  for (unsigned i = 0; i < _state.weight(); i++) {
+    State &s = _state.get_value(i);
+    s._lock.acquire();
+    expire(s, now);
+    s._lock.release();
+  }
+  _timer.reschedule_after(Timestamp::make_jiffies(_tick));
+}
 
+static inline void
+update_cksum(uint16_t *sum, const IP6Address &from, const IP6Address &to)
+{
+  const uint16_t *f = reinterpret_cast<const uint16_t *>(from.data());
+  const uint16_t *t = reinterpret_cast<const uint16_t *>(to.data());
+  for (int i = 0; i < 8; i++)
+    click_update_in_cksum(sum, f[i], t[i]);
+}
 
-  WritablePacket *q= Packet::make(p->length());
-  if (q==0) {
-    click_chatter("can not make packet!");
-    assert(0);
+/* Finds where the checksum and the ports of the transport header are. PORT
+   is the offset of the port of the inner host side (the source port of
+   outward packets, the destination port of inward packets), and PEER the
+   offset of the port of the external host, or -1. ICMPv6 echo messages use
+   their identifier as port. */
+static inline bool
+transport_offsets(const Packet *p, bool outward, int &sum, int &port, int &peer)
+{
+  const click_ip6 *ip6 = reinterpret_cast<const click_ip6 *>(p->data());
+  unsigned len = p->length() - sizeof(click_ip6);
+  const unsigned char *l4 = p->data() + sizeof(click_ip6);
+  switch (ip6->ip6_nxt) {
+  case 0x3a: //icmp6
+    if (len < 4)
+      return false;
+    sum = 2;
+    peer = -1;
+    if ((l4[0] == 128 || l4[0] == 129) && len >= 8)
+      port = 4;
+    else
+      port = -1;
+    return true;
+  case 0x6: //tcp
+    if (len < sizeof(click_tcp))
+      return false;
+    sum = 16;
+    break;
+  case 0x11: //udp
+    if (len < sizeof(click_udp))
+      return false;
+    sum = 6;
+    break;
+  default:
+    click_chatter(" discard the packet, protocol unrecognized");
+    return false;
   }
+  port = outward ? 0 : 2;
+  peer = outward ? 2 : 0;
+  return true;
+}
 
+static inline unsigned short
+read_port(const Packet *p, int off)
+{
+  if (off < 0)
+    return 0;
+  const unsigned char *x = p->data() + sizeof(click_ip6) + off;
+  return (x[0] << 8) | x[1];
+}
 
-  // create the new packet
-  // replace src ip6, src port, and tcp checksum  fields in the packet
-  unsigned char *start_new = (unsigned char *)q->data();
-  memset(q->data(), '\0', q->length());
-  memcpy(start_new, start, p->length());
-  click_ip6 *ip6_new = (click_ip6 * )q->data();
-
-  if (ip6_new->ip6_nxt ==0x3a) //the upper layer is an icmp6 packet
+// Translates the packet in place and updates the transport checksum
+// incrementally
+static inline void
+rewrite(WritablePacket *q, bool outward, const IP6Address &addr, int sum_off, int port_off, unsigned short port)
+{
+  click_ip6 *ip6 = reinterpret_cast<click_ip6 *>(q->data());
+  unsigned char *l4 = q->data() + sizeof(click_ip6);
+  uint16_t *sum = reinterpret_cast<uint16_t *>(l4 + sum_off);
+  IP6Address &field = reinterpret_cast<IP6Address &>(outward ? ip6->ip6_src : ip6->ip6_dst);
+  update_cksum(sum, field, addr);
+  field = addr;
+  if (port_off >= 0) {
+    uint16_t *x = reinterpret_cast<uint16_t *>(l4 + port_off);
+    uint16_t nport = htons(port);
+    click_update_in_cksum(sum, *x, nport);
+    *x = nport;
+  }
+  if (ip6->ip6_nxt == 0x11 && *sum == 0)
+    *sum = 0xFFFF;
+}
 
-     {
-      unsigned char * icmp6_start = (unsigned char *)(ip6_new +1);
-      //unsigned char *ip6_new2 = 0;
+Packet *
+AddressTranslator::handle_outward(Packet *p)
+{
+  int sum_off, port_off, peer_off;
+  if (p->length() < sizeof(click_ip6)
+      || !transport_offsets(p, true, sum_off, port_off, peer_off)) {
+    p->kill();
+    return 0;
+  }
 
-      if (lookup(ip6_dst, dport, ip6_mdst, mport, ip6_src, sport, 1))
-	{
-	   ip6_new->ip6_dst = ip6_dst;
-	   switch (icmp6_start[0])  {
-	   case 1  : ;  //need to change
-	   case 3  : ;  //need to change
-	   case 128: ;
-	   case 129: {
-	     click_icmp6_echo * icmp6 = (click_icmp6_echo *)(ip6_new +1);
-	     icmp6->icmp6_cksum = 0;
-	     icmp6->icmp6_cksum = htons(in6_fast_cksum(&ip6_new->ip6_src, &ip6_new->ip6_dst, ip6_new->ip6_plen, 0x3a, 0, (unsigned char *)icmp6, ip6_new->ip6_plen));
-	   }
-	   break;
-	   case 2: {
-	     click_icmp6_pkttoobig * icmp6 = (click_icmp6_pkttoobig *)(ip6_new +1);
-	     icmp6->icmp6_cksum = 0;
-	     icmp6->icmp6_cksum = htons(in6_fast_cksum(&ip6_new->ip6_src, &ip6_new->ip6_dst, ip6_new->ip6_plen, 0x3a, 0, (unsigned char *)icmp6, ip6_new->ip6_plen));
-	   }
-	   break;
-	   case 4: {
-	     click_icmp6_paramprob * icmp6 = (click_icmp6_paramprob *)(ip6_new +1);
-	     icmp6->icmp6_cksum = 0;
-	     icmp6->icmp6_cksum = htons(in6_fast_cksum(&ip6_new->ip6_src, &ip6_new->ip6_dst, ip6_new->ip6_plen, 0x3a, 0, (unsigned char *)icmp6, ip6_new->ip6_plen));
-	   }
-	   break;
-	   default: ;
-	   }
-
-	  p->kill();
-	  output(1).push(q);
-	}
-      else
-	{
-	  //click_chatter(" failed for mapping the dst ip6 address and port for an icmpv6 packet -inward");
-	  p->kill();
-	}
-    }
+  const click_ip6 *ip6 = reinterpret_cast<const click_ip6 *>(p->data());
+  IP6Address ip6_src = IP6Address(ip6->ip6_src);
+  IP6Address ip6_msrc;
+  IP6Address ip6_dst = IP6Address(ip6->ip6_dst);
+  uint16_t sport = read_port(p, port_off);
+  uint16_t dport = read_port(p, peer_off);
+  uint16_t mport = 0;
 
+  if (!lookup(ip6_src, sport, ip6_msrc, mport, ip6_dst, dport, 0)) {
+    p->kill();
+    return 0;
+  }
+  WritablePacket *q = p->uniqueify();
+  if (q)
+    rewrite(q, true, ip6_msrc, sum_off, port_off, mport);
+  return q;
+}
 
-  else if (ip6_new->ip6_nxt ==0x6) //the upper layer is a tcp packet
-    {
-       click_tcp *tcp_new  = (click_tcp *)(ip6_new+1);
-       sport = ntohs(tcp_new->th_sport);
-       mport = ntohs(tcp_new->th_dport);
-      if (lookup(ip6_dst, dport,ip6_mdst, mport, ip6_src, sport, 1))
-	{
-	  ip6_new->ip6_dst = ip6_dst;
-	  tcp_new->th_dport = htons(dport);
-	  //recalculate the checksum for TCP, deal with fragment later
-	  tcp_new->th_sum = 0;
-	  tcp_new->th_sum = htons(in6_fast_cksum(&ip6_new->ip6_src, &ip6_new->ip6_dst, ip6_new->ip6_plen, ip6_new->ip6_nxt, tcp_new->th_sum, (unsigned char *)tcp_new, ip6_new->ip6_plen));
+Packet *
+AddressTranslator::handle_inward(Packet *p)
+{
+  int sum_off, port_off, peer_off;
+  if (p->length() < sizeof(click_ip6)
+      || !transport_offsets(p, false, sum_off, port_off, peer_off)) {
+    p->kill();
+    return 0;
+  }
 
+  const click_ip6 *ip6 = reinterpret_cast<const click_ip6 *>(p->data());
+  IP6Address ip6_src = IP6Address(ip6->ip6_src);
+  IP6Address ip6_mdst = IP6Address(ip6->ip6_dst);
+  IP6Address ip6_dst;
+  uint16_t sport = read_port(p, peer_off);
+  uint16_t mport = read_port(p, port_off);
+  uint16_t dport = 0;
+
+  if (!lookup(ip6_dst, dport, ip6_mdst, mport, ip6_src, sport, 1)) {
+    p->kill();
+    return 0;
+  }
+  WritablePacket *q = p->uniqueify();
+  if (q)
+    rewrite(q, false, ip6_dst, sum_off, port_off, dport);
+  return q;
+}
 
-	  p->kill();
-	  output(1).push(q);
-	}
-       else
-	{
-	  //click_chatter(" failed for mapping the dst ip6 address and port for a tcp packet -inward");
-	  p->kill();
-	}
-    }
+void
+AddressTranslator::push(int port, Packet *p)
+{
+  if (port == 0)
+    p = handle_outward(p);
+  else
+    p = handle_inward(p);
+  if (p)
+    output(port).push(p);
+}
 
+#if HAVE_BATCH
+void
+AddressTranslator::push_batch(int port, PacketBatch *batch)
+{
+  if (port == 0) {
+    EXECUTE_FOR_EACH_PACKET_DROPPABLE(handle_outward, batch, [](Packet *){});
+  } else {
+    EXECUTE_FOR_EACH_PACKET_DROPPABLE(handle_inward, batch, [](Packet *){});
+  }
+  if (batch)
+    output(port).push_batch(batch);
+}
+#endif
 
-  else if (ip6_new->ip6_nxt ==0x11) //the upper layer is a udp packet
-    {
-       click_udp *udp_new  = (click_udp *)(ip6_new+1);
-       sport = ntohs(udp_new->uh_sport);
-       mport = ntohs(udp_new->uh_dport);
-      if (lookup(ip6_dst, dport,ip6_mdst, mport, ip6_src, sport, 1))
-	{
-	  ip6_new->ip6_dst = ip6_dst;
-	  udp_new->uh_dport = htons(dport);
-	  //recalculate the checksum for TCP, deal with fragment later
-	  udp_new->uh_sum = 0;
-	  udp_new->uh_sum = htons(in6_fast_cksum(&ip6_new->ip6_src, &ip6_new->ip6_dst, ip6_new->ip6_plen, ip6_new->ip6_nxt, udp_new->uh_sum, (unsigned char *)udp_new, ip6_new->ip6_plen));
-
-	  p->kill();
-	  output(1).push(q);
-	}
-       else
-	{
-	  //click_chatter(" failed for mapping the dst ip6 address and port for a udp packet - inward");
-	  p->kill();
-	}
-    }
+String
+AddressTranslator::read_handler(Element *e, void *thunk)
+{
+  AddressTranslator *at = static_cast<AddressTranslator *>(e);
+  switch ((intptr_t) thunk) {
+  case h_mappings: {
+    PER_THREAD_MEMBER_SUM(int, n, at->_state, _nmappings);
+    return String(n);
+  }
+  case h_expired: {
+    PER_THREAD_MEMBER_SUM(uint64_t, n, at->_state, _expired);
+    return String(n);
+  }
+  case h_free_blocks:
+    return String(at->_free_blocks.size());
+  default:
+    return String();
+  }
+}
 
-  else //discard other packets
-    {
-      click_chatter(" discard the packet, protocol unrecognized");
-      p->kill();
-    }
+void
+AddressTranslator::add_handlers()
+{
+  add_read_handler("mappings", read_handler, h_mappings);
+  add_read_handler("expired", read_handler, h_expired);
+  add_read_handler("free_blocks", read_handler, h_free_blocks);
 }
 
-EXPORT_ELEMENT(AddressTranslator)
 CLICK_ENDDECLS
+EXPORT_ELEMENT(AddressTranslator)
@@ -3,13 +3,13 @@
 #include <click/ip6address.hh>
 #include <click/ipaddress.hh>
 #include <click/vector.hh>
-#include <click/element.hh>
+#include <click/batchelement.hh>
 #include <click/bighashmap.hh>
 #include <click/ip6flowid.hh>
+#include <click/sync.hh>
+#include <click/timer.hh>
 CLICK_DECLS
 
-//#include <time.h>
-
 
 /*
  * =c
@@ -20,7 +20,8 @@ CLICK_DECLS
  *                   DynamicMapping,
  *                   DynamicPortMapping,
  *                   AddressAllocationDirection,
- *                   Mapped_IP6Address Port_start Port_end)
+ *                   Mapped_IP6Address Port_start Port_end,
+ *                   [I<keywords> TIMEOUT, PORT_BLOCK])
  *
  *
  * =s ip6
@@ -62,10 +63,55 @@ CLICK_DECLS
  * find an unsed port and create a mapped flowID for the flow and insert the entry, if the packet
  * comes from the right direction.
 
+ *
+ * The mapping table is indexed by hash tables in both directions: static
+ * entries by inner and by mapped address (and port), dynamic address bindings
+ * by inner and by mapped address, so a lookup does not depend on the number
+ * of mappings.
+ *
+ * Dynamic address and port mappings are kept per thread. The range of mapped
+ * ports is split in blocks of PORT_BLOCK ports, which threads take from a
+ * shared pool when they run out of ports, and keep afterwards. A thread
+ * creates the mappings of the flows it sees in the allocation direction, and
+ * packets of the other direction are looked up in the tables of the thread
+ * owning the block of their mapped port, under the lock of these tables. Both
+ * directions of a flow may thus be handled by different threads, as happens
+ * when RSS cannot steer the replies, whose addresses differ, to the thread of
+ * the mapping; the packets of one direction of a flow should be handled by a
+ * single thread. Mappings unused for TIMEOUT are removed by a
+ * timer wheel, and their ports reused.
+ *
+ * Keyword arguments, which may follow the positional arguments, are:
+ *
+ * =over 8
+ *
+ * =item TIMEOUT
+ *
+ * Time in seconds. Dynamic address and port mappings unused for this long
+ * are removed. Default is 300.
+ *
+ * =item PORT_BLOCK
+ *
+ * Integer. Number of mapped ports taken at once by a thread. Default is 64.
+ *
+ * =back
+ *
+ * =h mappings read-only
+ *
+ * Returns the number of dynamic address and port mappings.
+ *
+ * =h expired read-only
+ *
+ * Returns the number of dynamic address and port mappings removed after
+ * TIMEOUT.
+ *
+ * =h free_blocks read-only
+ *
+ * Returns the number of port blocks not taken by any thread yet.
  *
  * =a ProtocolTranslator64, ProtocolTranslator46 */
 
-class AddressTranslator : public Element {
+class AddressTranslator : public BatchElement {
 
  public:
 
@@ -76,12 +122,19 @@ class AddressTranslator : public Element {
 
   const char *class_name() const override		{ return "AddressTranslator"; }
   const char *port_count() const override		{ return "2/2"; }
+  const char *processing() const override		{ return PUSH; }
   int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
+  int initialize(ErrorHandler *) CLICK_COLD;
+  void add_handlers() CLICK_COLD;
   void push(int port, Packet *p);
+#if HAVE_BATCH
+  void push_batch(int port, PacketBatch *batch);
+#endif
+  void run_timer(Timer *);
   void add_map(IP6Address &mai,  bool binding);
   void add_map(IP6Address &iai, unsigned short ipi, IP6Address &mai, unsigned short mpi, IP6Address &ea, unsigned short ep, bool binding);
-  void handle_outward(Packet *p);
-  void handle_inward(Packet *p);
+  Packet *handle_outward(Packet *p);
+  Packet *handle_inward(Packet *p);
 
   bool lookup(IP6Address &, unsigned short &, IP6Address &, unsigned short &, IP6Address &, unsigned short &, bool);
   void cleanup(CleanupStage) CLICK_COLD;
@@ -95,11 +148,6 @@ protected:
     unsigned short _mpi;
     IP6Address _ea;
     unsigned short _ep;
-    //long unsigned int _t;
-     //time_t  _t;  //the last time that the packet passed the address translator
-                 //later: the time when FIN received from both direction for TCP
-                 //the time that the UDP packet has been sent for this session.
-   //unsigned char _state;
     bool _binding;
     bool _static;
 };
@@ -117,21 +165,59 @@ protected:
   //_iai, _ipi, _mai, _mpi, _ea, _ep
   bool _static_mapping[6];
 
+  // indexes of _v: static entries by (inner address, port) in the allocation
+  // direction and by (mapped address, port) in the other one; dynamic address
+  // bindings by inner and by mapped address
+  typedef HashMap<IP6FlowID, int> Index;
+  Index _static_fwd;
+  Index _static_rev;
+  Index _binding_out;
+  Index _binding_in;
+  Vector<int> _free_entries;
+  Spinlock _binding_lock;
+
+  bool lookup_static(IP6Address &, unsigned short &, IP6Address &, unsigned short &, bool);
+  bool lookup_binding(IP6Address &, unsigned short &, IP6Address &, unsigned short &, bool);
+  bool lookup_port(IP6Address &, unsigned short &, IP6Address &, unsigned short &, IP6Address &, unsigned short &, bool);
 
-  //using new approach
   typedef HashMap<IP6FlowID, Mapping *> Map6;
-  void clean_map(Map6 &, bool);
-  unsigned short find_mport( );
-  void mapping_freed(Mapping *, bool);
 
-  Map6 _in_map;
-  Map6 _out_map;
+  enum { wheel_size = 64 };
+
+  struct State {
+    Map6 _in_map;
+    Map6 _out_map;
+    Vector<unsigned short> _free_ports;
+    Mapping *_wheel[wheel_size];
+    click_jiffies_t _wheel_tick;
+    Spinlock _lock;
+    int _nmappings;
+    uint64_t _expired;
+    State() : _in_map(0), _out_map(0), _wheel_tick(0), _nmappings(0), _expired(0) {
+      memset(_wheel, 0, sizeof(_wheel));
+    }
+  };
+  per_thread<State> _state;
+
+  bool lookup_mapping(State &, bool, IP6Address &, unsigned short &, IP6Address &, unsigned short &, IP6Address &, unsigned short &, bool);
+  State *port_owner(unsigned short port);
+  unsigned short alloc_port(State &);
+  void schedule(State &, Mapping *, click_jiffies_t expiry);
+  void expire(State &, click_jiffies_t now);
+  void free_mapping(State &, Mapping *);
+
   IP6Address _maddr;
   unsigned short _mportl, _mporth;
-  Mapping *_rover;
-  Mapping *_rover2;
-  int _nmappings;
-  int _nmappings2;
+  unsigned _port_block;
+  Vector<int> _block_owner;
+  Vector<int> _free_blocks;
+  Spinlock _blocks_lock;
+  click_jiffies_t _timeout;
+  click_jiffies_t _tick;
+  Timer _timer;
+
+  enum { h_mappings, h_expired, h_free_blocks };
+  static String read_handler(Element *, void *) CLICK_COLD;
 
 };
 
@@ -139,26 +225,23 @@ class AddressTranslator::Mapping {
 
  public:
 
-  Mapping() CLICK_COLD;
-  void initialize(const IP6FlowID & new_flow) { _mapto = new_flow;     }
-  const IP6FlowID &flow_id() const    {  return _mapto;        }
-  unsigned short sport() const        { return _mapto.sport(); }
-  unsigned short dport() const        { return _mapto.dport(); }
-  //String s() const                  { return " ";    }
-  Mapping * get_next()                { return _next; }
-  Mapping * get_prev()                { return _prev; }
-  void set_next(Mapping * next)       { _next = next; }
-  void set_prev(Mapping * prev)       { _prev = prev; }
-  Mapping *free_next() const		{ return _free_next; }
-  void set_free_next(Mapping *m)      {_free_next = m;}
+  Mapping(const IP6Address &iai, unsigned short ipi, const IP6Address &mai, unsigned short mpi, const IP6Address &ea, unsigned short ep)
+    : _iai(iai), _mai(mai), _ea(ea), _ipi(ipi), _mpi(mpi), _ep(ep), _used(0), _wheel_next(0) {
+  }
 
+  IP6FlowID out_flow() const		{ return IP6FlowID(_iai, _ipi, _ea, _ep); }
+  IP6FlowID in_flow() const		{ return IP6FlowID(_ea, _ep, _mai, _mpi); }
 
  protected:
-  //long unsigned int _t;
-  IP6FlowID _mapto;
-  Mapping *_prev;
-  Mapping *_next;
-  Mapping *_free_next;
+
+  IP6Address _iai;
+  IP6Address _mai;
+  IP6Address _ea;
+  unsigned short _ipi;
+  unsigned short _mpi;
+  unsigned short _ep;
+  click_jiffies_t _used;
+  Mapping *_wheel_next;
 
   friend class AddressTranslator;
 };
@@ -270,14 +270,14 @@ ProtocolTranslator46::make_icmp_translate46(IP6Address ip6_src,
 }
 
 
-void
-ProtocolTranslator46::push(int, Packet *p)
+Packet *
+ProtocolTranslator46::simple_action(Packet *p)
 {
-    handle_ip4(p);
+  return handle_ip4(p);
 }
 
 
-void
+Packet *
 ProtocolTranslator46::handle_ip4(Packet *p)
 {
   click_ip *ip = (click_ip *)p->data();
@@ -307,12 +307,12 @@ ProtocolTranslator46::handle_ip4(Packet *p)
       p->kill();
       q->kill();
       q2->kill();
-      output(0).push(q3);
+      return q3;
     }
   else
     {
       p->kill();
-      output(0).push(q);
+      return q;
     }
 
 }
@@ -3,7 +3,7 @@
 #include <click/ip6address.hh>
 #include <click/ipaddress.hh>
 #include <click/vector.hh>
-#include <click/element.hh>
+#include <click/batchelement.hh>
 CLICK_DECLS
 
 /*
@@ -26,7 +26,7 @@ CLICK_DECLS
  *
  * =a AddressTranslator ProtocolTranslator64*/
 
-class ProtocolTranslator46 : public Element {
+class ProtocolTranslator46 : public SimpleElement<ProtocolTranslator46> {
 
 
  public:
@@ -36,8 +36,8 @@ class ProtocolTranslator46 : public Element {
 
   const char *class_name() const override		{ return "ProtocolTranslator46"; }
   const char *port_count() const override		{ return PORTS_1_1; }
-  void push(int port, Packet *p);
-  void handle_ip4(Packet *);
+  Packet *simple_action(Packet *p) override;
+  Packet *handle_ip4(Packet *);
 
 private:
 
@@ -289,14 +289,14 @@ ProtocolTranslator64::make_icmp_translate64(unsigned char *a,
 
 
 
-void
-ProtocolTranslator64::push(int, Packet *p)
+Packet *
+ProtocolTranslator64::simple_action(Packet *p)
 {
-  handle_ip6(p);
+  return handle_ip6(p);
 }
 
 
-void
+Packet *
 ProtocolTranslator64::handle_ip6(Packet *p)
 {
   click_ip6 *ip6 = (click_ip6 *) p->data();
@@ -333,19 +333,19 @@ ProtocolTranslator64::handle_ip6(Packet *p)
 	   p->kill();
 	   q->kill();
 	   q2->kill();
-	   output(0).push(q3);
+	   return q3;
 	 }
        else
 	 {
 	   p->kill();
-	   output(0).push(q);
+	   return q;
 	 }
     }
 
   else
     {
       p->kill();
-      return;
+      return 0;
     }
 }
 
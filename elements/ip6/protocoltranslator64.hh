@@ -3,7 +3,7 @@
 #include <click/ip6address.hh>
 #include <click/ipaddress.hh>
 #include <click/vector.hh>
-#include <click/element.hh>
+#include <click/batchelement.hh>
 CLICK_DECLS
 
 /*
@@ -25,7 +25,7 @@ CLICK_DECLS
  *
  * =a AddressTranslator ProtocolTranslator46*/
 
-class ProtocolTranslator64 : public Element {
+class ProtocolTranslator64 : public SimpleElement<ProtocolTranslator64> {
 
 
  public:
@@ -35,8 +35,8 @@ class ProtocolTranslator64 : public Element {
 
   const char *class_name() const override		{ return "ProtocolTranslator64"; }
   const char *port_count() const override		{ return PORTS_1_1; }
-  void push(int port, Packet *p);
-  void handle_ip6(Packet *);
+  Packet *simple_action(Packet *p) override;
+  Packet *handle_ip6(Packet *);
 
 private:
 
@@ -25,7 +25,7 @@
 
 CLICK_DECLS
 
-FlowIPManagerHMP::FlowIPManagerHMP()
+FlowIPManagerHMP::FlowIPManagerHMP() : _timer(this)
 {
     _current = 0;
 }
@@ -38,6 +38,9 @@ FlowIPManagerHMP::~FlowIPManagerHMP()
 int
 FlowIPManagerHMP::configure(Vector<String> &conf, ErrorHandler *errh)
 {
+    if (_expiry.configure(conf, this, errh, 0) < 0)
+        return -1;
+
     if (Args(conf, this, errh)
         .read_or_set_p("CAPACITY", _table_size, 65536)
             .read_or_set("RESERVE", _reserve, 0)
@@ -50,6 +53,10 @@ FlowIPManagerHMP::configure(Vector<String> &conf, ErrorHandler *errh)
     router()->get_root_init_future()->postOnce(&_fcb_builded_init_future);
     _fcb_builded_init_future.post(this);
 
+    //Expired flows are removed by their ID, kept after the expiry state
+    if (_expiry.enabled())
+        _reserve += sizeof(FlowExpiry::State) + sizeof(IPFlow5ID);
+
     return 0;
 }
 
@@ -70,9 +77,27 @@ int FlowIPManagerHMP::solve_initialize(ErrorHandler *errh)
     if (!fcbs)
         return errh->error("Could not init data table !");
 
+    if (_expiry.enabled()) {
+        _timer_wheel.initialize(_expiry.max_timeout());
+        _timer.initialize(this);
+        _timer.schedule_after(Timestamp::make_sec(1));
+    }
+
     return Router::InitFuture::solve_initialize(errh);
 }
 
+void FlowIPManagerHMP::run_timer(Timer* t)
+{
+    Timestamp recent = Timestamp::recent_steady();
+    _expiry.run(_timer_wheel, recent, true, [this](FlowControlBlock* fcb) {
+        _hash.erase(*flow_id(fcb));
+        _free_lock.acquire();
+        _free_ids.push_back(FlowExpiry::state(fcb)->index);
+        _free_lock.release();
+    });
+    t->reschedule_after(Timestamp::make_sec(1));
+}
+
 void FlowIPManagerHMP::cleanup(CleanupStage stage)
 {
 }
@@ -85,28 +110,53 @@ void FlowIPManagerHMP::post_migrate(DPDKDevice* dev, int from)
 {
 }
 
-void FlowIPManagerHMP::process(Packet* p, BatchBuilder& b)
+void FlowIPManagerHMP::process(Packet* p, BatchBuilder& b, const Timestamp& recent)
 {
     IPFlow5ID fid = IPFlow5ID(p);
     bool first = false;
 
     auto ptr = _hash.find_create(fid, [this,&first](){
-        int id = _current.fetch_and_add(1);first= true;return id;
+        first = true;
+        if (_expiry.enabled()) {
+            _free_lock.acquire();
+            if (_free_ids.size()) {
+                int id = _free_ids.back();
+                _free_ids.pop_back();
+                _free_lock.release();
+                return id;
+            }
+            _free_lock.release();
+        }
+        int id = _current.fetch_and_add(1);
+        return id;
         //click_chatter("Creating id %d",id);
     });
 
     int ret = *ptr;
+    FlowControlBlock* fcb = (FlowControlBlock*)((unsigned char*)fcbs + _flow_state_size_full * ret);
+
+    if (_expiry.enabled()) {
+        if (first) {
+            FlowExpiry::state(fcb)->index = ret;
+            *flow_id(fcb) = fid;
+            _expiry.start(_timer_wheel, fcb, p, true);
+        } else
+            _expiry.track(_timer_wheel, fcb, p, true);
+    }
 
     if (b.last == ret) {
         b.append(p);
     } else {
         PacketBatch* batch;
         batch = b.finish();
-        if (batch)
+        if (batch) {
+            fcb_stack->lastseen = recent;
             output_push_batch(0, batch);
-        fcb_stack = (FlowControlBlock*)((unsigned char*)fcbs + _flow_state_size_full * ret);
+        }
+        fcb_stack = fcb;
         b.init();
         b.append(p);
+        b.last = ret;
     }
 }
 
@@ -118,14 +168,23 @@ void FlowIPManagerHMP::init_assignment(Vector<unsigned> table)
 void FlowIPManagerHMP::push_batch(int, PacketBatch* batch)
 {
     BatchBuilder b;
+    Timestamp recent = Timestamp::recent_steady();
 
     FOR_EACH_PACKET_SAFE(batch, p) {
-        process(p, b);
+        process(p, b, recent);
     }
 
     batch = b.finish();
-    if (batch)
+    if (batch) {
+        fcb_stack->lastseen = recent;
         output_push_batch(0, batch);
+    }
+}
+
+void FlowIPManagerHMP::add_handlers()
+{
+    if (_expiry.enabled())
+        _expiry.add_handlers(this);
 }
 
 CLICK_ENDDECLS
@@ -11,7 +11,7 @@
 #include <click/ipflowid.hh>
 #include <click/flow/flowelement.hh>
 #include <click/flow/common.hh>
-#include <click/timerwheel.hh>
+#include <click/flow/flowexpiry.hh>
 
 #include "../flow/flowipmanager.hh"
 
@@ -22,6 +22,9 @@ class DPDKDevice;
 /**
  * FlowIPManager based on the HashtableMP (hierarchical locked hashtable)
  *
+ * Flows expire as with FlowIPManager when TIMEOUT is set, which is 0 by
+ * default. Expired flows give their FCB back to new flows.
+ *
  * @see also FlowIPManager
  */
 class FlowIPManagerHMP: public VirtualFlowManager, Router::InitFuture {
@@ -43,6 +46,9 @@ class FlowIPManagerHMP: public VirtualFlowManager, Router::InitFuture {
         void post_migrate(DPDKDevice* dev, int from);
 
         void push_batch(int, PacketBatch* batch) override;
+        void run_timer(Timer*) override;
+
+        void add_handlers() override CLICK_COLD;
 
         void init_assignment(Vector<unsigned> table);
 
@@ -50,10 +56,20 @@ class FlowIPManagerHMP: public VirtualFlowManager, Router::InitFuture {
         HashTableMP<IPFlow5ID,int> _hash;
         atomic_uint32_t _current;
 
-        inline void process(Packet* p, BatchBuilder& b);
+        inline void process(Packet* p, BatchBuilder& b, const Timestamp& recent);
+
+        static inline IPFlow5ID* flow_id(FlowControlBlock* fcb) {
+            return reinterpret_cast<IPFlow5ID*>(fcb->data + sizeof(FlowExpiry::State));
+        }
 
         FlowControlBlock *fcbs;
 
+        FlowExpiry _expiry;
+        FlowExpiry::wheel_type _timer_wheel;
+        Timer _timer; //Timer to launch the wheel
+        Vector<int> _free_ids; //Of expired flows
+        Spinlock _free_lock;
+
         int _table_size;
         int _flow_state_size_full;
         int _verbose;
@@ -29,7 +29,7 @@ CLICK_DECLS
 
 Spinlock FlowIPManagerSpinlock::hash_table_lock;
 
-FlowIPManagerSpinlock::FlowIPManagerSpinlock() : _verbose(1), _flags(0), _timer(this), _task(this)
+FlowIPManagerSpinlock::FlowIPManagerSpinlock() : hash(0), fcbs(0), _verbose(1), _flags(0), _timer(this), _task(this)
 {
 }
 
@@ -40,10 +40,12 @@ FlowIPManagerSpinlock::~FlowIPManagerSpinlock()
 int
 FlowIPManagerSpinlock::configure(Vector<String> &conf, ErrorHandler *errh)
 {
+    if (_expiry.configure(conf, this, errh, 60) < 0)
+        return -1;
+
     if (Args(conf, this, errh)
         .read_or_set_p("CAPACITY", _table_size, 65536)
         .read_or_set("RESERVE", _reserve, 0)
-        .read_or_set("TIMEOUT", _timeout, 60)
         .complete() < 0)
         return -1;
 
@@ -57,6 +59,8 @@ FlowIPManagerSpinlock::configure(Vector<String> &conf, ErrorHandler *errh)
     router()->get_root_init_future()->postOnce(&_fcb_builded_init_future);
     _fcb_builded_init_future.post(this);
 
+    _reserve += sizeof(FlowExpiry::State);
+
     return 0;
 }
 
@@ -80,46 +84,35 @@ int FlowIPManagerSpinlock::solve_initialize(ErrorHandler *errh)
     if (!hash)
         return errh->error("Could not init flow table !");
 
-    fcbs =  (FlowControlBlock*)CLICK_ALIGNED_ALLOC(_flow_state_size_full * _table_size);
-    bzero(fcbs,_flow_state_size_full * _table_size);
-    CLICK_ASSERT_ALIGNED(fcbs);
+    fcbs =  (FlowControlBlock*)SlabAllocator::allocate_large(_flow_state_size_full * _table_size);
     if (!fcbs)
         return errh->error("Could not init data table !");
+    CLICK_ASSERT_ALIGNED(fcbs);
+    bzero(fcbs,_flow_state_size_full * _table_size);
 
-    if (_timeout > 0) {
-        _timer_wheel.initialize(_timeout);
-    }
+    if (_expiry.enabled()) {
+        _timer_wheel.initialize(_expiry.max_timeout());
 
-    _timer.initialize(this);
-    _timer.schedule_after(Timestamp::make_sec(1));
+        _timer.initialize(this);
+        _timer.schedule_after(Timestamp::make_sec(1));
+    }
     _task.initialize(this, false);
     return 0;
 }
 
-const auto setter = [](FlowControlBlock* prev, FlowControlBlock* next)
-{
-    *((FlowControlBlock**)&prev->data_32[2]) = next;
-};
-
 bool FlowIPManagerSpinlock::run_task(Task* t)
 {
     Timestamp recent = Timestamp::recent_steady();
-    _timer_wheel.run_timers([this,recent](FlowControlBlock* prev) -> FlowControlBlock*{
-        FlowControlBlock* next = *((FlowControlBlock**)&prev->data_32[2]);
-        int old = (recent - prev->lastseen).sec();
-        if (old > _timeout) {
-            // click_chatter("Release %p as it is expired since %d", prev, old);
-            // expire
-            FlowIPManagerSpinlock::hash_table_lock.acquire();
-            rte_hash_free_key_with_position(hash, prev->data_32[0]);
-            FlowIPManagerSpinlock::hash_table_lock.release();
-        } else {
-            // click_chatter("Cascade %p", prev);
-            // No need for lock as we'll be the only one to enqueue there
-            _timer_wheel.schedule_after(prev, _timeout - (recent - prev->lastseen).sec(),setter);
-        }
-        return next;
+    // Take the table lock first, as the data path does
+    FlowIPManagerSpinlock::hash_table_lock.acquire();
+    _expiry.run(_timer_wheel, recent, true, [this](FlowControlBlock* fcb) {
+        void* key;
+        if (rte_hash_get_key_with_position(hash, FlowExpiry::state(fcb)->index, &key) < 0)
+            return;
+        IPFlow5ID fid = *(IPFlow5ID*)key;
+        rte_hash_del_key(hash, &fid);
     });
+    FlowIPManagerSpinlock::hash_table_lock.release();
     return true;
 }
 
@@ -137,6 +130,8 @@ void FlowIPManagerSpinlock::cleanup(CleanupStage stage)
         rte_hash_free(hash);
         FlowIPManagerSpinlock::hash_table_lock.release();
     }
+    if (fcbs)
+        SlabAllocator::deallocate_large(fcbs, _flow_state_size_full * _table_size);
 }
 
 void FlowIPManagerSpinlock::process(Packet* p, BatchBuilder& b, const Timestamp& recent)
@@ -154,20 +149,18 @@ void FlowIPManagerSpinlock::process(Packet* p, BatchBuilder& b, const Timestamp&
             if (unlikely(_verbose > 0)) {
                 click_chatter("Cannot add key (have %d items. Error %d)!", rte_hash_count(table), ret);
             }
+            FlowIPManagerSpinlock::hash_table_lock.release();
             p->kill();
             return;
         }
         fcb = (FlowControlBlock*)((unsigned char*)fcbs + (_flow_state_size_full * ret));
-        fcb->data_32[0] = ret;
-        if (_timeout) {
-            if (_flags) {
-                _timer_wheel.schedule_after_mp(fcb, _timeout, setter);
-            } else {
-                _timer_wheel.schedule_after(fcb, _timeout, setter);
-            }
-        }
+        FlowExpiry::state(fcb)->index = ret;
+        if (_expiry.enabled())
+            _expiry.start(_timer_wheel, fcb, p, true);
     } else {
         fcb = (FlowControlBlock*)((unsigned char*)fcbs + (_flow_state_size_full * ret));
+        if (_expiry.enabled())
+            _expiry.track(_timer_wheel, fcb, p, true);
     }
 
     FlowIPManagerSpinlock::hash_table_lock.release();
@@ -208,10 +201,12 @@ String FlowIPManagerSpinlock::read_handler(Element* e, void* thunk)
 
     rte_hash* table = fc->hash;
     switch ((intptr_t)thunk) {
-    case h_count:
+    case h_count: {
         FlowIPManagerSpinlock::hash_table_lock.acquire();
-        return String(rte_hash_count(table));
+        int count = rte_hash_count(table);
         FlowIPManagerSpinlock::hash_table_lock.release();
+        return String(count);
+    }
     default:
         return "<error>";
     }
@@ -219,6 +214,9 @@ String FlowIPManagerSpinlock::read_handler(Element* e, void* thunk)
 
 void FlowIPManagerSpinlock::add_handlers()
 {
+    add_read_handler("count", read_handler, h_count);
+    if (_expiry.enabled())
+        _expiry.add_handlers(this);
 }
 
 CLICK_ENDDECLS
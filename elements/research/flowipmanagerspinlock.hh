@@ -9,63 +9,13 @@
 #include <click/flow/common.hh>
 #include <click/flow/flowelement.hh>
 #include <click/batchbuilder.hh>
+#include <click/flow/flowexpiry.hh>
 CLICK_DECLS
 class DPDKDevice;
 struct rte_hash;
 
-template <typename T>
-class TimerWheelSpinlock {
-    public:
-        TimerWheelSpinlock() : _index(0) {
-        }
-
-        void initialize(int max) {
-            max = next_pow2(max + 2);
-            _mask = max - 1;
-            _buckets.resize(max);
-        }
-
-        inline void schedule_after(T* obj, uint32_t timeout, const std::function<void(T*,T*)> setter) {
-            unsigned id = ((*(volatile uint32_t*)&_index) + timeout) & _mask;
-            T* f = _buckets.unchecked_at(id);
-            setter(obj,f);
-            _buckets.unchecked_at(id) = obj;
-        }
-
-        inline void schedule_after_mp(T* obj, uint32_t timeout, const std::function<void(T*,T*)> setter) {
-            _writers_lock.acquire();
-            unsigned id = ((*(volatile uint32_t*)&_index) + timeout) & _mask;
-
-            // click_chatter("Enqueue %p at %d", obj, id);
-            T* f = _buckets.unchecked_at(id);
-            setter(obj,f);
-            _buckets.unchecked_at(id) = obj;
-            // click_write_fence(); done by release()
-            _writers_lock.release();
-        }
-
-        /**
-         * Must be called by one thread only!
-         */
-        inline void run_timers(std::function<T*(T*)> expire) {
-            T* f = _buckets.unchecked_at((_index) & _mask);
-            //click_chatter("Expire %d -> %d", _index, _index & _mask);
-            while (f != 0) {
-                f = expire(f);
-            }
-            _buckets.unchecked_at((_index) & _mask) = 0;
-            _index++;
-        }
-
-    private:
-        uint32_t _mask;
-        uint32_t _index;
-        Vector<T*> _buckets;
-        Spinlock _writers_lock;
-};
-
 /**
- * FlowIPManagerSpinlock(CAPACITY [, RESERVE])
+ * FlowIPManagerSpinlock(CAPACITY [, RESERVE, TIMEOUT, SYN_TIMEOUT, CLOSE_TIMEOUT, UDP_TIMEOUT, OTHER_TIMEOUT])
  *
  * =s flow
  *  FCB packet classifier - cuckoo shared-by-all-threads
@@ -79,6 +29,8 @@ class TimerWheelSpinlock {
  * neither set the offsets for placement in the FCB automatically. Look at
  * the middleclick branch for alternatives.
  *
+ * Flows expire as with FlowIPManager.
+ *
  * =a FlowIPManger
  *
  */
@@ -109,20 +61,19 @@ class FlowIPManagerSpinlock: public VirtualFlowManager, public Router::InitFutur
         rte_hash* hash;
         FlowControlBlock *fcbs;
 
-        int _reserve;
         int _table_size;
         int _flow_state_size_full;
         int _verbose;
         int _flags;
 
 
-        int _timeout;
+        FlowExpiry _expiry;
         Timer _timer; // Timer to launch the wheel
         Task _task;
 
         static String read_handler(Element* e, void* thunk);
         inline void process(Packet* p, BatchBuilder& b, const Timestamp& recent);
-        TimerWheelSpinlock<FlowControlBlock> _timer_wheel;
+        FlowExpiry::wheel_type _timer_wheel;
 
         // Added the Spinlock to manage multi-thread operations on the flow table
         static Spinlock hash_table_lock;
@@ -23,6 +23,9 @@
 #include <click/error.hh>
 #include <click/straccum.hh>
 #include <click/standard/alignmentinfo.hh>
+#if HAVE_DPDK
+# include <click/dpdkdevice.hh>
+#endif
 CLICK_DECLS
 namespace Classification {
 namespace Wordwise {
@@ -1176,6 +1179,65 @@ Program::length_checked_match(const Packet *p)
     return -pos;
 }
 
-}}
+}
+
+//
+// SPLIT PACKETS
+//
+
+int
+SplitAccess::configure(unsigned frame_length, ErrorHandler *errh)
+{
+#if HAVE_DPDK
+    if (!dpdk_split_enabled
+	|| DPDKDevice::SPLIT_ACCESS == DPDKDevice::SPLIT_ACCESS_IGNORE) {
+	_enabled = _pull = false;
+	return 0;
+    }
+
+    unsigned header_length = DPDKDevice::split_header_length();
+    if (frame_length > header_length) {
+	if (DPDKDevice::SPLIT_ACCESS == DPDKDevice::SPLIT_ACCESS_FAIL)
+	    return errh->error("program reads %u bytes, but split packets hold %u header bytes", frame_length, header_length);
+	else if (DPDKDevice::SPLIT_ACCESS == DPDKDevice::SPLIT_ACCESS_WARN)
+	    errh->warning("program reads %u bytes, but split packets hold %u header bytes\n(Split packets will look short. Set SPLIT_ACCESS pullup in DPDKInfo to fix this.)", frame_length, header_length);
+    }
+
+    // Headers may be longer than expected, so check at run time anyway
+    _enabled = true;
+    _pull = DPDKDevice::SPLIT_ACCESS == DPDKDevice::SPLIT_ACCESS_PULLUP;
+#else
+    (void) frame_length, (void) errh;
+    _enabled = _pull = false;
+#endif
+    return 0;
+}
+
+void
+SplitAccess::pullup(Packet *p, unsigned length)
+{
+#if HAVE_DPDK
+    int r = DPDKDevice::split_pullup(p, length, _pull);
+    if (r >= 0) {
+	_stats->beyond++;
+	if (r > 0)
+	    _stats->pulled++;
+    }
+#else
+    (void) p, (void) length;
+#endif
+}
+
+String
+SplitAccess::unparse() const
+{
+    PER_THREAD_MEMBER_SUM(uint64_t, beyond, _stats, beyond);
+    PER_THREAD_MEMBER_SUM(uint64_t, pulled, _stats, pulled);
+    StringAccum sa;
+    sa << "beyond " << beyond << "\npulled " << pulled << "\n";
+    return sa.take_string();
+}
+
+}
 CLICK_ENDDECLS
 ELEMENT_PROVIDES(Classification)
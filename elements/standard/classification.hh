@@ -3,6 +3,7 @@
 #define CLICK_CLASSIFICATION_WORDWISE_DOMINATOR_FASTPRED 1
 #include <click/packet.hh>
 #include <click/vector.hh>
+#include <click/multithread.hh>
 CLICK_DECLS
 class ErrorHandler;
 namespace Classification {
@@ -391,6 +392,63 @@ Program::match(const Packet *p)
     return -pos;
 }
 
-}}
+}
+
+/** @class SplitAccess
+ * @brief Checks that classification programs only read the header segment
+ * of header-data split packets.
+ *
+ * With --dpdk-split, a packet received from DPDK only holds its header
+ * segment. The payload stays in a second buffer, possibly in NIC memory, so
+ * a program that tests bytes beyond the header segment sees a short packet.
+ *
+ * configure() compares the extent of a program with the header segment
+ * length, and warns or fails according to DPDKInfo's SPLIT_ACCESS. Elements
+ * call it from their own configure(), so a live reconfiguration checks the
+ * new program too. At run
+ * time, check() counts packets that are shorter than the program needs but
+ * have more data in the next segment. In pullup mode, only the missing bytes
+ * are moved to the header segment. Without split, check() costs a test. */
+class SplitAccess { public:
+
+    SplitAccess()
+	: _enabled(false), _pull(false) {
+    }
+
+    /** @brief Configure for a program reading @a frame_length bytes from
+     * the start of the frame.
+     * @return 0 on success, or a negative error, leaving the configuration
+     * unchanged. */
+    int configure(unsigned frame_length, ErrorHandler *errh);
+
+    bool enabled() const {
+	return _enabled;
+    }
+
+    /** @brief Check that @a length bytes from @a p's data are available. */
+    inline void check(Packet *p, unsigned length) {
+	if (unlikely(_enabled) && p->length() < length)
+	    pullup(p, length);
+    }
+
+    String unparse() const;
+
+  private:
+
+    struct Stats {
+	uint64_t beyond;
+	uint64_t pulled;
+	Stats() : beyond(0), pulled(0) { }
+    };
+
+    bool _enabled;
+    bool _pull;
+    per_thread<Stats> _stats;
+
+    void pullup(Packet *p, unsigned length);
+
+};
+
+}
 CLICK_ENDDECLS
 #endif
@@ -230,6 +230,10 @@ Classifier::configure(Vector<String> &conf, ErrorHandler *errh)
 
     if (!errh->nerrors()) {
 	prog.warn_unused_outputs(noutputs(), errh);
+	// Offsets are relative to the data, which is usually the Ethernet
+	// header
+	if (_split.configure(prog.safe_length(), errh) < 0)
+	    return -1;
 	_prog = prog;
 	return 0;
     } else
@@ -243,10 +247,20 @@ Classifier::program_string(Element *element, void *)
     return c->_prog.unparse();
 }
 
+String
+Classifier::split_access_handler(Element *element, void *)
+{
+    Classifier *c = static_cast<Classifier *>(element);
+    return c->_split.unparse();
+}
+
 void
 Classifier::add_handlers()
 {
     add_read_handler("program", Classifier::program_string, 0, Handler::CALM);
+#if HAVE_DPDK
+    add_read_handler("split_access", Classifier::split_access_handler, 0);
+#endif
 }
 
 #if HAVE_BATCH
@@ -254,7 +268,7 @@ void
 Classifier::push_batch(int, PacketBatch * batch)
 {
 	CLASSIFY_EACH_PACKET(	(noutputs() + 1),
-							_prog.match,
+							classify,
 							batch,
 							checked_output_push_batch);
 
@@ -264,7 +278,7 @@ Classifier::push_batch(int, PacketBatch * batch)
 inline void
 Classifier::push(int, Packet *p)
 {
-    checked_output_push(_prog.match(p), p);
+    checked_output_push(classify(p), p);
 }
 
 CLICK_ENDDECLS
@@ -71,6 +71,12 @@ CLICK_DECLS
  *   safe length 22
  *   alignment offset 0
  *
+ * =h split_access read-only
+ * Only with DPDK. Returns the number of header-data split packets that were
+ * shorter than the program needs but had more data in their payload segment
+ * ("beyond"), and the number of them whose missing bytes were pulled up to
+ * the header segment ("pulled"). See DPDKInfo's SPLIT_ACCESS.
+ *
  * =a IPClassifier, IPFilter */
 
 class Classifier : public BatchElement { public:
@@ -99,8 +105,15 @@ class Classifier : public BatchElement { public:
   protected:
 
     Classification::Wordwise::Program _prog;
+    Classification::SplitAccess _split;
+
+    inline int classify(Packet *p) {
+	_split.check(p, _prog.safe_length());
+	return _prog.match(p);
+    }
 
     static String program_string(Element *, void *);
+    static String split_access_handler(Element *, void *);
 
 };
 
@@ -298,6 +298,30 @@ Counter::simple_action_batch(PacketBatch *batch)
     check_handlers(_count, _byte_count);
     return batch;
 }
+
+void
+Counter::push_array(int port, PacketArray &a)
+{
+    if (unlikely(_batch_precise)) {
+        FOR_EACH_PACKET_ARRAY(a,p)
+                                Counter::simple_action(p);
+    } else {
+        counter_int_type bc = 0;
+        FOR_EACH_PACKET_ARRAY(a,p) {
+            bc += p->length();
+        }
+
+        _count += a.count();
+        _byte_count += bc;
+
+        if (unlikely(!_simple)) {
+            _rate.update(a.count());
+            _byte_rate.update(bc);
+            check_handlers(_count, _byte_count);
+        }
+    }
+    output(port).push_array(a);
+}
 #endif
 
 void
@@ -218,6 +218,7 @@ class Counter : public CounterBase { public:
     Packet *simple_action(Packet *);
 #if HAVE_BATCH
     PacketBatch *simple_action_batch(PacketBatch* batch);
+    void push_array(int port, PacketArray &a) override;
 #endif
 
     void reset();
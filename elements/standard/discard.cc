@@ -64,6 +64,13 @@ Discard::push_batch(int, PacketBatch *head)
     _count+=head->count();
     head->fast_kill();
 }
+
+void
+Discard::push_array(int, PacketArray &a)
+{
+    _count+=a.count();
+    a.fast_kill();
+}
 #endif
 void
 Discard::push(int, Packet *p)
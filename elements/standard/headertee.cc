@@ -0,0 +1,173 @@
+// -*- c-basic-offset: 4 -*-
+/*
+ * headertee.{cc,hh} -- element duplicates packets, copying only their headers
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "headertee.hh"
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/packet_anno.hh>
+#include <clicknet/ip.h>
+#include <clicknet/tcp.h>
+#include <clicknet/udp.h>
+#if HAVE_DPDK
+# include <click/dpdkdevice.hh>
+#endif
+CLICK_DECLS
+
+HeaderTee::HeaderTee()
+    : _length(0)
+{
+}
+
+int
+HeaderTee::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    unsigned n = noutputs();
+    if (Args(conf, this, errh)
+	.read_p("N", n)
+	.read("LENGTH", _length)
+	.complete() < 0)
+	return -1;
+    if (n != (unsigned) noutputs())
+	return errh->error("%d outputs implies %d arms", noutputs(), noutputs());
+    return 0;
+}
+
+inline uint32_t
+HeaderTee::header_length(Packet *p) const
+{
+    if (_length)
+	return _length;
+    if (!p->has_network_header())
+	return DEFAULT_LENGTH;
+    int end = p->network_header_offset() + p->network_header_length();
+    const click_ip *ip = p->ip_header();
+    if (p->network_header_length() >= (int) sizeof(click_ip)
+	&& ip->ip_v == 4 && IP_FIRSTFRAG(ip)) {
+	if (ip->ip_p == IP_PROTO_TCP
+	    && p->transport_length() >= (int) sizeof(click_tcp))
+	    end = p->transport_header_offset() + (p->tcp_header()->th_off << 2);
+	else if (ip->ip_p == IP_PROTO_UDP
+		 && p->transport_length() >= (int) sizeof(click_udp))
+	    end = p->transport_header_offset() + sizeof(click_udp);
+    }
+    return end > 0 ? end : 0;
+}
+
+/* Returns the packet to send out an output, after the original packet p if
+   LAST is true. */
+inline Packet *
+HeaderTee::replicate(Packet *p, bool last, Stats &st)
+{
+#if HAVE_DPDK
+    if (DPDKDevice::is_dpdk_buffer(p)) {
+	if (Packet *q = DPDKDevice::make_header_replica(p, header_length(p),
+							rte_socket_id())) {
+	    uint32_t len = q->length();
+	    q->copy_annotations(p);
+	    // Click only sees the header: the rest counts as extra length, as
+	    // for truncated packets
+	    SET_EXTRA_LENGTH_ANNO(q, DPDKDevice::full_length(q) - len);
+	    if (p->has_mac_header() && (uint32_t) p->mac_header_offset() <= len)
+		q->set_mac_header(q->data() + p->mac_header_offset());
+	    if (p->has_network_header() && (uint32_t) p->network_header_offset() <= len)
+		q->set_network_header(q->data() + p->network_header_offset(),
+				      p->network_header_length());
+	    st.replicas++;
+	    st.copied += len;
+	    if (last)
+		p->kill();
+	    return q;
+	}
+    }
+#endif
+    if (last)
+	return p;
+    st.cloned++;
+    return p->clone();
+}
+
+void
+HeaderTee::push(int, Packet *p)
+{
+    Stats &st = *_stats;
+    int n = noutputs();
+    for (int i = 0; i < n - 1; i++)
+	if (Packet *q = replicate(p, false, st))
+	    output(i).push(q);
+    if (Packet *q = replicate(p, true, st))
+	output(n - 1).push(q);
+}
+
+#if HAVE_BATCH
+void
+HeaderTee::push_batch(int, PacketBatch *batch)
+{
+    Stats &st = *_stats;
+    int n = noutputs();
+    for (int i = 0; i < n; i++) {
+	bool last = i == n - 1;
+	PacketBatch *out = 0;
+	FOR_EACH_PACKET_SAFE(batch, p) {
+	    Packet *q = replicate(p, last, st);
+	    if (!q)
+		continue;
+	    q->set_next(0);
+	    if (out)
+		out->append_packet(q);
+	    else
+		out = PacketBatch::make_from_packet(q);
+	}
+	if (out)
+	    output_push_batch(i, out);
+    }
+}
+#endif
+
+String
+HeaderTee::read_handler(Element *e, void *thunk)
+{
+    HeaderTee *ht = static_cast<HeaderTee *>(e);
+    Stats s;
+    for (unsigned i = 0; i < ht->_stats.weight(); i++) {
+	const Stats &st = ht->_stats.get_value(i);
+	s.replicas += st.replicas;
+	s.copied += st.copied;
+	s.cloned += st.cloned;
+    }
+    switch ((uintptr_t) thunk) {
+    case h_replicas:
+	return String(s.replicas);
+    case h_copied:
+	return String(s.copied);
+    case h_copied_per_replica:
+	return String(s.replicas ? (double) s.copied / s.replicas : 0.);
+    default:
+	return String(s.cloned);
+    }
+}
+
+void
+HeaderTee::add_handlers()
+{
+    add_read_handler("replicas", read_handler, h_replicas);
+    add_read_handler("copied", read_handler, h_copied);
+    add_read_handler("copied_per_replica", read_handler, h_copied_per_replica);
+    add_read_handler("cloned", read_handler, h_cloned);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(HeaderTee)
+ELEMENT_MT_SAFE(HeaderTee)
@@ -0,0 +1,124 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_HEADERTEE_HH
+#define CLICK_HEADERTEE_HH
+#include <click/batchelement.hh>
+#include <click/multithread.hh>
+CLICK_DECLS
+
+/*
+=c
+
+HeaderTee([N, I<keywords> LENGTH])
+
+=s basictransfer
+
+duplicates packets, copying only their headers
+
+=d
+
+HeaderTee sends a replica of each incoming packet out each output, like Tee,
+for port mirroring or multicast fan-out of large packets. Each replica has a
+private copy of the packet's headers, which elements downstream may rewrite
+freely, while the payload is shared by all replicas and never copied.
+
+With DPDK, a replica is a new buffer holding the headers, chained to segments
+attached to the buffers of the original packet. DPDK counts the references to
+the payload, and frees it with the last replica. The payload of packets
+received on a header-data split port, possibly in NIC memory, is shared the
+same way. The original packet is freed once replicated, so that every output
+gets a private header.
+
+Click only sees the header of a replica: its length is the header length, and
+the payload cannot be read or modified. The rest of the replica is counted in
+its extra length annotation, as for truncated packets, so that elements
+honoring it, such as ToDump, ToIPSummaryDump or LinkUnqueue, use the full
+length. Other elements, such as Counter, see the header length only.
+ToDPDKDevice sends the whole replica.
+
+Packets that are not DPDK packets, and all packets in builds without DPDK,
+cannot share their payload apart from their header. They are sent as Tee
+does: clones out every output but the last one, which gets the original
+packet. An output that rewrites them will copy the whole packet.
+
+HeaderTee has however many outputs are used in the configuration, but you can
+say how many outputs you expect with the optional argument N.
+
+Keyword arguments are:
+
+=over 8
+
+=item LENGTH
+
+Integer. Number of bytes of the private header. Default is 0, which copies
+the headers up to the end of the TCP or UDP header, or of the IP header,
+according to the header annotations, or 64 bytes if they are not set.
+
+=back
+
+=h replicas read-only
+
+Returns the number of replicas with a private header.
+
+=h copied read-only
+
+Returns the number of header bytes copied in replicas.
+
+=h copied_per_replica read-only
+
+Returns the average number of bytes copied per replica.
+
+=h cloned read-only
+
+Returns the number of clones sent instead of replicas.
+
+=e
+
+   FromDPDKDevice(0) -> ht :: HeaderTee;
+   ht[0] -> ToDPDKDevice(1);
+   ht[1] -> StoreEtherAddress(02:00:00:00:00:01, dst) -> ToDPDKDevice(2);
+
+=a
+
+Tee, FromDPDKDevice */
+
+class HeaderTee : public BatchElement { public:
+
+    HeaderTee() CLICK_COLD;
+
+    const char *class_name() const override	{ return "HeaderTee"; }
+    const char *port_count() const override	{ return "1/1-"; }
+    const char *processing() const override	{ return PUSH; }
+
+    int configure(Vector<String> &, ErrorHandler *) override CLICK_COLD;
+    void add_handlers() override CLICK_COLD;
+
+    void push(int, Packet *) override;
+#if HAVE_BATCH
+    void push_batch(int, PacketBatch *) override;
+#endif
+
+  private:
+
+    enum { DEFAULT_LENGTH = 64 };
+
+    struct Stats {
+	uint64_t replicas;
+	uint64_t copied;
+	uint64_t cloned;
+	Stats() : replicas(0), copied(0), cloned(0) {
+	}
+    };
+
+    uint32_t _length;
+    per_thread<Stats> _stats;
+
+    inline uint32_t header_length(Packet *p) const;
+    inline Packet *replicate(Packet *p, bool last, Stats &st);
+
+    enum { h_replicas, h_copied, h_copied_per_replica, h_cloned };
+    static String read_handler(Element *, void *) CLICK_COLD;
+
+};
+
+CLICK_ENDDECLS
+#endif
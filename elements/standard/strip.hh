@@ -24,6 +24,7 @@ class Strip : public BatchElement { public:
 
     const char *class_name() const override		{ return "Strip"; }
     const char *port_count() const override		{ return PORTS_1_1; }
+    const char *flags() const override		{ return "F"; }
 
     int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
 
@@ -35,6 +35,9 @@ const unsigned FastUDPFlows::NO_LIMIT;
 
 FastUDPFlows::FastUDPFlows()
   : _flows(0)
+#if HAVE_DPDK
+    , _use_template(false), _nicmem_port(-1), _template(0)
+#endif
 {
 #if HAVE_BATCH
     in_batch_mode = BATCH_MODE_YES;
@@ -57,6 +60,8 @@ FastUDPFlows::configure(Vector<String> &conf, ErrorHandler *errh)
     unsigned rate;
     int limit;
     int len;
+    bool use_template = false;
+    int nicmem_port = -1;
     if (Args(conf, this, errh)
         .read_mp("RATE", rate)
         .read_mp("LIMIT", limit)
@@ -70,9 +75,19 @@ FastUDPFlows::configure(Vector<String> &conf, ErrorHandler *errh)
         .read_p("CHECKSUM", _cksum)
         .read_p("ACTIVE", _active)
         .read_p("STOP", _stop)
+        .read("PAYLOAD_TEMPLATE", use_template)
+        .read("NICMEM_PORT", nicmem_port)
         .complete() < 0)
         return -1;
 
+#if HAVE_DPDK
+    _use_template = use_template;
+    _nicmem_port = nicmem_port;
+#else
+    if (use_template || nicmem_port >= 0)
+        return errh->error("PAYLOAD_TEMPLATE requires DPDK");
+#endif
+
     set_length(len);
     _ethh.ether_type = htons(0x0800);
     if(rate != 0){
@@ -118,11 +133,24 @@ FastUDPFlows::get_packet()
     }
     _flows[flow].flow_count++;
 
+#if HAVE_DPDK
+    if (_template) {
+        Packet *p = DPDKDevice::make_templated(
+            _template, _flows[flow].packet->data(),
+            14 + sizeof(click_ip) + sizeof(click_udp), rte_socket_id());
+        if (p) {
+            p->set_dst_ip_anno(IPAddress(_dipaddr));
+            p->set_ip_header(reinterpret_cast<const click_ip *>(p->data() + 14), sizeof(click_ip));
+        }
+        return p;
+    }
+#endif
+
     return _flows[flow].packet->clone();
 }
 
 int
-FastUDPFlows::initialize(ErrorHandler *)
+FastUDPFlows::initialize(ErrorHandler *errh)
 {
     _count = 0;
     _flows = new flow_t[_nflows];
@@ -143,6 +171,11 @@ FastUDPFlows::initialize(ErrorHandler *)
         ip->ip_src = _sipaddr;
         ip->ip_dst = _dipaddr;
         ip->ip_tos = 0;
+#if HAVE_DPDK
+        // All flows must carry the payload of the template
+        if (_use_template)
+            memset(ip + 1, 0, _len - 14 - sizeof(click_ip));
+#endif
         ip->ip_off = 0;
         ip->ip_ttl = 250;
         ip->ip_sum = 0;
@@ -166,6 +199,21 @@ FastUDPFlows::initialize(ErrorHandler *)
     }
     _last_flow = 0;
 
+#if HAVE_DPDK
+    if (_use_template) {
+        unsigned hlen = 14 + sizeof(click_ip) + sizeof(click_udp);
+        if (!errh)
+            errh = ErrorHandler::default_handler();
+        _template = DPDKDevice::payload_template_create(
+            _flows[0].packet->data() + hlen, _len - hlen, _nicmem_port,
+            rte_socket_id(), errh);
+        if (!_template)
+            return -1;
+    }
+#else
+    (void) errh;
+#endif
+
     return 0;
 }
 
@@ -179,6 +227,10 @@ FastUDPFlows::cleanup_flows() {
         delete[] _flows;
         _flows = 0;
     }
+#if HAVE_DPDK
+    DPDKDevice::payload_template_destroy(_template);
+    _template = 0;
+#endif
 }
 
 void
@@ -6,6 +6,9 @@
 #include <click/packet.hh>
 #include <clicknet/ether.h>
 #include <clicknet/udp.h>
+#if HAVE_DPDK
+# include <click/dpdkdevice.hh>
+#endif
 
 CLICK_DECLS
 
@@ -14,7 +17,7 @@ CLICK_DECLS
  * FastUDPFlows(RATE, LIMIT, LEN,
  *              SRCETH, SRCIP,
  *              DSTETH, DSTIP,
- *              FLOWS, FLOWSIZE [, CHECKSUM, ACTIVE])
+ *              FLOWS, FLOWSIZE [, CHECKSUM, ACTIVE, I<keywords>])
  * =s udp
  * creates packets flows with static UDP/IP/Ethernet headers
  * =d
@@ -39,6 +42,30 @@ CLICK_DECLS
  *
  * By default FastUDPFlows is ACTIVE.
  *
+ * Keywords are:
+ *
+ * =over 8
+ *
+ * =item PAYLOAD_TEMPLATE
+ *
+ * Boolean. Only with DPDK. If true, the UDP payload, which is the same for
+ * all packets, is placed once in DPDK memory. Each packet is then a header
+ * mbuf chained to a shared external segment holding the payload, so that
+ * the payload is not copied nor read from a per-packet buffer. Downstream
+ * elements only see the headers, so it is meant to be connected directly
+ * to ToDPDKDevice. Default is false.
+ *
+ * =item NICMEM_PORT
+ *
+ * Integer. With PAYLOAD_TEMPLATE, place the payload in the memory of this
+ * DPDK port instead of host memory, so the NIC does not fetch it through
+ * PCIe for each packet. Exactly the payload length is taken from the NIC,
+ * and given back once FastUDPFlows is cleaned up and the last packet is
+ * freed. Falls back to host memory if the NIC has none left. Default is -1
+ * (host memory).
+ *
+ * =back
+ *
  * =h count read-only
  * Returns the total number of packets that have been generated.
  * =h rate read/write
@@ -109,6 +136,11 @@ class FastUDPFlows : public BatchElement {
             unsigned flow_count;
         };
         flow_t *_flows;
+#if HAVE_DPDK
+        bool _use_template;
+        int _nicmem_port;
+        DPDKDevice::PayloadTemplate *_template;
+#endif
         void change_ports(int);
         Packet *get_packet();
 
@@ -20,6 +20,7 @@
 #include <click/config.h>
 #include <click/glue.hh>
 #include <click/args.hh>
+#include <click/error.hh>
 #include <click/ipflowid.hh>
 #include <clicknet/ip.h>
 #include <clicknet/tcp.h>
@@ -30,7 +31,7 @@ CLICK_DECLS
 
 //TODO : disable timer if own_state is false
 
-IPLoadBalancer::IPLoadBalancer() {
+IPLoadBalancer::IPLoadBalancer() : _stateless(false), _cookie_mask(0) {
 
 };
 
@@ -44,6 +45,7 @@ IPLoadBalancer::configure(Vector<String> &conf, ErrorHandler *errh)
     if (Args(this, errh).bind(conf)
                .read_all("DST",Args::mandatory | Args::positional,DefaultArg<Vector<IPAddress>>(),_dsts)
                .read_mp("VIP", _vip)
+               .read("STATELESS", _stateless)
                .consume() < 0)
 		return -1;
 
@@ -55,6 +57,24 @@ IPLoadBalancer::configure(Vector<String> &conf, ErrorHandler *errh)
 
     click_chatter("%p{element} has %d routes",this,_dsts.size());
 
+    if (_stateless) {
+        // A retransmitted SYN must reach the server of the first one
+        if (!isFlowHashing(_mode_case))
+            return errh->error("STATELESS requires an LB_MODE that hashes the flow");
+        // Packets without cookie follow the hash ring
+        if (_mode_case != constant_hash_agg) {
+            if (_cst_hash.size() == 0)
+                _cst_hash.resize(_dsts.size() * 100);
+            build_hash_ring();
+        }
+        while ((int) _cookie_mask < _dsts.size() - 1)
+            _cookie_mask = (_cookie_mask << 1) | 1;
+        if (_cookie_mask == 0)
+            _cookie_mask = 1;
+        for (int i = 0; i < _dsts.size(); i++)
+            _dst_index[_dsts[i]] = i;
+    }
+
     return 0;
 }
 
@@ -64,13 +84,79 @@ int IPLoadBalancer::initialize(ErrorHandler *errh) {
     return 0;
 }
 
+inline int
+IPLoadBalancer::pick_stateless(Packet* p) {
+    const click_ip* ip = p->ip_header();
+    if (ip->ip_p == IP_PROTO_TCP && IP_FIRSTFRAG(ip)
+        && p->transport_length() >= (int) sizeof(click_tcp)) {
+        const uint8_t* ts = TCPHelper::getTimestampOption(p);
+        if (ts) {
+            if ((p->tcp_header()->th_flags & (TH_SYN | TH_ACK)) == TH_SYN)
+                return pick_server(p);
+            uint32_t ecr;
+            memcpy(&ecr, ts + 6, 4);
+            unsigned server = ntohl(ecr) & _cookie_mask;
+            if (likely(server < (unsigned) _dsts.size())) {
+                _stateless_stats->cookie_hits++;
+                return server;
+            }
+        }
+    }
+    _stateless_stats->hash_fallbacks++;
+    unsigned server_val = IPFlowID(p, false).hashcode();
+    server_val = ((server_val >> 16) ^ (server_val & 65535)) % _cst_hash.size();
+    return _cst_hash.unchecked_at(server_val);
+}
+
+/* Writes the index of the server SRC in the timestamp value of Q, rounded
+   down so that successive timestamps of a server stay in order. */
+inline void
+IPLoadBalancer::set_cookie(WritablePacket* q, IPAddress src) {
+    const click_ip* ip = q->ip_header();
+    if (ip->ip_p != IP_PROTO_TCP || !IP_FIRSTFRAG(ip)
+        || q->transport_length() < (int) sizeof(click_tcp))
+        return;
+    auto it = _dst_index.find(src);
+    if (!it)
+        return;
+    uint8_t* ts = TCPHelper::getTimestampOption(q);
+    if (!ts)
+        return;
+
+    click_tcp* th = q->tcp_header();
+    uint8_t* val = ts + 2;
+    uint32_t old_val, cookie = it.value();
+    memcpy(&old_val, val, 4);
+    uint32_t v = ntohl(old_val);
+    uint32_t nv = (v & ~_cookie_mask) | cookie;
+    if ((v & _cookie_mask) < cookie)
+        nv -= _cookie_mask + 1;
+    if (nv == v)
+        return;
+
+    // The option may start at an odd offset: update the checksum with the
+    // half-words that cover the value
+    int off = val - (uint8_t*) th;
+    uint8_t* w = (uint8_t*) th + (off & ~1);
+    int nw = (((off + 5) & ~1) - (off & ~1)) / 2;
+    uint16_t old_hw[3];
+    memcpy(old_hw, w, nw * 2);
+    nv = htonl(nv);
+    memcpy(val, &nv, 4);
+    for (int i = 0; i < nw; i++) {
+        uint16_t new_hw;
+        memcpy(&new_hw, w + 2 * i, 2);
+        click_update_in_cksum(&th->th_sum, old_hw[i], new_hw);
+    }
+}
+
 #if HAVE_BATCH
 void IPLoadBalancer::push_batch(int, PacketBatch* batch) {
 
     auto fnt = [this](Packet*&p) {
         WritablePacket* q =p->uniqueify();
 
-        unsigned hash = pick_server(q);
+        unsigned hash = _stateless ? pick_stateless(q) : pick_server(q);
         IPAddress srv = _dsts.unchecked_at(hash);
 	track_load(q, hash);
 
@@ -92,7 +178,7 @@ void IPLoadBalancer::push(int, Packet* p) {
             return;
         }
 
-        unsigned hash = pick_server(q);
+        unsigned hash = _stateless ? pick_stateless(q) : pick_server(q);
         IPAddress srv = _dsts.unchecked_at(hash);
 	track_load(q, hash);
 
@@ -123,9 +209,24 @@ IPLoadBalancer::read_handler(Element *e, void *thunk) {
 
 }
 
+String
+IPLoadBalancer::read_stateless_handler(Element *e, void *thunk) {
+    IPLoadBalancer *cs = static_cast<IPLoadBalancer *>(e);
+    uint64_t n = 0;
+    for (unsigned i = 0; i < cs->_stateless_stats.weight(); i++) {
+        const StatelessStats &st = cs->_stateless_stats.get_value(i);
+        n += thunk ? st.hash_fallbacks : st.cookie_hits;
+    }
+    return String(n);
+}
+
 void
 IPLoadBalancer::add_handlers(){
     add_lb_handlers<IPLoadBalancer>(this);
+    if (_stateless) {
+        add_read_handler("cookie_hits", read_stateless_handler, 0);
+        add_read_handler("hash_fallbacks", read_stateless_handler, 1);
+    }
 }
 
 IPLoadBalancerReverse::IPLoadBalancerReverse() {
@@ -160,6 +261,8 @@ void IPLoadBalancerReverse::push_batch(int, PacketBatch* batch) {
     auto fnt = [this](Packet* &p)  {
         WritablePacket* q =p->uniqueify();
         p = q;
+        if (_lb->_stateless)
+            _lb->set_cookie(q, q->ip_header()->ip_src);
 	q->ip_header()->ip_src = _lb->_vip;
         return q;
     };
@@ -177,6 +280,8 @@ void IPLoadBalancerReverse::push(int, Packet* p) {
         if (unlikely(!q)) {
             return;
         }
+        if (_lb->_stateless)
+            _lb->set_cookie(q, q->ip_header()->ip_src);
 	    q->ip_header()->ip_src = _lb->_vip;
 
         output_push(0, q);
@@ -7,6 +7,7 @@
 #include <click/batchelement.hh>
 #include <click/loadbalancer.hh>
 #include <click/vector.hh>
+#include <click/hashtable.hh>
 
 
 CLICK_DECLS
@@ -26,6 +27,28 @@ TCP&UDP load-balancer, without SNAT
 
 Load-balancer than only rewrites the destination.
 
+IPLoadBalancer keeps no per-connection state: each packet is dispatched by
+itself, so only hashing LB_MODEs keep connections on the same server, and
+only until the set of servers changes. In STATELESS mode, the server of a TCP
+connection is written in the connection itself, and IPLoadBalancerReverse
+must see all the packets from the servers. It writes the index of the server
+in the low bits of the timestamp value of the TCP timestamp option, which the
+client echoes back in every packet. IPLoadBalancer then sends packets whose
+echoed timestamp carries this cookie to that server, whatever the LB_MODE and
+the weights, without any lookup. SYNs with the timestamp option are
+dispatched according to LB_MODE, which must hash the flow so that a
+retransmitted SYN reaches the same server: STATELESS cannot be used with the
+rr, wrr, awrr, least and pow2 modes. Other packets, without timestamp or not
+TCP, are dispatched with a consistent hash of their flow, so that connections
+without timestamps stay on their server too.
+
+The cookie takes as few bits as needed to number the servers, B bits for
+up to 2^B servers. The timestamp values sent by the servers are rounded down
+to the closest value that ends with the cookie, which keeps them
+monotonic; servers then see echoed timestamps up to 2^B - 1 ticks older
+than the ones they sent, which inflates their round-trip time samples by as
+much.
+
 Keyword arguments are:
 
 =over 8
@@ -37,8 +60,22 @@ IP Address. Can be repeated multiple times, once per destination.
 =item VIP
 IP Address of this load-balancer.
 
+=item STATELESS
+
+Boolean. Keep connections on their server with cookies in their TCP
+timestamps, see above. Requires a flow-hashing LB_MODE, such as hash.
+Default is false.
+
 =back
 
+=h cookie_hits read-only
+
+Returns the number of packets dispatched from their cookie in STATELESS mode.
+
+=h hash_fallbacks read-only
+
+Returns the number of packets dispatched with the consistent hash in
+STATELESS mode.
 
 =a
 
@@ -70,8 +107,25 @@ public:
 private:
     static int handler(int op, String& s, Element* e, const Handler* h, ErrorHandler* errh);
     static String read_handler(Element *handler, void *user_data);
+    static String read_stateless_handler(Element *e, void *user_data);
     IPAddress _vip;
     bool _accept_nonsyn;
+
+    struct StatelessStats {
+        uint64_t cookie_hits;
+        uint64_t hash_fallbacks;
+        StatelessStats() : cookie_hits(0), hash_fallbacks(0) {
+        }
+    };
+
+    bool _stateless;
+    uint32_t _cookie_mask;
+    HashTable<IPAddress, int> _dst_index;
+    per_thread<StatelessStats> _stateless_stats;
+
+    inline int pick_stateless(Packet *p);
+    inline void set_cookie(WritablePacket *q, IPAddress src);
+
     static int write_handler(
       const String &, Element *, void *, ErrorHandler *
   ) CLICK_COLD;
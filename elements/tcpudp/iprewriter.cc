@@ -110,7 +110,7 @@ IPRewriter::add_flow(int ip_p, const IPFlowID &flowid,
     if (ip_p == IP_PROTO_TCP)
 	return TCPRewriter::add_flow(ip_p, flowid, rewritten_flowid, input);
 
-    void *data = _state->_udp_allocator.allocate();
+    void *data = SlabAllocator::allocate(sizeof(UDPFlow));
     if (!data) {
         click_chatter("[%s] [Core %d]: UDP Allocator failed", class_name(), click_current_cpu_id());
 	return 0;
@@ -260,7 +260,6 @@ class IPRewriter : public TCPRewriter { public:
         IPState() : _udp_map(0) {
         }
         Map                                 _udp_map;
-        SizedHashAllocator<sizeof(UDPFlow)> _udp_allocator;
         uint32_t                            _udp_timeouts[2];
         uint32_t                            _udp_streaming_timeout;
     };
@@ -293,7 +292,7 @@ IPRewriter::destroy_flow(IPRewriterFlow *flow)
     else {
 	unmap_flow(flow, _state->_udp_map, &reply_udp_map(flow->owner()));
 	flow->~IPRewriterFlow();
-	_state->_udp_allocator.deallocate(flow);
+	SlabAllocator::deallocate(flow, sizeof(UDPFlow));
     }
 }
 
@@ -0,0 +1,629 @@
+// -*- c-basic-offset: 4 -*-
+/*
+ * synproxy.{cc,hh} -- completes TCP handshakes with SYN cookies
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "synproxy.hh"
+#include <click/args.hh>
+#include <click/error.hh>
+#include <clicknet/ether.h>
+#if defined(__SSE4_2__)
+# include <nmmintrin.h>
+#endif
+CLICK_DECLS
+
+// MSS values a cookie can carry, in its 3 low bits
+static const uint16_t cookie_mss[8] = {
+    536, 1200, 1300, 1360, 1400, 1440, 1460, 8960
+};
+
+#define SIP_ROTL(x, b) (uint64_t) (((x) << (b)) | ((x) >> (64 - (b))))
+#define SIP_ROUND \
+    do { \
+	v0 += v1; v1 = SIP_ROTL(v1, 13); v1 ^= v0; v0 = SIP_ROTL(v0, 32); \
+	v2 += v3; v3 = SIP_ROTL(v3, 16); v3 ^= v2; \
+	v0 += v3; v3 = SIP_ROTL(v3, 21); v3 ^= v0; \
+	v2 += v1; v1 = SIP_ROTL(v1, 17); v1 ^= v2; v2 = SIP_ROTL(v2, 32); \
+    } while (0)
+
+/* SipHash-2-4 of a 20-byte message, given as two 8-byte words and the
+   4 last bytes. */
+static inline uint64_t
+siphash20(const uint64_t *k, uint64_t m0, uint64_t m1, uint32_t m2)
+{
+    uint64_t v0 = k[0] ^ 0x736f6d6570736575ULL;
+    uint64_t v1 = k[1] ^ 0x646f72616e646f6dULL;
+    uint64_t v2 = k[0] ^ 0x6c7967656e657261ULL;
+    uint64_t v3 = k[1] ^ 0x7465646279746573ULL;
+    uint64_t m[3] = { m0, m1, m2 | (20ULL << 56) };
+    for (int i = 0; i < 3; i++) {
+	v3 ^= m[i];
+	SIP_ROUND;
+	SIP_ROUND;
+	v0 ^= m[i];
+    }
+    v2 ^= 0xff;
+    SIP_ROUND;
+    SIP_ROUND;
+    SIP_ROUND;
+    SIP_ROUND;
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+static inline uint32_t
+crc32c_u64(uint32_t crc, uint64_t v)
+{
+#if defined(__SSE4_2__) && defined(__x86_64__)
+    return _mm_crc32_u64(crc, v);
+#else
+    for (int i = 0; i < 8; i++, v >>= 8) {
+	crc ^= v & 0xFF;
+	for (int b = 0; b < 8; b++)
+	    crc = (crc >> 1) ^ (0x82F63B78 & -(crc & 1));
+    }
+    return crc;
+#endif
+}
+
+SYNProxy::SYNProxy()
+    : _crc(false), _timeout(300), _timer(this)
+{
+    _key[0] = _key[1] = 0;
+}
+
+SYNProxy::~SYNProxy()
+{
+}
+
+int
+SYNProxy::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    String hash = "siphash", key;
+    bool have_key;
+    if (Args(conf, this, errh)
+	.read("HASH", WordArg(), hash)
+	.read("KEY", StringArg(), key).read_status(have_key)
+	.read("TIMEOUT", SecondsArg(), _timeout)
+	.complete() < 0)
+	return -1;
+    if (hash == "siphash")
+	_crc = false;
+    else if (hash == "crc")
+	_crc = true;
+    else
+	return errh->error("HASH must be siphash or crc");
+    if (_timeout == 0)
+	return errh->error("TIMEOUT must be positive");
+    if (have_key && key.length() != sizeof(_key))
+	return errh->error("KEY must be %d bytes long", (int) sizeof(_key));
+    else if (have_key)
+	memcpy(_key, key.data(), sizeof(_key));
+    else
+	for (int i = 0; i < 2; i++)
+	    _key[i] = ((uint64_t) click_random() << 42)
+		^ ((uint64_t) click_random() << 21) ^ click_random();
+    return 0;
+}
+
+int
+SYNProxy::initialize(ErrorHandler *)
+{
+    _timer.initialize(this);
+    _timer.schedule_after_sec(1);
+    return 0;
+}
+
+void
+SYNProxy::cleanup(CleanupStage)
+{
+    for (int i = 0; i < NSHARDS; i++) {
+	HashMap<IPFlowID, Conn> &table = _shards[i].table;
+	for (HashMap<IPFlowID, Conn>::iterator it = table.begin(); it.live(); it++)
+	    if (it.value().held)
+		it.value().held->kill();
+	table.clear();
+    }
+}
+
+/* Cookies are valid for two periods of 64 seconds. */
+inline uint32_t
+SYNProxy::cookie_time()
+{
+    return click_jiffies() / (CLICK_HZ * 64);
+}
+
+/* Hash of a packet from the client, with the client's initial sequence
+   number ISN. Only the 24 high bits are used. */
+inline uint32_t
+SYNProxy::hash(const click_ip *ip, const click_tcp *tcp, uint32_t isn, uint32_t t) const
+{
+    uint64_t m0 = ip->ip_src.s_addr | ((uint64_t) ip->ip_dst.s_addr << 32);
+    uint64_t m1 = tcp->th_sport | ((uint64_t) tcp->th_dport << 16)
+	| ((uint64_t) isn << 32);
+    if (_crc) {
+	uint32_t crc = crc32c_u64(0xFFFFFFFF, _key[0]);
+	crc = crc32c_u64(crc, m0 ^ _key[1]);
+	crc = crc32c_u64(crc, m1);
+	crc = crc32c_u64(crc, t);
+	return ~crc;
+    } else
+	return siphash20(_key, m0, m1, t);
+}
+
+bool
+SYNProxy::tcp_packet(Packet *p)
+{
+    const click_ip *ip = p->ip_header();
+    return p->has_network_header() && ip->ip_p == IP_PROTO_TCP
+	&& IP_FIRSTFRAG(ip) && p->transport_length() >= (int) sizeof(click_tcp);
+}
+
+static inline bool
+is_syn(Packet *p)
+{
+    return (p->tcp_header()->th_flags & (TH_SYN | TH_ACK | TH_RST)) == TH_SYN;
+}
+
+static inline void
+write_mss(click_tcp *tcp, int mss)
+{
+    uint8_t *o = reinterpret_cast<uint8_t *>(tcp + 1);
+    o[0] = TCPOPT_MAXSEG;
+    o[1] = TCPOLEN_MAXSEG;
+    o[2] = mss >> 8;
+    o[3] = mss & 0xFF;
+}
+
+static inline void
+finish_packet(click_ip *ip, click_tcp *tcp)
+{
+    ip->ip_v = 4;
+    ip->ip_hl = sizeof(click_ip) >> 2;
+    ip->ip_tos = 0;
+    ip->ip_len = htons(sizeof(click_ip) + sizeof(click_tcp) + TCPOLEN_MAXSEG);
+    ip->ip_id = 0;
+    ip->ip_off = htons(IP_DF);
+    ip->ip_sum = 0;
+    ip->ip_sum = click_in_cksum((unsigned char *) ip, sizeof(click_ip));
+    tcp->th_off = (sizeof(click_tcp) + TCPOLEN_MAXSEG) >> 2;
+    tcp->th_flags2 = 0;
+    tcp->th_urp = 0;
+    tcp->th_sum = 0;
+    unsigned csum = click_in_cksum((unsigned char *) tcp, sizeof(click_tcp) + TCPOLEN_MAXSEG);
+    tcp->th_sum = click_in_cksum_pseudohdr(csum, ip, sizeof(click_tcp) + TCPOLEN_MAXSEG);
+}
+
+/* Turns the client's SYN P into the SYN-ACK answering it, in place. */
+WritablePacket *
+SYNProxy::make_synack(Packet *p, uint32_t cookie)
+{
+    WritablePacket *q = p->uniqueify();
+    if (!q)
+	return 0;
+    // The answer has no IP options, and only the MSS TCP option
+    click_tcp tcp = *q->tcp_header();
+    if (q->ip_header()->ip_hl != sizeof(click_ip) >> 2)
+	q->set_ip_header(q->ip_header(), sizeof(click_ip));
+    int need = (q->transport_header() + sizeof(click_tcp) + TCPOLEN_MAXSEG) - q->end_data();
+    if (need > 0 && !(q = q->put(need)))
+	return 0;
+    else if (need < 0)
+	q->take(-need);
+
+    if (q->has_mac_header() && q->mac_header_length() == sizeof(click_ether)) {
+	click_ether *eth = reinterpret_cast<click_ether *>(q->mac_header());
+	uint8_t tmp[6];
+	memcpy(tmp, eth->ether_dhost, 6);
+	memcpy(eth->ether_dhost, eth->ether_shost, 6);
+	memcpy(eth->ether_shost, tmp, 6);
+    }
+
+    click_ip *ip = q->ip_header();
+    struct in_addr a = ip->ip_src;
+    ip->ip_src = ip->ip_dst;
+    ip->ip_dst = a;
+    ip->ip_ttl = 64;
+
+    click_tcp *th = q->tcp_header();
+    th->th_sport = tcp.th_dport;
+    th->th_dport = tcp.th_sport;
+    th->th_ack = htonl(ntohl(tcp.th_seq) + 1);
+    th->th_seq = htonl(cookie);
+    th->th_flags = TH_SYN | TH_ACK;
+    th->th_win = htons(65535);
+    write_mss(th, cookie_mss[cookie & 7]);
+    finish_packet(ip, th);
+    return q;
+}
+
+/* Computes the cookies of N SYNs, all the hashes first, and turns them into
+   SYN-ACKs. */
+inline void
+SYNProxy::cookie_batch(Packet **syns, int n)
+{
+    uint32_t t = cookie_time();
+    uint32_t cookies[COOKIE_BATCH];
+    for (int i = 0; i < n; i++) {
+	const click_tcp *tcp = syns[i]->tcp_header();
+	cookies[i] = hash(syns[i]->ip_header(), tcp, ntohl(tcp->th_seq), t);
+    }
+
+    for (int i = 0; i < n; i++) {
+	// Find the MSS option
+	Packet *p = syns[i];
+	const click_tcp *tcp = p->tcp_header();
+	int mss = cookie_mss[0];
+	const uint8_t *o = reinterpret_cast<const uint8_t *>(tcp + 1);
+	const uint8_t *endo = reinterpret_cast<const uint8_t *>(tcp) + (tcp->th_off << 2);
+	if (endo > p->end_data())
+	    endo = p->end_data();
+	while (o < endo && *o != TCPOPT_EOL) {
+	    if (*o == TCPOPT_NOP) {
+		o++;
+		continue;
+	    } else if (o + 1 >= endo || o[1] < 2 || o + o[1] > endo)
+		break;
+	    else if (*o == TCPOPT_MAXSEG && o[1] == TCPOLEN_MAXSEG)
+		mss = (o[2] << 8) | o[3];
+	    o += o[1];
+	}
+	int m = 7;
+	while (m > 0 && cookie_mss[m] > mss)
+	    m--;
+	uint32_t cookie = (cookies[i] & 0xFFFFFF00) | ((t & 31) << 3) | m;
+	syns[i] = make_synack(p, cookie);
+    }
+    _stats->syns += n;
+}
+
+/* Returns true if the ACK number of a client packet acknowledges a cookie,
+   and sets MSS to the MSS of that cookie. */
+inline bool
+SYNProxy::check_cookie(const click_ip *ip, const click_tcp *tcp, uint32_t cookie, int &mss) const
+{
+    uint32_t t = cookie_time();
+    uint32_t dt = (t - ((cookie >> 3) & 31)) & 31;
+    if (dt > 1)
+	return false;
+    uint32_t h = hash(ip, tcp, ntohl(tcp->th_seq) - 1, t - dt);
+    if ((h ^ cookie) & 0xFFFFFF00)
+	return false;
+    mss = cookie_mss[cookie & 7];
+    return true;
+}
+
+/* Builds the SYN to the server, for the client's ACK. */
+Packet *
+SYNProxy::make_syn(Packet *ack, int mss)
+{
+    int off = ack->network_header_offset();
+    WritablePacket *q = Packet::make(off + sizeof(click_ip) + sizeof(click_tcp) + TCPOLEN_MAXSEG);
+    if (!q)
+	return 0;
+    memcpy(q->data(), ack->data(), off + sizeof(click_ip));
+    q->copy_annotations(ack);
+    q->set_ip_header(reinterpret_cast<click_ip *>(q->data() + off), sizeof(click_ip));
+    if (ack->has_mac_header() && ack->mac_header_length() == sizeof(click_ether)
+	&& off >= (int) sizeof(click_ether))
+	q->set_mac_header(q->network_header() - sizeof(click_ether), sizeof(click_ether));
+
+    const click_tcp *atcp = ack->tcp_header();
+    click_tcp *th = q->tcp_header();
+    th->th_sport = atcp->th_sport;
+    th->th_dport = atcp->th_dport;
+    th->th_seq = htonl(ntohl(atcp->th_seq) - 1);
+    th->th_ack = 0;
+    th->th_flags = TH_SYN;
+    th->th_win = atcp->th_win;
+    write_mss(th, mss);
+    finish_packet(q->ip_header(), th);
+    return q;
+}
+
+/* Sets the sequence or acknowledgement number FIELD of P to VALUE. */
+void
+SYNProxy::splice(WritablePacket *p, uint32_t *field, uint32_t value)
+{
+    click_tcp *tcp = p->tcp_header();
+    uint32_t old = *field, nv = htonl(value);
+    uint16_t o[2], n[2];
+    memcpy(o, &old, 4);
+    memcpy(n, &nv, 4);
+    click_update_in_cksum(&tcp->th_sum, o[0], n[0]);
+    click_update_in_cksum(&tcp->th_sum, o[1], n[1]);
+    *field = nv;
+}
+
+/* Handles a packet from a client other than a SYN. */
+void
+SYNProxy::process_client(Packet *p, Packet *&to_server, Packet *&)
+{
+    const click_tcp *tcp = p->tcp_header();
+    uint8_t flags = tcp->th_flags;
+    IPFlowID flow(p);
+    Shard &s = shard_for(_shards, flow);
+    click_jiffies_t now = click_jiffies();
+
+    s.lock.acquire();
+    if (Conn *c = s.table.findp(flow)) {
+	if (c->state == S_SYN_SENT) {
+	    // The client sends data before the server has answered, it will
+	    // retransmit it
+	    s.lock.release();
+	    p->kill();
+	    return;
+	}
+	uint32_t delta = c->delta;
+	if (flags & TH_FIN)
+	    c->fins |= 1;
+	if (c->state == S_ESTABLISHED && ((flags & TH_RST) || c->fins == 3)) {
+	    c->state = S_CLOSING;
+	    c->expiry = now + CLOSING_TIMEOUT * CLICK_HZ;
+	} else if (c->state == S_ESTABLISHED)
+	    c->expiry = now + _timeout * CLICK_HZ;
+	s.lock.release();
+
+	WritablePacket *q = p->uniqueify();
+	if (q && (flags & TH_ACK))
+	    splice(q, &q->tcp_header()->th_ack, ntohl(q->tcp_header()->th_ack) + delta);
+	to_server = q;
+	return;
+    }
+    s.lock.release();
+
+    int mss;
+    if ((flags & (TH_SYN | TH_ACK | TH_RST | TH_FIN)) != TH_ACK
+	|| !check_cookie(p->ip_header(), tcp, ntohl(tcp->th_ack) - 1, mss)) {
+	_stats->invalid++;
+	p->kill();
+	return;
+    }
+    _stats->valid++;
+
+    Packet *syn = make_syn(p, mss);
+    if (!syn) {
+	p->kill();
+	return;
+    }
+    Conn conn;
+    conn.delta = ntohl(tcp->th_ack) - 1;	// the cookie, until the SYN-ACK
+    conn.held = p;
+    conn.expiry = now + SYN_SENT_TIMEOUT * CLICK_HZ;
+    s.lock.acquire();
+    // Another thread may have validated a copy of the same ACK first
+    bool fresh = !s.table.findp(flow);
+    if (fresh)
+	s.table.insert(flow, conn);
+    s.lock.release();
+    if (!fresh) {
+	p->kill();
+	syn->kill();
+	return;
+    }
+    to_server = syn;
+}
+
+/* Handles a packet from a server. */
+void
+SYNProxy::process_server(Packet *p, Packet *&to_server, Packet *&to_client)
+{
+    if (!tcp_packet(p)) {
+	to_client = p;
+	return;
+    }
+    const click_tcp *tcp = p->tcp_header();
+    uint8_t flags = tcp->th_flags;
+    IPFlowID flow(p, true);
+    Shard &s = shard_for(_shards, flow);
+    click_jiffies_t now = click_jiffies();
+
+    s.lock.acquire();
+    Conn *c = s.table.findp(flow);
+    if (!c) {
+	s.lock.release();
+	to_client = p;
+	return;
+    }
+
+    if (c->state == S_SYN_SENT) {
+	uint32_t cookie = c->delta;
+	Packet *held = c->held;
+	uint32_t client_seq = ntohl(held->tcp_header()->th_seq);
+	if ((flags & (TH_SYN | TH_ACK | TH_RST)) == (TH_SYN | TH_ACK)
+	    && ntohl(tcp->th_ack) == client_seq) {
+	    // Release the client's ACK, that completes the handshake
+	    uint32_t delta = ntohl(tcp->th_seq) - cookie;
+	    c->delta = delta;
+	    c->held = 0;
+	    c->state = S_ESTABLISHED;
+	    c->expiry = now + _timeout * CLICK_HZ;
+	    s.lock.release();
+	    p->kill();
+	    WritablePacket *q = held->uniqueify();
+	    if (q)
+		splice(q, &q->tcp_header()->th_ack, ntohl(q->tcp_header()->th_ack) + delta);
+	    to_server = q;
+	} else if ((flags & TH_RST) && ntohl(tcp->th_ack) == client_seq) {
+	    // The server refuses the connection: reset the client
+	    s.table.erase(flow);
+	    s.lock.release();
+	    held->kill();
+	    WritablePacket *q = p->uniqueify();
+	    if (q) {
+		click_tcp *th = q->tcp_header();
+		splice(q, &th->th_seq, cookie + 1);
+		uint16_t ow, nw;
+		memcpy(&ow, reinterpret_cast<uint8_t *>(th) + 12, 2);
+		th->th_flags = TH_RST;
+		memcpy(&nw, reinterpret_cast<uint8_t *>(th) + 12, 2);
+		click_update_in_cksum(&th->th_sum, ow, nw);
+	    }
+	    to_client = q;
+	} else {
+	    s.lock.release();
+	    p->kill();
+	}
+	return;
+    }
+
+    uint32_t delta = c->delta;
+    if (flags & TH_FIN)
+	c->fins |= 2;
+    if (c->state == S_ESTABLISHED && ((flags & TH_RST) || c->fins == 3)) {
+	c->state = S_CLOSING;
+	c->expiry = now + CLOSING_TIMEOUT * CLICK_HZ;
+    } else if (c->state == S_ESTABLISHED)
+	c->expiry = now + _timeout * CLICK_HZ;
+    s.lock.release();
+
+    WritablePacket *q = p->uniqueify();
+    if (q)
+	splice(q, &q->tcp_header()->th_seq, ntohl(q->tcp_header()->th_seq) - delta);
+    to_client = q;
+}
+
+void
+SYNProxy::push(int port, Packet *p)
+{
+    Packet *to_server = 0, *to_client = 0;
+    if (port == 1)
+	process_server(p, to_server, to_client);
+    else if (!tcp_packet(p))
+	to_server = p;
+    else if (is_syn(p)) {
+	cookie_batch(&p, 1);
+	to_client = p;
+    } else
+	process_client(p, to_server, to_client);
+    if (to_server)
+	output(0).push(to_server);
+    if (to_client)
+	output(1).push(to_client);
+}
+
+#if HAVE_BATCH
+void
+SYNProxy::push_batch(int port, PacketBatch *batch)
+{
+    BATCH_CREATE_INIT(servers);
+    BATCH_CREATE_INIT(clients);
+    Packet *syns[COOKIE_BATCH];
+    int nsyns = 0;
+
+    FOR_EACH_PACKET_SAFE(batch, p) {
+	Packet *to_server = 0, *to_client = 0;
+	if (port == 1)
+	    process_server(p, to_server, to_client);
+	else if (!tcp_packet(p))
+	    to_server = p;
+	else if (is_syn(p)) {
+	    syns[nsyns++] = p;
+	    if (nsyns == COOKIE_BATCH) {
+		cookie_batch(syns, nsyns);
+		for (int i = 0; i < nsyns; i++)
+		    if (syns[i]) {
+			BATCH_CREATE_APPEND(clients, syns[i]);
+		    }
+		nsyns = 0;
+	    }
+	} else
+	    process_client(p, to_server, to_client);
+	if (to_server) {
+	    BATCH_CREATE_APPEND(servers, to_server);
+	}
+	if (to_client) {
+	    BATCH_CREATE_APPEND(clients, to_client);
+	}
+    }
+    if (nsyns) {
+	cookie_batch(syns, nsyns);
+	for (int i = 0; i < nsyns; i++)
+	    if (syns[i]) {
+		BATCH_CREATE_APPEND(clients, syns[i]);
+	    }
+    }
+
+    BATCH_CREATE_FINISH(servers);
+    BATCH_CREATE_FINISH(clients);
+    if (servers)
+	output(0).push_batch(servers);
+    if (clients)
+	output(1).push_batch(clients);
+}
+#endif
+
+void
+SYNProxy::run_timer(Timer *)
+{
+    click_jiffies_t now = click_jiffies();
+    Vector<IPFlowID> expired;
+    for (int i = 0; i < NSHARDS; i++) {
+	Shard &s = _shards[i];
+	s.lock.acquire();
+	for (HashMap<IPFlowID, Conn>::iterator it = s.table.begin(); it.live(); it++)
+	    if (click_jiffies_less(it.value().expiry, now)) {
+		if (it.value().held)
+		    it.value().held->kill();
+		expired.push_back(it.key());
+	    }
+	for (int j = 0; j < expired.size(); j++)
+	    s.table.erase(expired[j]);
+	s.lock.release();
+	expired.clear();
+    }
+    _timer.reschedule_after_sec(1);
+}
+
+String
+SYNProxy::read_handler(Element *e, void *thunk)
+{
+    SYNProxy *sp = static_cast<SYNProxy *>(e);
+    uint64_t n = 0;
+    if ((uintptr_t) thunk == h_count) {
+	for (int i = 0; i < NSHARDS; i++) {
+	    sp->_shards[i].lock.acquire();
+	    n += sp->_shards[i].table.size();
+	    sp->_shards[i].lock.release();
+	}
+	return String(n);
+    }
+    for (unsigned i = 0; i < sp->_stats.weight(); i++) {
+	const Stats &st = sp->_stats.get_value(i);
+	switch ((uintptr_t) thunk) {
+	case h_syns:
+	    n += st.syns;
+	    break;
+	case h_valid:
+	    n += st.valid;
+	    break;
+	case h_invalid:
+	    n += st.invalid;
+	    break;
+	}
+    }
+    return String(n);
+}
+
+void
+SYNProxy::add_handlers()
+{
+    add_read_handler("syns", read_handler, h_syns);
+    add_read_handler("valid", read_handler, h_valid);
+    add_read_handler("invalid", read_handler, h_invalid);
+    add_read_handler("count", read_handler, h_count);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(SYNProxy)
+ELEMENT_MT_SAFE(SYNProxy)
@@ -0,0 +1,196 @@
+#ifndef CLICK_SYNPROXY_HH
+#define CLICK_SYNPROXY_HH
+#include <click/batchelement.hh>
+#include <click/hashmap.hh>
+#include <click/ipflowid.hh>
+#include <click/sync.hh>
+#include <click/timer.hh>
+#include <clicknet/ip.h>
+#include <clicknet/tcp.h>
+CLICK_DECLS
+
+/*
+=c
+
+SYNProxy([I<keywords> HASH, KEY, TIMEOUT])
+
+=s tcp
+
+absorbs SYN floods with SYN cookies
+
+=d
+
+SYNProxy sits between clients and the servers it protects, and completes the
+TCP handshake with the clients itself, so that a SYN flood never reaches the
+servers nor any connection table.
+
+Input 0 takes IP packets from the clients, and output 0 emits packets to the
+servers. Input 1 takes IP packets from the servers, and output 1 emits
+packets to the clients. Packets must have their IP header annotation set, as
+after CheckIPHeader; if they also have a MAC header, it must be an Ethernet
+header, whose addresses are swapped in the packets sent back.
+
+SYNs from clients are answered on output 1 with a SYN-ACK whose sequence
+number is a SYN cookie: a keyed hash of the connection, of the client's
+sequence number and of the time, with the client's MSS coded in its low bits.
+SYNs do not create any state. Cookies of a whole batch are computed in one
+pass.
+
+When a client's ACK carries a valid cookie, less than two minutes old,
+SYNProxy records the connection, sends a SYN with the client's sequence
+number and MSS to the server, and holds the ACK. When the server answers with
+a SYN-ACK, SYNProxy releases the held ACK, which completes the handshake with
+the server and delivers the data it may carry. From then on, the sequence
+numbers of the server and the acknowledgement numbers of the client are
+translated by the difference between the server's sequence number and the
+cookie, with incremental checksum updates. TCP packets from clients that are
+neither SYNs, nor part of a recorded connection, nor ACKs with a valid cookie,
+are dropped.
+
+Cookies have no room for the other TCP options: SYNProxy only offers the MSS
+option to clients and servers, so that connections through it use neither
+window scaling, nor SACK, nor timestamps. Connections opened by the servers
+are not supported, and should not go through SYNProxy. Packets other than
+TCP go through unchanged, from input 0 to output 0 and from input 1 to
+output 1.
+
+Connections are stored in a table shared by all threads, split in shards with
+their own lock, so that both directions of a connection may be handled by
+different threads.
+
+Keyword arguments are:
+
+=over 8
+
+=item HASH
+
+Either C<siphash> or C<crc>. The hash of the cookies. C<siphash> is
+SipHash-2-4, a keyed hash that attackers cannot invert to forge cookies.
+C<crc> is CRC32C of the connection and of a secret, using the SSE4.2
+instruction when available; it is faster, but weaker. Default is siphash.
+
+=item KEY
+
+String of 16 bytes. The secret key of the hash. Give the same KEY to several
+SYNProxy elements, for instance on several hosts behind a load balancer, so
+that they accept each other's cookies. Default is a random key.
+
+=item TIMEOUT
+
+Time. Connections idle for TIMEOUT are removed. Connections are removed
+10 seconds after a RST or a FIN in both directions, and 5 seconds after the
+SYN to the server if it does not answer. Default is 300s.
+
+=back
+
+=h syns read-only
+
+Returns the number of SYNs answered with a cookie.
+
+=h valid read-only
+
+Returns the number of ACKs with a valid cookie.
+
+=h invalid read-only
+
+Returns the number of TCP packets from clients dropped, mostly ACKs with an
+invalid cookie.
+
+=h count read-only
+
+Returns the number of connections in the table.
+
+=e
+
+   FromDevice(eth0) -> Strip(14) -> CheckIPHeader -> sp :: SYNProxy;
+   FromDevice(eth1) -> Strip(14) -> CheckIPHeader -> [1] sp;
+   sp[0] -> ... -> ToDevice(eth1);
+   sp[1] -> ... -> ToDevice(eth0);
+
+=a
+
+StatelessTCPResponder, CheckTCPHeader */
+
+class SYNProxy : public BatchElement { public:
+
+    SYNProxy() CLICK_COLD;
+    ~SYNProxy() CLICK_COLD;
+
+    const char *class_name() const override	{ return "SYNProxy"; }
+    const char *port_count() const override	{ return "2/2"; }
+    const char *processing() const override	{ return PUSH; }
+
+    int configure(Vector<String> &, ErrorHandler *) override CLICK_COLD;
+    int initialize(ErrorHandler *) override CLICK_COLD;
+    void cleanup(CleanupStage) override CLICK_COLD;
+    void add_handlers() override CLICK_COLD;
+
+    void push(int port, Packet *p) override;
+#if HAVE_BATCH
+    void push_batch(int port, PacketBatch *batch) override;
+#endif
+
+    void run_timer(Timer *) override;
+
+  private:
+
+    enum { NSHARDS = 64, COOKIE_BATCH = 32 };
+    enum { S_SYN_SENT, S_ESTABLISHED, S_CLOSING };
+    enum { SYN_SENT_TIMEOUT = 5, CLOSING_TIMEOUT = 10 };
+
+    // Keyed by the client to server direction
+    struct Conn {
+	uint32_t delta;		// server sequence number - cookie
+	Packet *held;		// the client's ACK, in S_SYN_SENT
+	uint8_t state;
+	uint8_t fins;		// 1: FIN from the client, 2: from the server
+	click_jiffies_t expiry;
+	Conn() : delta(0), held(0), state(S_SYN_SENT), fins(0), expiry(0) {
+	}
+    };
+
+    struct Shard {
+	Spinlock lock;
+	HashMap<IPFlowID, Conn> table;
+    } CLICK_CACHE_ALIGN;
+
+    struct Stats {
+	uint64_t syns;
+	uint64_t valid;
+	uint64_t invalid;
+	Stats() : syns(0), valid(0), invalid(0) {
+	}
+    };
+
+    Shard _shards[NSHARDS];
+    per_thread<Stats> _stats;
+    uint64_t _key[2];
+    bool _crc;
+    uint32_t _timeout;
+    Timer _timer;
+
+    static inline Shard &shard_for(Shard *shards, const IPFlowID &flow) {
+	return shards[flow.hashcode() & (NSHARDS - 1)];
+    }
+    static inline uint32_t cookie_time();
+    inline uint32_t hash(const click_ip *ip, const click_tcp *tcp,
+			 uint32_t isn, uint32_t t) const;
+    inline void cookie_batch(Packet **syns, int n);
+    inline bool check_cookie(const click_ip *ip, const click_tcp *tcp,
+			     uint32_t cookie, int &mss) const;
+
+    static bool tcp_packet(Packet *p);
+    static WritablePacket *make_synack(Packet *p, uint32_t cookie);
+    static Packet *make_syn(Packet *ack, int mss);
+    static void splice(WritablePacket *p, uint32_t *field, uint32_t value);
+
+    void process_client(Packet *p, Packet *&to_server, Packet *&to_client);
+    void process_server(Packet *p, Packet *&to_server, Packet *&to_client);
+
+    enum { h_syns, h_valid, h_invalid, h_count };
+    static String read_handler(Element *, void *) CLICK_COLD;
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -237,7 +237,7 @@ TCPRewriter::TCPFlow::unparse(StringAccum &sa, bool direction, click_jiffies_t n
 
 // TCPRewriter
 
-TCPRewriter::TCPRewriter() : _allocator()
+TCPRewriter::TCPRewriter()
 {
 }
 
@@ -298,7 +298,7 @@ TCPRewriter::add_flow(int /*ip_p*/, const IPFlowID &flowid,
 		      const IPFlowID &rewritten_flowid, int input)
 {
     void *data;
-    if (!(data = _allocator->allocate()))
+    if (!(data = SlabAllocator::allocate(sizeof(TCPFlow))))
 	return 0;
 
     TCPFlow *flow = new(data) TCPFlow
@@ -178,7 +178,6 @@ class TCPRewriter : public IPRewriterBase { public:
     void add_handlers() CLICK_COLD;
 
  protected:
-    per_thread<SizedHashAllocator<sizeof(TCPFlow)>> _allocator;
 
     unsigned _annos;
     uint32_t _tcp_data_timeout;
@@ -209,7 +208,7 @@ TCPRewriter::destroy_flow(IPRewriterFlow *flow)
 {
     unmap_flow(flow, _map[click_current_cpu_id()]);
     static_cast<TCPFlow *>(flow)->~TCPFlow();
-    _allocator->deallocate(flow);
+    SlabAllocator::deallocate(flow, sizeof(TCPFlow));
 }
 
 inline tcp_seq_t
@@ -70,7 +70,7 @@ UDPRewriter::UDPFlow::apply(WritablePacket *p, bool direction, unsigned annos)
 	_tflags += 2;
 }
 
-UDPRewriter::UDPRewriter() : _allocator()
+UDPRewriter::UDPRewriter()
 {
 }
 
@@ -130,7 +130,7 @@ IPRewriterEntry *
 UDPRewriter::add_flow(int ip_p, const IPFlowID &flowid,
 		      const IPFlowID &rewritten_flowid, int input)
 {
-    void *data = _allocator->allocate();
+    void *data = SlabAllocator::allocate(sizeof(UDPFlow));
     if (!data)
         return 0;
 
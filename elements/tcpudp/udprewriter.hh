@@ -208,7 +208,6 @@ class UDPRewriter : public IPRewriterBase { public:
     void add_handlers() CLICK_COLD;
 
   private:
-    per_thread<SizedHashAllocator<sizeof(UDPFlow)>> _allocator;
 
     unsigned _annos;
     uint32_t _udp_streaming_timeout;
@@ -234,7 +233,7 @@ UDPRewriter::destroy_flow(IPRewriterFlow *flow)
 {
     unmap_flow(flow, _map[click_current_cpu_id()]);
     flow->~IPRewriterFlow();
-    _allocator->deallocate(flow);
+    SlabAllocator::deallocate(flow, sizeof(UDPFlow));
 }
 
 CLICK_ENDDECLS
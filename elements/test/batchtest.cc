@@ -18,13 +18,22 @@
 
 #include <click/config.h>
 #include "batchtest.hh"
+#include <click/args.hh>
 
 CLICK_DECLS
 
-BatchTest::BatchTest()
+BatchTest::BatchTest() : _array(false)
 {
 }
 
+int
+BatchTest::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    return Args(conf, this, errh)
+        .read("ARRAY", _array)
+        .complete();
+}
+
 void
 BatchTest::push(int port,Packet* p)
 {
@@ -36,7 +45,22 @@ void
 BatchTest::push_batch(int port,PacketBatch* batch)
 {
     click_chatter("%p{element}: Batch push of %d packets",this,batch->count());
-    output_push_batch(port, batch);
+    if (_array) {
+        PacketArray a;
+        while (batch) {
+            a.clear();
+            a.append_batch(batch);
+            output_push_array(port, a);
+        }
+    } else
+        output_push_batch(port, batch);
+}
+
+void
+BatchTest::push_array(int port,PacketArray &a)
+{
+    click_chatter("%p{element}: Array push of %d packets",this,a.count());
+    output_push_array(port, a);
 }
 
 Packet*
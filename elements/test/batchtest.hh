@@ -7,12 +7,25 @@ CLICK_DECLS
 /*
 =c
 
-BatchTest()
+BatchTest([ARRAY])
 
 =s test
 
 Displays push packet or push batch depending on the type of function called
 
+=d
+
+Keyword arguments are:
+
+=over 8
+
+=item ARRAY
+
+Boolean. If true, batches are converted to a PacketArray and passed downstream
+with push_array. Default is false.
+
+=back
+
 */
 
 class BatchTest : public BatchElement { public:
@@ -23,10 +36,17 @@ class BatchTest : public BatchElement { public:
     const char *port_count() const override    { return PORTS_1_1; }
     const char *processing() const override    { return AGNOSTIC; }
 
+    int configure(Vector<String> &, ErrorHandler *) override CLICK_COLD;
+
     void push(int, Packet *) override;
     void push_batch(int, PacketBatch *) override;
+    void push_array(int, PacketArray &) override;
     Packet* pull(int) override;
     PacketBatch* pull_batch(int, unsigned) override;
+
+  private:
+
+    bool _array;
 };
 
 /*
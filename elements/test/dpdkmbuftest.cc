@@ -0,0 +1,120 @@
+// -*- c-basic-offset: 4 -*-
+/*
+ * dpdkmbuftest.{cc,hh} -- regression test element for DPDK packet conversions
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "dpdkmbuftest.hh"
+#include <click/dpdkdevice.hh>
+#include <click/error.hh>
+CLICK_DECLS
+
+DPDKMbufTest::DPDKMbufTest()
+{
+}
+
+#define CHECK(x) if (!(x)) return errh->error("%s:%d: test %<%s%> failed", __FILE__, __LINE__, #x);
+
+static Packet *
+make_dpdk_packet(uint32_t length)
+{
+    struct rte_mbuf *mb = DPDKDevice::get_pkt(rte_socket_id());
+    if (!mb)
+	return 0;
+    unsigned char *data = rte_pktmbuf_mtod(mb, unsigned char *);
+    for (uint32_t i = 0; i < length; i++)
+	data[i] = i;
+    rte_pktmbuf_data_len(mb) = rte_pktmbuf_pkt_len(mb) = length;
+#if CLICK_PACKET_USE_DPDK
+    return Packet::make(mb);
+#else
+    return Packet::make(data, length, DPDKDevice::free_pkt, mb,
+			rte_pktmbuf_headroom(mb), rte_pktmbuf_tailroom(mb));
+#endif
+}
+
+int
+DPDKMbufTest::initialize(ErrorHandler *errh)
+{
+    int node = rte_socket_id();
+
+    // A single segment is sent as Click sees it
+    Packet *p = make_dpdk_packet(100);
+    CHECK(p);
+    p->pull(14);
+    p = p->put(4);
+    struct rte_mbuf *mb = DPDKDevice::get_mbuf(p, false, node);
+    CHECK(mb);
+    CHECK(rte_pktmbuf_data_len(mb) == 90);
+    CHECK(rte_pktmbuf_pkt_len(mb) == 90);
+    CHECK(mb->nb_segs == 1);
+    CHECK(rte_pktmbuf_mtod(mb, unsigned char *)[0] == 14);
+#if !CLICK_PACKET_USE_DPDK
+    p->kill();
+#endif
+    rte_pktmbuf_free(mb);
+
+#if !CLICK_PACKET_USE_DPDK
+    // Even if the packet length of the mbuf is stale
+    p = make_dpdk_packet(60);
+    CHECK(p);
+    mb = DPDKDevice::get_mbuf(p, false, node, false);
+    rte_pktmbuf_pkt_len(mb) = 1000;
+    mb = DPDKDevice::get_mbuf(p, false, node);
+    CHECK(rte_pktmbuf_pkt_len(mb) == 60);
+    p->kill();
+    rte_pktmbuf_free(mb);
+#endif
+
+    // A templated packet keeps its payload segment
+    unsigned char payload[1000];
+    for (unsigned i = 0; i < sizeof(payload); i++)
+	payload[i] = ~i;
+    DPDKDevice::PayloadTemplate *t = DPDKDevice::payload_template_create(
+	payload, sizeof(payload), -1, node, errh);
+    CHECK(t);
+    CHECK(!t->nicmem);
+    CHECK(rte_pktmbuf_data_room_size(t->seg_pool) == 0);
+
+    unsigned char header[42];
+    memset(header, 0xAB, sizeof(header));
+    p = DPDKDevice::make_templated(t, header, sizeof(header), node);
+    CHECK(p);
+#if !CLICK_PACKET_USE_DPDK
+    // Click only sees the header
+    CHECK(p->length() == sizeof(header));
+#endif
+    CHECK(rte_mbuf_ext_refcnt_read(&t->shinfo) == 2);
+    p->pull(14);
+    mb = DPDKDevice::get_mbuf(p, false, node);
+    CHECK(mb);
+    CHECK(mb->nb_segs == 2);
+    CHECK(rte_pktmbuf_data_len(mb) == sizeof(header) - 14);
+    CHECK(rte_pktmbuf_pkt_len(mb) == sizeof(header) - 14 + sizeof(payload));
+    CHECK(mb->next->pool == t->seg_pool);
+    CHECK(rte_pktmbuf_data_len(mb->next) == sizeof(payload));
+    CHECK(memcmp(rte_pktmbuf_mtod(mb->next, unsigned char *), payload, sizeof(payload)) == 0);
+#if !CLICK_PACKET_USE_DPDK
+    p->kill();
+#endif
+    rte_pktmbuf_free(mb);
+    CHECK(rte_mbuf_ext_refcnt_read(&t->shinfo) == 1);
+    DPDKDevice::payload_template_destroy(t);
+
+    errh->message("All tests pass!");
+    return 0;
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(userlevel dpdk)
+EXPORT_ELEMENT(DPDKMbufTest)
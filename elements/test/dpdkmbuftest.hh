@@ -0,0 +1,37 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_DPDKMBUFTEST_HH
+#define CLICK_DPDKMBUFTEST_HH
+#include <click/element.hh>
+CLICK_DECLS
+
+/*
+=c
+
+DPDKMbufTest()
+
+=s test
+
+runs regression tests for DPDK packet conversions
+
+=d
+
+DPDKMbufTest runs regression tests for the conversion of Click packets to
+DPDK mbufs, as done by ToDPDKDevice, and for payload templates, at
+initialization time. It needs the DPDK packet pools, so the configuration
+must use a DPDK device. It does not route packets.
+
+*/
+
+class DPDKMbufTest : public Element { public:
+
+    DPDKMbufTest() CLICK_COLD;
+
+    const char *class_name() const override		{ return "DPDKMbufTest"; }
+
+    int configure_phase() const override	{ return CONFIGURE_PHASE_LAST; }
+    int initialize(ErrorHandler *) override CLICK_COLD;
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,166 @@
+// -*- c-basic-offset: 4 -*-
+/*
+ * linktabletest.{cc,hh} -- benchmark and check of LinkTable shortest paths
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "linktabletest.hh"
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#include <click/timestamp.hh>
+#include "elements/wifi/linktable.hh"
+CLICK_DECLS
+
+LinkTableTest::LinkTableTest()
+    : _lt(0), _nodes(1000), _degree(6), _changes(10), _rounds(10), _seed(1),
+      _seq(1), _incremental_usec(0), _full_usec(0), _errors(0)
+{
+}
+
+int
+LinkTableTest::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    Element *e;
+    if (Args(conf, this, errh)
+	.read_mp("LINKTABLE", e)
+	.read("NODES", _nodes)
+	.read("DEGREE", _degree)
+	.read("CHANGES", _changes)
+	.read("ROUNDS", _rounds)
+	.read("SEED", _seed)
+	.complete() < 0)
+	return -1;
+    if (!(_lt = static_cast<LinkTable *>(e->cast("LinkTable"))))
+	return errh->error("LINKTABLE must be a LinkTable");
+    if (_nodes < 2 || _degree < 4)
+	return errh->error("NODES must be at least 2 and DEGREE at least 4");
+    return 0;
+}
+
+void
+LinkTableTest::add_link(int from, int to)
+{
+    _lt->update_link(_hosts[from], _hosts[to], _seq, 0, click_random(100, 1000));
+    _lt->update_link(_hosts[to], _hosts[from], _seq, 0, click_random(100, 1000));
+    _links.push_back(IPPair(_hosts[from], _hosts[to]));
+    _links.push_back(IPPair(_hosts[to], _hosts[from]));
+}
+
+int
+LinkTableTest::initialize(ErrorHandler *errh)
+{
+    Vector<IPAddress> existing = _lt->get_hosts();
+    if (existing.size() != 1)
+	return errh->error("%p{element} is not empty", _lt);
+
+    click_srandom(_seed);
+    uint32_t first = ntohl(existing[0].addr());
+    for (int i = 0; i < _nodes; i++)
+	_hosts.push_back(IPAddress(htonl(first + i)));
+
+    int side = 1;
+    while (side * side < _nodes)
+	side++;
+    int extra = (_degree - 4) / 2;
+    for (int i = 0; i < _nodes; i++) {
+	int x = i % side, y = i / side;
+	if (x + 1 < side && i + 1 < _nodes)
+	    add_link(i, i + 1);
+	if (i + side < _nodes)
+	    add_link(i, i + side);
+	for (int k = 0; k < extra; k++) {
+	    int nx = x + (int) click_random(0, 4) - 2;
+	    int ny = y + (int) click_random(0, 4) - 2;
+	    int j = ny * side + nx;
+	    if (nx >= 0 && nx < side && ny >= 0 && j < _nodes && j != i)
+		add_link(i, j);
+	}
+    }
+    _lt->dijkstra(true, false);
+    _lt->dijkstra(false, false);
+    return 0;
+}
+
+void
+LinkTableTest::run()
+{
+    Timestamp incremental, full;
+    for (int r = 0; r < _rounds; r++) {
+	_seq++;
+	for (int c = 0; c < _changes; c++) {
+	    const IPPair &p = _links[click_random(0, _links.size() - 1)];
+	    uint32_t metric = click_random(0, 7) ? click_random(100, 1000) : 9999;
+	    _lt->update_link(p.src, p.dst, _seq, 0, metric);
+	}
+
+	Timestamp start = Timestamp::now_steady();
+	_lt->dijkstra(true);
+	_lt->dijkstra(false);
+	Timestamp middle = Timestamp::now_steady();
+	Vector<uint32_t> from_me, to_me;
+	for (int i = 0; i < _hosts.size(); i++) {
+	    from_me.push_back(_lt->get_host_metric_from_me(_hosts[i]));
+	    to_me.push_back(_lt->get_host_metric_to_me(_hosts[i]));
+	}
+
+	Timestamp middle2 = Timestamp::now_steady();
+	_lt->dijkstra(true, false);
+	_lt->dijkstra(false, false);
+	Timestamp end = Timestamp::now_steady();
+	incremental += middle - start;
+	full += end - middle2;
+
+	for (int i = 0; i < _hosts.size(); i++)
+	    if (from_me[i] != _lt->get_host_metric_from_me(_hosts[i])
+		|| to_me[i] != _lt->get_host_metric_to_me(_hosts[i])) {
+		_errors++;
+		break;
+	    }
+    }
+    if (_rounds) {
+	_incremental_usec = incremental.doubleval() * 1e6 / _rounds;
+	_full_usec = full.doubleval() * 1e6 / _rounds;
+    }
+}
+
+String
+LinkTableTest::read_handler(Element *e, void *)
+{
+    LinkTableTest *t = static_cast<LinkTableTest *>(e);
+    StringAccum sa;
+    sa << "hosts " << t->_hosts.size() << "\n"
+       << "links " << t->_links.size() << "\n"
+       << "incremental " << t->_incremental_usec << "\n"
+       << "full " << t->_full_usec << "\n"
+       << "errors " << t->_errors << "\n";
+    return sa.take_string();
+}
+
+int
+LinkTableTest::write_handler(const String &, Element *e, void *, ErrorHandler *)
+{
+    static_cast<LinkTableTest *>(e)->run();
+    return 0;
+}
+
+void
+LinkTableTest::add_handlers()
+{
+    add_read_handler("results", read_handler, 0);
+    add_write_handler("run", write_handler, 0);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(LinkTable)
+EXPORT_ELEMENT(LinkTableTest)
@@ -0,0 +1,108 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_LINKTABLETEST_HH
+#define CLICK_LINKTABLETEST_HH
+#include <click/element.hh>
+#include <click/ipaddress.hh>
+#include <click/vector.hh>
+CLICK_DECLS
+class LinkTable;
+
+/*
+=c
+
+LinkTableTest(LINKTABLE, [I<keywords> NODES, DEGREE, CHANGES, ROUNDS, SEED])
+
+=s test
+
+benchmarks and checks LinkTable shortest paths on a synthetic mesh
+
+=d
+
+LinkTableTest fills LINKTABLE, which must be empty, with a synthetic mesh at
+initialization time: NODES hosts on a square grid, each linked to its grid
+neighbors and to random hosts at most two rows or columns away, so that hosts
+have about DEGREE neighbors. The metric of each direction of a link is drawn
+between 100 and 1000. Hosts have consecutive addresses, starting with the
+address of LINKTABLE. It does not route packets.
+
+Writing the run handler then runs ROUNDS rounds. Each round changes the
+metric of CHANGES random links, sometimes to 9999 as routing protocols do for
+broken links, and recomputes the routes from and to the host of LINKTABLE,
+incrementally, then from scratch. Rounds whose results differ are counted as
+errors.
+
+Keyword arguments are:
+
+=over 8
+
+=item NODES
+
+Integer. Number of hosts. Default is 1000.
+
+=item DEGREE
+
+Integer. Average number of neighbors, at least 4. Default is 6.
+
+=item CHANGES
+
+Integer. Number of links changed per round. Default is 10.
+
+=item ROUNDS
+
+Integer. Number of rounds per run. Default is 10.
+
+=item SEED
+
+Integer. Seed of the random generator. Default is 1.
+
+=back
+
+=h run write-only
+
+Runs the rounds.
+
+=h results read-only
+
+Returns the number of hosts and links, the average time in microseconds of an
+incremental and of a complete computation of both trees per round, and the
+number of errors, one per line.
+
+=a LinkTable */
+
+class LinkTableTest : public Element { public:
+
+    LinkTableTest() CLICK_COLD;
+
+    const char *class_name() const override		{ return "LinkTableTest"; }
+
+    int configure(Vector<String> &, ErrorHandler *) override CLICK_COLD;
+    int initialize(ErrorHandler *) override CLICK_COLD;
+    void add_handlers() override CLICK_COLD;
+
+  private:
+
+    LinkTable *_lt;
+    int _nodes;
+    int _degree;
+    int _changes;
+    int _rounds;
+    uint32_t _seed;
+    uint32_t _seq;
+
+    Vector<IPAddress> _hosts;
+    Vector<IPPair> _links;
+
+    double _incremental_usec;
+    double _full_usec;
+    int _errors;
+
+    void add_link(int from, int to);
+    void run();
+
+    static String read_handler(Element *, void *) CLICK_COLD;
+    static int write_handler(const String &, Element *, void *, ErrorHandler *) CLICK_COLD;
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,106 @@
+// -*- c-basic-offset: 4 -*-
+/*
+ * queuescalingtest.{cc,hh} -- regression test element for QueueScalingPolicy
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "queuescalingtest.hh"
+#include <click/queuescaling.hh>
+#include <click/error.hh>
+CLICK_DECLS
+
+QueueScalingTest::QueueScalingTest()
+{
+}
+
+#define CHECK(x) if (!(x)) return errh->error("%s:%d: test %<%s%> failed", __FILE__, __LINE__, #x);
+
+int
+QueueScalingTest::initialize(ErrorHandler *errh)
+{
+    QueueScalingPolicy p(0.8, 0.3);
+
+    // Load measurement
+    p.reset(1000, 1000);
+    CHECK(!p.update(1000, 1000));
+    CHECK(p.update(1900, 1100));
+    CHECK(p.load() == 0.9);
+    CHECK(p.update(2000, 1500));
+    CHECK(p.load() == 0.2);
+    // Counters reset
+    CHECK(p.update(30, 70));
+    CHECK(p.load() == 0.3);
+
+    // Scaling up
+    p.reset(0, 0);
+    p.update(90, 10);
+    CHECK(p.decide(2, 1, 4) == 3);
+    CHECK(p.decide(4, 1, 4) == 4);
+
+    // Scaling down, unless the load would go above HIGH
+    p.reset(0, 0);
+    p.update(20, 80);
+    CHECK(p.decide(4, 1, 4) == 3);
+    CHECK(p.decide(1, 1, 4) == 1);
+    CHECK(p.decide(2, 2, 4) == 2);
+    p.reset(0, 0);
+    p.update(29, 71);
+    CHECK(p.decide(4, 1, 4) == 3);
+    CHECK(p.decide(2, 1, 4) == 1);
+    QueueScalingPolicy tight(0.5, 0.3);
+    tight.update(29, 71);
+    CHECK(tight.decide(2, 1, 4) == 2);
+    CHECK(tight.decide(3, 1, 4) == 2);
+
+    // Steady load
+    p.reset(0, 0);
+    p.update(50, 50);
+    CHECK(p.decide(3, 1, 4) == 3);
+
+    // RETA of a port shared by queues 0-1 of another element, and queues
+    // 2-5 of the scaled element
+    uint16_t reta[16];
+    for (int i = 0; i < 16; i++)
+	reta[i] = i % 6;
+    CHECK(QueueScalingPolicy::retarget(reta, 16, 2, 4, 2) == 4);
+    for (int i = 0; i < 16; i++) {
+	if (i % 6 < 2) {
+	    CHECK(reta[i] == i % 6);
+	} else {
+	    CHECK(reta[i] == 2 || reta[i] == 3);
+	}
+    }
+    int n2 = 0, n3 = 0;
+    for (int i = 0; i < 16; i++) {
+	n2 += reta[i] == 2;
+	n3 += reta[i] == 3;
+    }
+    CHECK(n2 == 5 && n3 == 5);
+    // Scaling back up spreads the same entries over all queues
+    CHECK(QueueScalingPolicy::retarget(reta, 16, 2, 4, 4) > 0);
+    int count[6] = {0, 0, 0, 0, 0, 0};
+    for (int i = 0; i < 16; i++)
+	count[reta[i]]++;
+    CHECK(count[0] == 3 && count[1] == 3);
+    CHECK(count[2] + count[3] + count[4] + count[5] == 10);
+    for (int q = 2; q < 6; q++)
+	CHECK(count[q] >= 2 && count[q] <= 3);
+    // Nothing to change
+    CHECK(QueueScalingPolicy::retarget(reta, 16, 2, 4, 4) == 0);
+
+    errh->message("All tests pass!");
+    return 0;
+}
+
+EXPORT_ELEMENT(QueueScalingTest)
+CLICK_ENDDECLS
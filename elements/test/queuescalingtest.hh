@@ -0,0 +1,35 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_QUEUESCALINGTEST_HH
+#define CLICK_QUEUESCALINGTEST_HH
+#include <click/element.hh>
+CLICK_DECLS
+
+/*
+=c
+
+QueueScalingTest()
+
+=s test
+
+runs regression tests for RX queue scaling decisions
+
+=d
+
+QueueScalingTest runs regression tests for the decisions of QueueScaler, and
+for the reprogramming of the RSS redirection table, at initialization time.
+It does not route packets.
+
+*/
+
+class QueueScalingTest : public Element { public:
+
+    QueueScalingTest() CLICK_COLD;
+
+    const char *class_name() const override		{ return "QueueScalingTest"; }
+
+    int initialize(ErrorHandler *) override CLICK_COLD;
+
+};
+
+CLICK_ENDDECLS
+#endif
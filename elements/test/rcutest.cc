@@ -1,6 +1,7 @@
 // -*- c-basic-offset: 4 -*-
 /*
- * rcutest.{cc,hh} -- regression test element for click_rcu
+ * rcutest.{cc,hh} -- regression test and benchmark element for click_rcu,
+ * fast_rcu, rwlock and QSBR
  * Tom Barbette
  *
  * Copyright (c) 2016 Cisco Meraki
@@ -23,38 +24,159 @@
 #include <click/error.hh>
 #include <click/args.hh>
 #include <click/master.hh>
+#include <click/straccum.hh>
 CLICK_DECLS
 
 RCUTest::RCUTest()
-    : _rcu(nastruct{0,0}), _fast_rcu(nastruct{0,0}), _nruns(0)
+    : _rcu(nastruct{0,0}), _fast_rcu(nastruct{0,0}), _rwlock(nastruct{0,0}),
+      _qsbr(new nastruct{0,0}), _nruns(0), _ops(0), _cycles(0),
+      _bench(BENCH_NONE), _runs(10000), _burst(1000), _write_every(100)
 {
 }
 
-bool
-RCUTest::run_task(Task *t)
+RCUTest::~RCUTest()
+{
+    delete _qsbr;
+}
+
+int
+RCUTest::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    String bench;
+    if (Args(this, errh).bind(conf)
+        .read("BENCH", WordArg(), bench)
+        .read("RUNS", _runs)
+        .read("BURST", _burst)
+        .read("WRITE_EVERY", _write_every)
+        .consume() < 0)
+        return -1;
+
+    if (!bench)
+        _bench = BENCH_NONE;
+    else if (bench == "rcu")
+        _bench = BENCH_RCU;
+    else if (bench == "fast_rcu")
+        _bench = BENCH_FAST_RCU;
+    else if (bench == "rwlock")
+        _bench = BENCH_RWLOCK;
+    else if (bench == "qsbr")
+        _bench = BENCH_QSBR;
+    else
+        return errh->error("unknown BENCH %<%s%>", bench.c_str());
+    if (_burst <= 0 || _write_every <= 0)
+        return errh->error("BURST and WRITE_EVERY must be positive");
+
+    return MTDieTest::configure(conf, errh);
+}
+
+void
+RCUTest::qsbr_reclaim(void *p)
+{
+    // Poison the node so a reader still using it fails its assertion
+    nastruct *n = static_cast<nastruct *>(p);
+    n->a = 0;
+    n->b = -1;
+    delete n;
+}
+
+void
+RCUTest::qsbr_update()
+{
+    _qsbr_lock.acquire();
+    nastruct *o = _qsbr;
+    nastruct *n = new nastruct(*o);
+    ++n->a;
+    ++n->b;
+    click_write_fence();
+    _qsbr = n;
+    _qsbr_lock.release();
+    master()->qsbr().call_after_grace_period(qsbr_reclaim, o);
+}
+
+inline void
+RCUTest::read(int bench)
+{
+    int flags;
+    switch (bench) {
+    case BENCH_RCU: {
+        const nastruct &n = _rcu.read_begin(flags);
+        assert(n.a == n.b);
+        _rcu.read_end(flags);
+        break;
+    }
+    case BENCH_FAST_RCU: {
+        const nastruct &n = _fast_rcu.read_begin(flags);
+        assert(n.a == n.b);
+        _fast_rcu.read_end(flags);
+        break;
+    }
+    case BENCH_RWLOCK: {
+        rwlock<nastruct>::ptr n = _rwlock.read();
+        assert(n->a == n->b);
+        break;
+    }
+    case BENCH_QSBR: {
+        const nastruct *n = _qsbr;
+        assert(n->a == n->b);
+        break;
+    }
+    }
+}
+
+inline void
+RCUTest::write(int bench)
 {
-    if (*_nruns & 1) {
+    int flags;
+    switch (bench) {
+    case BENCH_RCU: {
         nastruct &n = _rcu.write_begin();
         ++n.a;
         ++n.b;
         _rcu.write_commit();
-        int flags;
-        nastruct &fast_n = _fast_rcu.write_begin(flags);
-        ++fast_n.a;
-        ++fast_n.b;
+        break;
+    }
+    case BENCH_FAST_RCU: {
+        nastruct &n = _fast_rcu.write_begin(flags);
+        ++n.a;
+        ++n.b;
         _fast_rcu.write_commit(flags);
+        break;
+    }
+    case BENCH_RWLOCK: {
+        rwlock<nastruct>::write_ptr n = _rwlock.write();
+        ++n->a;
+        ++n->b;
+        break;
+    }
+    case BENCH_QSBR:
+        qsbr_update();
+        break;
+    }
+}
+
+bool
+RCUTest::run_task(Task *t)
+{
+    if (_bench != BENCH_NONE) {
+        uint64_t ops = *_ops;
+        click_cycles_t start = click_get_cycles();
+        for (int i = 0; i < _burst; ++i, ++ops)
+            if (ops % _write_every == 0)
+                write(_bench);
+            else
+                read(_bench);
+        *_cycles += click_get_cycles() - start;
+        *_ops = ops;
+    } else if (*_nruns & 1) {
+        for (int b = BENCH_RCU; b <= BENCH_QSBR; ++b)
+            write(b);
     } else {
-        int flags;
-        const nastruct &n = _rcu.read_begin(flags);
-        assert(n.a == n.b);
-        _rcu.read_end(flags);
-        const nastruct &fast_n = _fast_rcu.read_begin(flags);
-        assert(fast_n.a == fast_n.b);
-        _fast_rcu.read_end(flags);
+        for (int b = BENCH_RCU; b <= BENCH_QSBR; ++b)
+            read(b);
     }
 
     _nruns++;
-    if (*_nruns < 10000) {
+    if (*_nruns < _runs) {
         t->fast_reschedule();
     } else {
         router()->please_stop_driver();
@@ -79,6 +201,29 @@ RCUTest::read_param(Element *e, void *thunk_p)
       case 2: {
         return String(per_thread_arithmetic::sum(vc->_nruns));
       }
+      case 3: {
+        return String(vc->_rwlock.read()->a);
+      }
+      case 4: {
+        return String(vc->_qsbr->a);
+      }
+      case 5: {
+        PER_THREAD_SUM(uint64_t, ops, vc->_ops);
+        PER_THREAD_SUM(click_cycles_t, cycles, vc->_cycles);
+        return String(ops ? cycles / ops : 0);
+      }
+      case 6: {
+        QSBR &q = vc->master()->qsbr();
+        StringAccum sa;
+        sa << "grace_periods " << q.grace_periods() << '\n';
+        for (int i = 0; i < q.nthreads(); i++) {
+            uint64_t acks = q.thread_acks(i);
+            sa << i << ' ' << acks << ' '
+               << (acks ? q.thread_ack_cycles(i) / acks : 0) << ' '
+               << q.thread_reclaimed(i) << '\n';
+        }
+        return sa.take_string();
+      }
     }
     return String::make_empty();
 }
@@ -87,6 +232,10 @@ void RCUTest::add_handlers() {
     add_read_handler("rcu", read_param, 0);
     add_read_handler("fast_rcu", read_param, 1);
     add_read_handler("status", read_param, 2);
+    add_read_handler("rwlock", read_param, 3);
+    add_read_handler("qsbr", read_param, 4);
+    add_read_handler("cycles", read_param, 5);
+    add_read_handler("qsbr_stats", read_param, 6);
 }
 
 
@@ -4,6 +4,7 @@
 #include <click/element.hh>
 #include <click/task.hh>
 #include <click/multithread.hh>
+#include <click/sync.hh>
 #include "mtdietest.hh"
 
 CLICK_DECLS
@@ -15,16 +16,76 @@ RCUTest([I<keywords>])
 
 =s test
 
-runs regression tests for click_rcu
+runs regression tests and benchmarks for click_rcu, fast_rcu, rwlock and QSBR
 
+=d
+
+Without the BENCH keyword, every thread alternately reads and updates a pair
+of counters protected by each primitive, and asserts that readers never see
+a torn update.
+
+With BENCH, every thread runs RUNS times a burst of BURST operations on the
+chosen primitive only, and the number of cycles per operation is available
+in the C<cycles> handler. One operation out of WRITE_EVERY is an update.
+
+Keywords are:
+
+=over 8
+
+=item NTHREADS
+
+Number of threads running the test. Default is all of them.
+
+=item BENCH
+
+One of C<rcu>, C<fast_rcu>, C<rwlock> or C<qsbr>. Default is to run the
+regression test.
+
+=item RUNS
+
+Number of task runs per thread. Default is 10000.
+
+=item BURST
+
+Number of operations per task run when benchmarking. Default is 1000.
+
+=item WRITE_EVERY
+
+Ratio of reads to updates when benchmarking. Default is 100.
+
+=back
+
+=h rcu, fast_rcu, rwlock, qsbr read-only
+
+Returns the number of updates seen by each primitive.
+
+=h status read-only
+
+Returns the total number of task runs.
+
+=h cycles read-only
+
+Returns the average number of cycles per operation when benchmarking.
+
+=h qsbr_stats read-only
+
+Returns per-thread statistics of the router's QSBR domain: number of grace
+periods acknowledged, average number of cycles between the start of a grace
+period and the acknowledgement, and number of callbacks run.
+
+=a
+
+Master
 */
 
 class RCUTest : public MTDieTest { public:
 
     RCUTest() CLICK_COLD;
+    ~RCUTest() CLICK_COLD;
 
     const char *class_name() const override		{ return "RCUTest"; }
 
+    int configure(Vector<String> &conf, ErrorHandler *errh) CLICK_COLD;
     static String read_param(Element *e, void *thunk_p);
     void add_handlers();
     bool run_task(Task *t);
@@ -35,9 +96,26 @@ class RCUTest : public MTDieTest { public:
         int64_t b;
     };
 
+    enum { BENCH_NONE, BENCH_RCU, BENCH_FAST_RCU, BENCH_RWLOCK, BENCH_QSBR };
+
     click_rcu<nastruct> _rcu;
     fast_rcu<nastruct> _fast_rcu;
+    rwlock<nastruct> _rwlock;
+    nastruct * volatile _qsbr;
+    Spinlock _qsbr_lock;
     per_thread<int> _nruns;
+    per_thread<uint64_t> _ops;
+    per_thread<click_cycles_t> _cycles;
+
+    int _bench;
+    int _runs;
+    int _burst;
+    int _write_every;
+
+    void qsbr_update();
+    static void qsbr_reclaim(void *p);
+    inline void read(int bench);
+    inline void write(int bench);
 };
 
 CLICK_ENDDECLS
@@ -0,0 +1,77 @@
+/*
+ * genevedecap.{cc,hh} -- decapsulates Geneve packets
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "genevedecap.hh"
+#include <click/args.hh>
+#include <click/error.hh>
+#include <clicknet/ether.h>
+#include <clicknet/ip.h>
+#include <clicknet/udp.h>
+#include <clicknet/vxlan.h>
+CLICK_DECLS
+
+GeneveDecap::GeneveDecap()
+    : _offset(sizeof(click_ether)), _vni_anno(AGGREGATE_ANNO_OFFSET),
+      _dport(htons(GENEVE_PORT))
+{
+}
+
+GeneveDecap::~GeneveDecap()
+{
+}
+
+int
+GeneveDecap::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    bool ether = true;
+    int vni_anno = AGGREGATE_ANNO_OFFSET;
+    uint16_t dport = GENEVE_PORT;
+    if (Args(conf, this, errh)
+	.read("ETHER", ether)
+	.read("VNI_ANNO", AnnoArg(4), vni_anno)
+	.read("DPORT", IPPortArg(IP_PROTO_UDP), dport)
+	.complete() < 0)
+	return -1;
+    _offset = ether ? sizeof(click_ether) : 0;
+    _vni_anno = vni_anno;
+    _dport = htons(dport);
+    return 0;
+}
+
+int
+GeneveDecap::classify(Packet *p)
+{
+    const unsigned char *end = p->end_data();
+    const click_ip *ip = reinterpret_cast<const click_ip *>(p->data() + _offset);
+    if ((const unsigned char *) (ip + 1) > end || ip->ip_p != IP_PROTO_UDP
+	|| ip->ip_hl < (sizeof(click_ip) >> 2) || !IP_FIRSTFRAG(ip))
+	return 1;
+    const click_udp *udp = reinterpret_cast<const click_udp *>((const unsigned char *) ip + (ip->ip_hl << 2));
+    const click_geneve *gn = reinterpret_cast<const click_geneve *>(udp + 1);
+    if ((const unsigned char *) (gn + 1) > end || udp->uh_dport != _dport
+	|| GENEVE_VERSION(gn) != 0 || (gn->gn_flags & GENEVE_FLAG_O)
+	|| gn->gn_proto != htons(GENEVE_PROTO_ETHER))
+	return 1;
+    const unsigned char *inner = (const unsigned char *) (gn + 1) + GENEVE_OPTLEN(gn);
+    if (inner + sizeof(click_ether) > end)
+	return 1;
+    p->set_anno_u32(_vni_anno, ntohl(gn->gn_vni) >> 8);
+    p->pull(inner - p->data());
+    return 0;
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(GeneveDecap)
+ELEMENT_MT_SAFE(GeneveDecap)
@@ -0,0 +1,78 @@
+#ifndef CLICK_GENEVEDECAP_HH
+#define CLICK_GENEVEDECAP_HH
+#include <click/batchelement.hh>
+CLICK_DECLS
+
+/*
+=c
+
+GeneveDecap([I<keywords> ETHER, VNI_ANNO, DPORT])
+
+=s tunnel
+
+decapsulates Geneve packets
+
+=d
+
+Removes the outer headers of Geneve packets, options included, up to the
+inner Ethernet header, and stores their VNI in an annotation. Input packets
+start with the outer IPv4 header, or with an Ethernet header before it.
+Packets that are not UDP to the Geneve port, non-first fragments, too short,
+of another version than 0, control packets (O flag), or that do not carry
+Ethernet, are emitted unchanged on output 1 if it exists, and dropped
+otherwise. Options are skipped, even critical ones.
+
+Keyword arguments are:
+
+=over 8
+
+=item ETHER
+
+Boolean. If true, input packets start with the outer Ethernet header. Default
+is true.
+
+=item VNI_ANNO
+
+Annotation offset where the 4-byte VNI is stored. Default is AGGREGATE.
+
+=item DPORT
+
+Integer. Outer UDP destination port of Geneve packets. Default is 6081.
+
+=back
+
+=e
+
+   FromDevice(eth0)
+       -> c :: Classifier(12/0800 23/11 36/17c1, -)
+       -> GeneveDecap
+       -> ...
+
+=a
+
+GeneveEncap, VXLANDecap */
+
+class GeneveDecap : public ClassifyElement<GeneveDecap> { public:
+
+    GeneveDecap() CLICK_COLD;
+    ~GeneveDecap() CLICK_COLD;
+
+    const char *class_name() const override	{ return "GeneveDecap"; }
+    const char *port_count() const override	{ return PORTS_1_1X2; }
+    const char *processing() const override	{ return PUSH; }
+
+    int configure(Vector<String> &, ErrorHandler *) override CLICK_COLD;
+    bool can_live_reconfigure() const override	{ return true; }
+
+    int classify(Packet *p);
+
+  private:
+
+    int _offset;
+    int _vni_anno;
+    uint16_t _dport;		// network byte order
+
+};
+
+CLICK_ENDDECLS
+#endif
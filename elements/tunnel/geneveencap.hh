@@ -0,0 +1,54 @@
+#ifndef CLICK_GENEVEENCAP_HH
+#define CLICK_GENEVEENCAP_HH
+#include "udptunnelencap.hh"
+CLICK_DECLS
+
+/*
+=c
+
+GeneveEncap(SRC, TUNNEL, [I<keywords> SRCETH, VNI_ANNO, DPORT, SPORT, TTL, DF])
+
+=s tunnel
+
+encapsulates Ethernet frames in Geneve
+
+=d
+
+Encapsulates each Ethernet frame in Geneve (RFC 8926), without options, in
+UDP and IPv4, and optionally in an outer Ethernet header. The outer headers of each
+tunnel are prepared at configuration time and copied at once in front of the
+packet. Keyword arguments are those of UDPTunnelEncap; DPORT defaults to
+6081.
+
+=e
+
+Forwards the frames of virtual networks 10 and 20, received from any
+endpoint, to two other endpoints:
+
+   FromDevice(eth0) -> ... -> GeneveDecap(VNI_ANNO AGGREGATE)
+       -> GeneveEncap(10.0.0.1, SRCETH 0:0:0:0:0:1, VNI_ANNO AGGREGATE,
+			  TUNNEL 10 10.0.0.2 0:0:0:0:0:2,
+			  TUNNEL 20 10.0.0.3 0:0:0:0:0:3)
+       -> ToDevice(eth1);
+
+=a
+
+UDPTunnelEncap, GeneveDecap, VXLANEncap */
+
+class GeneveEncap : public UDPTunnelEncap { public:
+
+    GeneveEncap() CLICK_COLD;
+    ~GeneveEncap() CLICK_COLD;
+
+    const char *class_name() const override	{ return "GeneveEncap"; }
+
+  protected:
+
+    int tunnel_header_size() const override;
+    void write_tunnel_header(unsigned char *h, uint32_t vni) const override;
+    uint16_t default_dport() const override;
+
+};
+
+CLICK_ENDDECLS
+#endif
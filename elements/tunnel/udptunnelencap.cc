@@ -0,0 +1,221 @@
+/*
+ * udptunnelencap.{cc,hh} -- base class for UDP tunnel encapsulation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "udptunnelencap.hh"
+#include <click/args.hh>
+#include <click/error.hh>
+#include <clicknet/ether.h>
+#include <clicknet/ip.h>
+#include <clicknet/ip6.h>
+#include <clicknet/udp.h>
+CLICK_DECLS
+
+UDPTunnelEncap::UDPTunnelEncap()
+    : _table_mask(0), _hlen(0), _ip_offset(0), _vni_anno(-1), _sport(0), _df(false)
+{
+    _id = 0;
+    _drops = 0;
+}
+
+UDPTunnelEncap::~UDPTunnelEncap()
+{
+}
+
+int
+UDPTunnelEncap::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    IPAddress src;
+    EtherAddress srceth;
+    Vector<String> tunnels;
+    bool have_srceth, have_sport, df = false;
+    uint16_t dport = default_dport(), sport = 0;
+    uint8_t ttl = 64;
+    if (Args(conf, this, errh)
+	.read_mp("SRC", src)
+	.read("SRCETH", srceth).read_status(have_srceth)
+	.read_all("TUNNEL", AnyArg(), tunnels)
+	.read("VNI_ANNO", AnnoArg(4), _vni_anno)
+	.read("DPORT", IPPortArg(IP_PROTO_UDP), dport)
+	.read("SPORT", IPPortArg(IP_PROTO_UDP), sport).read_status(have_sport)
+	.read("TTL", ttl)
+	.read("DF", df)
+	.complete() < 0)
+	return -1;
+
+    if (tunnels.size() == 0)
+	return errh->error("no TUNNEL");
+    if (tunnels.size() > 1 && _vni_anno < 0)
+	return errh->error("VNI_ANNO is required with several tunnels");
+    _sport = have_sport ? sport : 0;
+    _df = df;
+
+    _ip_offset = have_srceth ? sizeof(click_ether) : 0;
+    _hlen = _ip_offset + sizeof(click_ip) + sizeof(click_udp) + tunnel_header_size();
+    _templates.assign(tunnels.size() * _hlen, 0);
+
+    uint32_t size = 2;
+    while (size < 2 * (uint32_t) tunnels.size())
+	size <<= 1;
+    Slot empty = {0, 0};
+    _table.assign(size, empty);
+    _table_mask = size - 1;
+
+    for (int t = 0; t < tunnels.size(); t++) {
+	uint32_t vni;
+	IPAddress dst;
+	EtherAddress dsteth;
+	bool have_dsteth;
+	if (Args(this, errh).push_back_words(tunnels[t])
+	    .read_mp("VNI", vni)
+	    .read_mp("DST", dst)
+	    .read_p("DSTETH", dsteth).read_status(have_dsteth)
+	    .complete() < 0)
+	    return -1;
+	if (vni >= (1 << 24))
+	    return errh->error("TUNNEL %d: VNI must be less than 2^24", t + 1);
+	if (have_srceth && !have_dsteth)
+	    return errh->error("TUNNEL %d: DSTETH is required with SRCETH", t + 1);
+	if (find_tunnel(vni) >= 0)
+	    return errh->error("TUNNEL %d: VNI %u already has a tunnel", t + 1, vni);
+
+	unsigned char *h = &_templates[t * _hlen];
+	if (have_srceth) {
+	    click_ether *eth = reinterpret_cast<click_ether *>(h);
+	    memcpy(eth->ether_dhost, dsteth.data(), 6);
+	    memcpy(eth->ether_shost, srceth.data(), 6);
+	    eth->ether_type = htons(ETHERTYPE_IP);
+	}
+	// The template is complete for an empty payload, lengths and IP
+	// checksum are updated per packet, as is the IP ID without DF
+	click_ip *ip = reinterpret_cast<click_ip *>(h + _ip_offset);
+	ip->ip_v = 4;
+	ip->ip_hl = sizeof(click_ip) >> 2;
+	ip->ip_len = htons(_hlen - _ip_offset);
+	ip->ip_off = df ? htons(IP_DF) : 0;
+	ip->ip_ttl = ttl;
+	ip->ip_p = IP_PROTO_UDP;
+	ip->ip_src = src.in_addr();
+	ip->ip_dst = dst.in_addr();
+	ip->ip_sum = click_in_cksum((unsigned char *) ip, sizeof(click_ip));
+	click_udp *udp = reinterpret_cast<click_udp *>(ip + 1);
+	udp->uh_sport = htons(_sport);
+	udp->uh_dport = htons(dport);
+	udp->uh_ulen = htons(sizeof(click_udp) + tunnel_header_size());
+	write_tunnel_header(reinterpret_cast<unsigned char *>(udp + 1), vni);
+
+	uint32_t i = (vni * 0x9E3779B1U) >> 8;
+	while (_table[i & _table_mask].index)
+	    i++;
+	_table[i & _table_mask].vni = vni;
+	_table[i & _table_mask].index = t + 1;
+    }
+    return 0;
+}
+
+/* Hash of the inner flow: the IP addresses, and the ports of TCP and UDP
+   packets that are not fragments; the Ethernet addresses for other
+   packets. */
+inline uint16_t
+UDPTunnelEncap::flow_port(const Packet *p)
+{
+    const unsigned char *d = p->data(), *end = p->end_data();
+    uint32_t h = 0;
+    if (end - d < 14)
+	return 49152;
+    uint16_t type = (d[12] << 8) | d[13];
+    const unsigned char *ip = d + 14, *l4 = 0;
+    int proto = 0;
+    if (type == ETHERTYPE_IP && end - ip >= (int) sizeof(click_ip)) {
+	const click_ip *iph = reinterpret_cast<const click_ip *>(ip);
+	h = iph->ip_src.s_addr ^ (iph->ip_dst.s_addr * 0x9E3779B1U);
+	proto = iph->ip_p;
+	if (!IP_ISFRAG(iph))
+	    l4 = ip + (iph->ip_hl << 2);
+    } else if (type == ETHERTYPE_IP6 && end - ip >= (int) sizeof(click_ip6)) {
+	const uint32_t *a = reinterpret_cast<const uint32_t *>(ip + 8);
+	for (int i = 0; i < 8; i++)
+	    h = (h ^ a[i]) * 0x9E3779B1U;
+	proto = ip[6];
+	l4 = ip + sizeof(click_ip6);
+    } else {
+	for (int i = 0; i < 12; i += 4)
+	    h = (h ^ *reinterpret_cast<const uint32_t *>(d + i)) * 0x9E3779B1U;
+    }
+    if (l4 && (proto == IP_PROTO_TCP || proto == IP_PROTO_UDP) && end - l4 >= 4)
+	h ^= *reinterpret_cast<const uint32_t *>(l4) * 0x85EBCA6BU;
+    h ^= h >> 16;
+    h *= 0x7FEB352DU;
+    h ^= h >> 15;
+    return 49152 | (h & 0x3FFF);
+}
+
+Packet *
+UDPTunnelEncap::simple_action(Packet *p)
+{
+    int t = 0;
+    if ((_vni_anno >= 0 && (t = find_tunnel(p->anno_u32(_vni_anno))) < 0)
+	|| p->length() > 0xFFFF - (uint32_t) (_hlen - _ip_offset)) {
+	_drops++;
+	p->kill();
+	return 0;
+    }
+
+    uint16_t sport = _sport ? _sport : flow_port(p);
+    uint32_t payload = p->length();
+    WritablePacket *q = p->push(_hlen);
+    if (!q)
+	return 0;
+    memcpy(q->data(), &_templates[t * _hlen], _hlen);
+
+    click_ip *ip = reinterpret_cast<click_ip *>(q->data() + _ip_offset);
+    uint16_t len = htons(ntohs(ip->ip_len) + payload);
+    click_update_in_cksum(&ip->ip_sum, ip->ip_len, len);
+    ip->ip_len = len;
+    if (!_df) {
+	uint16_t id = htons(_id.fetch_and_add(1));
+	click_update_in_cksum(&ip->ip_sum, 0, id);
+	ip->ip_id = id;
+    }
+    click_udp *udp = reinterpret_cast<click_udp *>(ip + 1);
+    udp->uh_ulen = htons(ntohs(udp->uh_ulen) + payload);
+    udp->uh_sport = htons(sport);
+    q->set_ip_header(ip, sizeof(click_ip));
+    return q;
+}
+
+#if HAVE_BATCH
+PacketBatch *
+UDPTunnelEncap::simple_action_batch(PacketBatch *batch)
+{
+    EXECUTE_FOR_EACH_PACKET_DROPPABLE(UDPTunnelEncap::simple_action, batch, [](Packet *){});
+    return batch;
+}
+#endif
+
+String
+UDPTunnelEncap::read_handler(Element *e, void *)
+{
+    UDPTunnelEncap *te = static_cast<UDPTunnelEncap *>(e);
+    return String(te->_drops.value());
+}
+
+void
+UDPTunnelEncap::add_handlers()
+{
+    add_read_handler("drops", read_handler, 0);
+}
+
+CLICK_ENDDECLS
+ELEMENT_PROVIDES(UDPTunnelEncap)
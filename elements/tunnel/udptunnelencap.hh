@@ -0,0 +1,150 @@
+#ifndef CLICK_UDPTUNNELENCAP_HH
+#define CLICK_UDPTUNNELENCAP_HH
+#include <click/batchelement.hh>
+#include <click/etheraddress.hh>
+#include <click/ipaddress.hh>
+#include <click/vector.hh>
+CLICK_DECLS
+
+/*
+=c
+
+UDPTunnelEncap
+
+=s tunnel
+
+base class for UDP tunnel encapsulation elements
+
+=d
+
+UDPTunnelEncap implements the data path shared by VXLANEncap and
+GeneveEncap: they only provide their tunnel header and UDP port. It cannot be
+used by itself.
+
+For every TUNNEL, the whole outer header, Ethernet, IPv4, UDP and tunnel
+headers, is built at configuration time. Each packet gets it in one copy,
+followed by the update of the lengths, of the IP checksum (incrementally), and
+of the UDP source port. Tunnels are found by VNI in an open-addressing hash
+table.
+
+Keyword arguments are:
+
+=over 8
+
+=item SRC
+
+IP address. Outer source address. Required.
+
+=item SRCETH
+
+Ethernet address. If given, an outer Ethernet header with this source is
+added, and every TUNNEL must give a destination Ethernet address.
+
+=item TUNNEL
+
+"VNI DST [DSTETH]". A tunnel to the endpoint of IP address DST, and of
+Ethernet address DSTETH, for packets of virtual network VNI. Give this
+argument once per tunnel; at least one is required.
+
+=item VNI_ANNO
+
+Annotation offset of the 4-byte VNI of each packet. Packets whose VNI has no
+TUNNEL are dropped. Required with several tunnels; with one, all packets use
+it by default.
+
+=item DPORT
+
+Integer. Outer UDP destination port. Default is the IANA port of the
+protocol.
+
+=item SPORT
+
+Integer. Outer UDP source port. By default, the source port is a hash of the
+inner flow in the range 49152-65535, so that routers balancing flows over
+several paths (ECMP) and NICs using RSS spread the inner flows of a tunnel.
+
+=item TTL
+
+Integer. Outer TTL. Default is 64.
+
+=item DF
+
+Boolean. Set the Don't Fragment flag of the outer header. Default is false.
+Without it, each packet gets a new IP ID, so that its fragments can be
+reassembled.
+
+=back
+
+The UDP checksum is 0, which is allowed over IPv4.
+
+=h drops read-only
+
+Returns the number of packets dropped because their VNI has no tunnel, or
+because they would be longer than 65535 bytes once encapsulated.
+
+=a VXLANEncap, GeneveEncap, UDPIPEncap */
+
+class UDPTunnelEncap : public BatchElement { public:
+
+    UDPTunnelEncap() CLICK_COLD;
+    ~UDPTunnelEncap() CLICK_COLD;
+
+    const char *port_count() const override	{ return PORTS_1_1; }
+
+    int configure(Vector<String> &, ErrorHandler *) override CLICK_COLD;
+    void add_handlers() override CLICK_COLD;
+
+    Packet *simple_action(Packet *) override;
+#if HAVE_BATCH
+    PacketBatch *simple_action_batch(PacketBatch *) override;
+#endif
+
+  protected:
+
+    /* Size of the tunnel header, following the UDP header. */
+    virtual int tunnel_header_size() const = 0;
+    /* Writes the tunnel header of virtual network VNI at H. */
+    virtual void write_tunnel_header(unsigned char *h, uint32_t vni) const = 0;
+    virtual uint16_t default_dport() const = 0;
+
+  private:
+
+    struct Slot {
+	uint32_t vni;
+	uint32_t index;		// tunnel index + 1, 0 if the slot is empty
+    };
+
+    Vector<unsigned char> _templates;
+    Vector<Slot> _table;
+    uint32_t _table_mask;
+    int _hlen;
+    int _ip_offset;
+    int _vni_anno;
+    uint16_t _sport;
+    bool _df;
+    atomic_uint32_t _id;
+    atomic_uint64_t _drops;
+
+    inline int find_tunnel(uint32_t vni) const;
+    static inline uint16_t flow_port(const Packet *p);
+
+    static String read_handler(Element *, void *) CLICK_COLD;
+
+};
+
+inline int
+UDPTunnelEncap::find_tunnel(uint32_t vni) const
+{
+    uint32_t i = (vni * 0x9E3779B1U) >> 8;
+    while (1) {
+	const Slot &s = _table[i & _table_mask];
+	if (!s.index)
+	    return -1;
+	if (s.vni == vni)
+	    return s.index - 1;
+	i++;
+    }
+}
+
+CLICK_ENDDECLS
+#endif
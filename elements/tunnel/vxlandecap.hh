@@ -0,0 +1,77 @@
+#ifndef CLICK_VXLANDECAP_HH
+#define CLICK_VXLANDECAP_HH
+#include <click/batchelement.hh>
+CLICK_DECLS
+
+/*
+=c
+
+VXLANDecap([I<keywords> ETHER, VNI_ANNO, DPORT])
+
+=s tunnel
+
+decapsulates VXLAN packets
+
+=d
+
+Removes the outer headers of VXLAN packets, up to the inner Ethernet header,
+and stores their VNI in an annotation. Input packets start with the outer
+IPv4 header, or with an Ethernet header before it. Packets that are not UDP to
+the VXLAN port, non-first fragments, too short, or whose VXLAN header has not
+the I flag, are emitted unchanged on output 1 if it exists, and dropped
+otherwise.
+
+Keyword arguments are:
+
+=over 8
+
+=item ETHER
+
+Boolean. If true, input packets start with the outer Ethernet header. Default
+is true.
+
+=item VNI_ANNO
+
+Annotation offset where the 4-byte VNI is stored. Default is AGGREGATE.
+
+=item DPORT
+
+Integer. Outer UDP destination port of VXLAN packets. Default is 4789.
+
+=back
+
+=e
+
+   FromDevice(eth0)
+       -> c :: Classifier(12/0800 23/11 36/12b5, -)
+       -> VXLANDecap
+       -> ...
+
+=a
+
+VXLANEncap, GeneveDecap */
+
+class VXLANDecap : public ClassifyElement<VXLANDecap> { public:
+
+    VXLANDecap() CLICK_COLD;
+    ~VXLANDecap() CLICK_COLD;
+
+    const char *class_name() const override	{ return "VXLANDecap"; }
+    const char *port_count() const override	{ return PORTS_1_1X2; }
+    const char *processing() const override	{ return PUSH; }
+
+    int configure(Vector<String> &, ErrorHandler *) override CLICK_COLD;
+    bool can_live_reconfigure() const override	{ return true; }
+
+    int classify(Packet *p);
+
+  private:
+
+    int _offset;
+    int _vni_anno;
+    uint16_t _dport;		// network byte order
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,54 @@
+#ifndef CLICK_VXLANENCAP_HH
+#define CLICK_VXLANENCAP_HH
+#include "udptunnelencap.hh"
+CLICK_DECLS
+
+/*
+=c
+
+VXLANEncap(SRC, TUNNEL, [I<keywords> SRCETH, VNI_ANNO, DPORT, SPORT, TTL, DF])
+
+=s tunnel
+
+encapsulates Ethernet frames in VXLAN
+
+=d
+
+Encapsulates each Ethernet frame in VXLAN (RFC 7348), in UDP and IPv4, and
+optionally in an outer Ethernet header. The outer headers of each
+tunnel are prepared at configuration time and copied at once in front of the
+packet. Keyword arguments are those of UDPTunnelEncap; DPORT defaults to
+4789.
+
+=e
+
+Forwards the frames of virtual networks 10 and 20, received from any
+endpoint, to two other endpoints:
+
+   FromDevice(eth0) -> ... -> VXLANDecap(VNI_ANNO AGGREGATE)
+       -> VXLANEncap(10.0.0.1, SRCETH 0:0:0:0:0:1, VNI_ANNO AGGREGATE,
+			  TUNNEL 10 10.0.0.2 0:0:0:0:0:2,
+			  TUNNEL 20 10.0.0.3 0:0:0:0:0:3)
+       -> ToDevice(eth1);
+
+=a
+
+UDPTunnelEncap, VXLANDecap, GeneveEncap */
+
+class VXLANEncap : public UDPTunnelEncap { public:
+
+    VXLANEncap() CLICK_COLD;
+    ~VXLANEncap() CLICK_COLD;
+
+    const char *class_name() const override	{ return "VXLANEncap"; }
+
+  protected:
+
+    int tunnel_header_size() const override;
+    void write_tunnel_header(unsigned char *h, uint32_t vni) const override;
+    uint16_t default_dport() const override;
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -30,12 +30,14 @@ int DPDKInfo::configure(Vector<String> &conf, ErrorHandler *errh) {
     }
     instance = this;
     bool has_socket_mbuf, has_mbuf = false;
+    String split_access;
     if (Args(conf, this, errh)
         .read_p("NB_MBUF", DPDKDevice::DEFAULT_NB_MBUF).read_status(has_mbuf)
         .read_all("NB_SOCKET_MBUF", DPDKDevice::NB_MBUF).read_status(has_socket_mbuf)
         .read("MBUF_SIZE", DPDKDevice::MBUF_DATA_SIZE)
         .read("MBUF_CACHE_SIZE", DPDKDevice::MBUF_CACHE_SIZE)
         .read("MAX_HDS_QUEUES", DPDKDevice::MAX_HDS_QUEUES)
+        .read("SPLIT_ACCESS", WordArg(), split_access)
         .read("RX_PTHRESH", DPDKDevice::RX_PTHRESH)
         .read("RX_HTHRESH", DPDKDevice::RX_HTHRESH)
         .read("RX_WTHRESH", DPDKDevice::RX_WTHRESH)
@@ -65,6 +67,20 @@ int DPDKInfo::configure(Vector<String> &conf, ErrorHandler *errh) {
         }
     }
 
+    if (split_access) {
+        split_access = split_access.lower();
+        if (split_access == "ignore")
+            DPDKDevice::SPLIT_ACCESS = DPDKDevice::SPLIT_ACCESS_IGNORE;
+        else if (split_access == "warn")
+            DPDKDevice::SPLIT_ACCESS = DPDKDevice::SPLIT_ACCESS_WARN;
+        else if (split_access == "fail")
+            DPDKDevice::SPLIT_ACCESS = DPDKDevice::SPLIT_ACCESS_FAIL;
+        else if (split_access == "pullup")
+            DPDKDevice::SPLIT_ACCESS = DPDKDevice::SPLIT_ACCESS_PULLUP;
+        else
+            return errh->error("SPLIT_ACCESS must be ignore, warn, fail or pullup");
+    }
+
     if (DPDKDevice::MBUF_CACHE_SIZE > RTE_MEMPOOL_CACHE_MAX_SIZE) {
         return errh->error("The number of MBUF must be lower than %d", RTE_MEMPOOL_CACHE_MAX_SIZE);
     }
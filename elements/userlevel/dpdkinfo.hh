@@ -40,6 +40,14 @@ RTE_PKTMBUF_HEADROOM.
 Integer.  Number of message buffer to keep in a per-core cache. It should be
 such that NB_MBUF modulo MBUF_CACHE_SIZE == 0. Defaults to 256.
 
+=item SPLIT_ACCESS
+
+String. With --dpdk-split, received packets only hold the header segment.
+Says what Classifier, IPFilter and IPClassifier do when their program reads
+beyond it: ignore, warn (at initialization), fail (at initialization), or
+pullup (move just the missing bytes of each such packet to the header
+segment). Defaults to warn.
+
 =item RX_PTHRESH
 
 Integer.  RX prefetch threshold. Defaults to 8.
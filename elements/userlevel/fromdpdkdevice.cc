@@ -57,6 +57,8 @@ FromDPDKDevice::FromDPDKDevice() :
     _count = 0;
     _idle = 0;
     _idle_count = 0;
+    _active_queues = 0;
+    _drain_until = 0;
 }
 
 FromDPDKDevice::~FromDPDKDevice()
@@ -84,6 +86,8 @@ int FromDPDKDevice::configure(Vector<String> &conf, ErrorHandler *errh)
     bool flow_isolate = false;
 #if HAVE_FLOW_API
     String flow_rules_filename;
+    String hds_steer = "none";
+    unsigned hds_min_length = 256;
 #endif
     if (Args(this, errh).bind(conf)
         .read_mp("PORT", dev)
@@ -101,6 +105,8 @@ int FromDPDKDevice::configure(Vector<String> &conf, ErrorHandler *errh)
         .read("FLOW_ISOLATE", flow_isolate)
     #if HAVE_FLOW_API
         .read("FLOW_RULES_FILE", flow_rules_filename)
+        .read("HDS_STEER", WordArg(), hds_steer)
+        .read("HDS_MIN_LENGTH", hds_min_length)
     #endif
         .read("VF_POOLS", num_pools)
         .read_all("VF_VLAN", vf_vlan)
@@ -192,6 +198,23 @@ int FromDPDKDevice::configure(Vector<String> &conf, ErrorHandler *errh)
         );
     }
 
+    hds_steer = hds_steer.lower();
+    if (hds_steer != "none") {
+        if (mode.lower() != FlowRuleManager::DISPATCHING_MODE) {
+            return errh->error("HDS_STEER requires MODE %s", FlowRuleManager::DISPATCHING_MODE.c_str());
+        }
+        if (hds_min_length > 0xFFFF) {
+            return errh->error("HDS_MIN_LENGTH must be lower than 65536");
+        }
+        if (hds_steer == "length") {
+            _dev->set_init_hds_steer(DPDKDevice::HDS_STEER_LENGTH, hds_min_length);
+        } else if (hds_steer == "tcp") {
+            _dev->set_init_hds_steer(DPDKDevice::HDS_STEER_TCP, hds_min_length);
+        } else {
+            return errh->error("HDS_STEER must be none, length or tcp");
+        }
+    }
+
     r = _dev->set_mode(mode, num_pools, vf_vlan, flow_rules_filename, errh);
 #else
     r = _dev->set_mode(mode, num_pools, vf_vlan, errh);
@@ -241,9 +264,14 @@ int FromDPDKDevice::initialize(ErrorHandler *errh)
         if (ret != 0) return ret;
     }
 
+    _active_queues = n_queues;
     ret = initialize_tasks(_active,errh);
     if (ret != 0) return ret;
 
+    // Header-data split pools are allocated on the node of the polling thread
+    for (int q = firstqueue; q <= lastqueue; q++)
+        _dev->set_rx_queue_thread(q, thread_for_queue(q));
+
     if (queue_share > 1)
         return errh->error(
             "Sharing queue between multiple threads is not "
@@ -302,6 +330,8 @@ bool FromDPDKDevice::run_task(Task *t)
     int ret = 0;
     click_cycles_t before;
 
+    bool polling = false;
+
     for (int iqueue = queue_for_thisthread_begin();
             iqueue<=queue_for_thisthread_end(); iqueue++) {
          before = click_get_cycles();
@@ -372,6 +402,23 @@ bool FromDPDKDevice::run_task(Task *t)
 	    _idle += click_get_cycles() - before;
 	    _idle_count += 1;
 	}
+        // Disabled queues are polled until empty
+        if (n || iqueue - firstqueue < _active_queues)
+            polling = true;
+    }
+
+    // All the queues of this thread are disabled and returned nothing. The
+    // NIC may still be writing packets hashed before the RETA changed, so
+    // keep polling until the drain delay passed and no descriptor is used.
+    // Then release the core until set_active_queues() reschedules the task.
+    if (unlikely(!polling)) {
+        bool drained = !click_jiffies_less(click_jiffies(), _drain_until);
+        for (int iqueue = queue_for_thisthread_begin();
+                drained && iqueue <= queue_for_thisthread_end(); iqueue++)
+            if (rte_eth_rx_queue_count(_dev->port_id, iqueue) > 0)
+                drained = false;
+        if (drained)
+            return ret;
     }
 
 #if HAVE_DPDK_INTERRUPT
@@ -417,12 +464,12 @@ void FromDPDKDevice::selected(int fd, int mask) {
 
 enum {
     h_vendor, h_driver, h_carrier, h_duplex, h_autoneg, h_speed, h_type,
-    h_ipackets, h_ibytes, h_imissed, h_ierrors, h_nombufs,
+    h_ipackets, h_ibytes, h_imissed, h_ierrors, h_nombufs, h_hds_pools,
     h_stats_packets, h_stats_bytes,
     h_active, h_safe_active,
     h_xstats, h_queue_count,
     h_nb_rx_queues, h_nb_tx_queues, h_nb_vf_pools,
-    h_rss,
+    h_rss, h_active_queues,
     h_mac, h_add_mac, h_remove_mac, h_vf_mac,
     h_mtu,
     h_cycles, h_cycles_idle,
@@ -431,7 +478,7 @@ enum {
     h_rule_add, h_rules_del, h_rules_flush,
     h_rules_list, h_rules_list_with_hits, h_rules_ids_global, h_rules_ids_internal,
     h_rules_count, h_rules_count_with_hits, h_rule_packet_hits, h_rule_byte_count,
-    h_rules_aggr_stats
+    h_rules_aggr_stats, h_hds_steer
 #endif
 };
 
@@ -468,6 +515,8 @@ String FromDPDKDevice::read_handler(Element *e, void * thunk)
             else
                 return String(0);
         }
+        case h_active_queues:
+            return String(fd->_active_queues);
         case h_cycles_idle: {
             if (likely(fd->_idle_count)) {
                 //return String(fd->_idle / fd->_idle_count);
@@ -591,6 +640,17 @@ String FromDPDKDevice::statistics_handler(Element *e, void *thunk)
             portid_t port_id = fd->get_device()->get_port_id();
             return String(FlowRuleManager::get_flow_rule_mgr(port_id)->flow_rules_count_explicit());
         }
+        case h_hds_steer: {
+            StringAccum acc;
+            static const char * const groups[] = {"split", "regular"};
+            for (int g = 0; g < DPDKDevice::HDS_GROUP_COUNT; g++) {
+                int64_t pkts, bytes;
+                if (fd->_dev->hds_steer_counters((DPDKDevice::HDSGroup) g, pkts, bytes) == 0) {
+                    acc << groups[g] << ' ' << pkts << ' ' << bytes << '\n';
+                }
+            }
+            return acc.take_string();
+        }
         case h_rules_count_with_hits: {
             portid_t port_id = fd->get_device()->get_port_id();
             return String(FlowRuleManager::get_flow_rule_mgr(port_id)->flow_rules_with_hits_count());
@@ -598,11 +658,57 @@ String FromDPDKDevice::statistics_handler(Element *e, void *thunk)
     #endif
         case h_nombufs:
             return String(stats.rx_nombuf);
+        case h_hds_pools:
+            return fd->_dev->hds_pool_stats();
         default:
             return "<unknown>";
     }
 }
 
+/**
+ * Enable the first @a n queues of this element, and disable the others.
+ *
+ * The RETA entries pointing to the queues of this element are reprogrammed
+ * to spread their traffic over the enabled queues. Entries of other queues of
+ * the port are left alone. The threads of disabled queues keep polling them
+ * until they are drained, then stop rescheduling their task, so the cores are
+ * idle.
+ */
+int FromDPDKDevice::set_active_queues(int n, ErrorHandler *errh)
+{
+    if (!_dev)
+        return errh->error("Device is not initialized");
+    if (n < 1 || n > n_queues)
+        return errh->error("The number of active queues must be between 1 and %d", n_queues);
+    int old = _active_queues;
+    if (n == old)
+        return 0;
+
+    if (n > old) {
+        // Restart the polling tasks first, so no packet waits in a new queue
+        _active_queues = n;
+        for (int q = firstqueue + old; q < firstqueue + n; q++) {
+            Task *t = task_for_thread(thread_for_queue(q));
+            if (t)
+                t->reschedule();
+        }
+    }
+
+    if (_dev->set_rss_queues(firstqueue, n_queues, n) != 0) {
+        _active_queues = old;
+        return errh->error("Could not update the RETA of port %d", _dev->port_id);
+    }
+
+    // Removed queues receive no more packets, let their threads drain them
+    // before parking
+    if (n < old) {
+        _drain_until = click_jiffies() + DRAIN_JIFFIES;
+        click_write_fence();
+    }
+    _active_queues = n;
+    return 0;
+}
+
 int FromDPDKDevice::write_handler(
         const String &input, Element *e, void *thunk, ErrorHandler *errh) {
     FromDPDKDevice *fd = static_cast<FromDPDKDevice *>(e);
@@ -668,6 +774,12 @@ int FromDPDKDevice::write_handler(
                 return errh->error("Not a valid integer");
             return fd->_dev->set_rss_max(max);
         }
+        case h_active_queues: {
+            int n;
+            if (!IntArg().parse<int>(input,n))
+                return errh->error("Not a valid integer");
+            return fd->set_active_queues(n, errh);
+        }
         case h_isolate: {
             if (input.empty()) {
                 return errh->error("DPDK Flow Rule Manager (port %u): Specify isolation mode (true/1 -> isolation, otherwise no isolation)", fd->_dev->port_id);
@@ -917,12 +1029,15 @@ void FromDPDKDevice::add_handlers()
     add_read_handler("vf_mac_addr",read_handler, h_vf_mac);
 
     add_write_handler("max_rss", write_handler, h_rss, 0);
+    add_read_handler("active_queues", read_handler, h_active_queues);
+    add_write_handler("active_queues", write_handler, h_active_queues, 0);
 
     add_read_handler("hw_count",statistics_handler, h_ipackets);
     add_read_handler("hw_bytes",statistics_handler, h_ibytes);
     add_read_handler("hw_dropped",statistics_handler, h_imissed);
     add_read_handler("hw_errors",statistics_handler, h_ierrors);
     add_read_handler("nombufs",statistics_handler, h_nombufs);
+    add_read_handler("hds_pools",statistics_handler, h_hds_pools);
 
     add_write_handler("flow_isolate", write_handler, h_isolate, 0);
     add_read_handler ("flow_isolate", statistics_handler, h_isolate);
@@ -937,6 +1052,7 @@ void FromDPDKDevice::add_handlers()
     add_read_handler (FlowRuleManager::FLOW_RULE_LIST_WITH_HITS,  statistics_handler, h_rules_list_with_hits);
     add_read_handler (FlowRuleManager::FLOW_RULE_COUNT,           statistics_handler, h_rules_count);
     add_read_handler (FlowRuleManager::FLOW_RULE_COUNT_WITH_HITS, statistics_handler, h_rules_count_with_hits);
+    add_read_handler ("hds_steer_stats", statistics_handler, h_hds_steer);
 #endif
 
     add_read_handler("mtu",read_handler, h_mtu);
@@ -101,6 +101,21 @@ and if MODE is set to flow, a path to a file with Flow Rule Manager rules
 can be supplied to the device. These rules are installed in the NIC using
 DPDK's flow API.
 
+=item HDS_STEER
+
+String. Requires MODE flow and --dpdk-split. Can be none, length or tcp.
+Steers packets with an IPv4 total length of at least HDS_MIN_LENGTH to the
+header-data split queues (the MAX_HDS_QUEUES first ones, see DPDKInfo), and
+other packets to the regular queues. With tcp, only TCP packets go to the
+split queues, so that ACKs and other small or non-TCP packets do not consume
+split descriptors. Each group of queues keeps its own RSS spread. Defaults
+to none.
+
+=item HDS_MIN_LENGTH
+
+Integer. The IPv4 total length from which packets are steered to the split
+queues with HDS_STEER. Defaults to 256.
+
 =item FLOW_ISOLATE
 
 Boolean. Requires MODE flow. Isolated mode guarantees that all ingress
@@ -259,6 +274,11 @@ If no rule number is specified, an error is returned (aggregate statistics not s
 
 Returns aggregate rule statistics.
 
+=h hds_steer_stats read-only
+
+Returns the packets and bytes steered to each group of queues by HDS_STEER, one
+line per group ("split" and "regular").
+
 =h active read-only
 
 Returns the status of the device (1 for active, otherwise 0).
@@ -324,6 +344,17 @@ If JSON is supported, the return format is JSON, otherwise a string is returned.
 
 Reconfigures the size of the RSS table.
 
+=h active_queues read/write
+
+Returns or sets the number of queues of this element receiving traffic, from
+1 to the number of queues the element was initialized with. Setting it
+spreads the entries of the RSS redirection table (RETA) pointing to the queues
+of the element over its first N queues. Entries pointing to other queues of
+the port, used by other elements, are not changed. The threads of the
+disabled queues poll them until they are drained, then stop, leaving their
+cores idle until the queues are enabled again. See QueueScaler to drive it
+from the measured load.
+
 =h hw_count read-only
 
 Returns the number of packets received by this device, as computed by the hardware.
@@ -344,6 +375,15 @@ Returns the number of errors of this device, as computed by the hardware.
 
 Returns the total number of RX mbuf allocation failures. 
 
+=h hds_pools read-only
+
+With header-data split (click --dpdk-split), returns the state of
+the pools of each split RX queue, one line per pool: "QUEUE hdr|data NODE SIZE
+AVAILABLE IN_USE". Each split queue has its own header and data pools, on the
+NUMA node of the thread polling it, sized from the RX and TX descriptor
+counts. A pool with no available buffer is exhausted; the NIC then drops
+packets, counted by nombufs.
+
 =h rule_add write-only
 
 Inserts a new rule into this device's rule table.
@@ -427,6 +467,32 @@ public:
         return _dev;
     }
 
+    /**
+     * @brief Return the first queue polled by thread @a tid, or -1
+     */
+    inline int rx_queue_for_thread(int tid) {
+        if (!_thread_state.get_value_for_thread(tid).task)
+            return -1;
+        return _thread_state.get_value_for_thread(tid).first_queue_id;
+    }
+
+    int set_active_queues(int n, ErrorHandler *errh);
+    inline int active_queues() const {
+        return _active_queues;
+    }
+    inline int max_active_queues() const {
+        return n_queues;
+    }
+
+    /**
+     * @brief Cycles spent processing received bursts and polling empty
+     * queues since the last reset of cycles_pb and cycles_idle
+     */
+    inline void cycles(uint64_t &busy, uint64_t &idle) const {
+        busy = _accum;
+        idle = _idle;
+    }
+
 #if HAVE_DPDK_READ_CLOCK
     static uint64_t read_clock(void* thunk);
 #endif
@@ -468,6 +534,11 @@ protected:
     uint64_t _count;
     uint64_t _idle;
     uint64_t _idle_count;
+    volatile int _active_queues;
+    // Disabled queues are polled at least until then
+    volatile click_jiffies_t _drain_until;
+
+    enum { DRAIN_JIFFIES = CLICK_HZ / 100 + 1 };
 };
 
 CLICK_ENDDECLS
@@ -444,7 +444,8 @@ int RXQueueDevice::initialize_rx(ErrorHandler *errh) {
 }
 
 int QueueDevice::initialize_tasks(bool schedule, ErrorHandler *errh) {
-    _q_infos.resize(n_queues);
+    // Indexed by queue id, from firstqueue
+    _q_infos.resize(firstqueue + n_queues);
 
     int th_num = 0;
     int qu_num = firstqueue;
@@ -460,7 +461,7 @@ int QueueDevice::initialize_tasks(bool schedule, ErrorHandler *errh) {
 
         if (th_share_idx % thread_share != 0) {
             --th_num;
-            _q_infos[qu_num].lock = 0;
+            queue_info(qu_num).lock = 0;
         }
 
         Task* &task = _thread_state.get_value_for_thread(th_id).task;
@@ -475,7 +476,7 @@ int QueueDevice::initialize_tasks(bool schedule, ErrorHandler *errh) {
         for (int j = 0; j < queue_per_threads; j++) {
             if (_verbose > 2)
                 click_chatter("%s: Queue %d handled by th %d", name().c_str(), qu_num,th_id);
-            _q_infos[qu_num].thread_id = th_id;
+            queue_info(qu_num).thread_id = th_id;
             // If queues are shared, this mapping is loosy: _q_infos[].thread_id will map to the last thread. That's fine, we only want to retrieve one to find one thread to finish some job
             qu_share_idx++;
             if (qu_share_idx % queue_share == 0)
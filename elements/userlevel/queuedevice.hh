@@ -100,13 +100,29 @@ protected:
 
     bool _active; // Is this element active
 
+    /**
+     * Per-queue data of queue @a queue, indexed by queue id
+     */
+    inline QueueInfo &queue_info(int queue) {
+        return _q_infos[queue];
+    }
+
+    /**
+     * Per-queue data of the first queue of the current thread, the one
+     * shared with other threads when queues are shared
+     */
+    inline QueueInfo &queue_info_for_thread() {
+        return queue_info(queue_for_thisthread_begin());
+    }
+
     /**
      * Attempt to take the per-queue lock
      * @return true if taken
      */
     inline bool lock_attempt() {
-        if (_q_infos[id_for_thread()].lock.nonatomic_value() != NO_LOCK) {
-            if (_q_infos[id_for_thread()].lock.swap((uint32_t)1) == (uint32_t)0)
+        QueueInfo &qi = queue_info_for_thread();
+        if (qi.lock.nonatomic_value() != NO_LOCK) {
+            if (qi.lock.swap((uint32_t)1) == (uint32_t)0)
                 return true;
             else
                 return false;
@@ -120,11 +136,12 @@ protected:
      * Takes the per-queue lock
      */
     inline void lock() {
-        if (_q_infos[id_for_thread()].lock.nonatomic_value() != NO_LOCK) {
-            while (_q_infos[id_for_thread()].lock.swap((uint32_t)1) != (uint32_t)0)
+        QueueInfo &qi = queue_info_for_thread();
+        if (qi.lock.nonatomic_value() != NO_LOCK) {
+            while (qi.lock.swap((uint32_t)1) != (uint32_t)0)
                     do {
                     click_relax_fence();
-                    } while ( _q_infos[id_for_thread()].lock != (uint32_t)0);
+                    } while (qi.lock != (uint32_t)0);
         }
     }
 
@@ -132,8 +149,9 @@ protected:
      * Release the per-queue lock
      */
     inline void unlock() {
-        if (_q_infos[id_for_thread()].lock.nonatomic_value() != NO_LOCK) {
-            _q_infos[id_for_thread()].lock = (uint32_t)0;
+        QueueInfo &qi = queue_info_for_thread();
+        if (qi.lock.nonatomic_value() != NO_LOCK) {
+            qi.lock = (uint32_t)0;
         }
     }
 
@@ -216,7 +234,7 @@ protected:
     }
 
     inline int thread_for_queue(int queue) {
-        return _q_infos[queue].thread_id;
+        return queue_info(queue).thread_id;
     }
 
     int thread_per_queues() {
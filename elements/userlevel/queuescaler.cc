@@ -0,0 +1,153 @@
+// -*- c-basic-offset: 4; related-file-name: "queuescaler.hh" -*-
+/*
+ * queuescaler.{cc,hh} - Scale the RX queues of a FromDPDKDevice with its load
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include <click/args.hh>
+#include <click/error.hh>
+#include "queuescaler.hh"
+#include "fromdpdkdevice.hh"
+
+CLICK_DECLS
+
+QueueScaler::QueueScaler()
+    : _fd(0), _timer(this), _interval(1, 0),
+      _min(1), _max(-1), _active(true), _verbose(false)
+{
+}
+
+QueueScaler::~QueueScaler()
+{
+}
+
+int
+QueueScaler::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    Element *e;
+    double high = _policy.high(), low = _policy.low();
+    if (Args(conf, this, errh)
+        .read_mp("DEV", e)
+        .read("INTERVAL", _interval)
+        .read("HIGH", high)
+        .read("LOW", low)
+        .read("MIN", _min)
+        .read("MAX", _max)
+        .read("ACTIVE", _active)
+        .read("VERBOSE", _verbose)
+        .complete() < 0)
+        return -1;
+
+    _fd = static_cast<FromDPDKDevice *>(e->cast("FromDPDKDevice"));
+    if (!_fd)
+        return errh->error("DEV must be a FromDPDKDevice");
+    if (low < 0 || high > 1 || low >= high)
+        return errh->error("LOW and HIGH must satisfy 0 <= LOW < HIGH <= 1");
+    _policy = QueueScalingPolicy(high, low);
+    if (_interval <= Timestamp())
+        return errh->error("INTERVAL must be positive");
+    return 0;
+}
+
+int
+QueueScaler::initialize(ErrorHandler *errh)
+{
+    int n = _fd->max_active_queues();
+    if (_max < 0 || _max > n)
+        _max = n;
+    if (_min < 1 || _min > _max)
+        return errh->error("MIN must be between 1 and %d", _max);
+
+    uint64_t busy, idle;
+    _fd->cycles(busy, idle);
+    _policy.reset(busy, idle);
+    _timer.initialize(this);
+    _timer.schedule_after(_interval);
+    return 0;
+}
+
+int
+QueueScaler::set_queues(int n, ErrorHandler *errh)
+{
+    int old = _fd->active_queues();
+    if (_fd->set_active_queues(n, errh) < 0)
+        return -1;
+    if (_verbose && n != old)
+        click_chatter("%p{element}: %d -> %d queues (load %.2f)", this, old, n, _policy.load());
+    return 0;
+}
+
+void
+QueueScaler::run_timer(Timer *)
+{
+    uint64_t busy, idle;
+    _fd->cycles(busy, idle);
+    if (_policy.update(busy, idle) && _active) {
+        int n = _fd->active_queues();
+        int next = _policy.decide(n, _min, _max);
+        if (next != n)
+            set_queues(next, ErrorHandler::default_handler());
+    }
+
+    _timer.reschedule_after(_interval);
+}
+
+String
+QueueScaler::read_handler(Element *e, void *thunk)
+{
+    QueueScaler *qs = static_cast<QueueScaler *>(e);
+    switch ((intptr_t) thunk) {
+    case h_queues:
+        return String(qs->_fd->active_queues());
+    case h_load:
+        return String(qs->_policy.load());
+    case h_active:
+        return String(qs->_active);
+    default:
+        return String();
+    }
+}
+
+int
+QueueScaler::write_handler(const String &str, Element *e, void *thunk, ErrorHandler *errh)
+{
+    QueueScaler *qs = static_cast<QueueScaler *>(e);
+    switch ((intptr_t) thunk) {
+    case h_queues: {
+        int n;
+        if (!IntArg().parse(str, n))
+            return errh->error("syntax error");
+        return qs->set_queues(n, errh);
+    }
+    case h_active:
+        if (!BoolArg().parse(str, qs->_active))
+            return errh->error("syntax error");
+        return 0;
+    default:
+        return -1;
+    }
+}
+
+void
+QueueScaler::add_handlers()
+{
+    add_read_handler("queues", read_handler, h_queues);
+    add_write_handler("queues", write_handler, h_queues);
+    add_read_handler("load", read_handler, h_load);
+    add_read_handler("active", read_handler, h_active);
+    add_write_handler("active", write_handler, h_active);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(userlevel dpdk FromDPDKDevice)
+EXPORT_ELEMENT(QueueScaler)
@@ -0,0 +1,129 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_QUEUESCALER_HH
+#define CLICK_QUEUESCALER_HH
+#include <click/element.hh>
+#include <click/timer.hh>
+#include <click/queuescaling.hh>
+
+CLICK_DECLS
+
+class FromDPDKDevice;
+
+/*
+ * =title QueueScaler
+ *
+ * =c
+ *
+ * QueueScaler(DEV, [I<keywords> INTERVAL, HIGH, LOW, MIN, MAX, ACTIVE, VERBOSE])
+ *
+ * =s threads
+ *
+ * scales the RX queues of a FromDPDKDevice with its load
+ *
+ * =d
+ *
+ * Every INTERVAL, QueueScaler computes the load of the FromDPDKDevice element
+ * DEV: the share of its polling cycles spent on non-empty bursts since the
+ * last interval. If the load is above HIGH, one more queue is enabled. If it
+ * is below LOW, and would stay below HIGH with one queue less, one queue is
+ * disabled.
+ *
+ * Enabling or disabling queues goes through the active_queues handler of
+ * FromDPDKDevice: the RSS redirection table is reprogrammed, and the threads
+ * polling disabled queues stop once they drained them, so their cores are
+ * idle and can be used by other workloads. The device must use RSS, and its
+ * queues should be served by one thread each (N_QUEUES equal to the number
+ * of threads).
+ *
+ * Keyword arguments are:
+ *
+ * =over 8
+ *
+ * =item DEV
+ *
+ * The FromDPDKDevice element to scale.
+ *
+ * =item INTERVAL
+ *
+ * Time. Interval between two decisions. Default is 1s.
+ *
+ * =item HIGH
+ *
+ * Load above which a queue is added. Default is 0.8.
+ *
+ * =item LOW
+ *
+ * Load below which a queue is removed. Default is 0.3.
+ *
+ * =item MIN
+ *
+ * Minimal number of active queues. Default is 1.
+ *
+ * =item MAX
+ *
+ * Maximal number of active queues. Default is all the queues of DEV.
+ *
+ * =item ACTIVE
+ *
+ * Boolean. If false, the load is measured but the number of queues is only
+ * changed by the queues handler. Default is true.
+ *
+ * =item VERBOSE
+ *
+ * Boolean. Print every change. Default is false.
+ *
+ * =back
+ *
+ * =h queues read/write
+ *
+ * Returns or sets the number of active queues.
+ *
+ * =h load read-only
+ *
+ * Returns the load measured during the last interval.
+ *
+ * =h active read/write
+ *
+ * Returns or sets ACTIVE.
+ *
+ * =e
+ *
+ *   fd :: FromDPDKDevice(0, N_QUEUES 8, MAXTHREADS 8) -> ...
+ *   QueueScaler(fd, MIN 2, HIGH 0.7)
+ *
+ * =a FromDPDKDevice
+ */
+class QueueScaler : public Element { public:
+
+    QueueScaler() CLICK_COLD;
+    ~QueueScaler() CLICK_COLD;
+
+    const char *class_name() const override { return "QueueScaler"; }
+    const char *port_count() const override { return PORTS_0_0; }
+
+    int configure(Vector<String> &, ErrorHandler *) override CLICK_COLD;
+    int initialize(ErrorHandler *) override CLICK_COLD;
+    void add_handlers() override CLICK_COLD;
+
+    void run_timer(Timer *) override;
+
+  private:
+
+    FromDPDKDevice *_fd;
+    Timer _timer;
+    Timestamp _interval;
+    QueueScalingPolicy _policy;
+    int _min;
+    int _max;
+    bool _active;
+    bool _verbose;
+
+    int set_queues(int n, ErrorHandler *errh);
+
+    enum { h_queues, h_load, h_active };
+    static String read_handler(Element *, void *) CLICK_COLD;
+    static int write_handler(const String &, Element *, void *, ErrorHandler *) CLICK_COLD;
+};
+
+CLICK_ENDDECLS
+#endif
@@ -21,6 +21,7 @@
 #include <click/error.hh>
 
 #include "todpdkdevice.hh"
+#include "fromdpdkdevice.hh"
 
 CLICK_DECLS
 
@@ -31,7 +32,7 @@ ToDPDKDevice::ToDPDKDevice() :
 #endif
     _dev(0),
     _timeout(0), _congestion_warning_printed(false), _create(true),
-    _tso(0), _tco(false), _uco(false), _ipco(false)
+    _tso(0), _tco(false), _uco(false), _ipco(false), _recycle_rx(0)
 {
      _blocking = false;
      _burst = -1;
@@ -66,6 +67,7 @@ int ToDPDKDevice::configure(Vector<String> &conf, ErrorHandler *errh)
         .read("TCO", _tco)
         .read("UCO", _uco)
 #endif
+        .read("RECYCLE", ElementCastArg("FromDPDKDevice"), _recycle_rx)
         .complete() < 0)
             return -1;
     if (!DPDKDeviceArg::parse(dev, _dev)) {
@@ -76,6 +78,13 @@ int ToDPDKDevice::configure(Vector<String> &conf, ErrorHandler *errh)
     }
 
 
+    if (_recycle_rx) {
+        // Split packets come from two pools, the header one and the data one
+        if (dpdk_split_enabled)
+            return errh->error("RECYCLE cannot be used with header-data split (--dpdk-split)");
+        DPDKDevice::recycle_enabled = true;
+    }
+
 #if HAVE_IQUEUE
     if (_timeout > 0) {
         return errh->error("Timeout parameter does not make sense without the IQUEUE feature.");
@@ -182,6 +191,20 @@ String ToDPDKDevice::statistics_handler(Element *e, void * thunk)
             return String(stats.obytes);
         case h_oerrors:
             return String(stats.oerrors);
+        case h_recycled:
+        case h_mempool_ops: {
+            uint64_t recycled, ring_ops;
+            DPDKDevice::recycle_stats(recycled, ring_ops);
+            if ((uintptr_t) thunk == h_mempool_ops) {
+                unsigned long long sent = td->n_count();
+                return String(sent ? (double) ring_ops / (double) sent : 0.);
+            }
+#if RTE_VERSION >= RTE_VERSION_NUM(23,11,0,0)
+            PER_THREAD_MEMBER_SUM(uint64_t, recycled_rx, td->_recycle, recycled);
+            recycled += recycled_rx;
+#endif
+            return String(recycled);
+        }
     }
 
     return 0;
@@ -196,8 +219,50 @@ void ToDPDKDevice::add_handlers()
     add_read_handler("hw_count",statistics_handler, h_opackets);
     add_read_handler("hw_bytes",statistics_handler, h_obytes);
     add_read_handler("hw_errors",statistics_handler, h_oerrors);
+    if (_recycle_rx) {
+        add_read_handler("recycled",statistics_handler, h_recycled);
+        add_read_handler("mempool_ops",statistics_handler, h_mempool_ops);
+    }
 }
 
+#if RTE_VERSION >= RTE_VERSION_NUM(23,11,0,0)
+/* Find the RX queue polled by the current thread, once the device is started.
+ * Called on the first send of each thread. */
+void ToDPDKDevice::resolve_recycle(RecycleState &rs)
+{
+    rs.rx_queue = -1;
+    if (!_recycle_rx || !_recycle_rx->get_device())
+        return;
+    int q = _recycle_rx->rx_queue_for_thread(click_current_cpu_id());
+    if (q < 0) {
+        click_chatter("%p{element}: thread %d does not poll %p{element}, no mbuf recycling",
+                      this, click_current_cpu_id(), _recycle_rx);
+        return;
+    }
+    int err = rte_eth_recycle_rx_queue_info_get(_recycle_rx->get_device()->port_id, q, &rs.info);
+    if (err != 0) {
+        click_chatter("%p{element}: cannot recycle mbufs to queue %d of port %d: %s",
+                      this, q, _recycle_rx->get_device()->port_id, rte_strerror(-err));
+        return;
+    }
+    rs.rx_queue = q;
+}
+
+/* Move the mbufs freed by the TX queue to the RX queue of this thread. Must
+ * be called with the TX queue lock held. */
+inline void ToDPDKDevice::recycle_mbufs(unsigned tx_queue)
+{
+    if (likely(!_recycle_rx))
+        return;
+    RecycleState &rs = *_recycle;
+    if (unlikely(rs.rx_queue == -2))
+        resolve_recycle(rs);
+    if (rs.rx_queue >= 0)
+        rs.recycled += rte_eth_recycle_mbufs(_recycle_rx->get_device()->port_id, rs.rx_queue,
+                                             _dev->port_id, tx_queue, &rs.info);
+}
+#endif
+
 #if HAVE_IQUEUE
 
 inline void ToDPDKDevice::set_flush_timer(DPDKDevice::TXInternalQueue &iqueue) {
@@ -239,6 +304,9 @@ void ToDPDKDevice::flush_internal_tx_queue(DPDKDevice::TXInternalQueue &iqueue)
 
     lock(); // ! This is a queue lock, not a thread lock.
 
+#if RTE_VERSION >= RTE_VERSION_NUM(23,11,0,0)
+    recycle_mbufs(queue_for_thisthread_begin());
+#endif
     do {
         sub_burst = iqueue.nr_pending > 32 ? 32 : iqueue.nr_pending;
         if (iqueue.index + sub_burst >= (unsigned)_internal_tx_queue_size)
@@ -429,6 +497,9 @@ void ToDPDKDevice::push_batch(int, PacketBatch *head)
 
         lock(); // ! This is a queue lock, not a thread lock.
 
+#if RTE_VERSION >= RTE_VERSION_NUM(23,11,0,0)
+        recycle_mbufs(queue_for_thisthread_begin());
+#endif
         sent = rte_eth_tx_burst(_dev->port_id, queue_for_thisthread_begin(), pkts, count);
 
         unlock();
@@ -9,6 +9,8 @@
 
 CLICK_DECLS
 
+class FromDPDKDevice;
+
 /*
 =title ToDPDKDevice
 
@@ -92,6 +94,19 @@ Integer.  Number of descriptors per ring. The default is 1024.
 Boolean.  Do not fail if the PORT do not existent. If it's the case the task
 will never run and this element will behave like Idle.
 
+=item RECYCLE
+
+FromDPDKDevice element. In run-to-completion configurations, where each
+thread receives from a queue of RECYCLE and sends on a queue of this element,
+feed the mbufs freed by the TX queue back to the RX queue polled by the same
+thread. The packet pools then give each lcore a free list of mbufs behind the
+DPDK per-lcore cache: mbufs freed when the cache is full go to the list of
+the lcore, and refills of its RX ring take them back from there before the
+shared ring of the pool. With DPDK 23.11 or later, if the driver supports it,
+the mbufs are also moved directly from the TX queue to the software ring of
+the RX queue with the recycle mbufs API. RECYCLE cannot be used with
+header-data split (--dpdk-split). By default, no recycling is done.
+
 =back
 
 This element is only available at user level, when compiled with DPDK support.
@@ -112,6 +127,19 @@ Returns the number of packets dropped by the device.
 
 Resets n_send and n_dropped counts to zero.
 
+=h recycled read-only
+
+Returns the number of mbufs taken back from the free lists of the lcores, or
+moved from the TX queues to the RX queues, with RECYCLE. The free lists are
+shared by all ToDPDKDevice elements.
+
+=h mempool_ops read-only
+
+Returns the number of mbufs that went through the shared rings of the pools,
+put or taken, per packet sent by this element, as counted by the pools. This
+is the traffic that neither the DPDK per-lcore caches nor RECYCLE could keep
+on the core. Only available with RECYCLE.
+
 =a DPDKInfo, FromDPDKDevice */
 
 class ToDPDKDevice : public TXQueueDevice {
@@ -138,7 +166,7 @@ public:
     void add_handlers() CLICK_COLD;
 
     enum {
-        h_opackets,h_obytes,h_oerrors
+        h_opackets,h_obytes,h_oerrors,h_recycled,h_mempool_ops
     };
 
 #if HAVE_IQUEUE
@@ -154,6 +182,20 @@ private:
 
     inline void enqueue(rte_mbuf* &q, rte_mbuf* mbuf, const Packet* p);
 
+#if RTE_VERSION >= RTE_VERSION_NUM(23,11,0,0)
+    class RecycleState { public:
+        RecycleState() : rx_queue(-2), recycled(0) { }
+        int rx_queue; // -2: not resolved yet, -1: no recycling
+        struct rte_eth_recycle_rxq_info info;
+        uint64_t recycled;
+    };
+    per_thread<RecycleState> _recycle;
+
+    inline void recycle_mbufs(unsigned tx_queue);
+    void resolve_recycle(RecycleState &rs) CLICK_COLD;
+#endif
+    FromDPDKDevice *_recycle_rx;
+
 #if HAVE_IQUEUE
     inline void set_flush_timer(DPDKDevice::TXInternalQueue &iqueue);
     void flush_internal_tx_queue(DPDKDevice::TXInternalQueue &);
@@ -23,6 +23,7 @@
 #include <click/glue.hh>
 #include <elements/wifi/path.hh>
 #include <click/straccum.hh>
+#include <click/heap.hh>
 CLICK_DECLS
 
 LinkTable::LinkTable()
@@ -76,7 +77,7 @@ LinkTable::configure (Vector<String> &conf, ErrorHandler *errh)
 
   _stale_timeout.assign(stale_period, 0);
 
-  _hosts.insert(_ip, HostInfo(_ip));
+  host_index(_ip);
   return ret;
 }
 
@@ -88,6 +89,7 @@ LinkTable::take_state(Element *e, ErrorHandler *) {
 
   _hosts = q->_hosts;
   _links = q->_links;
+  reindex();
   dijkstra(true);
   dijkstra(false);
 }
@@ -137,7 +139,101 @@ LinkTable::clear()
 {
   _hosts.clear();
   _links.clear();
+  reindex();
+}
+
+/* Returns the index of host IP, adding it if needed. */
+int
+LinkTable::host_index(IPAddress ip)
+{
+  HostInfo *nfo = _hosts.findp(ip);
+  if (nfo) {
+    return nfo->_index;
+  }
+  int index = _ips.size();
+  _hosts.insert(ip, HostInfo(ip, index));
+  _ips.push_back(ip);
+  _out.push_back(EdgeList());
+  _in.push_back(EdgeList());
+  for (int i = 0; i < 2; i++) {
+    _trees[i]._metric.push_back(no_metric);
+    _trees[i]._prev.push_back(-1);
+  }
+  return index;
+}
+
+/* Rebuilds the host indexes and the adjacency lists from _hosts and
+   _links, after they were replaced. */
+void
+LinkTable::reindex()
+{
+  HTable hosts;
+  hosts.swap(_hosts);
+  _ips.clear();
+  _out.clear();
+  _in.clear();
+  for (int i = 0; i < 2; i++) {
+    _trees[i]._metric.clear();
+    _trees[i]._prev.clear();
+    _trees[i]._changes.clear();
+    _trees[i]._valid = false;
+  }
+  if (_ip) {
+    host_index(_ip);
+  }
+  for (HTIter iter = hosts.begin(); iter.live(); iter++) {
+    host_index(iter.key());
+  }
+  for (LTIter iter = _links.begin(); iter.live(); iter++) {
+    const LinkInfo &nfo = iter.value();
+    int from = host_index(nfo._from), to = host_index(nfo._to);
+    set_edge(_out, from, to, nfo._metric);
+    set_edge(_in, to, from, nfo._metric);
+  }
+}
+
+/* Sets the metric of the edge from HOST to PEER in ADJ, removing the edge
+   if METRIC is 0. */
+void
+LinkTable::set_edge(Vector<EdgeList> &adj, int host, int peer, unsigned metric)
+{
+  EdgeList &l = adj[host];
+  for (int i = 0; i < l.size(); i++) {
+    if (l[i]._peer == peer) {
+      if (metric) {
+	l[i]._metric = metric;
+      } else {
+	l[i] = l.back();
+	l.pop_back();
+      }
+      return;
+    }
+  }
+  if (metric) {
+    l.push_back(Edge(peer, metric));
+  }
+}
 
+unsigned
+LinkTable::edge_metric(const Vector<EdgeList> &adj, int host, int peer) const
+{
+  const EdgeList &l = adj[host];
+  for (int i = 0; i < l.size(); i++) {
+    if (l[i]._peer == peer) {
+      return l[i]._metric;
+    }
+  }
+  return 0;
+}
+
+void
+LinkTable::link_changed(int from, int to)
+{
+  for (int i = 0; i < 2; i++) {
+    if (_trees[i]._valid) {
+      _trees[i]._changes.push_back(make_pair(from, to));
+    }
+  }
 }
 bool
 LinkTable::update_link(IPAddress from, IPAddress to,
@@ -151,27 +247,23 @@ LinkTable::update_link(IPAddress from, IPAddress to,
   }
 
   /* make sure both the hosts exist */
-  HostInfo *nfrom = _hosts.findp(from);
-  if (!nfrom) {
-    HostInfo foo = HostInfo(from);
-    _hosts.insert(from, foo);
-    nfrom = _hosts.findp(from);
-  }
-  HostInfo *nto = _hosts.findp(to);
-  if (!nto) {
-    _hosts.insert(to, HostInfo(to));
-    nto = _hosts.findp(to);
-  }
-
-  assert(nfrom);
-  assert(nto);
+  int nfrom = host_index(from);
+  int nto = host_index(to);
 
   IPPair p = IPPair(from, to);
   LinkInfo *lnfo = _links.findp(p);
+  unsigned old_metric = 0;
   if (!lnfo) {
     _links.insert(p, LinkInfo(from, to, seq, age, metric));
   } else {
+    old_metric = lnfo->_metric;
     lnfo->update(seq, age, metric);
+    metric = lnfo->_metric;
+  }
+  if (metric != old_metric) {
+    set_edge(_out, nfrom, nto, metric);
+    set_edge(_in, nto, nfrom, metric);
+    link_changed(nfrom, nto);
   }
   return true;
 }
@@ -211,10 +303,10 @@ LinkTable::get_host_metric_to_me(IPAddress s)
     return 0;
   }
   HostInfo *nfo = _hosts.findp(s);
-  if (!nfo) {
+  if (!nfo || _trees[0]._metric[nfo->_index] == no_metric) {
     return 0;
   }
-  return nfo->_metric_to_me;
+  return _trees[0]._metric[nfo->_index];
 }
 
 uint32_t
@@ -224,10 +316,10 @@ LinkTable::get_host_metric_from_me(IPAddress s)
     return 0;
   }
   HostInfo *nfo = _hosts.findp(s);
-  if (!nfo) {
+  if (!nfo || _trees[1]._metric[nfo->_index] == no_metric) {
     return 0;
   }
-  return nfo->_metric_from_me;
+  return _trees[1]._metric[nfo->_index];
 }
 
 uint32_t
@@ -345,22 +437,18 @@ LinkTable::best_route(IPAddress dst, bool from_me)
     return reverse_route;
   }
   HostInfo *nfo = _hosts.findp(dst);
+  if (!nfo) {
+    return reverse_route;
+  }
 
-  if (from_me) {
-    while (nfo && nfo->_metric_from_me != 0) {
-      reverse_route.push_back(nfo->_ip);
-      nfo = _hosts.findp(nfo->_prev_from_me);
-    }
-    if (nfo && nfo->_metric_from_me == 0) {
-    reverse_route.push_back(nfo->_ip);
-    }
-  } else {
-    while (nfo && nfo->_metric_to_me != 0) {
-      reverse_route.push_back(nfo->_ip);
-      nfo = _hosts.findp(nfo->_prev_to_me);
-    }
-    if (nfo && nfo->_metric_to_me == 0) {
-      reverse_route.push_back(nfo->_ip);
+  /* unreachable hosts get a route to themselves only, which is not valid */
+  const Tree &t = _trees[from_me];
+  int i = nfo->_index;
+  reverse_route.push_back(_ips[i]);
+  if (t._metric[i] != no_metric) {
+    while (t._prev[i] >= 0) {
+      i = t._prev[i];
+      reverse_route.push_back(_ips[i]);
     }
   }
 
@@ -458,12 +546,11 @@ LinkTable::print_hosts()
 void
 LinkTable::clear_stale() {
 
-  LTable links;
+  Vector<IPPair> stale;
   for (LTIter iter = _links.begin(); iter.live(); iter++) {
     LinkInfo nfo = iter.value();
-    if ((unsigned) _stale_timeout.sec() >= nfo.age()) {
-      links.insert(IPPair(nfo._from, nfo._to), nfo);
-    } else {
+    if ((unsigned) _stale_timeout.sec() < nfo.age()) {
+      stale.push_back(iter.key());
       if (0) {
 	click_chatter("%p{element} :: %s removing link %s -> %s metric %d seq %d age %d\n",
 		      this,
@@ -476,11 +563,15 @@ LinkTable::clear_stale() {
       }
     }
   }
-  _links.clear();
 
-  for (LTIter iter = links.begin(); iter.live(); iter++) {
-    LinkInfo nfo = iter.value();
-    _links.insert(IPPair(nfo._from, nfo._to), nfo);
+  for (int i = 0; i < stale.size(); i++) {
+    LinkInfo *nfo = _links.findp(stale[i]);
+    int from = _hosts.findp(nfo->_from)->_index;
+    int to = _hosts.findp(nfo->_to)->_index;
+    _links.erase(stale[i]);
+    set_edge(_out, from, to, 0);
+    set_edge(_in, to, from, 0);
+    link_changed(from, to);
   }
 
 }
@@ -490,137 +581,183 @@ LinkTable::get_neighbors(IPAddress ip)
 {
   Vector<IPAddress> neighbors;
 
-  typedef HashMap<IPAddress, bool> IPMap;
-  IPMap ip_addrs;
-
-  for (HTIter iter = _hosts.begin(); iter.live(); iter++) {
-    ip_addrs.insert(iter.value()._ip, true);
-  }
-
-  for (IPMap::const_iterator i = ip_addrs.begin(); i.live(); i++) {
-    HostInfo *neighbor = _hosts.findp(i.key());
-    assert(neighbor);
-    if (ip != neighbor->_ip) {
-      LinkInfo *lnfo = _links.findp(IPPair(ip, neighbor->_ip));
-      if (lnfo) {
-	neighbors.push_back(neighbor->_ip);
-      }
+  HostInfo *nfo = _hosts.findp(ip);
+  if (nfo) {
+    const EdgeList &l = _out[nfo->_index];
+    for (int i = 0; i < l.size(); i++) {
+      neighbors.push_back(_ips[l[i]._peer]);
     }
-
   }
 
   return neighbors;
 }
-void
-LinkTable::dijkstra(bool from_me)
-{
-  Timestamp start = Timestamp::now();
-  IPAddress src = _ip;
-
-  typedef HashMap<IPAddress, bool> IPMap;
-  IPMap ip_addrs;
 
-  for (HTIter iter = _hosts.begin(); iter.live(); iter++) {
-    ip_addrs.insert(iter.value()._ip, true);
+namespace {
+struct HeapLess {
+  bool operator()(const Pair<uint32_t, int> &a, const Pair<uint32_t, int> &b) const {
+    return a.first < b.first;
   }
+};
+}
 
-  for (IPMap::const_iterator i = ip_addrs.begin(); i.live(); i++) {
-    /* clear them all initially */
-    HostInfo *n = _hosts.findp(i.key());
-    n->clear(from_me);
-  }
-  HostInfo *root_info = _hosts.findp(src);
+/* Runs dijkstra's algorithm from the hosts in HEAP, following the edges of
+   ADJ. Hosts may appear several times in HEAP; only the entry matching their
+   current metric is used. */
+void
+LinkTable::dijkstra_run(Tree &t, const Vector<EdgeList> &adj,
+			Vector<Pair<uint32_t, int> > &heap)
+{
+  HeapLess less;
+  while (heap.size()) {
+    Pair<uint32_t, int> top = heap[0];
+    pop_heap(heap.begin(), heap.end(), less);
+    heap.pop_back();
+    if (top.first != t._metric[top.second]) {
+      continue;
+    }
 
+    const EdgeList &l = adj[top.second];
+    for (int i = 0; i < l.size(); i++) {
+      uint32_t metric = top.first + l[i]._metric;
+      int peer = l[i]._peer;
+      if (metric < t._metric[peer]) {
+	t._metric[peer] = metric;
+	t._prev[peer] = top.second;
+	heap.push_back(make_pair(metric, peer));
+	push_heap(heap.begin(), heap.end(), less);
+      }
+    }
+  }
+}
 
-  assert(root_info);
+void
+LinkTable::dijkstra_full(Tree &t, const Vector<EdgeList> &adj)
+{
+  t._metric.assign(_ips.size(), no_metric);
+  t._prev.assign(_ips.size(), -1);
+  t._changes.clear();
+
+  int root = _hosts.findp(_ip)->_index;
+  t._metric[root] = 0;
+  Vector<Pair<uint32_t, int> > heap;
+  heap.push_back(make_pair(0U, root));
+  dijkstra_run(t, adj, heap);
+  t._valid = true;
+}
 
-  if (from_me) {
-    root_info->_prev_from_me = root_info->_ip;
-    root_info->_metric_from_me = 0;
-  } else {
-    root_info->_prev_to_me = root_info->_ip;
-    root_info->_metric_to_me = 0;
+/* Updates the tree for the links changed since the last run. The hosts whose
+   path used a link whose metric increased, or which was removed, are reset
+   and restarted from their neighbors outside of that part of the tree; the
+   hosts reached with a smaller metric through a changed link are updated.
+   Then dijkstra's algorithm only propagates the changes. Returns false if
+   too many links changed, and the tree must be recomputed. */
+bool
+LinkTable::dijkstra_incremental(Tree &t, bool from_me)
+{
+  /* the tree follows the links from me, or the reverse links to me */
+  const Vector<EdgeList> &adj = from_me ? _out : _in;
+  const Vector<EdgeList> &radj = from_me ? _in : _out;
+  int n = _ips.size();
+  if (!t._valid || t._changes.size() * 4 > n) {
+    return false;
   }
 
-  IPAddress current_min_ip = root_info->_ip;
-
-  while (current_min_ip) {
-    HostInfo *current_min = _hosts.findp(current_min_ip);
-    assert(current_min);
-    if (from_me) {
-      current_min->_marked_from_me = true;
-    } else {
-      current_min->_marked_to_me = true;
+  /* find the roots of the subtrees whose metric increased */
+  Vector<int> affected;
+  for (int i = 0; i < t._changes.size(); i++) {
+    int a = t._changes[i].first, b = t._changes[i].second;
+    if (!from_me) {
+      click_swap(a, b);
     }
+    unsigned m = edge_metric(adj, a, b);
+    if (t._prev[b] == a && (!m || t._metric[a] + m > t._metric[b])) {
+      affected.push_back(b);
+    }
+  }
 
-
-    for (IPMap::const_iterator i = ip_addrs.begin(); i.live(); i++) {
-      HostInfo *neighbor = _hosts.findp(i.key());
-      assert(neighbor);
-      bool marked = neighbor->_marked_to_me;
-      if (from_me) {
-	marked = neighbor->_marked_from_me;
-      }
-
-      if (marked) {
-	continue;
-      }
-
-      IPPair pair = IPPair(neighbor->_ip, current_min_ip);
-      if (from_me) {
-	pair = IPPair(current_min_ip, neighbor->_ip);
-      }
-      LinkInfo *lnfo = _links.findp(pair);
-      if (!lnfo || !lnfo->_metric) {
-	continue;
+  Vector<Pair<uint32_t, int> > heap;
+  HeapLess less;
+  if (affected.size()) {
+    /* reset the subtrees, found with the children of each host */
+    Vector<int> first_child(n, -1), next_sibling(n, -1);
+    for (int i = 0; i < n; i++) {
+      if (t._prev[i] >= 0) {
+	next_sibling[i] = first_child[t._prev[i]];
+	first_child[t._prev[i]] = i;
       }
-      uint32_t neighbor_metric = neighbor->_metric_to_me;
-      uint32_t current_metric = current_min->_metric_to_me;
-
-      if (from_me) {
-	neighbor_metric = neighbor->_metric_from_me;
-	current_metric = current_min->_metric_from_me;
+    }
+    Vector<bool> in_subtree(n, false);
+    Vector<int> stack, subtree;
+    for (int i = 0; i < affected.size(); i++) {
+      if (!in_subtree[affected[i]]) {
+	in_subtree[affected[i]] = true;
+	stack.push_back(affected[i]);
       }
-
-
-      uint32_t adjusted_metric = current_metric + lnfo->_metric;
-      if (!neighbor_metric ||
-	  adjusted_metric < neighbor_metric) {
-	if (from_me) {
-	  neighbor->_metric_from_me = adjusted_metric;
-	  neighbor->_prev_from_me = current_min_ip;
-	} else {
-	  neighbor->_metric_to_me = adjusted_metric;
-	  neighbor->_prev_to_me = current_min_ip;
+    }
+    while (stack.size()) {
+      int h = stack.back();
+      stack.pop_back();
+      for (int c = first_child[h]; c >= 0; c = next_sibling[c]) {
+	if (!in_subtree[c]) {
+	  in_subtree[c] = true;
+	  stack.push_back(c);
 	}
-
       }
+      t._metric[h] = no_metric;
+      t._prev[h] = -1;
+      subtree.push_back(h);
     }
 
-    current_min_ip = IPAddress();
-    uint32_t  min_metric = ~0;
-    for (IPMap::const_iterator i = ip_addrs.begin(); i.live(); i++) {
-      HostInfo *nfo = _hosts.findp(i.key());
-      uint32_t metric = nfo->_metric_to_me;
-      bool marked = nfo->_marked_to_me;
-      if (from_me) {
-	metric = nfo->_metric_from_me;
-	marked = nfo->_marked_from_me;
+    /* restart them from their neighbors outside of the subtrees */
+    for (int j = 0; j < subtree.size(); j++) {
+      int h = subtree[j];
+      const EdgeList &l = radj[h];
+      for (int i = 0; i < l.size(); i++) {
+	int peer = l[i]._peer;
+	if (!in_subtree[peer] && t._metric[peer] != no_metric
+	    && t._metric[peer] + l[i]._metric < t._metric[h]) {
+	  t._metric[h] = t._metric[peer] + l[i]._metric;
+	  t._prev[h] = peer;
+	}
       }
-      if (!marked && metric &&
-	  metric < min_metric) {
-        current_min_ip = nfo->_ip;
-        min_metric = metric;
+      if (t._metric[h] != no_metric) {
+	heap.push_back(make_pair(t._metric[h], h));
+	push_heap(heap.begin(), heap.end(), less);
       }
     }
+  }
+
+  /* links whose metric decreased */
+  for (int i = 0; i < t._changes.size(); i++) {
+    int a = t._changes[i].first, b = t._changes[i].second;
+    if (!from_me) {
+      click_swap(a, b);
+    }
+    unsigned m = edge_metric(adj, a, b);
+    if (m && t._metric[a] != no_metric && t._metric[a] + m < t._metric[b]) {
+      t._metric[b] = t._metric[a] + m;
+      t._prev[b] = a;
+      heap.push_back(make_pair(t._metric[b], b));
+      push_heap(heap.begin(), heap.end(), less);
+    }
+  }
 
+  t._changes.clear();
+  dijkstra_run(t, adj, heap);
+  return true;
+}
+
+void
+LinkTable::dijkstra(bool from_me, bool incremental)
+{
+  Timestamp start = Timestamp::now();
 
+  Tree &t = _trees[from_me];
+  if (!incremental || !dijkstra_incremental(t, from_me)) {
+    dijkstra_full(t, from_me ? _out : _in);
   }
 
   dijkstra_time = Timestamp::now() - start;
-  //StringAccum sa;
-  //sa << "dijstra took " << finish - start;
-  //click_chatter("%s: %s\n", name().c_str(), sa.take_string().c_str());
 }
 
 
@@ -693,7 +830,7 @@ LinkTable_write_param(const String &in_s, Element *e, void *vparam,
     break;
   }
   case H_CLEAR: f->clear(); break;
-  case H_DIJKSTRA: f->dijkstra(true); f->dijkstra(false); break;
+  case H_DIJKSTRA: f->dijkstra(true, false); f->dijkstra(false, false); break;
   }
   return 0;
 }
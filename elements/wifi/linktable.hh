@@ -6,6 +6,7 @@
 #include <click/element.hh>
 #include <click/bighashmap.hh>
 #include <click/hashmap.hh>
+#include <click/pair.hh>
 #include "path.hh"
 CLICK_DECLS
 
@@ -16,7 +17,16 @@ CLICK_DECLS
  * Keeps a Link state database and calculates Weighted Shortest Path
  * for other elements
  * =d
- * Runs dijkstra's algorithm occasionally.
+ * Runs dijkstra's algorithm occasionally, from this host (routes_from) and to
+ * it (routes_to).
+ *
+ * The links are also kept as adjacency lists indexed by host, and the shortest
+ * path trees as arrays, so dijkstra() uses a binary heap instead of scanning
+ * all the hosts, and needs no hash lookup. When few links changed since the
+ * last run, it only recomputes the hosts whose path used a link whose metric
+ * increased or which was removed, and the hosts reached through a link whose
+ * metric decreased. The dijkstra write handler forces a complete
+ * recomputation.
  * =a ARPTable
  *
  */
@@ -60,7 +70,7 @@ public:
   bool valid_route(const Vector<IPAddress> &route);
   unsigned get_route_metric(const Vector<IPAddress> &route);
   Vector<IPAddress> get_neighbors(IPAddress ip);
-  void dijkstra(bool);
+  void dijkstra(bool from_me, bool incremental = true);
   void clear_stale();
   Vector<IPAddress> best_route(IPAddress dst, bool from_me);
 
@@ -146,47 +156,17 @@ protected:
   class HostInfo {
   public:
     IPAddress _ip;
-    uint32_t _metric_from_me;
-    uint32_t _metric_to_me;
-
-    IPAddress _prev_from_me;
-    IPAddress _prev_to_me;
-
-    bool _marked_from_me;
-    bool _marked_to_me;
+    int _index;		// in _ips, _out, _in and the trees
 
-    HostInfo(IPAddress p = IPAddress()) {
+    HostInfo(IPAddress p = IPAddress(), int index = -1) {
       _ip = p;
-      _metric_from_me = 0;
-      _metric_to_me = 0;
-      _prev_from_me = IPAddress();
-      _prev_to_me = IPAddress();
-      _marked_from_me = false;
-      _marked_to_me = false;
+      _index = index;
     }
 
     HostInfo(const HostInfo &p) :
-      _ip(p._ip),
-      _metric_from_me(p._metric_from_me),
-      _metric_to_me(p._metric_to_me),
-      _prev_from_me(p._prev_from_me),
-      _prev_to_me(p._prev_to_me),
-      _marked_from_me(p._marked_from_me),
-      _marked_to_me(p._marked_to_me)
+      _ip(p._ip), _index(p._index)
     { }
 
-    void clear(bool from_me) {
-      if (from_me ) {
-	_prev_from_me = IPAddress();
-	_metric_from_me = 0;
-	_marked_from_me = false;
-      } else {
-	_prev_to_me = IPAddress();
-	_metric_to_me = 0;
-	_marked_to_me = false;
-      }
-    }
-
   };
 
   typedef HashMap<IPAddress, HostInfo> HTable;
@@ -199,6 +179,39 @@ protected:
   HTable _hosts;
   LTable _links;
 
+  /* adjacency lists, by host index */
+  struct Edge {
+    int _peer;
+    unsigned _metric;
+    Edge(int peer = -1, unsigned metric = 0) : _peer(peer), _metric(metric) { }
+  };
+  typedef Vector<Edge> EdgeList;
+
+  Vector<IPAddress> _ips;
+  Vector<EdgeList> _out;	// links from each host
+  Vector<EdgeList> _in;		// links to each host
+
+  /* shortest path tree, one from me and one to me */
+  enum { no_metric = 0xFFFFFFFFU };
+  struct Tree {
+    Vector<uint32_t> _metric;	// no_metric if unreachable
+    Vector<int> _prev;		// next host towards me, -1 if none
+    Vector<Pair<int, int> > _changes;	// links (from, to) changed since
+				// the last run
+    bool _valid;
+    Tree() : _valid(false) { }
+  };
+  Tree _trees[2];		// indexed by from_me
+
+  int host_index(IPAddress ip);
+  void reindex();
+  void set_edge(Vector<EdgeList> &adj, int host, int peer, unsigned metric);
+  unsigned edge_metric(const Vector<EdgeList> &adj, int host, int peer) const;
+  void link_changed(int from, int to);
+  void dijkstra_full(Tree &t, const Vector<EdgeList> &adj);
+  bool dijkstra_incremental(Tree &t, bool from_me);
+  void dijkstra_run(Tree &t, const Vector<EdgeList> &adj, Vector<Pair<uint32_t, int> > &heap);
+
 
   IPAddress _ip;
   Timestamp _stale_timeout;
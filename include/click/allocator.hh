@@ -6,6 +6,7 @@
 #include <click/glue.hh>
 #include <click/multithread.hh>
 #include <click/sync.hh>
+#include <click/string.hh>
 #include <typeinfo>
 #define CLICK_DEBUG_ALLOCATOR 0
 CLICK_DECLS
@@ -241,5 +242,198 @@ pool_allocator_mt<T,ZERO,POOL_SIZE,POOL_COUNT>::~pool_allocator_mt() {
 #endif
     }
 
+/**
+ * Slab allocator for element state: flow control blocks, rewriter flows and
+ * flow tables.
+ *
+ * Objects are grouped in size classes, up to max_size bytes. Every NUMA node
+ * has one arena per size class, carved out of 2 MB chunks backed by
+ * hugepages: DPDK memzones when DPDK is enabled, anonymous hugepage mappings
+ * otherwise (or transparent hugepages if none are reserved). Chunks are
+ * aligned on their size and start with a header giving their node and size
+ * class, so the home arena of any object is found without a lookup.
+ *
+ * Each thread keeps a magazine of free objects per size class, refilled from
+ * and flushed to the arenas of its node in bulk, so the fast path takes no
+ * lock. Objects freed by a thread of another node are gathered in a
+ * magazine per remote node, and given back to their home arena once it is
+ * full. Memory therefore never migrates from one node to another.
+ *
+ * Thread i is assumed to run on CPU i, as FastClick pins them.
+ *
+ * Bigger objects are allocated with CLICK_LALLOC. Large tables can be
+ * allocated on a given node with allocate_large().
+ *
+ * Outside userlevel, everything falls back to CLICK_LALLOC.
+ */
+class SlabAllocator { public:
+
+    enum {
+        chunk_shift = 21,
+        chunk_size = 1 << chunk_shift,
+        max_size = 4096,
+        nclasses = 76,
+        magazine_size = 64
+    };
+
+    /** @brief Allocate @a size bytes. Memory is not initialized. */
+    static inline void *allocate(size_t size);
+    /** @brief Free @a p, allocated with allocate(@a size). Any thread may
+     * free memory allocated by another one. */
+    static inline void deallocate(void *p, size_t size);
+
+    /** @brief Allocate @a size bytes on NUMA node @a node (the node of the
+     * current thread if negative), backed by hugepages when possible.
+     * Memory is not initialized. Returns 0 on failure. */
+    static void *allocate_large(size_t size, int node = -1);
+    static void deallocate_large(void *p, size_t size);
+
+    /** @brief Return the NUMA node of thread @a thread_id. */
+    static int thread_node(int thread_id);
+    static int current_node() {
+        return thread_node(click_current_cpu_id());
+    }
+
+    /** @brief Return the occupancy of every arena, one line per node and
+     * size class in use: node, object size, chunks, capacity, free objects
+     * in the arena, free objects in thread magazines and objects in use. */
+    static String occupancy();
+
+    static inline int size_class(size_t size) {
+        if (size <= 256)
+            return size ? (size + 15) / 16 - 1 : 0;
+        return 15 + (size - 256 + 63) / 64;
+    }
+
+    static inline size_t class_size(int c) {
+        return c < 16 ? (c + 1) * 16 : 256 + (c - 15) * 64;
+    }
+
+#if CLICK_USERLEVEL
+  private:
+
+    struct Chunk {
+        int node;
+        int sclass;
+        Chunk *next;
+        const void *zone;
+    };
+
+    // Objects start after the chunk header, on a cache line boundary
+    enum {
+        header_size = (sizeof(Chunk) + CLICK_CACHE_LINE_SIZE - 1) & ~(CLICK_CACHE_LINE_SIZE - 1)
+    };
+
+    struct Magazine {
+        unsigned count;
+        void *objs[magazine_size];
+    };
+
+    struct ThreadCache {
+        int node;
+        Magazine local[nclasses];
+        Magazine **remote;
+    };
+
+    struct Arena;
+
+    static ThreadCache *_caches[CLICK_CPU_MAX];
+    static Arena *_arenas;
+    static int _nnodes;
+    static Spinlock _lock;
+
+    static inline Chunk *chunk_of(void *p) {
+        return reinterpret_cast<Chunk *>((uintptr_t) p & ~(uintptr_t) (chunk_size - 1));
+    }
+
+    static void initialize();
+    static ThreadCache *cache();
+    static inline Arena &arena(int node, int sclass);
+    static void *arena_get(Arena &a, int node, int sclass);
+    static void flush(Magazine &m, unsigned n, int node, int sclass);
+    static bool map(size_t size, int node, void **mem, const void **zone);
+    static void *refill(int sclass);
+    static void release(void *p, int sclass);
+#endif
+
+};
+
+#if CLICK_USERLEVEL
+inline void *
+SlabAllocator::allocate(size_t size)
+{
+    if (unlikely(size > max_size))
+        return CLICK_LALLOC(size);
+    int c = size_class(size);
+    unsigned id = click_current_cpu_id();
+    if (likely(id < CLICK_CPU_MAX) && likely(_caches[id] != 0)) {
+        Magazine &m = _caches[id]->local[c];
+        if (likely(m.count > 0))
+            return m.objs[--m.count];
+    }
+    return refill(c);
+}
+
+inline void
+SlabAllocator::deallocate(void *p, size_t size)
+{
+    if (!p)
+        return;
+    if (unlikely(size > max_size)) {
+        CLICK_LFREE(p, size);
+        return;
+    }
+    int c = size_class(size);
+    unsigned id = click_current_cpu_id();
+    if (likely(id < CLICK_CPU_MAX) && likely(_caches[id] != 0)) {
+        ThreadCache *tc = _caches[id];
+        Magazine &m = tc->local[c];
+        if (likely(m.count < magazine_size) && likely(chunk_of(p)->node == tc->node)) {
+            m.objs[m.count++] = p;
+            return;
+        }
+    }
+    release(p, c);
+}
+#else
+inline void *
+SlabAllocator::allocate(size_t size)
+{
+    return CLICK_LALLOC(size);
+}
+
+inline void
+SlabAllocator::deallocate(void *p, size_t size)
+{
+    if (p)
+        CLICK_LFREE(p, size);
+}
+
+inline void *
+SlabAllocator::allocate_large(size_t size, int)
+{
+    return CLICK_LALLOC(size);
+}
+
+inline void
+SlabAllocator::deallocate_large(void *p, size_t size)
+{
+    if (p)
+        CLICK_LFREE(p, size);
+}
+
+inline int
+SlabAllocator::thread_node(int)
+{
+    return 0;
+}
+
+inline String
+SlabAllocator::occupancy()
+{
+    return String();
+}
+#endif
+
 CLICK_ENDDECLS
 #endif
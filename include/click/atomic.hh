@@ -160,6 +160,7 @@ class atomic_uint64_t { public:
 
     inline static void add(volatile uint64_t &x, uint64_t delta);
     inline static uint64_t compare_swap(volatile uint64_t &x, uint64_t expected, uint64_t desired) CLICK_BUILTINS_DEPRECATED;
+    inline static bool compare_and_swap(volatile uint64_t &x, uint64_t expected, uint64_t desired);
 
     inline static bool use_builtins(){return CLICK_ATOMIC_BUILTINS;}
   private:
@@ -1049,6 +1050,44 @@ atomic_uint64_t::compare_swap(uint64_t expected, uint64_t desired) {
 }
 #endif
 
+/** @brief  Perform a compare-and-swap operation.
+ *  @param  x         value
+ *  @param  expected  test value
+ *  @param  desired   new value
+ *  @return True if the old @a x equaled @a expected (in which case @a x
+ *	    was set to @a desired), false otherwise.
+ *
+ * Behaves like this, but in one atomic step:
+ * @code
+ * uint64_t old_value = x;
+ * if (x == expected)
+ *     x = desired;
+ * return old_value == expected;
+ * @endcode
+ *
+ * Unlike compare_swap(), available with builtins. Also acts as a memory
+ * barrier. */
+inline bool
+atomic_uint64_t::compare_and_swap(volatile uint64_t &x, uint64_t expected, uint64_t desired)
+{
+#if CLICK_ATOMIC_BUILTINS
+    return __atomic_compare_exchange(&x, &expected, &desired, 0, CLICK_ATOMIC_MEMORDER, CLICK_ATOMIC_MEMORDER);
+#elif CLICK_ATOMIC_X86 && defined(__x86_64__)
+    asm volatile (CLICK_ATOMIC_LOCK "cmpxchgq %2,%0 ; sete %%al"
+		  : "=m" (x), "=a" (expected)
+		  : "r" (desired), "m" (x), "a" (expected)
+		  : "cc", "memory");
+    return (uint8_t) expected;
+#elif CLICK_LINUXMODULE && defined(cmpxchg)
+    return cmpxchg(&x, expected, desired) == expected;
+#else
+    uint64_t old_value = x;
+    if (old_value == expected)
+	x = desired;
+    return old_value == expected;
+#endif
+}
+
 /** @brief  Atomically add @a delta to the value, returning the old value.
  *
  * Behaves like this, but in one atomic step:
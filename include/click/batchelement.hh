@@ -10,6 +10,9 @@
 #include <click/element.hh>
 #include <click/packet_anno.hh>
 #include <click/routervisitor.hh>
+#if HAVE_BATCH
+# include <click/packetarray.hh>
+#endif
 
 /**
  * This file utilizes the Curiously Recurring Template Pattern (CRTP)
@@ -79,6 +82,18 @@ class BatchElement : public Element { public:
         output(port).push_batch(batch);
     }
 
+    inline void checked_output_push_array(int port, PacketArray &a) {
+        if ((unsigned) port < (unsigned) noutputs())
+            output_push_array(port,a);
+        else
+            a.fast_kill();
+    }
+
+    inline void
+    output_push_array(int port, PacketArray &a) {
+        output(port).push_array(a);
+    }
+
     inline void
     output_push(int port, Packet* p) {
         if (in_batch_mode == BATCH_MODE_YES) {
@@ -94,9 +109,38 @@ class BatchElement : public Element { public:
         return input(port).pull_batch(max);
     }
 
+    /**
+     * Runs a linear chain of fused elements, see the F flag of
+     * Element::flags(). The router connects the upstream elements of the
+     * first stage to it instead of the first stage, and gives it the index
+     * of the first stage. The stages stay in the router, so their handlers
+     * and their other outputs are untouched.
+     */
+    class FusedChain : public Element { public:
+        FusedChain(const Vector<BatchElement*> &stages);
+
+        const char *class_name() const override { return "FusedChain"; }
+
+        void push(int port, Packet *p) override;
+        void push_batch(int port, PacketBatch *batch) override;
+
+        String unparse() const;
+
+      private:
+        Vector<BatchElement*> _stages;
+    };
+
+    /**
+     * Whether the router fuses chains of F-flagged elements. False by
+     * default, see click --fuse.
+     */
+    static bool fusion_enabled;
+
 
 protected :
 
+    FusedChain *_fused;
+
     /**
      * Propagate a BATCH_MODE_YES upstream or downstream
      */
@@ -160,6 +204,10 @@ class ClassifyElement : public BatchElement { public:
     void push_batch(int, PacketBatch *batch) {
           CLASSIFY_EACH_PACKET(noutputs() + 1, static_cast<T&>(*this).classify,batch,checked_output_push_batch);
     }
+
+    void push_array(int, PacketArray &a) override {
+          CLASSIFY_EACH_PACKET_ARRAY(noutputs() + 1, static_cast<T&>(*this).classify,a,checked_output_push_array);
+    }
 #endif
 
     private:
@@ -243,7 +291,7 @@ class SimpleElement : public BatchElement { public:
 
 #if HAVE_BATCH
     void push_batch(int port, PacketBatch* head) override final {
-        head = _sm_action_batch(head);
+        head = static_cast<T&>(*this).T::simple_action_batch(head);
         if (head)
             output(port).push_batch(head);
     }
@@ -251,18 +299,37 @@ class SimpleElement : public BatchElement { public:
     PacketBatch* pull_batch(int port, unsigned max) override final {
         PacketBatch* head = input_pull_batch(port,max);
         if (head)
-            head = _sm_action_batch(head);
+            head = static_cast<T&>(*this).T::simple_action_batch(head);
         return head;
     }
-#endif
 
-  private:
-
-    inline PacketBatch* _sm_action_batch(PacketBatch* batch) {
+    /**
+     * Runs simple_action() on each packet. T may hide it with a faster batch
+     * path, that push_batch() and pull_batch() call without a virtual call.
+     */
+    PacketBatch* simple_action_batch(PacketBatch* batch) override {
         EXECUTE_FOR_EACH_PACKET_DROPPABLE(static_cast<T&>(*this).simple_action, batch, [](Packet*){});
         return batch;
     }
 
+    /**
+     * Runs simple_action() on each packet of the array, compacting the
+     * dropped ones. T may hide it with an array kernel, that push_array()
+     * calls without a virtual call.
+     */
+    void simple_action_array(PacketArray &a) {
+        EXECUTE_FOR_EACH_PACKET_ARRAY_DROPPABLE(static_cast<T&>(*this).simple_action, a, [](Packet*){});
+    }
+
+    void push_array(int port, PacketArray &a) override final {
+        static_cast<T&>(*this).T::simple_action_array(a);
+        if (!a.empty())
+            output(port).push_array(a);
+    }
+#endif
+
+  private:
+
     SimpleElement(){};
     friend T;
 
@@ -2,6 +2,7 @@
 #define DPDKGLUE_H
 #include <rte_version.h>
 #include <rte_hash_crc.h>
+#include <rte_mbuf.h>
 #include <click/ipflowid.hh>
 
 inline uint32_t
@@ -32,6 +33,44 @@ static inline int rte_ring_mc_dequeue_bulk(struct rte_ring *r, void **obj_table,
 #define RTE_MBUF_INDIRECT(m) RTE_MBUF_CLONED(m)
 #endif
 
+/**
+ * Collects mbufs to free, and frees them by bursts. rte_pktmbuf_free_bulk()
+ * groups consecutive mbufs of the same mempool in a single bulk put, instead
+ * of one mempool operation per mbuf.
+ */
+class MbufBulkFree { public:
+    enum { CAPACITY = 64 };
+
+    MbufBulkFree() : _n(0) {
+    }
+
+    ~MbufBulkFree() {
+        flush();
+    }
+
+    inline void add(struct rte_mbuf *m) {
+        _mbufs[_n++] = m;
+        if (unlikely(_n == CAPACITY))
+            flush();
+    }
+
+    inline void flush() {
+        if (_n == 0)
+            return;
+#if RTE_VERSION >= RTE_VERSION_NUM(20,11,0,0)
+        rte_pktmbuf_free_bulk(_mbufs, _n);
+#else
+        for (unsigned i = 0; i < _n; i++)
+            rte_pktmbuf_free(_mbufs[i]);
+#endif
+        _n = 0;
+    }
+
+  private:
+    struct rte_mbuf *_mbufs[CAPACITY];
+    unsigned _n;
+};
+
 #if RTE_VERSION < RTE_VERSION_NUM(20,11,0,0)
 #define TIMESTAMP_FIELD(mbuf) \
             (mbuf->timestamp)
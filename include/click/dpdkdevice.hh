@@ -80,21 +80,34 @@ class DPDKDevice {
 public:
 
     portid_t port_id;
-    struct rte_mempool *data_pktmbuf_pool;
-    struct rte_mempool *hdr_pktmbuf_pool;
+    // Header-data split pools, per RX queue
+    Vector<struct rte_mempool *> data_pktmbuf_pools;
+    Vector<struct rte_mempool *> hdr_pktmbuf_pools;
+    // NIC memory shared by the data pools of all split RX queues
+    void *hds_dm;
+    size_t hds_dm_len;
 
     DPDKDevice() CLICK_COLD;
     DPDKDevice(portid_t port_id) CLICK_COLD;
 
+    // Steering between header-data split queues and regular queues
+    enum HDSSteerMode { HDS_STEER_NONE, HDS_STEER_LENGTH, HDS_STEER_TCP };
+    enum HDSGroup { HDS_GROUP_SPLIT, HDS_GROUP_REGULAR, HDS_GROUP_COUNT };
+
+    // What classifiers do with programs reading beyond the header segment
+    enum SplitAccessMode {
+        SPLIT_ACCESS_IGNORE, SPLIT_ACCESS_WARN, SPLIT_ACCESS_FAIL, SPLIT_ACCESS_PULLUP
+    };
+
     struct DevInfo {
         inline DevInfo() :
             vendor_id(PCI_ANY_ID), vendor_name(), device_id(PCI_ANY_ID), driver(0),
             init_mac(), init_mtu(0), init_rss(-1), init_fc_mode(FC_UNSET),
-            rx_queues(0, false), tx_queues(0, false), n_rx_descs(0), n_tx_descs(0),
+            rx_queues(0, false), tx_queues(0, false), rx_queue_threads(), n_rx_descs(0), n_tx_descs(0),
             num_pools(0), promisc(false),
 	    mq_mode((enum rte_eth_rx_mq_mode)-1), mq_mode_str(""),
             rx_offload(0), tx_offload(0),	
-	    flow_isolate(false),
+	    flow_isolate(false), hds_steer(HDS_STEER_NONE), hds_min_length(0),
             vlan_filter(false), vlan_strip(false), vlan_extend(false), vf_vlan(),
             lro(false), jumbo(false)
         {
@@ -122,6 +135,7 @@ public:
             click_chatter("             Reception Mode: %s", mq_mode_str.c_str());
             click_chatter("           Promiscuous Mode: %s", promisc? "true":"false");
             click_chatter("         Flow API Isolation: %s", flow_isolate? "true":"false");
+            click_chatter("       Split queue steering: %s", hds_steer == HDS_STEER_NONE ? "none" : (hds_steer == HDS_STEER_TCP ? "tcp" : "length"));
             click_chatter("           Rx Offloads flag: %" PRIu64, rx_offload);
             click_chatter("           Tx Offloads flag: %" PRIu64, tx_offload);
             click_chatter("          VLAN    Filtering: %s", vlan_filter? "true":"false");
@@ -142,6 +156,7 @@ public:
         FlowControlMode init_fc_mode;
         Vector<bool> rx_queues;
         Vector<bool> tx_queues;
+        Vector<int> rx_queue_threads;
         unsigned n_rx_descs;
         unsigned n_tx_descs;
         int num_pools;
@@ -151,6 +166,8 @@ public:
         uint64_t rx_offload;
         uint64_t tx_offload;
         bool flow_isolate;
+        HDSSteerMode hds_steer;
+        unsigned hds_min_length;
         bool vlan_filter;
         bool vlan_strip;
         bool vlan_extend;
@@ -178,6 +195,10 @@ public:
         ErrorHandler *errh
     ) CLICK_COLD;
 
+    void set_rx_queue_thread(unsigned queue_id, int thread) CLICK_COLD;
+    int get_rx_queue_numa_node(unsigned queue_id);
+    String hds_pool_stats() CLICK_COLD;
+
     EtherAddress get_mac();
     void set_init_mac(EtherAddress mac);
     void set_init_mtu(uint16_t mtu);
@@ -186,6 +207,7 @@ public:
     void set_rx_offload(uint64_t offload);
     void set_tx_offload(uint64_t offload);
     void set_init_flow_isolate(const bool &flow_isolate);
+    void set_init_hds_steer(HDSSteerMode mode, unsigned min_length);
 
     inline void set_isolation_mode(const bool &isolated) {
         info.flow_isolate = isolated;
@@ -206,7 +228,8 @@ public:
     String get_device_vendor_name();
     uint16_t get_device_id();
     const char *get_device_driver();
-    int set_rss_max(int max);
+    int set_rss_max(int max, int first = 0);
+    int set_rss_queues(int first, int count, int n);
 
     static unsigned int dev_count() {
 #if RTE_VERSION >= RTE_VERSION_NUM(18,05,0,0)
@@ -268,19 +291,64 @@ public:
 
     static void free_pkt(unsigned char *, size_t, void *pktmbuf);
 
+    /*
+     * PayloadTemplate is a constant payload placed once in NIC memory (or
+     * in host memory), that many packets share as an external segment.
+     * The template holds one reference; every attached segment holds
+     * another one, and the memory is released with the last one. Segments
+     * come from seg_pool, whose mbufs have no data room of their own.
+     */
+    struct PayloadTemplate {
+        unsigned char *data;
+        rte_iova_t iova;
+        uint16_t length;
+        bool nicmem;
+        struct rte_device *dev;
+        struct rte_mempool *seg_pool;
+        struct rte_mbuf_ext_shared_info shinfo;
+    };
+
+    static PayloadTemplate *payload_template_create(
+        const unsigned char *data, uint16_t length, int port_id, int node,
+        ErrorHandler *errh
+    ) CLICK_COLD;
+    static void payload_template_destroy(PayloadTemplate *t) CLICK_COLD;
+    inline static Packet *make_templated(
+        PayloadTemplate *t, const unsigned char *header, uint32_t header_length,
+        int node
+    );
+    inline static Packet *make_header_replica(
+        Packet *p, uint32_t header_length, int node
+    );
+    inline static uint32_t full_length(Packet *p);
+
+    /** @brief Return the length of the header segment of split packets. */
+    static unsigned split_header_length() {
+        return _rx_pkt_seg_lengths[0] - RTE_PKTMBUF_HEADROOM;
+    }
+    static int split_pullup(Packet *p, unsigned length, bool pull);
+
     static unsigned int get_nb_txdesc(const portid_t &port_id);
 
 #if HAVE_FLOW_API
     static int configure_nic(const portid_t &port_id);
+    int configure_hds_steering(ErrorHandler *errh);
+    int hds_steer_counters(HDSGroup group, int64_t &pkts, int64_t &bytes);
 #endif
 
     static void cleanup(ErrorHandler *errh);
 
+    /* Set before the pools are created to give every lcore a free list of
+     * mbufs in front of the shared ring of the pools (ToDPDKDevice RECYCLE) */
+    static bool recycle_enabled;
+    static void recycle_stats(uint64_t &recycled, uint64_t &ring_ops);
+
     static Vector<int> NB_MBUF;
     static int DEFAULT_NB_MBUF;
     static int MBUF_DATA_SIZE;
     static int MBUF_SIZE;
     static int MAX_HDS_QUEUES;
+    static int SPLIT_ACCESS;
     static int MBUF_CACHE_SIZE;
     static int RX_PTHRESH;
     static int RX_HTHRESH;
@@ -343,6 +411,9 @@ private:
     enum Dir { RX, TX };
 
     struct DevInfo info;
+#if HAVE_FLOW_API
+    Vector<uint32_t> _hds_rules[HDS_GROUP_COUNT];
+#endif
 
 #define MAX_SEGS_BUFFER_SPLIT (2)
     static unsigned _rx_pkt_seg_lengths[MAX_SEGS_BUFFER_SPLIT];
@@ -359,7 +430,9 @@ private:
                     bool lro, bool jumbo, unsigned n_desc, ErrorHandler *errh) CLICK_COLD;
 
     // non-static as we need the portid
-    int alloc_pktmbufs_data(ErrorHandler* errh, unsigned i) CLICK_COLD;
+    unsigned hds_nb_mbuf() const;
+    int alloc_hds_nicmem(ErrorHandler* errh, unsigned n_split) CLICK_COLD;
+    int alloc_pktmbufs_data(ErrorHandler* errh, unsigned queue, unsigned n_split) CLICK_COLD;
     static int alloc_pktmbufs(ErrorHandler* errh) CLICK_COLD;
 
     static DPDKDevice *ensure_device(const portid_t &port_id) {
@@ -456,8 +529,12 @@ inline struct rte_mbuf* DPDKDevice::get_mbuf(Packet* p, bool create, int node, b
 #endif
             ) {
         /* If the packet is an unshared DPDK packet, we can send
-         *  the mbuf as it to DPDK*/
-        rte_pktmbuf_pkt_len(mbuf) = p->length();
+         *  the mbuf as it to DPDK. Click only sees the first segment: the
+         *  following ones of chained mbufs are kept.*/
+        if (unlikely(mbuf->next != 0))
+            rte_pktmbuf_pkt_len(mbuf) = p->length() + (rte_pktmbuf_pkt_len(mbuf) - rte_pktmbuf_data_len(mbuf));
+        else
+            rte_pktmbuf_pkt_len(mbuf) = p->length();
         rte_pktmbuf_data_len(mbuf) = p->length();
         mbuf->data_off = p->headroom();
 #ifndef CLICK_NOINDIRECT
@@ -490,6 +567,129 @@ inline struct rte_mbuf* DPDKDevice::get_mbuf(Packet* p, bool create, int node, b
     return mbuf;
 }
 
+/**
+ * Make a packet made of a copy of header, followed by the payload of t.
+ * Click only sees the header: the payload is a second segment, that the NIC
+ * reads from the template memory at transmission.
+ */
+inline Packet *DPDKDevice::make_templated(PayloadTemplate *t, const unsigned char *header, uint32_t header_length, int node) {
+    struct rte_mbuf *hdr = get_pkt(node);
+    if (unlikely(!hdr))
+        return 0;
+    struct rte_mbuf *seg = rte_pktmbuf_alloc(t->seg_pool);
+    if (unlikely(!seg)) {
+        rte_pktmbuf_free(hdr);
+        return 0;
+    }
+
+    rte_mbuf_ext_refcnt_update(&t->shinfo, 1);
+    rte_pktmbuf_attach_extbuf(seg, t->data, t->iova, t->length, &t->shinfo);
+    rte_pktmbuf_data_len(seg) = t->length;
+
+    unsigned char *data = rte_pktmbuf_mtod(hdr, unsigned char *);
+    memcpy(data, header, header_length);
+    rte_pktmbuf_data_len(hdr) = header_length;
+    rte_pktmbuf_pkt_len(hdr) = header_length + t->length;
+    hdr->next = seg;
+    hdr->nb_segs = 2;
+
+#if CLICK_PACKET_USE_DPDK
+    return Packet::make(hdr);
+#else
+    return Packet::make(data, header_length, DPDKDevice::free_pkt, hdr,
+                        rte_pktmbuf_headroom(hdr), rte_pktmbuf_tailroom(hdr));
+#endif
+}
+
+/**
+ * Make a replica of p made of a private copy of its first header_length
+ * bytes, followed by the rest of p as segments attached to the buffers of p.
+ * Only the header is copied: the payload, including the payload segment of
+ * packets received on a header-data split port, is shared and reference
+ * counted by DPDK. Click only sees the header of the replica.
+ *
+ * @return the replica, without annotations, or 0 if p is not a DPDK packet
+ * or no buffer is available
+ */
+inline Packet *DPDKDevice::make_header_replica(Packet *p, uint32_t header_length, int node) {
+    struct rte_mbuf *mb;
+#if CLICK_PACKET_USE_DPDK
+    mb = p->mb();
+#else
+    if (is_dpdk_packet(p))
+        mb = (struct rte_mbuf *) p->destructor_argument();
+# ifndef CLICK_NOINDIRECT
+    else if (p->data_packet() && is_dpdk_packet(p->data_packet()))
+        mb = (struct rte_mbuf *) p->data_packet()->destructor_argument();
+# endif
+    else
+        return 0;
+#endif
+    if (header_length > p->length())
+        header_length = p->length();
+
+    struct rte_mbuf *hdr = get_pkt(node);
+    if (unlikely(!hdr))
+        return 0;
+    unsigned char *data = rte_pktmbuf_mtod(hdr, unsigned char *);
+    memcpy(data, p->data(), header_length);
+    rte_pktmbuf_data_len(hdr) = header_length;
+    rte_pktmbuf_pkt_len(hdr) = header_length;
+    hdr->nb_segs = 1;
+
+    // The part of the first segment that Click sees after the header
+    struct rte_mbuf *last = hdr;
+    uint32_t rest = p->length() - header_length;
+    if (rest) {
+        struct rte_mbuf *seg = get_pkt(node);
+        if (unlikely(!seg))
+            goto fail;
+        rte_pktmbuf_attach(seg, mb);
+        seg->data_off = p->data() + header_length - (unsigned char *) seg->buf_addr;
+        rte_pktmbuf_data_len(seg) = rest;
+        last->next = seg;
+        last = seg;
+        rte_pktmbuf_pkt_len(hdr) += rest;
+        hdr->nb_segs++;
+    }
+
+    // The following segments, such as the payload of split packets
+    if (mb->next) {
+        struct rte_mbuf *seg = rte_pktmbuf_clone(mb->next, get_mpool(node));
+        if (unlikely(!seg))
+            goto fail;
+        last->next = seg;
+        for (; seg; seg = seg->next) {
+            rte_pktmbuf_pkt_len(hdr) += rte_pktmbuf_data_len(seg);
+            hdr->nb_segs++;
+        }
+    }
+
+#if CLICK_PACKET_USE_DPDK
+    return Packet::make(hdr);
+#else
+    return Packet::make(data, header_length, DPDKDevice::free_pkt, hdr,
+                        rte_pktmbuf_headroom(hdr), rte_pktmbuf_tailroom(hdr));
+#endif
+
+  fail:
+    rte_pktmbuf_free(hdr);
+    return 0;
+}
+
+/**
+ * Return the length of DPDK packet p, including the segments that Click
+ * does not see, such as the payload of replicas and split packets.
+ */
+inline uint32_t DPDKDevice::full_length(Packet *p) {
+#if CLICK_PACKET_USE_DPDK
+    struct rte_mbuf *mb = p->mb();
+#else
+    struct rte_mbuf *mb = (struct rte_mbuf *) p->destructor_argument();
+#endif
+    return p->length() + rte_pktmbuf_pkt_len(mb) - rte_pktmbuf_data_len(mb);
+}
+
 inline rte_mbuf* DPDKDevice::get_pkt(unsigned numa_node) {
     struct rte_mbuf* mbuf = rte_pktmbuf_alloc(get_mpool(numa_node));
     if (unlikely(!mbuf)) {
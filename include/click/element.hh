@@ -8,6 +8,9 @@
 #include <click/packetbatch.hh>
 #include <click/handler.hh>
 #include <click/sync.hh>
+#if CLICK_USERLEVEL
+# include <click/pathtrace.hh>
+#endif
 #include <functional>
 
 CLICK_DECLS
@@ -23,6 +26,7 @@ class Bitvector;
 class EtherAddress;
 
 class BatchElement;
+class PacketArray;
 
 #define BATCH_MAX_PULL 256
 
@@ -47,6 +51,7 @@ class Element { public:
 #if HAVE_BATCH
     virtual void push_batch(int port, PacketBatch *p);
     virtual PacketBatch* pull_batch(int port,unsigned max) CLICK_WARN_UNUSED_RESULT;
+    virtual void push_array(int port, PacketArray &a);
 #endif
 
     virtual bool run_task(Task *task);  // return true iff did useful work
@@ -269,6 +274,7 @@ class Element { public:
 #if HAVE_BATCH
         inline void push_batch(PacketBatch* p) const;
         inline PacketBatch* pull_batch(unsigned max) const;
+        inline void push_array(PacketArray &a) const;
 
         inline void start_batch();
         inline void end_batch();
@@ -313,6 +319,7 @@ class Element { public:
 
         friend class Element;
         friend class BatchElement;
+        friend class Router;
 
     };
 
@@ -701,6 +708,9 @@ inline void
 Element::Port::push(Packet* p) const
 {
     assert(_e && p);
+#if CLICK_USERLEVEL
+    PathTrace::push(_e, _port, p);
+#endif
 #ifdef HAVE_AUTO_BATCH
     if (likely(_e->in_batch_mode == BATCH_MODE_YES)) {
         if (*current_batch != 0) {
@@ -789,6 +799,9 @@ Element::Port::pull() const
 #if CLICK_STATS >= 1
     if (p)
         ++_packets;
+#endif
+#if CLICK_USERLEVEL
+    PathTrace::pull(_e, _port, p);
 #endif
     return p;
 }
@@ -802,6 +815,9 @@ Element::Port::push_batch(PacketBatch* batch) const {
 #if BATCH_DEBUG
     click_chatter("Pushing batch of %d packets to %p{element}",batch->count(),_e);
 #endif
+#if CLICK_USERLEVEL
+    PathTrace::push_batch(_e, _port, batch);
+#endif
 #if HAVE_BOUND_PORT_TRANSFER
     _bound_batch.push_batch(_e,_port,batch);
 #else
@@ -809,6 +825,19 @@ Element::Port::push_batch(PacketBatch* batch) const {
 #endif
 }
 
+/** @brief Push the packets of array @a a to this port.
+ *
+ * Array-aware elements receive the array directly, others receive
+ * the packets as a linked PacketBatch. See PacketArray.
+ */
+inline void
+Element::Port::push_array(PacketArray &a) const {
+#if BATCH_DEBUG
+    click_chatter("Pushing array to %p{element}",_e);
+#endif
+    _e->push_array(_port,a);
+}
+
 #ifdef HAVE_AUTO_BATCH
 inline void
 Element::Port::start_batch() {
@@ -895,6 +924,9 @@ Element::Port::pull_batch(unsigned max) const {
     batch = _bound_batch.pull_batch(_e,_port, max);
 #else
     batch = _e->pull_batch(_port, max);
+#endif
+#if CLICK_USERLEVEL
+    PathTrace::pull_batch(_e, _port, batch);
 #endif
     return batch;
 }
@@ -196,83 +196,20 @@ extern __thread FlowTableHolder* fcb_table;
 #define SFCB_STACK(fnt) \
 		{FlowControlBlock* fcb_save = fcb_stack;fcb_stack=0;fnt;fcb_stack=fcb_save;}
 
-#define CLICK_DEBUG_FCBPOOL 0
-
-#define SFCB_POOL_COUNT 32
-#define SFCB_POOL_SIZE 2048
+/**
+ * Allocator for FlowControlBlocks.
+ *
+ * Blocks come from the SlabAllocator, so they are kept on hugepages of the
+ * NUMA node of the thread that created them, and cached per thread.
+ */
 class FCBPool {
 private:
-    class SFCBList {
-        private:
-            FlowControlBlock* _p;
-            unsigned _count;
-        public:
-
-            operator int() const { return _count; }
-
-            SFCBList (int c) : _p(0), _count( c ) {
-            }
-
-	    SFCBList() : _p(0), _count(0) {
-		}
-
-            inline void reset() {
-                _p = 0;
-                _count = 0;
-            }
-
-            inline void assign(SFCBList list) {
-                _count = list._count;
-                _p = list._p;
-            }
-
-            inline int count() const {
-                return _count;
-            }
 
-            inline void add(FlowControlBlock* fcb) {
-#if CLICK_DEBUG_FCBPOOL
-                assert(*(((uint64_t*)fcb) + 1) != ALLOCATOR_POISON);
-                assert(fcb->count() == 0);
-                *(((uint64_t*)fcb) + 1) = ALLOCATOR_POISON;
-#endif
-                *((FlowControlBlock**)fcb) = _p;
-                _p = fcb;
-                _count++;
-            }
-
-            inline FlowControlBlock* get() {
-                FlowControlBlock* fcb = _p;
-#if CLICK_DEBUG_FCBPOOL
-                assert(*(((uint64_t*)fcb) + 1) == ALLOCATOR_POISON);
-                *(((uint64_t*)fcb) + 1) = 0;
-#endif
-                _p = *((FlowControlBlock**)fcb);
-                _count--;
-                fcb->initialize();
-                return fcb;
-            }
-    };
-
-
-	inline FlowControlBlock* alloc_new() {
-		FlowControlBlock* fcb = (FlowControlBlock*)CLICK_LALLOC(sizeof(FlowControlBlock) + _data_size);
-		flow_assert(fcb);
-/*#if HAVE_DYNAMIC_FLOW_RELEASE_FNT
-		fcb->release_fnt = &pool_release_fnt;
-		fcb->thunk = this;
-#endif*/
-		fcb->initialize();
-		return fcb;
+	inline size_t fcb_size() const {
+		return sizeof(FlowControlBlock) + _data_size;
 	}
 
-	typedef MPMCRing<SFCBList,SFCB_POOL_COUNT> SFCBListRing;
-
-	SFCBListRing global_fcb_list_ring;
-
-
 	size_t _data_size;
-	per_thread_oread<SFCBList> lists;
 public:
     static FCBPool* biggest_pool;
     static int initialized;
@@ -283,29 +220,10 @@ public:
     static FlowControlBlock* init_allocate();
     static void init_release(FlowControlBlock*);
 
-	FCBPool() : _data_size(0), lists() {
+	FCBPool() : _data_size(0) {
 	}
 
 	~FCBPool() {
-	    //TODO
-	    /*
-		//Free all per-thread caches
-		for (unsigned i = 0; i < lists.weight(); i++) {
-			SFCBList &list = lists.get_value(i);
-			FlowControlBlock* fcb;
-			while (list.count > 0 && (fcb = list.get()) != NULL) {
-				CLICK_LFREE(fcb,sizeof(FlowControlBlock) + _data_size);
-			}
-		}
-
-		//Free the caches inside the global ring
-		SFCBList list;
-		while ((list = global_fcb_list_ring.extract()) != 0) {
-			FlowControlBlock* fcb;
-			while (list.count > 0 && (fcb = list.get()) != NULL) {
-				CLICK_LFREE(fcb,sizeof(FlowControlBlock) + _data_size);
-			}
-		}*/
 	}
 
 
@@ -318,24 +236,11 @@ public:
 		FCBPool::initialized++;
 	}
 
-	void compress(Bitvector threads);
-
 	inline FlowControlBlock* allocate() {
-		if (lists->count() > 0)
-			return lists->get();
-
-		SFCBList newlist;
-
-		newlist = global_fcb_list_ring.extract();
-		if (newlist.count()) {
-			lists->assign(newlist);
-            FlowControlBlock* fcb = lists->get();
-			return fcb;
-		} else {
-			FlowControlBlock* fcb = alloc_new();
-			flow_assert(fcb);
-			return fcb;
-		}
+		FlowControlBlock* fcb = (FlowControlBlock*)SlabAllocator::allocate(fcb_size());
+		flow_assert(fcb);
+		fcb->initialize();
+		return fcb;
 	}
 
     inline FlowControlBlock* allocate_empty() {
@@ -345,11 +250,7 @@ public:
     }
 
 	inline void release(FlowControlBlock* fcb) {
-		if (lists->count() >= SFCB_POOL_SIZE) {
-			global_fcb_list_ring.insert(lists.get());
-			lists->reset();
-		}
-		lists->add(fcb);
+		SlabAllocator::deallocate(fcb, fcb_size());
 	}
 
 	static void pool_release_fnt(FlowControlBlock* fcb, void* thunk) {
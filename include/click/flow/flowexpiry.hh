@@ -0,0 +1,222 @@
+#ifndef CLICK_FLOWEXPIRY_HH
+#define CLICK_FLOWEXPIRY_HH
+#include <click/config.h>
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/multithread.hh>
+#include <click/straccum.hh>
+#include <click/timerwheel.hh>
+#include <click/flow/common.hh>
+#include <clicknet/ip.h>
+#include <clicknet/tcp.h>
+
+CLICK_DECLS
+
+/**
+ * Per-class flow timeouts of the flow managers.
+ *
+ * Each flow is given a timeout class from the first packet seen, and TCP
+ * flows then move to another class according to the TCP flags of their
+ * packets: a flow whose packets only have SYN is in the SYN class, a packet
+ * without SYN makes it established, and a FIN or a RST makes it closing for
+ * the rest of its life. Flows are scheduled in a TimerWheel ticking every
+ * second, with their TimerWheelLink in the FCB, and are moved forward when
+ * they switch to a class with a shorter timeout. When a flow comes up in the
+ * wheel, it expires if it has been idle for the timeout of its class, or is
+ * scheduled again for the remaining time.
+ *
+ * The manager keeps a State at the start of each FCB, and must reserve
+ * sizeof(State) bytes there.
+ */
+class FlowExpiry {
+    public:
+        enum { SYN, ESTABLISHED, CLOSING, UDP, OTHER, NCLASSES };
+
+        struct State {
+            uint32_t index; //The identifier of the flow in the manager
+            uint32_t cls;
+            TimerWheelLink<FlowControlBlock> link;
+        };
+
+        typedef TimerWheel<FlowControlBlock> wheel_type;
+
+        FlowExpiry() {
+            for (int i = 0; i < NCLASSES; i++)
+                _timeout[i] = 0;
+        }
+
+        /**
+         * Read the TIMEOUT, SYN_TIMEOUT, CLOSE_TIMEOUT, UDP_TIMEOUT and
+         * OTHER_TIMEOUT keywords out of conf.
+         */
+        int configure(Vector<String> &conf, Element* e, ErrorHandler* errh, int default_timeout) {
+            int timeout = default_timeout;
+            int syn = 10, closing = 10, udp = 0, other = 0;
+            bool have_udp, have_other;
+            if (Args(e, errh).bind(conf)
+                .read("TIMEOUT", timeout)
+                .read("SYN_TIMEOUT", syn)
+                .read("CLOSE_TIMEOUT", closing)
+                .read("UDP_TIMEOUT", udp).read_status(have_udp)
+                .read("OTHER_TIMEOUT", other).read_status(have_other)
+                .consume() < 0)
+                return -1;
+            if (timeout <= 0)
+                return 0;
+            if (syn <= 0 || closing <= 0 || (have_udp && udp <= 0) || (have_other && other <= 0))
+                return errh->error("timeouts must be positive");
+            _timeout[ESTABLISHED] = timeout;
+            _timeout[SYN] = syn;
+            _timeout[CLOSING] = closing;
+            _timeout[UDP] = have_udp ? udp : timeout;
+            _timeout[OTHER] = have_other ? other : timeout;
+            return 0;
+        }
+
+        inline bool enabled() const {
+            return _timeout[ESTABLISHED] > 0;
+        }
+
+        int max_timeout() const {
+            int m = 0;
+            for (int i = 0; i < NCLASSES; i++)
+                if (_timeout[i] > m)
+                    m = _timeout[i];
+            return m;
+        }
+
+        static inline State* state(FlowControlBlock* fcb) {
+            return reinterpret_cast<State*>(fcb->data);
+        }
+
+        static inline TimerWheelLink<FlowControlBlock>* link(FlowControlBlock* fcb) {
+            return &state(fcb)->link;
+        }
+
+        /**
+         * Schedule the new flow fcb, of which p is the first packet.
+         */
+        inline void start(wheel_type& wheel, FlowControlBlock* fcb, Packet* p, bool mp) {
+            State* s = state(fcb);
+            s->cls = classify(p);
+            s->link.pprev = 0;
+            _stats->count[s->cls]++;
+            if (mp)
+                wheel.move_after_mp(fcb, _timeout[s->cls], link);
+            else
+                wheel.move_after(fcb, _timeout[s->cls], link);
+        }
+
+        /**
+         * Track the TCP flags of p, a packet of the existing flow fcb.
+         */
+        inline void track(wheel_type& wheel, FlowControlBlock* fcb, Packet* p, bool mp) {
+            State* s = state(fcb);
+            if (s->cls >= CLOSING)
+                return;
+            int cls = tcp_class(p);
+            if (cls == SYN || (cls == ESTABLISHED && s->cls == ESTABLISHED))
+                return;
+            //Longer timeouts are taken into account when the flow comes up
+            if (_timeout[cls] < _timeout[s->cls]) {
+                if (mp) {
+                    //Another thread may have expired the flow since it was
+                    //looked up, it must not be scheduled again
+                    if (!wheel.move_after_if_scheduled_mp(fcb, _timeout[cls], link))
+                        return;
+                } else
+                    wheel.move_after(fcb, _timeout[cls], link);
+            }
+            Stats& st = *_stats;
+            st.count[s->cls]--;
+            st.count[cls]++;
+            s->cls = cls;
+        }
+
+        /**
+         * Advance the wheel by one second. release(fcb) must remove an
+         * expired flow from the manager.
+         */
+        template <typename F>
+        inline void run(wheel_type& wheel, const Timestamp& recent, bool mp, F release) {
+            auto expire = [this, &wheel, &recent, &release](FlowControlBlock* fcb) {
+                State* s = state(fcb);
+                int old = (recent - fcb->lastseen).sec();
+                if (old >= _timeout[s->cls]) {
+                    Stats& st = *_stats;
+                    st.count[s->cls]--;
+                    st.expired[s->cls]++;
+                    release(fcb);
+                } else
+                    wheel.move_after(fcb, _timeout[s->cls] - old, link);
+            };
+            if (mp)
+                wheel.run_linked_timers_mp(expire, link);
+            else
+                wheel.run_linked_timers(expire, link);
+        }
+
+        void add_handlers(Element* e) {
+            e->add_read_handler("flows", read_flows, this);
+            e->add_read_handler("expired", read_expired, this);
+        }
+
+    private:
+        struct Stats {
+            int64_t count[NCLASSES];
+            uint64_t expired[NCLASSES];
+            Stats() {
+                for (int i = 0; i < NCLASSES; i++)
+                    count[i] = expired[i] = 0;
+            }
+        };
+
+        int _timeout[NCLASSES];
+        per_thread<Stats> _stats;
+
+        static inline int tcp_class(Packet* p) {
+            const click_ip* ip = p->ip_header();
+            if (!IP_FIRSTFRAG(ip) || p->transport_length() < (int) sizeof(click_tcp))
+                return ESTABLISHED;
+            uint8_t flags = p->tcp_header()->th_flags;
+            if (flags & (TH_FIN | TH_RST))
+                return CLOSING;
+            if (flags & TH_SYN)
+                return SYN;
+            return ESTABLISHED;
+        }
+
+        static inline int classify(Packet* p) {
+            switch (p->ip_header()->ip_p) {
+            case IP_PROTO_TCP:
+                return tcp_class(p);
+            case IP_PROTO_UDP:
+                return UDP;
+            default:
+                return OTHER;
+            }
+        }
+
+        String unparse(bool expired) const {
+            static const char* const names[] = {"syn", "established", "closing", "udp", "other"};
+            StringAccum sa;
+            for (int c = 0; c < NCLASSES; c++) {
+                int64_t n = 0;
+                for (unsigned i = 0; i < _stats.weight(); i++)
+                    n += expired ? _stats.get_value(i).expired[c] : _stats.get_value(i).count[c];
+                sa << names[c] << ' ' << n << '\n';
+            }
+            return sa.take_string();
+        }
+
+        static String read_flows(Element*, void* thunk) {
+            return static_cast<FlowExpiry*>(thunk)->unparse(false);
+        }
+
+        static String read_expired(Element*, void* thunk) {
+            return static_cast<FlowExpiry*>(thunk)->unparse(true);
+        }
+};
+
+CLICK_ENDDECLS
+#endif
@@ -58,6 +58,10 @@ class LoadBalancer { public:
         return mode == pow2 || mode == least_load || mode == weighted_round_robin || mode == auto_weighted_round_robin || mode == table;
     }
 
+    static bool isFlowHashing(LBMode mode) {
+        return mode != round_robin && mode != weighted_round_robin && mode != auto_weighted_round_robin && mode != least_load && mode != pow2;
+    }
+
     // Metric to use when the LB technique is load-based
     enum LSTMode {
         connections,
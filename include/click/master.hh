@@ -3,6 +3,7 @@
 #define CLICK_MASTER_HH
 #include <click/router.hh>
 #include <click/atomic.hh>
+#include <click/qsbr.hh>
 #if CLICK_USERLEVEL
 # include <signal.h>
 #endif
@@ -32,6 +33,9 @@ class Master { public:
     inline RouterThread *thread(int id) const;
     void wake_somebody();
 
+    /** @brief Return the QSBR reclamation domain shared by the threads. */
+    QSBR &qsbr()                                { return _qsbr; }
+
 #if CLICK_USERLEVEL
     int add_signal_handler(int signo, Router *router, String handler);
     int remove_signal_handler(int signo, Router *router, String handler);
@@ -59,6 +63,7 @@ class Master { public:
     // THREADS
     RouterThread **_threads;
     int _nthreads;
+    QSBR _qsbr;
 
     // ROUTERS
     Router *_routers;
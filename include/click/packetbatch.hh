@@ -660,6 +660,17 @@ public :
 
     void fast_kill();
     void fast_kill_nonatomic();
+#elif HAVE_BATCH && CLICK_PACKET_USE_DPDK
+    inline void fast_kill() {
+        MbufBulkFree mbufs;
+        FOR_EACH_PACKET_SAFE(this,p) {
+            mbufs.add(p->mb());
+        }
+    }
+
+    void fast_kill_nonatomic() {
+        fast_kill();
+    }
 #else
     inline void fast_kill() {
         kill();
@@ -754,6 +765,16 @@ inline void PacketBatch::kill() {
 		last_data->set_next(0);\
 		PacketBatch::make_from_simple_list(head_data,last_data,n_data)->recycle_batch(true);\
 	}
+#elif HAVE_BATCH && CLICK_PACKET_USE_DPDK
+/* Packets are mbufs, free them by bursts */
+#define BATCH_RECYCLE_START() \
+	MbufBulkFree recycled_mbufs;
+
+#define BATCH_RECYCLE_PACKET(p) {recycled_mbufs.add(p->mb());}
+#define BATCH_RECYCLE_PACKET_NONATOMIC(p) {recycled_mbufs.add(p->mb());}
+
+#define BATCH_RECYCLE_END() \
+	recycled_mbufs.flush();
 #else
 #define BATCH_RECYCLE_START() {}
 #define BATCH_RECYCLE_END() {}
@@ -0,0 +1,122 @@
+// -*- c-basic-offset: 4; related-file-name: "../../lib/pathtrace.cc" -*-
+#ifndef CLICK_PATHTRACE_HH
+#define CLICK_PATHTRACE_HH
+#include <click/glue.hh>
+#include <click/vector.hh>
+CLICK_DECLS
+class Element;
+class Packet;
+class PacketBatch;
+class ErrorHandler;
+
+/** @file <click/pathtrace.hh>
+ * @brief Sampled per-packet path tracing.
+ */
+
+/** @class PathTrace
+ * @brief Records the element boundaries crossed by sampled packets.
+ *
+ * While tracing is active, every push and pull through an Element::Port
+ * checks the trace annotation of the packets it transfers. If it is not
+ * zero, a record (trace ID, element, port, direction, cycle counter) is
+ * appended to the buffer of the current thread. Buffers are rings written
+ * by a single thread, so recording takes no lock; the oldest records are
+ * overwritten when a ring is full.
+ *
+ * For a push, the record names the element and input port receiving the
+ * packet. For a pull, it names the element and output port the packet is
+ * pulled from. Packets handed to another thread, by a Pipeliner or a
+ * queue, are recorded by both threads, so the handoff delay shows as the
+ * difference of the two cycle counts. This assumes a constant and
+ * synchronized cycle counter, as found on current x86 CPUs.
+ *
+ * The PathTracer element samples packets and owns the buffers. When tracing
+ * is not active, each port transfer only tests a global boolean.
+ */
+class PathTrace { public:
+
+    enum { PUSH = 0, PULL = 1 };
+
+    struct Record {
+	click_cycles_t cycles;
+	const Element *element;
+	uint32_t id;
+	int16_t port;
+	uint8_t kind;
+	uint8_t thread;
+    };
+
+    /** @brief True while sampled packets are recorded. */
+    static bool active;
+
+    static inline void push(const Element *e, int port, const Packet *p);
+    static inline void pull(const Element *e, int port, const Packet *p);
+#if HAVE_BATCH
+    static inline void push_batch(const Element *e, int port, const PacketBatch *batch);
+    static inline void pull_batch(const Element *e, int port, const PacketBatch *batch);
+#endif
+
+    /** @brief Allocate per-thread buffers of @a capacity records, rounded up
+     * to a power of two, and read trace IDs from annotation @a anno. */
+    static int initialize(unsigned capacity, int anno, ErrorHandler *errh);
+    /** @brief Stop tracing and free the buffers. Threads must be stopped. */
+    static void cleanup();
+    /** @brief Forget all records. */
+    static void clear();
+
+    /** @brief Record trace ID @a id crossing port @a port of @a e. */
+    static void record(const Element *e, int port, int kind, uint32_t id);
+
+    /** @brief Return the number of records written since the last clear(),
+     * including overwritten ones. */
+    static uint64_t written();
+
+    /** @brief Return the records still in the buffers, sorted by trace ID
+     * and cycle counter. */
+    static void collect(Vector<Record> &records);
+
+    static int anno() { return _anno; }
+
+  private:
+
+    static int _anno;
+
+    static void record_packet(const Element *e, int port, int kind, const Packet *p);
+#if HAVE_BATCH
+    static void record_batch(const Element *e, int port, int kind, const PacketBatch *batch);
+#endif
+
+};
+
+inline void
+PathTrace::push(const Element *e, int port, const Packet *p)
+{
+    if (unlikely(active))
+	record_packet(e, port, PUSH, p);
+}
+
+inline void
+PathTrace::pull(const Element *e, int port, const Packet *p)
+{
+    if (unlikely(active) && p)
+	record_packet(e, port, PULL, p);
+}
+
+#if HAVE_BATCH
+inline void
+PathTrace::push_batch(const Element *e, int port, const PacketBatch *batch)
+{
+    if (unlikely(active))
+	record_batch(e, port, PUSH, batch);
+}
+
+inline void
+PathTrace::pull_batch(const Element *e, int port, const PacketBatch *batch)
+{
+    if (unlikely(active) && batch)
+	record_batch(e, port, PULL, batch);
+}
+#endif
+
+CLICK_ENDDECLS
+#endif
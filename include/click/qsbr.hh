@@ -0,0 +1,351 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_QSBR_HH
+#define CLICK_QSBR_HH
+#include <click/glue.hh>
+#include <click/sync.hh>
+#include <click/vector.hh>
+#include <click/machine.hh>
+CLICK_DECLS
+
+/** @file <click/qsbr.hh>
+ * @brief Quiescent-state-based memory reclamation.
+ */
+
+/** @class QSBR
+ * @brief A quiescent-state-based reclamation domain.
+ *
+ * QSBR lets elements replace nodes of large shared structures without
+ * locking readers. Readers take no lock and write no shared memory. Instead,
+ * each RouterThread reports a quiescent state between two iterations of its
+ * driver loop. At that point, no task run by the thread can still hold a
+ * reference to a node obtained during an earlier run.
+ *
+ * A writer first unlinks a node from the structure, so that new readers
+ * cannot find it. Then it passes the node to defer_free(), defer_delete() or
+ * call_after_grace_period(). The node is reclaimed after a grace period:
+ * once every running thread has reported a quiescent state.
+ *
+ * Threads blocked in the operating system, waiting for file descriptors or
+ * timers, are offline. They hold no references and do not delay grace
+ * periods.
+ *
+ * Reclamation is batched. All callbacks registered until the next
+ * quiescent state of any thread are sealed together and share a single
+ * grace period. The thread whose report completes the grace period runs
+ * the whole batch.
+ *
+ * There is one domain per Master, available through Master::qsbr() and
+ * Element::master()->qsbr(). Elements must not keep references to protected
+ * nodes in their state across task runs; they must look them up again at
+ * each run.
+ *
+ * @code
+ * Node *old = _table[i];
+ * _table[i] = new_node;
+ * master()->qsbr().defer_delete(old);
+ * @endcode
+ */
+class QSBR { public:
+
+    typedef void (*callback_type)(void *);
+
+    inline QSBR();
+    inline ~QSBR();
+
+    inline void initialize(int nthreads);
+
+    /** @brief Report a quiescent state for thread @a thread_id.
+     *
+     * Called by RouterThread between two iterations of its driver loop.
+     * Unless a grace period is in progress, it only reads three shared words
+     * that are rarely written. */
+    inline void quiescent(int thread_id);
+
+    /** @brief Mark thread @a thread_id as offline: it will not read protected
+     * structures until thread_online() is called. */
+    inline void thread_offline(int thread_id);
+    inline void thread_online(int thread_id);
+
+    /** @brief Call @a f(@a arg) after the next grace period. */
+    inline void call_after_grace_period(callback_type f, void *arg);
+
+    /** @brief Call delete on @a p after the next grace period. */
+    template <typename T> inline void defer_delete(T *p);
+#if CLICK_USERLEVEL
+    /** @brief Call free() on @a p after the next grace period. */
+    inline void defer_free(void *p);
+#endif
+
+    /** @brief Wait for a grace period.
+     *
+     * When it returns, all readers that could have found a node unlinked
+     * before the call are done with it. The calling thread must hold no
+     * reference to protected nodes. This busy-waits until all running
+     * threads report a quiescent state, so it is meant for the control
+     * path. */
+    inline void synchronize();
+
+    /** @brief Return the current grace period number. */
+    uint32_t epoch() const		{ return _epoch; }
+    /** @brief Return the number of grace periods completed. */
+    uint64_t grace_periods() const	{ return _grace_periods; }
+    /** @brief Return the number of callbacks not sealed in a batch yet. */
+    unsigned pending() const		{ return _npending; }
+    /** @brief Return the number of batches waiting for their grace period. */
+    unsigned batches() const		{ return _nwaiting; }
+
+    int nthreads() const		{ return _nthreads; }
+    /** @brief Return the number of grace periods acknowledged by thread
+     * @a thread_id, and the total cycles it took to acknowledge them. */
+    uint64_t thread_acks(int thread_id) const	{ return _threads[thread_id].acks; }
+    uint64_t thread_ack_cycles(int thread_id) const { return _threads[thread_id].ack_cycles; }
+    /** @brief Return the number of callbacks run by thread @a thread_id. */
+    uint64_t thread_reclaimed(int thread_id) const { return _threads[thread_id].reclaimed; }
+
+  private:
+
+    struct Callback {
+	callback_type f;
+	void *arg;
+    };
+
+    struct Batch {
+	uint32_t epoch;
+	Vector<Callback> callbacks;
+	Batch *next;
+    };
+
+    struct ThreadState {
+	volatile uint32_t ctr;
+	uint64_t acks;
+	uint64_t ack_cycles;
+	uint64_t reclaimed;
+    } CLICK_CACHE_ALIGN;
+
+    ThreadState *_threads;
+    int _nthreads;
+
+    volatile uint32_t _epoch;
+    volatile click_cycles_t _epoch_start;
+    volatile unsigned _npending;
+    volatile unsigned _nwaiting;
+    uint64_t _grace_periods;
+
+    Spinlock _lock;
+    Vector<Callback> _pending;
+    Batch *_head;
+    Batch *_tail;
+
+    inline void ack(ThreadState &t, uint32_t e);
+    inline void reclaim(int thread_id);
+    inline void seal();
+    inline bool elapsed(uint32_t e) const;
+    static inline void run(Vector<Callback> &cbs) {
+	for (Callback *c = cbs.begin(); c != cbs.end(); ++c)
+	    c->f(c->arg);
+    }
+
+    template <typename T> static void delete_callback(void *p) {
+	delete static_cast<T *>(p);
+    }
+#if CLICK_USERLEVEL
+    static void free_callback(void *p) {
+	::free(p);
+    }
+#endif
+
+    QSBR(const QSBR &);
+    QSBR &operator=(const QSBR &);
+
+};
+
+inline
+QSBR::QSBR()
+    : _threads(0), _nthreads(0), _epoch(1), _epoch_start(0), _npending(0),
+      _nwaiting(0), _grace_periods(0), _head(0), _tail(0)
+{
+}
+
+inline
+QSBR::~QSBR()
+{
+    // No thread runs anymore, everything can go
+    while (Batch *b = _head) {
+	_head = b->next;
+	run(b->callbacks);
+	delete b;
+    }
+    run(_pending);
+    delete[] _threads;
+}
+
+inline void
+QSBR::initialize(int nthreads)
+{
+    assert(!_threads);
+    _nthreads = nthreads;
+    _threads = new ThreadState[nthreads];
+    for (int i = 0; i < nthreads; i++) {
+	_threads[i].ctr = 0;
+	_threads[i].acks = _threads[i].ack_cycles = _threads[i].reclaimed = 0;
+    }
+}
+
+inline void
+QSBR::ack(ThreadState &t, uint32_t e)
+{
+    // Loads of protected nodes must not move after the report, nor the next
+    // ones before it
+    click_fence();
+    t.ctr = e;
+    click_fence();
+    t.acks++;
+    t.ack_cycles += click_get_cycles() - _epoch_start;
+}
+
+inline void
+QSBR::quiescent(int thread_id)
+{
+    ThreadState &t = _threads[thread_id];
+    uint32_t e = _epoch;
+    // A batch may still wait if the report that completed its grace period
+    // found the lock taken
+    if (likely(t.ctr == e) && likely(_npending == 0) && likely(_nwaiting == 0))
+	return;
+    if (t.ctr != e)
+	ack(t, e);
+    if (_npending || _nwaiting)
+	reclaim(thread_id);
+}
+
+inline void
+QSBR::thread_offline(int thread_id)
+{
+    click_fence();
+    _threads[thread_id].ctr = 0;
+    click_fence();
+    // We may have been the last thread the oldest batch waited for
+    if (_nwaiting)
+	reclaim(thread_id);
+}
+
+inline void
+QSBR::thread_online(int thread_id)
+{
+    _threads[thread_id].ctr = _epoch;
+    click_fence();
+}
+
+inline bool
+QSBR::elapsed(uint32_t e) const
+{
+    for (int i = 0; i < _nthreads; i++) {
+	uint32_t c = _threads[i].ctr;
+	if (c != 0 && (int32_t) (c - e) < 0)
+	    return false;
+    }
+    return true;
+}
+
+// Must be called with _lock held
+inline void
+QSBR::seal()
+{
+    Batch *b = new Batch;
+    b->callbacks.swap(_pending);
+    b->next = 0;
+    uint32_t e = _epoch + 1;
+    if (e == 0)
+	e = 1;
+    b->epoch = e;
+    if (_tail)
+	_tail->next = b;
+    else
+	_head = b;
+    _tail = b;
+    _nwaiting++;
+    _npending = 0;
+    _epoch_start = click_get_cycles();
+    click_write_fence();
+    _epoch = e;
+}
+
+inline void
+QSBR::reclaim(int thread_id)
+{
+    if (!_lock.attempt())
+	return;
+    if (_npending) {
+	seal();
+	// Our own report for the new epoch comes at the next iteration
+    }
+    Batch *done = 0, **done_tail = &done;
+    while (_head && elapsed(_head->epoch)) {
+	Batch *b = _head;
+	_head = b->next;
+	if (!_head)
+	    _tail = 0;
+	_nwaiting--;
+	_grace_periods++;
+	*done_tail = b;
+	done_tail = &b->next;
+    }
+    *done_tail = 0;
+    _lock.release();
+
+    while (Batch *b = done) {
+	done = b->next;
+	run(b->callbacks);
+	if (thread_id >= 0 && thread_id < _nthreads)
+	    _threads[thread_id].reclaimed += b->callbacks.size();
+	delete b;
+    }
+}
+
+inline void
+QSBR::call_after_grace_period(callback_type f, void *arg)
+{
+    Callback c = {f, arg};
+    // The node must be unlinked before we look at the reader states
+    click_fence();
+    _lock.acquire();
+    _pending.push_back(c);
+    _npending = _pending.size();
+    _lock.release();
+}
+
+template <typename T>
+inline void
+QSBR::defer_delete(T *p)
+{
+    call_after_grace_period(delete_callback<T>, p);
+}
+
+#if CLICK_USERLEVEL
+inline void
+QSBR::defer_free(void *p)
+{
+    call_after_grace_period(free_callback, p);
+}
+#endif
+
+inline void
+QSBR::synchronize()
+{
+    int id = click_current_cpu_id();
+    bool own = id >= 0 && id < _nthreads && _threads[id].ctr != 0;
+    _lock.acquire();
+    seal();
+    uint32_t e = _epoch;
+    _lock.release();
+
+    // The caller holds no reference: report for it
+    if (own)
+	ack(_threads[id], e);
+    while (!elapsed(e))
+	click_relax_fence();
+    reclaim(own ? id : -1);
+}
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,90 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_QUEUESCALING_HH
+#define CLICK_QUEUESCALING_HH
+#include <click/glue.hh>
+CLICK_DECLS
+
+/** @file <click/queuescaling.hh>
+ * @brief Decisions of the RX queue scaling of QueueScaler.
+ */
+
+/** @class QueueScalingPolicy
+ * @brief Chooses the number of active RX queues from the measured load.
+ *
+ * The load is the share of polling cycles that returned packets. One queue
+ * is added when the load is above HIGH, and one is removed when it is below
+ * LOW and would stay below HIGH with one queue less.
+ */
+class QueueScalingPolicy { public:
+
+    QueueScalingPolicy(double high = 0.8, double low = 0.3)
+	: _high(high), _low(low), _last_busy(0), _last_idle(0), _load(0) {
+    }
+
+    double high() const		{ return _high; }
+    double low() const		{ return _low; }
+    double load() const		{ return _load; }
+
+    /** @brief Start measuring from the cycle counters @a busy and @a idle. */
+    void reset(uint64_t busy, uint64_t idle) {
+	_last_busy = busy;
+	_last_idle = idle;
+    }
+
+    /** @brief Measure the load since the last call from the cycle counters
+     * @a busy and @a idle.
+     * @return false if no cycle was spent polling, so the load is unknown */
+    bool update(uint64_t busy, uint64_t idle) {
+	// The counters go back to 0 when they are reset
+	if (busy < _last_busy || idle < _last_idle)
+	    _last_busy = _last_idle = 0;
+	uint64_t dbusy = busy - _last_busy, didle = idle - _last_idle;
+	_last_busy = busy;
+	_last_idle = idle;
+	if (dbusy + didle == 0)
+	    return false;
+	_load = (double) dbusy / (double) (dbusy + didle);
+	return true;
+    }
+
+    /** @brief Return the number of queues to use, with @a n queues active
+     * and at least @a min and at most @a max queues. */
+    int decide(int n, int min, int max) const {
+	if (_load > _high && n < max)
+	    return n + 1;
+	if (_load < _low && n > min && _load * n / (n - 1) < _high)
+	    return n - 1;
+	return n;
+    }
+
+    /** @brief Spread the entries of the RSS redirection table @a reta, of
+     * @a size entries, that point to queues [@a first, @a first + @a count),
+     * over queues [@a first, @a first + @a n). Entries pointing to other
+     * queues are left alone, as they may belong to another element.
+     * @return the number of entries changed */
+    static unsigned retarget(uint16_t *reta, unsigned size, int first, int count, int n) {
+	unsigned changed = 0, k = 0;
+	for (unsigned i = 0; i < size; i++) {
+	    if (reta[i] < first || reta[i] >= first + count)
+		continue;
+	    uint16_t q = first + k++ % n;
+	    if (reta[i] != q) {
+		reta[i] = q;
+		changed++;
+	    }
+	}
+	return changed;
+    }
+
+  private:
+
+    double _high;
+    double _low;
+    uint64_t _last_busy;
+    uint64_t _last_idle;
+    double _load;
+
+};
+
+CLICK_ENDDECLS
+#endif
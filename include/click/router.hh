@@ -374,6 +374,10 @@ class Router { public:
 
     int hard_home_thread_id(const Element *e) const;
 
+#if HAVE_BATCH
+    void fuse_chains();
+#endif
+
     int element_lerror(ErrorHandler*, Element*, const char*, ...) const;
 
     // private handler methods
@@ -0,0 +1,294 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_SIMD_HH
+#define CLICK_SIMD_HH
+#include <click/glue.hh>
+#include <clicknet/ether.h>
+#if CLICK_USERLEVEL && defined(__x86_64__) && defined(__GNUC__) && !defined(CLICK_TOOL)
+# define CLICK_SIMD 1
+# include <immintrin.h>
+#endif
+CLICK_DECLS
+
+/** @file <click/simd.hh>
+ * @brief Vector kernels working on several packet headers at once.
+ *
+ * The IP kernels take an array of up to CLICK_SIMD_LANES header pointers,
+ * one per packet, and process all headers together: header words are
+ * gathered in vector registers so the arithmetic is done once for all lanes.
+ * The Ethernet kernel works on one frame at a time, as it has no arithmetic
+ * to share.
+ *
+ * Both an SSE2 and an AVX2 version are built, whatever the compiler flags.
+ * The AVX2 one is chosen at runtime if the CPU supports it, see
+ * click_simd_level(). CLICK_SIMD is not defined on other architectures and
+ * in the kernel; elements must then use their scalar code.
+ *
+ * The kernels do not check lengths nor sharing. Callers only give headers
+ * of unique packets which have enough data, and handle the other packets
+ * with their scalar path.
+ */
+
+#define CLICK_SIMD_LANES 8
+
+enum { CLICK_SIMD_SCALAR = 0, CLICK_SIMD_SSE2, CLICK_SIMD_AVX2 };
+
+/** @brief Return the best instruction set usable by the vector kernels. */
+inline int
+click_simd_level()
+{
+#if CLICK_SIMD
+# ifdef __AVX2__
+    return CLICK_SIMD_AVX2;
+# else
+    static int level = -1;
+    if (unlikely(level < 0)) {
+	__builtin_cpu_init();
+	level = __builtin_cpu_supports("avx2") ? CLICK_SIMD_AVX2 : CLICK_SIMD_SSE2;
+    }
+    return level;
+# endif
+#else
+    return CLICK_SIMD_SCALAR;
+#endif
+}
+
+#if CLICK_SIMD
+# define CLICK_SIMD_AVX2_FUNCTION __attribute__((target("avx2")))
+
+inline uint32_t
+click_simd_load32(const unsigned char *p)
+{
+    uint32_t x;
+    memcpy(&x, p, 4);
+    return x;
+}
+
+inline __m128i
+click_simd_gather4_sse2(const unsigned char *const *h, int offset)
+{
+    return _mm_set_epi32(click_simd_load32(h[3] + offset), click_simd_load32(h[2] + offset),
+			 click_simd_load32(h[1] + offset), click_simd_load32(h[0] + offset));
+}
+
+/* Add the two halfwords of each 32-bit lane. Header words are kept in
+ * network byte order: the one's complement sum does not depend on it. */
+inline __m128i
+click_simd_halves_sse2(__m128i d)
+{
+    return _mm_add_epi32(_mm_and_si128(d, _mm_set1_epi32(0xFFFF)), _mm_srli_epi32(d, 16));
+}
+
+inline __m128i
+click_simd_fold_sse2(__m128i s)
+{
+    return click_simd_halves_sse2(click_simd_halves_sse2(s));
+}
+
+/* Sum of the halfwords of a 20-byte header, not folded yet */
+inline __m128i
+click_simd_ip_sum4_sse2(const unsigned char *const *h, __m128i &d0)
+{
+    d0 = click_simd_gather4_sse2(h, 0);
+    __m128i d2 = click_simd_gather4_sse2(h, 8);
+    __m128i s = _mm_add_epi32(click_simd_halves_sse2(d0), _mm_and_si128(d2, _mm_set1_epi32(0xFFFF)));
+    s = _mm_add_epi32(s, click_simd_halves_sse2(click_simd_gather4_sse2(h, 4)));
+    s = _mm_add_epi32(s, click_simd_halves_sse2(click_simd_gather4_sse2(h, 12)));
+    s = _mm_add_epi32(s, click_simd_halves_sse2(click_simd_gather4_sse2(h, 16)));
+    return _mm_add_epi32(s, _mm_srli_epi32(d2, 16));
+}
+
+inline unsigned
+click_simd_ip_check4_sse2(const unsigned char *const *h)
+{
+    __m128i d0;
+    __m128i s = click_simd_fold_sse2(click_simd_ip_sum4_sse2(h, d0));
+    __m128i ok = _mm_and_si128(_mm_cmpeq_epi32(s, _mm_set1_epi32(0xFFFF)),
+			       _mm_cmpeq_epi32(_mm_and_si128(d0, _mm_set1_epi32(0xFF)),
+					       _mm_set1_epi32(0x45)));
+    return _mm_movemask_ps(_mm_castsi128_ps(ok));
+}
+
+CLICK_SIMD_AVX2_FUNCTION inline __m256i
+click_simd_halves_avx2(__m256i d)
+{
+    return _mm256_add_epi32(_mm256_and_si256(d, _mm256_set1_epi32(0xFFFF)), _mm256_srli_epi32(d, 16));
+}
+
+/* Gather one 32-bit word at @a offset from each of the 8 headers. Plain
+ * loads are used rather than the AVX2 gather instructions, which are slower
+ * for so few elements on most CPUs. */
+CLICK_SIMD_AVX2_FUNCTION inline __m256i
+click_simd_gather8_avx2(const unsigned char *const *h, int offset)
+{
+    return _mm256_set_epi32(click_simd_load32(h[7] + offset), click_simd_load32(h[6] + offset),
+			    click_simd_load32(h[5] + offset), click_simd_load32(h[4] + offset),
+			    click_simd_load32(h[3] + offset), click_simd_load32(h[2] + offset),
+			    click_simd_load32(h[1] + offset), click_simd_load32(h[0] + offset));
+}
+
+CLICK_SIMD_AVX2_FUNCTION inline __m256i
+click_simd_ip_sum8_avx2(const unsigned char *const *h, __m256i &d0)
+{
+    d0 = click_simd_gather8_avx2(h, 0);
+    __m256i d2 = click_simd_gather8_avx2(h, 8);
+    __m256i s = _mm256_add_epi32(click_simd_halves_avx2(d0), _mm256_and_si256(d2, _mm256_set1_epi32(0xFFFF)));
+    s = _mm256_add_epi32(s, click_simd_halves_avx2(click_simd_gather8_avx2(h, 4)));
+    s = _mm256_add_epi32(s, click_simd_halves_avx2(click_simd_gather8_avx2(h, 12)));
+    s = _mm256_add_epi32(s, click_simd_halves_avx2(click_simd_gather8_avx2(h, 16)));
+    return _mm256_add_epi32(s, _mm256_srli_epi32(d2, 16));
+}
+
+CLICK_SIMD_AVX2_FUNCTION inline __m256i
+click_simd_fold_avx2(__m256i s)
+{
+    return click_simd_halves_avx2(click_simd_halves_avx2(s));
+}
+
+CLICK_SIMD_AVX2_FUNCTION inline unsigned
+click_simd_ip_check8_avx2(const unsigned char *const *h)
+{
+    __m256i d0;
+    __m256i s = click_simd_fold_avx2(click_simd_ip_sum8_avx2(h, d0));
+    __m256i ok = _mm256_and_si256(_mm256_cmpeq_epi32(s, _mm256_set1_epi32(0xFFFF)),
+				  _mm256_cmpeq_epi32(_mm256_and_si256(d0, _mm256_set1_epi32(0xFF)),
+						     _mm256_set1_epi32(0x45)));
+    return _mm256_movemask_ps(_mm256_castsi256_ps(ok));
+}
+
+CLICK_SIMD_AVX2_FUNCTION inline void
+click_simd_ip_set_checksum8_avx2(unsigned char *const *h, uint32_t *sum)
+{
+    __m256i d0;
+    __m256i s = click_simd_fold_avx2(click_simd_ip_sum8_avx2(h, d0));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(sum), _mm256_xor_si256(s, _mm256_set1_epi32(0xFFFF)));
+}
+
+/* TTL decrement on the third header word: the TTL is its first byte and the
+ * checksum its upper halfword. In network byte order the TTL halfword
+ * decreases by 0x0100 (RFC 1624); on the little-endian word loaded here this
+ * is a decrease by 1, so the checksum update adds ~0x0001. There is no AVX2
+ * version: the kernel is bound by the loads and stores, not the arithmetic. */
+inline unsigned
+click_simd_ip_dec_ttl4_sse2(unsigned char *const *h, uint32_t *word)
+{
+    __m128i d = click_simd_gather4_sse2(h, 8);
+    const __m128i lo = _mm_set1_epi32(0xFFFF);
+    __m128i live = _mm_cmpgt_epi32(_mm_and_si128(d, _mm_set1_epi32(0xFF)), _mm_set1_epi32(1));
+    __m128i s = _mm_add_epi32(_mm_xor_si128(_mm_srli_epi32(d, 16), lo), _mm_set1_epi32(0xFFFE));
+    s = click_simd_halves_sse2(s);
+    __m128i nd = _mm_or_si128(_mm_and_si128(_mm_sub_epi32(d, _mm_set1_epi32(1)), lo),
+			      _mm_slli_epi32(_mm_xor_si128(s, lo), 16));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(word), nd);
+    return _mm_movemask_ps(_mm_castsi128_ps(live));
+}
+
+/* Pad the header array to a full vector by repeating the first header */
+template <typename T>
+inline void
+click_simd_pad(T *const *h, int n, T **l)
+{
+    for (int i = 0; i < CLICK_SIMD_LANES; i++)
+	l[i] = h[i < n ? i : 0];
+}
+
+/** @brief Validate up to 8 IPv4 headers.
+ * @param h header pointers, each with at least 20 bytes of data
+ * @param n number of headers, 1 to CLICK_SIMD_LANES
+ * @return bitmask of the headers which have version 4, a header length of
+ * 20 bytes and a correct checksum
+ *
+ * Headers which are not set in the result may still be valid, for instance
+ * if they have IP options; they must be checked by the scalar code. */
+inline unsigned
+click_simd_ip_check(const unsigned char *const *h, int n)
+{
+    const unsigned char *l[CLICK_SIMD_LANES];
+    click_simd_pad(h, n, l);
+    unsigned m;
+    if (click_simd_level() == CLICK_SIMD_AVX2)
+	m = click_simd_ip_check8_avx2(l);
+    else {
+	m = click_simd_ip_check4_sse2(l);
+	if (n > 4)
+	    m |= click_simd_ip_check4_sse2(l + 4) << 4;
+    }
+    return m & ((1U << n) - 1);
+}
+
+/** @brief Set the checksum of up to 8 IPv4 headers without options.
+ * @param h header pointers, each with a 20-byte header
+ * @param n number of headers, 1 to CLICK_SIMD_LANES */
+inline void
+click_simd_ip_set_checksum(unsigned char *const *h, int n)
+{
+    unsigned char *l[CLICK_SIMD_LANES];
+    uint32_t sum[CLICK_SIMD_LANES];
+    for (int i = 0; i < n; i++)
+	memset(h[i] + 10, 0, 2);
+    click_simd_pad(h, n, l);
+    if (click_simd_level() == CLICK_SIMD_AVX2)
+	click_simd_ip_set_checksum8_avx2(l, sum);
+    else
+	for (int i = 0; i < n; i += 4) {
+	    __m128i d0;
+	    __m128i s = click_simd_fold_sse2(click_simd_ip_sum4_sse2(l + i, d0));
+	    _mm_storeu_si128(reinterpret_cast<__m128i *>(sum + i), _mm_xor_si128(s, _mm_set1_epi32(0xFFFF)));
+	}
+    for (int i = 0; i < n; i++) {
+	uint16_t s = sum[i];
+	memcpy(h[i] + 10, &s, 2);
+    }
+}
+
+/** @brief Decrement the TTL of up to 8 IPv4 headers.
+ * @param h header pointers, each with at least 20 bytes of data
+ * @param n number of headers, 1 to CLICK_SIMD_LANES
+ * @return bitmask of the headers which had a TTL greater than 1
+ *
+ * Only the headers set in the result are modified: their TTL is decremented
+ * and their checksum incrementally updated. */
+inline unsigned
+click_simd_ip_dec_ttl(unsigned char *const *h, int n)
+{
+    unsigned char *l[CLICK_SIMD_LANES];
+    uint32_t word[CLICK_SIMD_LANES];
+    click_simd_pad(h, n, l);
+    unsigned m = click_simd_ip_dec_ttl4_sse2(l, word);
+    if (n > 4)
+	m |= click_simd_ip_dec_ttl4_sse2(l + 4, word + 4) << 4;
+    m &= (1U << n) - 1;
+    for (int i = 0; i < n; i++)
+	if (m & (1U << i))
+	    memcpy(h[i] + 8, &word[i], 4);
+    return m;
+}
+
+/** @brief Return the vector used by click_simd_ether_rewrite() to write
+ * the destination and source addresses of @a ethh. */
+inline __m128i
+click_simd_ether_addresses(const click_ether *ethh)
+{
+    unsigned char t[16];
+    memcpy(t, ethh, 12);
+    memset(t + 12, 0, 4);
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(t));
+}
+
+/** @brief Rewrite the Ethernet addresses of a frame.
+ * @param h MAC header, with at least 16 bytes of buffer
+ * @param addrs addresses from click_simd_ether_addresses()
+ *
+ * The frame is updated with one 16-byte load and one 16-byte store; the
+ * Ethernet type and the next two bytes are written back unchanged. */
+inline void
+click_simd_ether_rewrite(unsigned char *h, __m128i addrs)
+{
+    const __m128i mask = _mm_set_epi32(0, -1, -1, -1);
+    __m128i *x = reinterpret_cast<__m128i *>(h);
+    _mm_storeu_si128(x, _mm_or_si128(addrs, _mm_andnot_si128(mask, _mm_loadu_si128(x))));
+}
+
+#endif
+
+CLICK_ENDDECLS
+#endif
@@ -240,6 +240,14 @@ public:
 
     static int iterateOptions(Packet *packet, std::function<bool(uint8_t,void*)> fnt);
 
+    /**
+     * @brief Find the timestamp option of a TCP packet
+     * @param packet The packet
+     * @return A pointer to the kind byte of the option, or 0 if the packet
+     * has none
+     */
+    inline static uint8_t* getTimestampOption(Packet* packet);
+
 };
 
 inline tcp_seq_t
@@ -405,6 +413,34 @@ inline uint16_t TCPHelper::getDestinationPort(Packet* packet) const
     return ntohs(tcph->th_dport);
 }
 
+inline uint8_t* TCPHelper::getTimestampOption(Packet* packet)
+{
+    uint8_t* opt = const_cast<uint8_t*>((const uint8_t*) (packet->tcp_header() + 1));
+    const uint8_t* end = (const uint8_t*) packet->tcp_header() + (packet->tcp_header()->th_off << 2);
+
+    if (end > packet->end_data())
+        end = packet->end_data();
+
+    // Most stacks send NOP, NOP, timestamp first
+    if (opt + 12 <= end && opt[0] == TCPOPT_NOP && opt[1] == TCPOPT_NOP
+        && opt[2] == TCPOPT_TIMESTAMP && opt[3] == TCPOLEN_TIMESTAMP)
+        return opt + 2;
+
+    while (opt < end) {
+        if (opt[0] == TCPOPT_EOL)
+            break;
+        else if (opt[0] == TCPOPT_NOP)
+            opt++;
+        else if (opt + 1 >= end || opt[1] < 2 || opt + opt[1] > end)
+            break;
+        else if (opt[0] == TCPOPT_TIMESTAMP && opt[1] == TCPOLEN_TIMESTAMP)
+            return opt;
+        else
+            opt += opt[1];
+    }
+    return 0;
+}
+
 inline bool TCPHelper::isTCP(Packet* packet)
 {
     return packet->ip_header()->ip_p == IP_PROTO_TCP;
@@ -5,6 +5,18 @@
 
 CLICK_DECLS
 
+/**
+ * Links of an object that can be moved to another bucket of a TimerWheel,
+ * or removed from it, before it expires. pprev points to the pointer to the
+ * object, in its bucket or in the previous object; it is 0 when the object
+ * is not scheduled.
+ */
+template <typename T>
+struct TimerWheelLink {
+    T* next;
+    T** pprev;
+};
+
 template <typename T>
 class TimerWheel {
     public:
@@ -17,6 +29,14 @@ class TimerWheel {
             _buckets.resize(max);
         }
 
+        /**
+         * Forget all scheduled objects, without calling anything on them.
+         */
+        void clear() {
+            for (int i = 0; i < _buckets.size(); i++)
+                _buckets.unchecked_at(i) = 0;
+        }
+
         inline void schedule_after(T* obj, uint32_t timeout, const std::function<void(T*,T*)> setter) {
             unsigned id = ((*(volatile uint32_t*)&_index) + timeout) & _mask;
             T* f = _buckets.unchecked_at(id);
@@ -49,7 +69,81 @@ class TimerWheel {
             _index++;
         }
 
+        /**
+         * Schedule OBJ after TIMEOUT ticks, removing it first from the bucket
+         * it is in, if any. LINK(obj) must return the TimerWheelLink of obj,
+         * which must be zeroed before the first call.
+         */
+        template <typename L>
+        inline void move_after(T* obj, uint32_t timeout, L link) {
+            TimerWheelLink<T>* l = link(obj);
+            if (l->pprev)
+                unlink(l, link);
+            T** head = &_buckets.unchecked_at(((*(volatile uint32_t*)&_index) + timeout) & _mask);
+            l->next = *head;
+            if (l->next)
+                link(l->next)->pprev = &l->next;
+            l->pprev = head;
+            *head = obj;
+        }
+
+        template <typename L>
+        inline void move_after_mp(T* obj, uint32_t timeout, L link) {
+            _writers_lock.acquire();
+            move_after(obj, timeout, link);
+            _writers_lock.release();
+        }
+
+        /**
+         * Same as move_after_mp(), but leaves OBJ alone if it is not
+         * scheduled anymore, eg. because another thread expired it.
+         * @return whether OBJ was moved
+         */
+        template <typename L>
+        inline bool move_after_if_scheduled_mp(T* obj, uint32_t timeout, L link) {
+            _writers_lock.acquire();
+            bool scheduled = link(obj)->pprev != 0;
+            if (scheduled)
+                move_after(obj, timeout, link);
+            _writers_lock.release();
+            return scheduled;
+        }
+
+        /**
+         * Expire the objects scheduled with move_after() for the current
+         * tick. EXPIRE is called on each object after it is removed from the
+         * wheel, and may schedule it again, at least one tick later. Must be
+         * called by one thread only!
+         */
+        template <typename L>
+        inline void run_linked_timers(std::function<void(T*)> expire, L link) {
+            T** head = &_buckets.unchecked_at(_index & _mask);
+            _index++;
+            while (T* f = *head) {
+                unlink(link(f), link);
+                expire(f);
+            }
+        }
+
+        /**
+         * Same as run_linked_timers(), when other threads use move_after_mp().
+         */
+        template <typename L>
+        inline void run_linked_timers_mp(std::function<void(T*)> expire, L link) {
+            _writers_lock.acquire();
+            run_linked_timers(expire, link);
+            _writers_lock.release();
+        }
+
     private:
+        template <typename L>
+        static inline void unlink(TimerWheelLink<T>* l, L link) {
+            *l->pprev = l->next;
+            if (l->next)
+                link(l->next)->pprev = l->pprev;
+            l->pprev = 0;
+        }
+
         uint32_t _mask;
         uint32_t _index;
         Vector<T*> _buckets;
@@ -0,0 +1,36 @@
+#ifndef CLICKNET_VXLAN_H
+#define CLICKNET_VXLAN_H
+
+/*
+ * <clicknet/vxlan.h> -- VXLAN and Geneve header definitions
+ *
+ * Relevant RFCs include:
+ *   RFC7348	Virtual eXtensible Local Area Network (VXLAN)
+ *   RFC8926	Geneve: Generic Network Virtualization Encapsulation
+ */
+
+struct click_vxlan {
+    uint8_t	vx_flags;		/* 0     flags			     */
+#define VXLAN_FLAG_I		0x08	/*         VNI is valid		     */
+    uint8_t	vx_reserved1[3];	/* 1-3   reserved		     */
+    uint32_t	vx_vni;			/* 4-7   VNI (high 24 bits)	     */
+};
+
+#define VXLAN_PORT		4789
+
+struct click_geneve {
+    uint8_t	gn_ver_optlen;		/* 0     version (2 bits), options
+					         length in 4-byte words	     */
+#define GENEVE_VERSION(g)	((g)->gn_ver_optlen >> 6)
+#define GENEVE_OPTLEN(g)	(((g)->gn_ver_optlen & 0x3F) << 2)
+    uint8_t	gn_flags;		/* 1     flags			     */
+#define GENEVE_FLAG_O		0x80	/*         control packet	     */
+#define GENEVE_FLAG_C		0x40	/*         critical options	     */
+    uint16_t	gn_proto;		/* 2-3   inner protocol type	     */
+    uint32_t	gn_vni;			/* 4-7   VNI (high 24 bits)	     */
+};
+
+#define GENEVE_PORT		6081
+#define GENEVE_PROTO_ETHER	0x6558	/* transparent Ethernet bridging   */
+
+#endif
@@ -1,9 +1,358 @@
+// -*- related-file-name: "../include/click/allocator.hh" -*-
+/*
+ * allocator.cc -- pool and slab allocators
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
 #include <click/config.h>
 #include <click/allocator.hh>
+#include <click/straccum.hh>
+#include <click/vector.hh>
+#if CLICK_USERLEVEL
+# include <sys/mman.h>
+# if HAVE_NUMA
+extern "C" {
+#  include <numa.h>
+}
+# endif
+# if HAVE_DPDK
+#  include <rte_lcore.h>
+#  include <rte_memzone.h>
+# endif
+#endif
 
 CLICK_DECLS
 
 bool pool_allocator_mt_base::_dying = false;
 int pool_allocator_mt_base::_n_msg = 0;
 
+#if CLICK_USERLEVEL
+
+struct SlabAllocator::Arena {
+    Spinlock lock;
+    void *free;
+    unsigned nfree;
+    char *pos;
+    char *end;
+    Chunk *chunks;
+    unsigned nchunks;
+    unsigned capacity;
+
+    Arena()
+        : free(0), nfree(0), pos(0), end(0), chunks(0), nchunks(0),
+          capacity(0) {
+    }
+} CLICK_CACHE_ALIGN;
+
+SlabAllocator::ThreadCache *SlabAllocator::_caches[CLICK_CPU_MAX];
+SlabAllocator::Arena *SlabAllocator::_arenas = 0;
+int SlabAllocator::_nnodes = 1;
+Spinlock SlabAllocator::_lock;
+
+#if HAVE_DPDK
+// Memzones given by allocate_large(), to find them back when freed
+static Vector<const struct rte_memzone *> slab_large_zones;
+static atomic_uint32_t slab_zone_id;
+#endif
+
+void
+SlabAllocator::initialize()
+{
+    _lock.acquire();
+    if (!_arenas) {
+        int n = 1;
+#if HAVE_NUMA
+        if (numa_available() >= 0)
+            n = numa_max_node() + 1;
+#endif
+        Arena *a = new Arena[n * nclasses];
+        _nnodes = n;
+        click_write_fence();
+        _arenas = a;
+    }
+    _lock.release();
+}
+
+int
+SlabAllocator::thread_node(int thread_id)
+{
+    if (!_arenas)
+        initialize();
+    int node = 0;
+#if HAVE_DPDK
+    if (dpdk_enabled && thread_id >= 0 && thread_id < RTE_MAX_LCORE)
+        node = rte_lcore_to_socket_id(thread_id);
+    else
+#endif
+#if HAVE_NUMA
+    if (numa_available() >= 0)
+        node = numa_node_of_cpu(thread_id);
+#endif
+    if (node < 0 || node >= _nnodes)
+        node = 0;
+    return node;
+}
+
+inline SlabAllocator::Arena &
+SlabAllocator::arena(int node, int sclass)
+{
+    return _arenas[node * nclasses + sclass];
+}
+
+SlabAllocator::ThreadCache *
+SlabAllocator::cache()
+{
+    unsigned id = click_current_cpu_id();
+    if (id >= CLICK_CPU_MAX)
+        return 0;
+    if (!_caches[id]) {
+        ThreadCache *tc = new ThreadCache;
+        tc->node = thread_node(id);
+        for (int c = 0; c < nclasses; c++)
+            tc->local[c].count = 0;
+        tc->remote = new Magazine *[_nnodes * nclasses];
+        for (int i = 0; i < _nnodes * nclasses; i++)
+            tc->remote[i] = 0;
+        _caches[id] = tc;
+    }
+    return _caches[id];
+}
+
+bool
+SlabAllocator::map(size_t size, int node, void **mem, const void **zone)
+{
+    *zone = 0;
+#if HAVE_DPDK
+    if (dpdk_enabled) {
+        char name[RTE_MEMZONE_NAMESIZE];
+        snprintf(name, sizeof(name), "click_slab_%u", slab_zone_id.fetch_and_add(1));
+        const struct rte_memzone *mz = rte_memzone_reserve_aligned(name, size, node, RTE_MEMZONE_2MB | RTE_MEMZONE_SIZE_HINT_ONLY, chunk_size);
+        if (mz) {
+            *mem = mz->addr;
+            *zone = mz;
+            return true;
+        }
+    }
+#endif
+    void *p = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB;
+# ifdef MAP_HUGE_SHIFT
+    flags |= chunk_shift << MAP_HUGE_SHIFT;
+# endif
+    p = mmap(0, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+#endif
+    if (p == MAP_FAILED) {
+        // No hugepage reserved: align a regular mapping ourselves and ask
+        // for transparent hugepages
+        char *q = (char *) mmap(0, size + chunk_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (q == (char *) MAP_FAILED)
+            return false;
+        char *a = (char *) (((uintptr_t) q + chunk_size - 1) & ~(uintptr_t) (chunk_size - 1));
+        if (a > q)
+            munmap(q, a - q);
+        if (q + chunk_size > a)
+            munmap(a + size, q + chunk_size - a);
+        p = a;
+#ifdef MADV_HUGEPAGE
+        madvise(p, size, MADV_HUGEPAGE);
+#endif
+    }
+#if HAVE_NUMA
+    if (_nnodes > 1)
+        numa_tonode_memory(p, size, node);
+#endif
+    *mem = p;
+    return true;
+}
+
+// Must be called with the arena lock held
+void *
+SlabAllocator::arena_get(Arena &a, int node, int sclass)
+{
+    if (void *p = a.free) {
+        a.free = *reinterpret_cast<void **>(p);
+        a.nfree--;
+        return p;
+    }
+    size_t size = class_size(sclass);
+    if (a.pos + size > a.end) {
+        void *mem;
+        const void *zone;
+        if (!map(chunk_size, node, &mem, &zone))
+            return 0;
+        Chunk *ch = reinterpret_cast<Chunk *>(mem);
+        ch->node = node;
+        ch->sclass = sclass;
+        ch->next = a.chunks;
+        ch->zone = zone;
+        a.chunks = ch;
+        a.nchunks++;
+        a.capacity += (chunk_size - header_size) / size;
+        a.pos = reinterpret_cast<char *>(mem) + header_size;
+        a.end = reinterpret_cast<char *>(mem) + chunk_size;
+    }
+    void *p = a.pos;
+    a.pos += size;
+    return p;
+}
+
+void
+SlabAllocator::flush(Magazine &m, unsigned n, int node, int sclass)
+{
+    if (n > m.count)
+        n = m.count;
+    if (!n)
+        return;
+    Arena &a = arena(node, sclass);
+    a.lock.acquire();
+    for (unsigned i = m.count - n; i < m.count; i++) {
+        *reinterpret_cast<void **>(m.objs[i]) = a.free;
+        a.free = m.objs[i];
+    }
+    a.nfree += n;
+    a.lock.release();
+    m.count -= n;
+}
+
+void *
+SlabAllocator::refill(int sclass)
+{
+    ThreadCache *tc = cache();
+    int node = tc ? tc->node : current_node();
+    Arena &a = arena(node, sclass);
+    a.lock.acquire();
+    void *p = arena_get(a, node, sclass);
+    if (p && tc) {
+        // Take half a magazine at once, so alternate allocations and frees
+        // do not hit the arena every time
+        Magazine &m = tc->local[sclass];
+        while (m.count < magazine_size / 2) {
+            void *q = arena_get(a, node, sclass);
+            if (!q)
+                break;
+            m.objs[m.count++] = q;
+        }
+    }
+    a.lock.release();
+    return p;
+}
+
+void
+SlabAllocator::release(void *p, int sclass)
+{
+    int node = chunk_of(p)->node;
+    ThreadCache *tc = cache();
+    if (!tc) {
+        Arena &a = arena(node, sclass);
+        a.lock.acquire();
+        *reinterpret_cast<void **>(p) = a.free;
+        a.free = p;
+        a.nfree++;
+        a.lock.release();
+        return;
+    }
+
+    Magazine *m;
+    if (node == tc->node) {
+        m = &tc->local[sclass];
+        if (m->count == magazine_size)
+            flush(*m, magazine_size / 2, node, sclass);
+    } else {
+        // Remote frees go back to their home node in bulk
+        Magazine *&r = tc->remote[node * nclasses + sclass];
+        if (!r) {
+            r = new Magazine;
+            r->count = 0;
+        }
+        m = r;
+        if (m->count == magazine_size)
+            flush(*m, magazine_size, node, sclass);
+    }
+    m->objs[m->count++] = p;
+}
+
+void *
+SlabAllocator::allocate_large(size_t size, int node)
+{
+    if (!_arenas)
+        initialize();
+    if (node < 0 || node >= _nnodes)
+        node = current_node();
+    size = (size + chunk_size - 1) & ~(size_t) (chunk_size - 1);
+    void *mem;
+    const void *zone;
+    if (!map(size, node, &mem, &zone))
+        return 0;
+#if HAVE_DPDK
+    if (zone) {
+        _lock.acquire();
+        slab_large_zones.push_back(static_cast<const struct rte_memzone *>(zone));
+        _lock.release();
+    }
+#endif
+    return mem;
+}
+
+void
+SlabAllocator::deallocate_large(void *p, size_t size)
+{
+    if (!p)
+        return;
+#if HAVE_DPDK
+    _lock.acquire();
+    for (int i = 0; i < slab_large_zones.size(); i++)
+        if (slab_large_zones[i]->addr == p) {
+            const struct rte_memzone *mz = slab_large_zones[i];
+            slab_large_zones[i] = slab_large_zones.back();
+            slab_large_zones.pop_back();
+            _lock.release();
+            rte_memzone_free(mz);
+            return;
+        }
+    _lock.release();
+#endif
+    size = (size + chunk_size - 1) & ~(size_t) (chunk_size - 1);
+    munmap(p, size);
+}
+
+String
+SlabAllocator::occupancy()
+{
+    if (!_arenas)
+        return String();
+    StringAccum sa;
+    for (int node = 0; node < _nnodes; node++)
+        for (int c = 0; c < nclasses; c++) {
+            Arena &a = arena(node, c);
+            if (!a.nchunks)
+                continue;
+            // Read without locks: the numbers may be slightly off
+            unsigned cached = 0;
+            for (int id = 0; id < CLICK_CPU_MAX; id++)
+                if (ThreadCache *tc = _caches[id]) {
+                    if (tc->node == node)
+                        cached += tc->local[c].count;
+                    if (Magazine *r = tc->remote[node * nclasses + c])
+                        cached += r->count;
+                }
+            unsigned free = a.nfree + (a.end - a.pos) / class_size(c);
+            sa << node << ' ' << class_size(c) << ' ' << a.nchunks << ' '
+               << a.capacity << ' ' << free << ' ' << cached << ' '
+               << (a.capacity - free - cached) << '\n';
+        }
+    return sa.take_string();
+}
+
+#endif
+
 CLICK_ENDDECLS
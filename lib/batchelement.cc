@@ -8,18 +8,66 @@
 #include <click/glue.hh>
 #include <click/batchelement.hh>
 #include <click/routervisitor.hh>
+#include <click/straccum.hh>
 
 CLICK_DECLS
 
 #ifdef HAVE_BATCH
 
-BatchElement::BatchElement()
+bool BatchElement::fusion_enabled = false;
+
+BatchElement::BatchElement() : _fused(0)
 {
     in_batch_mode = Element::BATCH_MODE_IFPOSSIBLE;
 }
 
 BatchElement::~BatchElement() {
+    delete _fused;
+}
+
+BatchElement::FusedChain::FusedChain(const Vector<BatchElement*> &stages)
+    : _stages(stages)
+{
+    assert(_stages.size() > 0);
+}
+
+void
+BatchElement::FusedChain::push(int port, Packet *p)
+{
+    push_batch(port, PacketBatch::make_from_packet(p));
+}
 
+/*
+ * Each stage runs its own batch kernel, so vectorized stages keep their fast
+ * path. Only the port transfer and the push_batch() call between two stages
+ * are saved. The upstream port records the batch for the first stage, as the
+ * chain has its index; the other stages record it here, as their input port
+ * would.
+ */
+void
+BatchElement::FusedChain::push_batch(int, PacketBatch *batch)
+{
+    BatchElement **s = _stages.begin();
+    while (1) {
+        batch = (*s)->simple_action_batch(batch);
+        if (!batch)
+            return;
+        if (++s == _stages.end())
+            break;
+#if CLICK_USERLEVEL
+        PathTrace::push_batch(*s, 0, batch);
+#endif
+    }
+    _stages.back()->output_push_batch(0, batch);
+}
+
+String
+BatchElement::FusedChain::unparse() const
+{
+    StringAccum sa;
+    for (int i = 0; i < _stages.size(); i++)
+        sa << (i ? " -> " : "") << _stages[i]->name();
+    return sa.take_string();
 }
 
 bool BatchElement::BatchModePropagate::visit(Element *e, bool, int,
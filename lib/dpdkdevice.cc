@@ -24,8 +24,11 @@
 #include <click/element.hh>
 #include <click/dpdkdevice.hh>
 #include <click/userutils.hh>
+#include <click/straccum.hh>
+#include <click/queuescaling.hh>
 #include <rte_errno.h>
 #include <rte_malloc.h>
+#include <rte_ring.h>
 #include <click/dpdk_glue.hh>
 #include <execinfo.h>
 
@@ -44,16 +47,14 @@ extern "C" {
 
 CLICK_DECLS
 
-DPDKDevice::DPDKDevice() : port_id(-1), hdr_pktmbuf_pool(NULL), data_pktmbuf_pool(NULL), info() {
+DPDKDevice::DPDKDevice() : port_id(-1), hds_dm(0), hds_dm_len(0), info() {
 }
 
-DPDKDevice::DPDKDevice(portid_t port_id) : port_id(port_id) {
+DPDKDevice::DPDKDevice(portid_t port_id) : port_id(port_id), hds_dm(0), hds_dm_len(0) {
     #if HAVE_FLOW_API
         if (port_id >= 0)
             initialize_flow_rule_manager(port_id, ErrorHandler::default_handler());
     #endif
-	data_pktmbuf_pool = NULL;
-	hdr_pktmbuf_pool = NULL;
 };
 
 uint16_t DPDKDevice::get_device_vendor_id()
@@ -80,7 +81,7 @@ const char *DPDKDevice::get_device_driver()
 
 #define RETA_CONF_SIZE     (ETH_RSS_RETA_SIZE_512 / RTE_RETA_GROUP_SIZE)
 
-int DPDKDevice::set_rss_max(int max)
+int DPDKDevice::set_rss_max(int max, int first)
 {
     struct rte_eth_rss_reta_entry64 reta_conf[RETA_CONF_SIZE];
     struct rte_eth_dev_info dev_info;
@@ -97,7 +98,7 @@ int DPDKDevice::set_rss_max(int max)
     for (i = 0; i < reta_size; i++) {
         uint32_t reta_id = i / RTE_RETA_GROUP_SIZE;
         uint32_t reta_pos = i % RTE_RETA_GROUP_SIZE;
-        uint32_t core_id = i % max;
+        uint32_t core_id = first + i % max;
         reta_conf[reta_id].reta[reta_pos] = core_id;
     }
     /* RETA update */
@@ -105,6 +106,35 @@ int DPDKDevice::set_rss_max(int max)
     return status;
 }
 
+/**
+ * Spread the RETA entries pointing to queues [first, first + count) over
+ * queues [first, first + n), leaving the entries of other queues alone.
+ */
+int DPDKDevice::set_rss_queues(int first, int count, int n)
+{
+    struct rte_eth_rss_reta_entry64 reta_conf[RETA_CONF_SIZE];
+    uint16_t reta[ETH_RSS_RETA_SIZE_512];
+    struct rte_eth_dev_info dev_info;
+
+    rte_eth_dev_info_get(port_id, &dev_info);
+    uint16_t reta_size = dev_info.reta_size;
+    if (reta_size == 0 || reta_size > ETH_RSS_RETA_SIZE_512 || n < 1 || n > count)
+        return -EINVAL;
+    memset(reta_conf, 0, sizeof(reta_conf));
+    for (uint32_t i = 0; i < reta_size; i++)
+        reta_conf[i / RTE_RETA_GROUP_SIZE].mask = UINT64_MAX;
+    int status = rte_eth_dev_rss_reta_query(port_id, reta_conf, reta_size);
+    if (status != 0)
+        return status;
+    for (uint32_t i = 0; i < reta_size; i++)
+        reta[i] = reta_conf[i / RTE_RETA_GROUP_SIZE].reta[i % RTE_RETA_GROUP_SIZE];
+    if (QueueScalingPolicy::retarget(reta, reta_size, first, count, n) == 0)
+        return 0;
+    for (uint32_t i = 0; i < reta_size; i++)
+        reta_conf[i / RTE_RETA_GROUP_SIZE].reta[i % RTE_RETA_GROUP_SIZE] = reta[i];
+    return rte_eth_dev_rss_reta_update(port_id, reta_conf, reta_size);
+}
+
 #if HAVE_FLOW_API
 /**
  * Called by the constructor of DPDKDevice.
@@ -180,128 +210,268 @@ int DPDKDevice::get_nb_mbuf(int socket) {
         return NB_MBUF[socket % NB_MBUF.size()];
 }
 
-int DPDKDevice::alloc_pktmbufs_data(ErrorHandler* errh, unsigned numa_node)
+/**
+ * Return the number of buffers of each pool of a header-data split RX queue:
+ * both rings may be full of split packets, plus what the per-core caches of
+ * every lcore may hold. Mempools are rings, which are most efficient with
+ * 2^n - 1 elements.
+ */
+unsigned DPDKDevice::hds_nb_mbuf() const
 {
-    String mempool_name = DPDKDevice::MEMPOOL_PREFIX + String(numa_node) + String(":hds");
-    const char* pool_name = mempool_name.c_str();
-    struct rte_pktmbuf_extmem ext_mem[10240];
-    int ret, ext_mem_num = 1;
-    char name[64], hname[64];
-    unsigned int nb_mbuf = DPDKDevice::MAX_HDS_QUEUES * (info.n_rx_descs + info.n_tx_descs) * 2;
-
-    if (nb_mbuf >= 65536 || DPDKDevice::MAX_HDS_QUEUES == -1 || DPDKDevice::MAX_HDS_QUEUES == 0)
-	    nb_mbuf = 65536 - 1;
-    printf("Using %d MBUFs for header-data split\n", nb_mbuf);
-
-    snprintf(name, sizeof(name), "d_%s%d", pool_name, port_id);
-    snprintf(hname, sizeof(hname), "h_%s%d", pool_name, port_id);
-
-    if (data_pktmbuf_pool || hdr_pktmbuf_pool) {
-	    printf("hdr/data pktmbuf already exists for %s %p %p\n", mempool_name.c_str(),
-		   data_pktmbuf_pool, hdr_pktmbuf_pool);
+    unsigned int nb_mbuf = 2 * (info.n_rx_descs + info.n_tx_descs)
+	    + (rte_lcore_count() + 1) * MBUF_CACHE_SIZE * 3 / 2;
+    return next_pow2(nb_mbuf + 1) - 1;
+}
+
+/**
+ * Allocate one NIC memory region for the data pools of the @a n_split
+ * header-data split RX queues, which alloc_pktmbufs_data() divides between
+ * them. rte_dev_alloc_dm() may return less than asked, so asking queue by
+ * queue would let the first queues take all the memory.
+ *
+ * If the NIC has no memory to give, all split queues use host memory.
+ */
+int DPDKDevice::alloc_hds_nicmem(ErrorHandler* errh, unsigned n_split)
+{
+    if (hds_dm || n_split == 0)
+	    return 0;
+
+    hds_dm_len = (size_t) n_split * hds_nb_mbuf() * _rx_pkt_seg_lengths[1];
+    if (rte_dev_alloc_dm(rte_eth_devices[port_id].device, &hds_dm, &hds_dm_len)
+	|| !hds_dm || hds_dm_len < (size_t) n_split * _rx_pkt_seg_lengths[1]) {
+	    errh->warning("Could not allocate NIC memory for the %u split queues of port %d, using host memory",
+			  n_split, port_id);
+	    if (hds_dm)
+		    rte_dev_free_dm(rte_eth_devices[port_id].device, hds_dm);
+	    hds_dm = 0;
+	    hds_dm_len = 0;
 	    return 0;
     }
 
-    ext_mem[0].elt_size = _rx_pkt_seg_lengths[1];
-    // ext_mem[0].buf_len = get_nb_mbuf(numa_node) * ext_mem[0].elt_size;
-    ext_mem[0].buf_len = nb_mbuf * _rx_pkt_seg_lengths[1];
-
-    if (dpdk_nicmem_enabled) {
-	    int totsz = 0, j = 0;
-
-	    //printf("Alloc nic pinned mem\n");
-	    ret = rte_dev_alloc_dm(rte_eth_devices[port_id].device,
-				   &ext_mem[0].buf_ptr,
-				   &ext_mem[0].buf_len);
-	    if (ret || ext_mem[0].buf_len == 0) {
-		    printf("[-] Failed to allocate NIC memory\n"
-			   "    Entering fallback using host memory\n");
-		    /* reset ext_mem and restart with ext-host mem */
-		    ext_mem[0].elt_size = _rx_pkt_seg_lengths[1];
-		    ext_mem[0].buf_len = nb_mbuf * _rx_pkt_seg_lengths[1];
-		    goto host_mem_fallback;
-	    }
+    if (rte_dev_get_dma_map(rte_eth_devices[port_id].device, hds_dm,
+			    RTE_BAD_IOVA, hds_dm_len))
+	    return errh->error("NIC DMA map failed on port %d", port_id);
+
+    click_chatter("Allocated %lu bytes of NIC memory for the %u split queues of port %d",
+		  (unsigned long) hds_dm_len, n_split, port_id);
+    return 0;
+}
+
+/**
+ * Create the header and data pools of header-data split RX queue @a queue,
+ * out of @a n_split split queues.
+ *
+ * Each split queue gets its own pair of pools, allocated on the NUMA node of
+ * the thread polling it, so the polling core does not share the pool rings
+ * with other queues. With NIC memory, the data pool uses the share of the
+ * region of alloc_hds_nicmem() that belongs to the queue.
+ */
+int DPDKDevice::alloc_pktmbufs_data(ErrorHandler* errh, unsigned queue, unsigned n_split)
+{
+    enum { MAX_EXT_MEM = 10240 };
+    struct rte_pktmbuf_extmem ext_mem[MAX_EXT_MEM];
+    struct rte_mempool *data_pool, *hdr_pool;
+    char name[RTE_MEMPOOL_NAMESIZE], hname[RTE_MEMPOOL_NAMESIZE];
+    int numa_node = get_rx_queue_numa_node(queue);
+    unsigned int nb_mbuf = hds_nb_mbuf();
+    unsigned int elt_size = _rx_pkt_seg_lengths[1];
+
+    if (data_pktmbuf_pools.size() <= (int) queue) {
+	    data_pktmbuf_pools.resize(queue + 1, NULL);
+	    hdr_pktmbuf_pools.resize(queue + 1, NULL);
+    }
+    if (data_pktmbuf_pools[queue] || hdr_pktmbuf_pools[queue])
+	    return 0;
 
-	    printf("[+] Allocated device memory: %p %lu\n",
-		   ext_mem[0].buf_ptr,
-		   ext_mem[0].buf_len);
+    snprintf(name, sizeof(name), "d_%shds%d_%u", MEMPOOL_PREFIX.c_str(), port_id, queue);
+    snprintf(hname, sizeof(hname), "h_%shds%d_%u", MEMPOOL_PREFIX.c_str(), port_id, queue);
+    click_chatter("Using %u MBUFs for header-data split on port %d queue %u, node %d",
+		  nb_mbuf, port_id, queue, numa_node);
 
-	    // if (numa_node == 0) {
+    if (hds_dm) {
+	    // Our share of the region, in whole buffers
+	    size_t share = hds_dm_len / n_split / elt_size * elt_size;
+	    unsigned per_share = share / elt_size;
+
+	    ext_mem[0].buf_ptr = (char *) hds_dm + (size_t) queue * share;
 	    ext_mem[0].buf_iova = RTE_BAD_IOVA;
-	    // ret = rte_extmem_register(ext_mem[0].buf_ptr,
-	    //     		      ext_mem[0].buf_len, NULL,
-	    //     		      ext_mem[0].buf_iova, 4096);
-	    // if (ret)
-	    //         rte_exit(EXIT_FAILURE,
-	    //     	     "Failed to register NIC memory %p %lu\n",
-	    //     	     ext_mem[0].buf_ptr, ext_mem[0].buf_len);
-	    // }
-
-	    ret = rte_dev_get_dma_map(rte_eth_devices[port_id].device,
-				      ext_mem[0].buf_ptr, ext_mem[0].buf_iova,
-				      ext_mem[0].buf_len);
-	    if (ret)
-		    rte_exit(EXIT_FAILURE,
-			     "NIC DMA map failed\n");
+	    ext_mem[0].buf_len = share;
+	    ext_mem[0].elt_size = elt_size;
 
 	    /* This fills external memory with repeated
 	     * instances of NIC memory to overcome the
 	     * limitation on NIC memory size
 	     */
-	    totsz = ext_mem[0].buf_len / ext_mem[0].elt_size;
-	    while (totsz < nb_mbuf) {
-		    ext_mem[++j] = ext_mem[0];
-		    totsz += (ext_mem[j].buf_len / ext_mem[j].elt_size);
-	    }
-	    ext_mem_num = j + 1;
-	    data_pktmbuf_pool =
+	    unsigned ext_mem_num = (nb_mbuf + per_share - 1) / per_share;
+	    if (ext_mem_num > MAX_EXT_MEM)
+		    return errh->error("%lu bytes of NIC memory per split queue cannot back %u buffers of %u bytes",
+				       (unsigned long) share, nb_mbuf, elt_size);
+	    for (unsigned j = 1; j < ext_mem_num; j++)
+		    ext_mem[j] = ext_mem[0];
+	    data_pool =
 		    rte_pktmbuf_pool_create_extbuf(name, nb_mbuf,
 						   MBUF_CACHE_SIZE, 0,
-						   ext_mem[0].elt_size,
+						   elt_size,
 						   numa_node, &ext_mem[0],
 						   ext_mem_num);
-	    //printf("%p %d\n", ext_mem[1].buf_ptr, ext_mem[1].buf_len);
-    } else { // host mem
-host_mem_fallback:
-	    // char extname[64];
-
-	    // snprintf(extname, sizeof(extname), "ext%s%d", pool_name, port_id);
-	    // ext_mem[0].buf_ptr = rte_malloc(extname, ext_mem[0].buf_len, 64);
-	    // ext_mem[0].buf_iova = 0; // ignored in mlx5
-	    // if (!ext_mem[0].buf_ptr) {
-	    //     printf("Bad rte_malloc %d!\n", ext_mem[0].buf_len);
-	    //     return -1;
-	    // }
-	    // data_pktmbuf_pool =
-	    //     rte_pktmbuf_pool_create_extbuf(name, get_nb_mbuf(numa_node),
-	    //                    MBUF_CACHE_SIZE, 0,
-	    //                    ext_mem[0].elt_size,
-	    //                    numa_node, &ext_mem[0],
-	    //                    ext_mem_num);
-	    printf("Host-backed memory data mbuf pool: %s\n", name);
-	    data_pktmbuf_pool =
+    } else {
+	    data_pool =
 		    rte_pktmbuf_pool_create(name, nb_mbuf,
 					    MBUF_CACHE_SIZE, 0,
-					    ext_mem[0].elt_size,
+					    elt_size,
 					    numa_node);
     }
 
-    if (!data_pktmbuf_pool) {
-	    errh->error("Could not allocate data MBuf pools %d with %d buffers : error %d (%s)",numa_node, nb_mbuf, rte_errno,rte_strerror(rte_errno));
+    if (!data_pool) {
+	    errh->error("Could not allocate data MBuf pool for queue %u on node %d with %u buffers : error %d (%s)",queue, numa_node, nb_mbuf, rte_errno,rte_strerror(rte_errno));
 	    return rte_errno;
     }
 
-    hdr_pktmbuf_pool = rte_pktmbuf_pool_create(hname, nb_mbuf,
-					       MBUF_CACHE_SIZE, DPDK_ANNO_SIZE,
-					       _rx_pkt_seg_lengths[0], numa_node);
-    if (!hdr_pktmbuf_pool) {
-	    errh->error("Could not allocate hdr MBuf pools %d with %d buffers : error %d (%s)",numa_node, nb_mbuf, rte_errno,rte_strerror(rte_errno));
+    hdr_pool = rte_pktmbuf_pool_create(hname, nb_mbuf,
+				       MBUF_CACHE_SIZE, DPDK_ANNO_SIZE,
+				       _rx_pkt_seg_lengths[0], numa_node);
+    if (!hdr_pool) {
+	    errh->error("Could not allocate hdr MBuf pool for queue %u on node %d with %u buffers : error %d (%s)",queue, numa_node, nb_mbuf, rte_errno,rte_strerror(rte_errno));
+	    rte_mempool_free(data_pool);
 	    return rte_errno;
     }
 
+    data_pktmbuf_pools[queue] = data_pool;
+    hdr_pktmbuf_pools[queue] = hdr_pool;
+
+    return 0;
+}
+
+/*
+ * Mempool driver of ToDPDKDevice's RECYCLE.
+ *
+ * Each lcore keeps the mbufs it frees in its own free list, behind the DPDK
+ * per-lcore cache, and takes them back from there first. In run-to-completion
+ * forwarding, the mbufs freed by TX completion when the cache overflows then
+ * refill the RX ring of the same core without going through the shared ring
+ * of the pool, which only takes what the free lists cannot hold.
+ */
+#define RECYCLE_OPS_NAME "click_recycle"
+enum { RECYCLE_LIST_SIZE = 1024 };
+
+struct RecycleList {
+    unsigned len;
+    uint64_t recycled;  // mbufs taken back from the list
+    uint64_t ring_ops;  // mbufs put in or taken from the shared ring
+    void *objs[RECYCLE_LIST_SIZE];
+} __rte_cache_aligned;
+
+struct RecyclePool {
+    struct rte_ring *ring;
+    RecycleList lists[RTE_MAX_LCORE];
+};
+
+static int recycle_alloc(struct rte_mempool *mp)
+{
+    char name[RTE_RING_NAMESIZE];
+    RecyclePool *rp = (RecyclePool *) rte_zmalloc_socket(
+        "click_recycle", sizeof(RecyclePool), RTE_CACHE_LINE_SIZE, mp->socket_id);
+    if (!rp)
+        return -ENOMEM;
+    snprintf(name, sizeof(name), "rc_%s", mp->name);
+    rp->ring = rte_ring_create(name, rte_align32pow2(mp->size + 1), mp->socket_id, 0);
+    if (!rp->ring) {
+        rte_free(rp);
+        return -rte_errno;
+    }
+    mp->pool_data = rp;
     return 0;
 }
 
+static void recycle_free(struct rte_mempool *mp)
+{
+    RecyclePool *rp = (RecyclePool *) mp->pool_data;
+    rte_ring_free(rp->ring);
+    rte_free(rp);
+}
+
+static int recycle_enqueue(struct rte_mempool *mp, void * const *objs, unsigned n)
+{
+    RecyclePool *rp = (RecyclePool *) mp->pool_data;
+    unsigned lcore = rte_lcore_id();
+    unsigned i = 0;
+    if (lcore < RTE_MAX_LCORE) {
+        RecycleList &l = rp->lists[lcore];
+        i = RECYCLE_LIST_SIZE - l.len;
+        if (i > n)
+            i = n;
+        memcpy(&l.objs[l.len], objs, i * sizeof(void *));
+        l.len += i;
+        l.ring_ops += n - i;
+    }
+    // The ring can hold every mbuf of the pool
+    if (i < n && rte_ring_enqueue_bulk(rp->ring, objs + i, n - i, NULL) == 0)
+        return -ENOBUFS;
+    return 0;
+}
+
+static int recycle_dequeue(struct rte_mempool *mp, void **objs, unsigned n)
+{
+    RecyclePool *rp = (RecyclePool *) mp->pool_data;
+    unsigned lcore = rte_lcore_id();
+    RecycleList *l = lcore < RTE_MAX_LCORE ? &rp->lists[lcore] : 0;
+    unsigned i = 0;
+    if (l) {
+        i = l->len < n ? l->len : n;
+        l->len -= i;
+        memcpy(objs, &l->objs[l->len], i * sizeof(void *));
+    }
+    if (i < n && rte_ring_dequeue_bulk(rp->ring, objs + i, n - i, NULL) == 0) {
+        // All or nothing: give the mbufs back to the list
+        if (l)
+            l->len += i;
+        return -ENOBUFS;
+    }
+    if (l) {
+        l->recycled += i;
+        l->ring_ops += n - i;
+    }
+    return 0;
+}
+
+static unsigned recycle_get_count(const struct rte_mempool *mp)
+{
+    RecyclePool *rp = (RecyclePool *) mp->pool_data;
+    unsigned count = rte_ring_count(rp->ring);
+    for (int i = 0; i < RTE_MAX_LCORE; i++)
+        count += rp->lists[i].len;
+    return count;
+}
+
+static struct rte_mempool_ops recycle_ops = {
+    RECYCLE_OPS_NAME,
+    recycle_alloc,
+    recycle_free,
+    recycle_enqueue,
+    recycle_dequeue,
+    recycle_get_count,
+};
+
+/**
+ * Sum the mbufs taken back from the free lists of RECYCLE, and the mbufs
+ * that went through the shared rings of the pools, over all pools.
+ */
+void DPDKDevice::recycle_stats(uint64_t &recycled, uint64_t &ring_ops)
+{
+    recycled = ring_ops = 0;
+    if (!recycle_enabled)
+        return;
+    for (unsigned i = 0; i < _nr_pktmbuf_pools; i++) {
+        if (!_pktmbuf_pools[i])
+            continue;
+        RecyclePool *rp = (RecyclePool *) _pktmbuf_pools[i]->pool_data;
+        for (int j = 0; j < RTE_MAX_LCORE; j++) {
+            recycled += rp->lists[j].recycled;
+            ring_ops += rp->lists[j].ring_ops;
+        }
+    }
+}
+
 int DPDKDevice::alloc_pktmbufs(ErrorHandler* errh)
 {
     /* Count NUMA sockets for each device and each node, we do not want to
@@ -359,12 +529,23 @@ int DPDKDevice::alloc_pktmbufs(ErrorHandler* errh)
     }
 #endif
 
+    if (recycle_enabled && rte_eal_process_type() != RTE_PROC_PRIMARY)
+        return errh->error("RECYCLE cannot be used by a secondary DPDK process");
+    if (recycle_enabled && rte_mempool_register_ops(&recycle_ops) < 0)
+        return errh->error("Could not register the mempool driver of RECYCLE");
+
     if (rte_eal_process_type() == RTE_PROC_PRIMARY) {
         // Create a pktmbuf pool for each active socket
         for (unsigned i = 0; i < _nr_pktmbuf_pools; i++) {
                 if (!_pktmbuf_pools[i]) {
                         String mempool_name = DPDKDevice::MEMPOOL_PREFIX + String(i);
                         const char* name = mempool_name.c_str();
+                        if (recycle_enabled)
+                            _pktmbuf_pools[i] =
+                                rte_pktmbuf_pool_create_by_ops(name, get_nb_mbuf(i),
+                                                               MBUF_CACHE_SIZE, DPDK_ANNO_SIZE,
+                                                               MBUF_DATA_SIZE, i, RECYCLE_OPS_NAME);
+                        else
                         _pktmbuf_pools[i] =
 #if RTE_VERSION >= RTE_VERSION_NUM(2,2,0,0)
                                 rte_pktmbuf_pool_create(name, get_nb_mbuf(i),
@@ -813,29 +994,32 @@ also                ETH_TXQ_FLAGS_NOMULTMEMP
 	    if (DPDKDevice::MAX_HDS_QUEUES == -1)
 		    DPDKDevice::MAX_HDS_QUEUES = info.rx_queues.size();
 
-	    if (alloc_pktmbufs_data(errh, numa_node))
-		    return errh->error("Failed to allocate pktmbuf data\n");
-
 	    rx_seg[0].length = _rx_pkt_seg_lengths[0] - RTE_PKTMBUF_HEADROOM;
 	    rx_seg[1].length = _rx_pkt_seg_lengths[1];
 
-	    //rx_seg[0].mp = _pktmbuf_pools[numa_node];
-	    rx_seg[0].mp = hdr_pktmbuf_pool;
-	    rx_seg[1].mp = data_pktmbuf_pool;
-
 	    rx_conf.offloads |= DEV_RX_OFFLOAD_BUFFER_SPLIT | DEV_RX_OFFLOAD_SCATTER;
 	    tx_conf.offloads |= DEV_TX_OFFLOAD_MULTI_SEGS;
+	    unsigned n_split = info.rx_queues.size();
+	    if (n_split > (unsigned) DPDKDevice::MAX_HDS_QUEUES)
+		    n_split = DPDKDevice::MAX_HDS_QUEUES;
+	    if (dpdk_nicmem_enabled && alloc_hds_nicmem(errh, n_split))
+		    return -1;
 	    for (unsigned i = 0; i < (unsigned)info.rx_queues.size(); ++i) {
 		    if (i < DPDKDevice::MAX_HDS_QUEUES) {
+			    if (alloc_pktmbufs_data(errh, i, n_split))
+				    return errh->error("Failed to allocate pktmbuf data\n");
+			    rx_seg[0].mp = hdr_pktmbuf_pools[i];
+			    rx_seg[1].mp = data_pktmbuf_pools[i];
+
 			    printf("Creates extended Rx queue %d\n", i);
 			    // 2x n_rx_descs as each packet is two descriptors
 			    if (rte_eth_rx_queue_setup_ex(port_id, i,
-							  info.n_rx_descs * 2, numa_node,
+							  info.n_rx_descs * 2, get_rx_queue_numa_node(i),
 							  &rx_conf,
 							  rx_seg, MAX_SEGS_BUFFER_SPLIT))
 			    return errh->error(
 				"Cannot initialize extended RX queue %u of port %u on node %u : %s",
-				i, port_id, numa_node, rte_strerror(rte_errno));
+				i, port_id, get_rx_queue_numa_node(i), rte_strerror(rte_errno));
 		    } else {
 			    printf("Creates normal Rx queue %d\n", i);
 			    if (rte_eth_rx_queue_setup(port_id, i, info.n_rx_descs,
@@ -1085,6 +1269,12 @@ void DPDKDevice::set_init_flow_isolate(const bool &flow_isolate) {
     info.flow_isolate = flow_isolate;
 }
 
+void DPDKDevice::set_init_hds_steer(HDSSteerMode mode, unsigned min_length) {
+    assert(!_is_initialized);
+    info.hds_steer = mode;
+    info.hds_min_length = min_length;
+}
+
 EtherAddress DPDKDevice::get_mac() {
     assert(_is_initialized);
     struct rte_ether_addr addr;
@@ -1202,6 +1392,73 @@ int DPDKDevice::add_tx_queue(unsigned &queue_id, unsigned n_desc, ErrorHandler *
     return add_queue(DPDKDevice::TX, queue_id, false, false, false, false, false, false, n_desc, errh);
 }
 
+/**
+ * Record that RX queue @a queue_id is polled by thread @a thread, so the
+ * buffers of that queue are allocated on the NUMA node of the thread.
+ */
+void DPDKDevice::set_rx_queue_thread(unsigned queue_id, int thread)
+{
+    if (info.rx_queue_threads.size() <= (int) queue_id)
+        info.rx_queue_threads.resize(queue_id + 1, -1);
+    info.rx_queue_threads[queue_id] = thread;
+}
+
+/**
+ * Return the lcore running Click thread @a thread. click runs thread 0 on the
+ * main lcore, and the others on the worker lcores, in order.
+ */
+static unsigned thread_to_lcore(int thread)
+{
+    unsigned lcore_id;
+#if RTE_VERSION >= RTE_VERSION_NUM(20,11,0,0)
+    unsigned main_lcore = rte_get_main_lcore();
+    if (thread > 0)
+        RTE_LCORE_FOREACH_WORKER(lcore_id) {
+#else
+    unsigned main_lcore = rte_get_master_lcore();
+    if (thread > 0)
+        RTE_LCORE_FOREACH_SLAVE(lcore_id) {
+#endif
+            if (--thread == 0)
+                return lcore_id;
+        }
+    return main_lcore;
+}
+
+/**
+ * Return the NUMA node of the thread polling RX queue @a queue_id, or the
+ * node of the port if no thread was recorded.
+ */
+int DPDKDevice::get_rx_queue_numa_node(unsigned queue_id)
+{
+    if ((int) queue_id < info.rx_queue_threads.size() && info.rx_queue_threads[queue_id] >= 0)
+        return core_to_numa_node(thread_to_lcore(info.rx_queue_threads[queue_id]));
+    return get_port_numa_node(port_id);
+}
+
+/**
+ * Describe the header-data split pools of every RX queue, one per line:
+ * queue, "hdr" or "data", NUMA node, size, available buffers, buffers in use.
+ * A pool with no available buffer is exhausted, and the NIC then drops
+ * packets for that queue and counts them in rx_nombuf.
+ */
+String DPDKDevice::hds_pool_stats()
+{
+    StringAccum sa;
+    for (int i = 0; i < data_pktmbuf_pools.size(); i++) {
+        struct rte_mempool *pools[2] = {hdr_pktmbuf_pools[i], data_pktmbuf_pools[i]};
+        static const char * const kinds[2] = {"hdr", "data"};
+        for (int k = 0; k < 2; k++) {
+            if (!pools[k])
+                continue;
+            sa << i << ' ' << kinds[k] << ' ' << pools[k]->socket_id << ' '
+               << pools[k]->size << ' ' << rte_mempool_avail_count(pools[k]) << ' '
+               << rte_mempool_in_use_count(pools[k]) << '\n';
+        }
+    }
+    return sa.take_string();
+}
+
 int DPDKDevice::static_initialize(ErrorHandler* errh) {
 #if HAVE_DPDK_PACKET_POOL
     if (!dpdk_enabled) {
@@ -1299,6 +1556,9 @@ int DPDKDevice::initialize(ErrorHandler *errh)
             if (err != 0) {
                 return errh->error("Could not configure all rules for device %d", port_id);
             }
+            if (dev->configure_hds_steering(errh) != 0) {
+                return errh->error("Could not steer traffic between split and regular queues of device %d", port_id);
+            }
         }
     }
 #endif
@@ -1332,6 +1592,124 @@ int DPDKDevice::configure_nic(const portid_t &port_id)
 
     return 0;
 }
+
+/**
+ * Installs the rules steering traffic between the header-data split queues
+ * (the first MAX_HDS_QUEUES ones) and the regular queues of this device.
+ * Packets with an IPv4 total length of at least hds_min_length, and that are
+ * TCP in TCP mode, go to the split queues, the others to the regular
+ * queues. Each group is spread over its own queues by RSS, and counted by
+ * its own rules.
+ *
+ * rte_flow has no range match, so [hds_min_length, 65535] is expanded in
+ * value/mask prefixes: at most 16 rules. The catch-all rule of the regular
+ * group has a lower priority.
+ *
+ * @args errh: an error handler
+ * @return 0 on success, otherwise a negative integer
+ */
+int DPDKDevice::configure_hds_steering(ErrorHandler *errh)
+{
+    if (info.hds_steer == HDS_STEER_NONE) {
+        return 0;
+    }
+
+    if (!dpdk_split_enabled) {
+        return errh->error("Steering to split queues of port %u requires --dpdk-split", port_id);
+    }
+
+    int n_split = DPDKDevice::MAX_HDS_QUEUES;
+    const int n_rx = info.rx_queues.size();
+    if ((n_split < 0) || (n_split > n_rx)) {
+        n_split = n_rx;
+    }
+    if ((n_split == 0) || (n_split == n_rx)) {
+        return errh->error(
+            "Steering to split queues of port %u needs both split and regular queues, "
+            "but %d of %d queues are split. Set MAX_HDS_QUEUES in DPDKInfo",
+            port_id, n_split, n_rx
+        );
+    }
+
+    FlowRuleManager *flow_rule_mgr = FlowRuleManager::get_flow_rule_mgr(port_id, errh);
+    assert(flow_rule_mgr);
+
+    StringAccum split_queues, regular_queues;
+    for (int i = 0; i < n_rx; i++) {
+        if (i < n_split) {
+            split_queues << i << ' ';
+        } else {
+            regular_queues << i << ' ';
+        }
+    }
+
+    const String prefix = "flow create " + String(port_id) + " priority ";
+    const String rss = "end actions rss types ip tcp udp end queues ";
+    const String l4 = (info.hds_steer == HDS_STEER_TCP) ? "tcp / " : "";
+
+    HashMap<uint32_t, String> rules_map;
+    Vector<uint32_t> rule_ids[HDS_GROUP_COUNT];
+
+    // Largest aligned power-of-two blocks covering [min_length, 65535]
+    uint32_t len = info.hds_min_length;
+    while (len <= 0xFFFF) {
+        uint32_t block = len ? (len & -len) : 0x10000;
+        StringAccum rule;
+        rule << prefix << "0 ingress pattern eth / ipv4 total_len spec " << len
+             << " total_len mask " << ((~(block - 1)) & 0xFFFF) << " / " << l4
+             << rss << split_queues << "end / count / end\n";
+        uint32_t int_rule_id = flow_rule_mgr->flow_rule_cache()->next_internal_rule_id();
+        rules_map.insert(int_rule_id, rule.take_string());
+        rule_ids[HDS_GROUP_SPLIT].push_back(int_rule_id);
+        len += block;
+    }
+
+    StringAccum rule;
+    rule << prefix << "1 ingress pattern eth / "
+         << rss << regular_queues << "end / count / end\n";
+    uint32_t int_rule_id = flow_rule_mgr->flow_rule_cache()->next_internal_rule_id();
+    rules_map.insert(int_rule_id, rule.take_string());
+    rule_ids[HDS_GROUP_REGULAR].push_back(int_rule_id);
+
+    if (flow_rule_mgr->flow_rules_update(rules_map, false, 0) != (int32_t) rules_map.size()) {
+        return -1;
+    }
+
+    for (int g = 0; g < HDS_GROUP_COUNT; g++) {
+        _hds_rules[g].swap(rule_ids[g]);
+    }
+
+    return 0;
+}
+
+/**
+ * Sums the counters of the steering rules of one queue group.
+ *
+ * @args group: the queue group
+ * @args pkts: the number of packets steered to this group
+ * @args bytes: the number of bytes steered to this group
+ * @return 0 on success, otherwise a negative integer
+ */
+int DPDKDevice::hds_steer_counters(HDSGroup group, int64_t &pkts, int64_t &bytes)
+{
+    pkts = bytes = 0;
+    if (_hds_rules[group].empty()) {
+        return -1;
+    }
+
+    FlowRuleManager *flow_rule_mgr = FlowRuleManager::get_flow_rule_mgr(port_id);
+    assert(flow_rule_mgr);
+
+    for (int i = 0; i < _hds_rules[group].size(); i++) {
+        int64_t rule_pkts = 0;
+        int64_t rule_bytes = 0;
+        flow_rule_mgr->flow_rule_query(_hds_rules[group][i], rule_pkts, rule_bytes);
+        pkts += rule_pkts;
+        bytes += rule_bytes;
+    }
+
+    return 0;
+}
 #endif
 
 void DPDKDevice::free_pkt(unsigned char *, size_t, void *pktmbuf)
@@ -1339,6 +1717,165 @@ void DPDKDevice::free_pkt(unsigned char *, size_t, void *pktmbuf)
     rte_pktmbuf_free((struct rte_mbuf *) pktmbuf);
 }
 
+static void payload_template_free(void *, void *opaque)
+{
+    DPDKDevice::PayloadTemplate *t = (DPDKDevice::PayloadTemplate *) opaque;
+    if (t->nicmem)
+        rte_dev_free_dm(t->dev, t->data);
+    else
+        rte_free(t->data);
+    rte_free(t);
+}
+
+/**
+ * Returns the pool of the segments attached to payload templates on NUMA
+ * node @a node. Its mbufs have no data room, as they only point to the
+ * template. It is shared by all templates and never freed, as segments may
+ * still be returned to it after the last template is gone.
+ */
+static struct rte_mempool *payload_template_seg_pool(int node, ErrorHandler *errh)
+{
+    char name[RTE_MEMPOOL_NAMESIZE];
+    snprintf(name, sizeof(name), "click_tplseg_%d", node);
+    struct rte_mempool *mp = rte_mempool_lookup(name);
+    if (!mp) {
+        mp = rte_pktmbuf_pool_create(name, DPDKDevice::DEFAULT_NB_MBUF,
+                                     DPDKDevice::MBUF_CACHE_SIZE, 0, 0, node);
+        if (!mp)
+            errh->error("Could not allocate the payload template segments on node %d: %s",
+                        node, rte_strerror(rte_errno));
+    }
+    return mp;
+}
+
+/**
+ * Places a constant payload once in the memory of a NIC, or in host memory,
+ * so that packets can reference it instead of carrying a copy.
+ *
+ * Exactly the payload length is asked from the NIC. If it cannot give it,
+ * or gives more, host memory is used instead.
+ *
+ * @args data: the payload
+ * @args length: the payload length
+ * @args port_id: the port whose memory is used, or -1 for host memory
+ * @args node: the NUMA node of host memory
+ * @args errh: an error handler
+ * @return the template, or NULL on error
+ */
+DPDKDevice::PayloadTemplate *DPDKDevice::payload_template_create(
+        const unsigned char *data, uint16_t length, int port_id, int node,
+        ErrorHandler *errh)
+{
+    struct rte_mempool *seg_pool = payload_template_seg_pool(node, errh);
+    if (!seg_pool)
+        return 0;
+
+    PayloadTemplate *t = (PayloadTemplate *) rte_zmalloc_socket(
+        "payload_template", sizeof(PayloadTemplate), RTE_CACHE_LINE_SIZE, node);
+    if (!t) {
+        errh->error("Could not allocate payload template");
+        return 0;
+    }
+    t->seg_pool = seg_pool;
+
+    if (port_id >= 0) {
+        struct rte_device *dev = rte_eth_devices[port_id].device;
+        void *ptr = 0;
+        size_t len = length;
+        if (rte_dev_alloc_dm(dev, &ptr, &len) || !ptr || len != length) {
+            errh->warning("Could not allocate %u bytes of NIC memory on port %d, using host memory", length, port_id);
+            if (ptr)
+                rte_dev_free_dm(dev, ptr);
+        } else if (rte_dev_get_dma_map(dev, ptr, RTE_BAD_IOVA, len)) {
+            rte_dev_free_dm(dev, ptr);
+            rte_free(t);
+            errh->error("NIC DMA map of the payload template failed on port %d", port_id);
+            return 0;
+        } else {
+            t->data = (unsigned char *) ptr;
+            t->iova = RTE_BAD_IOVA;
+            t->dev = dev;
+            t->nicmem = true;
+        }
+    }
+
+    if (!t->nicmem) {
+        t->data = (unsigned char *) rte_malloc_socket(
+            "payload_template", length, RTE_CACHE_LINE_SIZE, node);
+        if (!t->data) {
+            rte_free(t);
+            errh->error("Could not allocate %u bytes for payload template", length);
+            return 0;
+        }
+        t->iova = rte_malloc_virt2iova(t->data);
+    }
+
+    memcpy(t->data, data, length);
+    t->length = length;
+    t->shinfo.free_cb = payload_template_free;
+    t->shinfo.fcb_opaque = t;
+    rte_mbuf_ext_refcnt_set(&t->shinfo, 1);
+    return t;
+}
+
+/**
+ * Releases the reference of the owner of a payload template. The memory is
+ * freed once no packet references it anymore.
+ *
+ * @args t: the template
+ */
+void DPDKDevice::payload_template_destroy(PayloadTemplate *t)
+{
+    if (t && rte_mbuf_ext_refcnt_update(&t->shinfo, -1) == 0)
+        payload_template_free(t->data, t);
+}
+
+/**
+ * Makes the first length bytes of a packet received on a header-data split
+ * port readable through the packet, by moving the missing bytes from the
+ * payload segment to the tailroom of the header segment.
+ *
+ * @args p: a packet
+ * @args length: the number of bytes needed after p->data()
+ * @args pull: if false, only reports whether bytes are missing
+ * @return -1 if the packet has no data beyond its header segment, 1 if the
+ * missing bytes were moved, otherwise 0
+ */
+int DPDKDevice::split_pullup(Packet *p, unsigned length, bool pull)
+{
+    struct rte_mbuf *mb;
+#if CLICK_PACKET_USE_DPDK
+    mb = p->mb();
+#else
+    if (!is_dpdk_packet(p))
+        return -1;
+    mb = (struct rte_mbuf *) p->destructor_argument();
+#endif
+    struct rte_mbuf *seg = mb->next;
+    unsigned char *end = rte_pktmbuf_mtod(mb, unsigned char *) + rte_pktmbuf_data_len(mb);
+    if (!seg || rte_pktmbuf_data_len(seg) == 0 || p->end_data() != end)
+        return -1;
+
+    unsigned n = length - p->length();
+    if (n > rte_pktmbuf_data_len(seg))
+        n = rte_pktmbuf_data_len(seg);
+    if (!pull || p->shared() || p->tailroom() < n)
+        return 0;
+
+    memcpy(end, rte_pktmbuf_mtod(seg, unsigned char *), n);
+    seg->data_off += n;
+    seg->data_len -= n;
+    // The total length of the chain does not change
+#if !CLICK_PACKET_USE_DPDK
+    // Cannot reallocate, as p is not shared and has the tailroom
+    WritablePacket *q = p->put(n);
+    assert(q == p);
+    (void) q;
+#endif
+    mb->data_len += n;
+    return 1;
+}
+
 void DPDKDevice::cleanup(ErrorHandler *errh)
 {
     (void)errh;
@@ -1576,6 +2113,8 @@ int DPDKDevice::MBUF_SIZE = MBUF_DATA_SIZE
                           + sizeof (struct rte_mbuf);
 int DPDKDevice::MBUF_CACHE_SIZE = 256;
 int DPDKDevice::MAX_HDS_QUEUES = -1; // all queues
+bool DPDKDevice::recycle_enabled = false;
+int DPDKDevice::SPLIT_ACCESS = DPDKDevice::SPLIT_ACCESS_WARN;
 int DPDKDevice::RX_PTHRESH = 8;
 int DPDKDevice::RX_HTHRESH = 8;
 int DPDKDevice::RX_WTHRESH = 4;
@@ -34,6 +34,9 @@
 #include <click/bitvector.hh>
 #include <click/routervisitor.hh>
 #include <click/lexer.hh>
+#if HAVE_BATCH
+# include <click/packetarray.hh>
+#endif
 #if CLICK_DEBUG_SCHEDULING
 # include <click/notifier.hh>
 #endif
@@ -1228,6 +1231,14 @@ Element::processing_vector(int* in_v, int* out_v, ErrorHandler* errh) const
  * RoundRobinSched has 0 inputs, are idle rather than busy, and waste no
  * CPU time.</dd>
  *
+ * <dt><tt>F</tt></dt> <dd>This element is a BatchElement that may be fused
+ * with its neighbours. Its only input is push, and its push_batch() behaves
+ * like BatchElement's default: it calls simple_action_batch() and pushes the
+ * result on output 0. Packets sent to any other output, such as drops, are
+ * pushed from simple_action_batch() itself. When fusion is enabled (click
+ * --fuse), linear chains of <tt>F</tt>-flagged elements are run by a single
+ * BatchElement::FusedChain when the router is initialized.</dd>
+ *
  * </dl>
  */
 const char*
@@ -3177,6 +3188,18 @@ void Element::push_batch(int port, PacketBatch* batch) {
 #endif
 }
 
+/** @brief Push the packets of array @a a onto push input @a port.
+ *
+ * Elements that can process packets from a PacketArray override this
+ * function to avoid going through the linked representation. The default
+ * implementation links the packets and calls push_batch().
+ */
+void Element::push_array(int port, PacketArray &a) {
+    PacketBatch* batch = a.to_batch();
+    if (batch)
+        push_batch(port, batch);
+}
+
 PacketBatch* Element::pull_batch(int port, unsigned max) {
     PacketBatch* batch;
     MAKE_BATCH(pull(port),batch,max);
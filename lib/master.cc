@@ -49,6 +49,7 @@ Master::Master(int nthreads)
     for (int tid = -1; tid < nthreads; tid++) {
         _threads[tid + 1] = new RouterThread(this, tid);
     }
+    _qsbr.initialize(nthreads);
 
 #if CLICK_USERLEVEL
     // signal information
@@ -33,6 +33,7 @@
 #if HAVE_DPDK
 # include <rte_malloc.h>
 # include <click/dpdkdevice.hh>
+# include <click/dpdk_glue.hh>
 #endif
 #if CLICK_PACKET_USE_DPDK
 # include <rte_lcore.h>
@@ -481,10 +482,13 @@ WritablePacket::check_data_pool_size(PacketPool &packet_pool) {
     if (unlikely(packet_pool.pd && packet_pool.pdcount >= CLICK_PACKET_DATA_POOL_SIZE)) {
         packet_pool.pd->set_anno_u32(0, packet_pool.pdcount);
         if (!global_packet_pool.pdbatch.insert(packet_pool.pd)) {
+#if HAVE_DPDK_PACKET_POOL
+            MbufBulkFree mbufs;
+#endif
             while (WritablePacket *pd = packet_pool.pd) {
                 packet_pool.pd = static_cast<WritablePacket *>(pd->next());
 #if HAVE_DPDK_PACKET_POOL
-                rte_pktmbuf_free((struct rte_mbuf*)pd->destructor_argument());
+                mbufs.add((struct rte_mbuf*)pd->destructor_argument());
 #else
 # if HAVE_NETMAP_PACKET_POOL
                 if (NetmapBufQ::is_valid_netmap_packet(pd))
@@ -582,7 +586,22 @@ WritablePacket::recycle_packet_batch(WritablePacket *head, Packet* tail, unsigne
 
     Packet* next = ((head != 0)? head->next() : 0 );
     Packet* p = head;
+#if HAVE_DPDK
+    // Free the mbufs of DPDK buffers by bursts rather than one by one
+    MbufBulkFree mbufs;
+#endif
     for (;p != 0;p=next,next=(p==0?0:p->next())) {
+#if HAVE_DPDK
+        WritablePacket *wp = static_cast<WritablePacket *>(p);
+        if (wp->_head && wp->_destructor == DPDKDevice::free_pkt
+# ifndef CLICK_NOINDIRECT
+            && !wp->_data_packet
+# endif
+            ) {
+            mbufs.add((struct rte_mbuf *) wp->_destructor_argument);
+            wp->_head = 0;
+        }
+#endif
         ((WritablePacket*)p)->~WritablePacket();
     }
     check_packet_pool_size(packet_pool);
@@ -0,0 +1,155 @@
+// -*- c-basic-offset: 4; related-file-name: "../include/click/pathtrace.hh" -*-
+/*
+ * pathtrace.cc -- sampled per-packet path tracing
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include <click/pathtrace.hh>
+#include <click/packet.hh>
+#include <click/packetbatch.hh>
+#include <click/error.hh>
+#include <click/machine.hh>
+CLICK_DECLS
+
+namespace {
+struct Buffer {
+    PathTrace::Record *records;
+    volatile uint64_t written;
+} CLICK_CACHE_ALIGN;
+
+Buffer *buffers = 0;
+int nbuffers = 0;
+unsigned mask = 0;
+}
+
+bool PathTrace::active = false;
+int PathTrace::_anno = 0;
+
+int
+PathTrace::initialize(unsigned capacity, int anno, ErrorHandler *errh)
+{
+    if (buffers)
+	return errh->error("path tracing is already initialized");
+    if (anno < 0 || anno + 4 > Packet::anno_size)
+	return errh->error("bad annotation offset");
+
+    unsigned size = 1;
+    while (size < capacity)
+	size <<= 1;
+    nbuffers = click_max_cpu_ids();
+    buffers = new Buffer[nbuffers];
+    for (int i = 0; i < nbuffers; i++) {
+	buffers[i].records = 0;
+	buffers[i].written = 0;
+    }
+    for (int i = 0; i < nbuffers; i++)
+	if (!(buffers[i].records = new Record[size])) {
+	    cleanup();
+	    return errh->error("out of memory");
+	}
+    mask = size - 1;
+    _anno = anno;
+    return 0;
+}
+
+void
+PathTrace::cleanup()
+{
+    active = false;
+    for (int i = 0; i < nbuffers; i++)
+	delete[] buffers[i].records;
+    delete[] buffers;
+    buffers = 0;
+    nbuffers = 0;
+}
+
+void
+PathTrace::clear()
+{
+    for (int i = 0; i < nbuffers; i++)
+	buffers[i].written = 0;
+}
+
+void
+PathTrace::record(const Element *e, int port, int kind, uint32_t id)
+{
+    int tid = click_current_cpu_id();
+    if ((unsigned) tid >= (unsigned) nbuffers)
+	return;
+    Buffer &b = buffers[tid];
+    Record &r = b.records[b.written & mask];
+    r.cycles = click_get_cycles();
+    r.element = e;
+    r.id = id;
+    r.port = port;
+    r.kind = kind;
+    r.thread = tid;
+    click_write_fence();
+    b.written = b.written + 1;
+}
+
+void
+PathTrace::record_packet(const Element *e, int port, int kind, const Packet *p)
+{
+    if (uint32_t id = p->anno_u32(_anno))
+	record(e, port, kind, id);
+}
+
+#if HAVE_BATCH
+void
+PathTrace::record_batch(const Element *e, int port, int kind, const PacketBatch *batch)
+{
+    for (const Packet *p = batch; p; p = p->next())
+	if (uint32_t id = p->anno_u32(_anno))
+	    record(e, port, kind, id);
+}
+#endif
+
+uint64_t
+PathTrace::written()
+{
+    uint64_t n = 0;
+    for (int i = 0; i < nbuffers; i++)
+	n += buffers[i].written;
+    return n;
+}
+
+static int
+record_compar(const void *a, const void *b, void *)
+{
+    const PathTrace::Record *ra = static_cast<const PathTrace::Record *>(a);
+    const PathTrace::Record *rb = static_cast<const PathTrace::Record *>(b);
+    if (ra->id != rb->id)
+	return ra->id < rb->id ? -1 : 1;
+    if (ra->cycles != rb->cycles)
+	return ra->cycles < rb->cycles ? -1 : 1;
+    return 0;
+}
+
+void
+PathTrace::collect(Vector<Record> &records)
+{
+    records.clear();
+    for (int i = 0; i < nbuffers; i++) {
+	Buffer &b = buffers[i];
+	uint64_t end = b.written;
+	click_read_fence();
+	uint64_t start = end > mask + 1 ? end - mask - 1 : 0;
+	for (uint64_t j = start; j < end; j++)
+	    records.push_back(b.records[j & mask]);
+    }
+    if (records.size())
+	click_qsort(records.begin(), records.size(), sizeof(Record), record_compar);
+}
+
+CLICK_ENDDECLS
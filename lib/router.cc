@@ -35,6 +35,7 @@
 #include <click/notifier.hh>
 #include <click/nameinfo.hh>
 #include <click/bighashmap_arena.hh>
+#include <click/allocator.hh>
 #if HAVE_DPDK_PACKET_POOL
 #include <click/dpdkdevice.hh>
 #endif
@@ -1262,6 +1263,68 @@ Router::InitFuture::post(InitFuture* future) {
 }
 
 
+#if HAVE_BATCH
+/*
+ * Replace linear chains of F-flagged elements by a BatchElement::FusedChain.
+ * A stage is linked to the next one if its output 0 is the only connection
+ * to the input of the next stage. The first stage may have any number of
+ * upstream elements: their ports are redirected to the chain.
+ *
+ * Nothing is fused when ports count packets (CLICK_STATS), as the ports
+ * between stages are skipped.
+ */
+void
+Router::fuse_chains()
+{
+#if CLICK_STATS >= 1
+    return;
+#endif
+    int n = nelements();
+    Vector<int> fusable(n, 0), nin(n, 0), next(n, -1), prev(n, -1);
+
+    for (int i = 0; i < n; i++) {
+        Element *e = _elements[i];
+        fusable[i] = e->flag_value('F') > 0
+            && e->in_batch_mode == Element::BATCH_MODE_YES
+            && e->ninputs() == 1 && e->input_is_push(0)
+            && e->noutputs() >= 1 && e->output_is_push(0);
+    }
+    for (const Connection *c = _conn.begin(); c != _conn.end(); ++c) {
+        if ((*c)[0].port == 0)
+            nin[(*c)[0].idx]++;
+        if ((*c)[1].port == 0)
+            next[(*c)[1].idx] = (*c)[0].idx;
+    }
+    for (int i = 0; i < n; i++) {
+        int j = next[i];
+        if (fusable[i] && j >= 0 && j != i && fusable[j] && nin[j] == 1)
+            prev[j] = i;
+        else
+            next[i] = -1;
+    }
+
+    for (int i = 0; i < n; i++) {
+        if (!fusable[i] || prev[i] >= 0 || next[i] < 0)
+            continue;
+        Vector<BatchElement *> stages;
+        for (int j = i; j >= 0; j = next[j])
+            stages.push_back(static_cast<BatchElement *>(_elements[j]));
+
+        BatchElement::FusedChain *chain = new BatchElement::FusedChain(stages);
+        chain->attach_router(this, i);
+        stages[0]->_fused = chain;
+        for (const Connection *c = _conn.begin(); c != _conn.end(); ++c)
+            if ((*c)[0] == Port(i, 0)) {
+                Element *up = _elements[(*c)[1].idx];
+                up->_ports[1][(*c)[1].port].assign(true, up, chain, 0);
+            }
+# if BATCH_DEBUG
+        click_chatter("Fused %s", chain->unparse().c_str());
+# endif
+    }
+}
+#endif
+
 int
 Router::initialize(ErrorHandler *errh)
 {
@@ -1462,6 +1525,11 @@ Router::initialize(ErrorHandler *errh)
                 x = hard_home_thread_id(i ? _elements[i - 1] : _root_element);
         }
 
+#if HAVE_BATCH
+        if (BatchElement::fusion_enabled)
+            fuse_chains();
+#endif
+
         _state = ROUTER_LIVE;
 #ifdef CLICK_NAMEDB_CHECK
         NameInfo::check(_root_element, errh);
@@ -2440,7 +2508,8 @@ Router::configuration_string() const
 enum { GH_VERSION, GH_CONFIG, GH_FLATCONFIG, GH_LIST, GH_LOAD, GH_LOAD_CYCLES, GH_USEFUL_CYCLES, GH_REQUIREMENTS,
        GH_DRIVER, GH_ACTIVE_PORTS, GH_ACTIVE_PORT_STATS, GH_STRING_PROFILE,
        GH_STRING_PROFILE_LONG, GH_SCHEDULING_PROFILE, GH_STOP,
-       GH_ELEMENT_CYCLES, GH_CLASS_CYCLES, GH_RESET_CYCLES };
+       GH_ELEMENT_CYCLES, GH_CLASS_CYCLES, GH_RESET_CYCLES, GH_SLAB_OCCUPANCY,
+       GH_FUSED_CHAINS };
 
 #if CLICK_STATS >= 2
 struct stats_info {
@@ -2519,6 +2588,17 @@ Router::router_read_handler(Element *e, void *thunk)
         }
         break;
 
+#if HAVE_BATCH
+      case GH_FUSED_CHAINS:
+        if (r)
+            for (int i = 0; i < r->nelements(); i++) {
+                Element *e = r->_elements[i];
+                if (e->flag_value('F') > 0 && static_cast<BatchElement *>(e)->_fused)
+                    sa << static_cast<BatchElement *>(e)->_fused->unparse() << "\n";
+            }
+        break;
+#endif
+
       case GH_REQUIREMENTS:
         if (r)
             for (int i = 0; i < r->_requirements.size(); i++)
@@ -2568,6 +2648,11 @@ Router::router_read_handler(Element *e, void *thunk)
         break;
 #endif
 
+#if CLICK_USERLEVEL
+    case GH_SLAB_OCCUPANCY:
+        return SlabAllocator::occupancy();
+#endif
+
 #if HAVE_STRING_PROFILING
     case GH_STRING_PROFILE:
         String::profile_report(sa);
@@ -2713,12 +2798,18 @@ Router::static_initialize()
         add_read_handler(0, "requirements", router_read_handler, (void *)GH_REQUIREMENTS);
         add_read_handler(0, "handlers", Element::read_handlers_handler, 0);
         add_read_handler(0, "list", router_read_handler, (void *)GH_LIST);
+#if HAVE_BATCH
+        add_read_handler(0, "fused_chains", router_read_handler, (void *)GH_FUSED_CHAINS);
+#endif
 #if HAVE_CLICK_LOAD
         set_handler(0, "load", Handler::h_read | Handler::f_read_param, router_handler, (void *)GH_LOAD, (void *)0);
         set_handler(0, "load_cycles", Handler::h_read | Handler::f_read_param, router_handler, (void *)GH_LOAD_CYCLES, (void *)0);
         set_handler(0, "useful_kcycles", Handler::h_read | Handler::f_read_param, router_handler, (void *)GH_USEFUL_CYCLES, (void *)0);
 #endif
         add_write_handler(0, "stop", router_write_handler, (void *)GH_STOP);
+#if CLICK_USERLEVEL
+        add_read_handler(0, "slab_occupancy", router_read_handler, (void *)GH_SLAB_OCCUPANCY);
+#endif
 #if CLICK_STATS >= 1
         add_read_handler(0, "active_ports", router_read_handler, (void *)GH_ACTIVE_PORTS);
         add_read_handler(0, "active_port_stats", router_read_handler, (void *)GH_ACTIVE_PORT_STATS);
@@ -655,6 +655,8 @@ RouterThread::driver()
 #endif
 
     driver_lock_tasks();
+    if (_id >= 0)
+        _master->qsbr().thread_online(_id);
 
 #if HAVE_ADAPTIVE_SCHEDULER
     client_set_tickets(C_CLICK, DRIVER_TOTAL_TICKETS / 2);
@@ -710,6 +712,10 @@ RouterThread::driver()
             timer_set().run_timers(this, _master);
         } while (0);
 
+        // no task or timer holds references to protected data anymore
+        if (_id >= 0)
+            _master->qsbr().quiescent(_id);
+
         // run operating system
         do {
 #if !HAVE_ADAPTIVE_SCHEDULER && !BSD_NETISRSCHED
@@ -731,6 +737,8 @@ RouterThread::driver()
 #endif
     }
 
+    if (_id >= 0)
+        _master->qsbr().thread_offline(_id);
     driver_unlock_tasks();
 
     _driver_entered = false;
@@ -326,6 +326,22 @@ SelectSet::remove_select(int fd, Element *element, int mask)
     return 0;
 }
 
+// A thread blocked in the kernel holds no reference to QSBR-protected data,
+// so it must not delay grace periods
+static inline void
+qsbr_offline(RouterThread *thread, int delay_type)
+{
+    if (delay_type != 0 && thread->thread_id() >= 0)
+	thread->master()->qsbr().thread_offline(thread->thread_id());
+}
+
+static inline void
+qsbr_online(RouterThread *thread, int delay_type)
+{
+    if (delay_type != 0 && thread->thread_id() >= 0)
+	thread->master()->qsbr().thread_online(thread->thread_id());
+}
+
 inline bool
 SelectSet::post_select(RouterThread *thread, bool acquire)
 {
@@ -400,8 +416,10 @@ SelectSet::run_selects_kqueue(RouterThread *thread)
     thread->set_thread_state_for_blocking(delay_type);
 
     struct kevent kev[256];
+    qsbr_offline(thread, delay_type);
     int n = kevent(_kqueue, 0, 0, &kev[0], 256, wait_ptr);
     int was_errno = errno;
+    qsbr_online(thread, delay_type);
 
     if (post_select(thread, true))
 	return;
@@ -450,8 +468,10 @@ SelectSet::run_selects_poll(RouterThread *thread)
 	timeout = -1;
     thread->set_thread_state_for_blocking(delay_type);
 
+    qsbr_offline(thread, delay_type);
     int n = poll(my_pollfds.begin(), my_pollfds.size(), timeout);
     int was_errno = errno;
+    qsbr_online(thread, delay_type);
 
     if (post_select(thread, true))
 	return;
@@ -506,8 +526,10 @@ SelectSet::run_selects_select(RouterThread *thread)
 	wait_ptr = 0;
     thread->set_thread_state_for_blocking(delay_type);
 
+    qsbr_offline(thread, delay_type);
     int n = select(n_select_fd, &read_mask, &write_mask, (fd_set*) 0, wait_ptr);
     int was_errno = errno;
+    qsbr_online(thread, delay_type);
 
     if (post_select(thread, true))
 	return;
@@ -49,6 +49,7 @@
 #include <click/routerthread.hh>
 #include <click/router.hh>
 #include <click/master.hh>
+#include <click/batchelement.hh>
 #include <click/error.hh>
 #include <click/timer.hh>
 #include <click/straccum.hh>
@@ -86,6 +87,7 @@ CLICK_USING_DECLS
 #define SIMTICK_OPT             321
 #define DPDK_SPLIT_OPT          322
 #define DPDK_NICMEM_OPT         323
+#define FUSE_OPT                324
 
 static const Clp_Option options[] = {
     { "allow-reconfigure", 'R', ALLOW_RECONFIG_OPT, 0, Clp_Negate },
@@ -95,6 +97,7 @@ static const Clp_Option options[] = {
     { "dpdk-split", 0, DPDK_SPLIT_OPT, 0, 0 },
     { "dpdk-nicmem", 0, DPDK_NICMEM_OPT, 0, 0 },
     { "file", 'f', ROUTER_OPT, Clp_ValString, 0 },
+    { "fuse", 0, FUSE_OPT, 0, Clp_Negate },
     { "handler", 'h', HANDLER_OPT, Clp_ValString, 0 },
     { "help", 0, HELP_OPT, 0, 0 },
     { "output", 'o', OUTPUT_OPT, Clp_ValString, 0 },
@@ -161,6 +164,7 @@ Options:\n\
   -q, --quit                    Do not run driver.\n\
   -t, --time                    Print information on how long driver took.\n\
   -w, --no-warnings             Do not print warnings.\n\
+      --fuse                    Fuse linear chains of batch elements.\n\
       --simtime                 Run in simulation time.\n\
       --simtick                 Amount of subseconds to add in warp time.\n\
   -C, --clickpath PATH          Use PATH for CLICKPATH.\n\
@@ -636,6 +640,13 @@ main(int argc, char **argv)
      case NO_WARNINGS_OPT:
       warnings = clp->negated;
       break;
+
+     case FUSE_OPT:
+#if HAVE_BATCH
+      BatchElement::fusion_enabled = !clp->negated;
+#endif
+      break;
+
 #if HAVE_DPDK
      case DPDK_SPLIT_OPT:
       dpdk_split_enabled = true;